@@ -74,7 +74,9 @@ int LNetNIFini(void);
  * \see LNetMEAttach
  * @{ */
 int LNetGetId(unsigned int index, lnet_process_id_t *id);
+int LNetCPTHasNI(int cpt);
 int LNetDist(lnet_nid_t nid, lnet_nid_t *srcnid, __u32 *order);
+int LNetPeerConnStats(lnet_nid_t nid, lnet_conn_stats_t *stats);
 void LNetSnprintHandle(char *str, int str_len, lnet_handle_any_t handle);
 
 /** @} lnet_addr */
@@ -138,6 +138,11 @@ struct lnet_ioctl_peer {
 			__u32 cr_peer_tx_qnob;
 			__u32 cr_ncpt;
 		} pr_peer_credits;
+		struct {
+			__u32 cc_ncpt;
+			__u32 cc_pad;
+			lnet_conn_stats_t cc_stats;
+		} pr_peer_conns;
 	} pr_lnd_u;
 };
 
@@ -81,6 +81,15 @@ static inline int lnet_is_route_alive(lnet_route_t *route)
 	return route->lr_downis == 0;
 }
 
+/* EWMAs give new samples a weight of 1 / (1 << LNET_EWMA_SHIFT) and are
+ * kept scaled by 1 << LNET_EWMA_SHIFT */
+#define LNET_EWMA_SHIFT		3
+
+static inline void lnet_ewma_add(long *avg, long sample)
+{
+	*avg += sample - (*avg >> LNET_EWMA_SHIFT);
+}
+
 static inline int lnet_is_wire_handle_none (lnet_handle_wire_t *wh)
 {
 	return (wh->wh_interface_cookie == LNET_WIRE_HANDLE_COOKIE_NONE &&
@@ -399,8 +408,8 @@ lnet_handle2me(lnet_handle_me_t *handle)
 static inline void
 lnet_peer_addref_locked(lnet_peer_t *lp)
 {
-	LASSERT(lp->lp_refcount > 0);
-	lp->lp_refcount++;
+	LASSERT(atomic_read(&lp->lp_refcount) > 0);
+	atomic_inc(&lp->lp_refcount);
 }
 
 extern void lnet_destroy_peer_locked(lnet_peer_t *lp);
@@ -408,9 +417,8 @@ extern void lnet_destroy_peer_locked(lnet_peer_t *lp);
 static inline void
 lnet_peer_decref_locked(lnet_peer_t *lp)
 {
-	LASSERT(lp->lp_refcount > 0);
-	lp->lp_refcount--;
-	if (lp->lp_refcount == 0)
+	LASSERT(atomic_read(&lp->lp_refcount) > 0);
+	if (atomic_dec_and_test(&lp->lp_refcount))
 		lnet_destroy_peer_locked(lp);
 }
 
@@ -769,10 +777,21 @@ int lnet_net_unique(__u32 net, struct list_head *nilist);
 int lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt);
 lnet_peer_t *lnet_find_peer_locked(struct lnet_peer_table *ptable,
 				   lnet_nid_t nid);
+lnet_peer_t *lnet_find_peer(lnet_nid_t nid, int cpt);
 void lnet_peer_tables_cleanup(lnet_ni_t *ni);
 void lnet_peer_tables_destroy(void);
 int lnet_peer_tables_create(void);
 void lnet_debug_peer(lnet_nid_t nid);
+int lnet_peer_rails_create(void);
+void lnet_peer_rails_destroy(void);
+struct lnet_peer_rail *lnet_peer_rail_find_locked(lnet_nid_t nid);
+int lnet_peer_rail_add(lnet_nid_t primary, lnet_nid_t rail);
+void lnet_peer_rail_learn(lnet_nid_t primary, lnet_nid_t rail);
+int lnet_peer_rail_discovery_start(void);
+void lnet_peer_rail_discovery_stop(void);
+lnet_nid_t lnet_peer_rail_select_locked(lnet_nid_t nid, int cpt,
+					lnet_nid_t *self);
+int lnet_parse_peer_rails(char *str);
 int lnet_get_peer_info(__u32 peer_index, __u64 *nid,
 		       char alivness[LNET_MAX_STR_LEN],
 		       __u32 *cpt_iter, __u32 *refcount,
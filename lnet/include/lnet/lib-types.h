@@ -43,6 +43,7 @@
 #endif
 
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/uio.h>
 #include <linux/types.h>
 
@@ -126,6 +127,13 @@ typedef struct lnet_libhandle {
 #define lh_entry(ptr, type, member) \
 	((type *)((char *)(ptr)-(char *)(&((type *)0)->member)))
 
+/* per-CPT delivery statistics of an EQ, protected by lnet_res_lock(cpt) */
+typedef struct lnet_eq_stats {
+	__u64			es_events;	/* events delivered */
+	__u64			es_queued;	/* events stored for polling */
+	__u64			es_contended;	/* lnet_eq_wait_lock was busy */
+} lnet_eq_stats_t;
+
 typedef struct lnet_eq {
 	struct list_head	eq_list;
 	lnet_libhandle_t	eq_lh;
@@ -135,6 +143,7 @@ typedef struct lnet_eq {
 	lnet_eq_handler_t	eq_callback;
 	lnet_event_t		*eq_events;
 	int			**eq_refs;	/* percpt refcount for EQ */
+	lnet_eq_stats_t		**eq_stats;	/* percpt delivery stats */
 } lnet_eq_t;
 
 typedef struct lnet_me {
@@ -246,6 +255,11 @@ typedef struct lnet_lnd
 	/* query of peer aliveness */
 	void (*lnd_query)(struct lnet_ni *ni, lnet_nid_t peer, cfs_time_t *when);
 
+	/* query of connection statistics; optional, may sleep. Return
+	 * -ENOENT if not connected to the peer */
+	int (*lnd_conn_stats)(struct lnet_ni *ni, lnet_nid_t peer,
+			      lnet_conn_stats_t *stats);
+
 	/* accept a new connection */
 	int (*lnd_accept)(struct lnet_ni *ni, struct socket *sock);
 } lnd_t;
@@ -346,6 +360,8 @@ typedef struct lnet_peer {
 	unsigned int		lp_notifylnd:1;
 	/* some thread is handling notification */
 	unsigned int		lp_notifying:1;
+	/* removed from the peer hash, RCU lookups may still find it */
+	unsigned int		lp_unhashed:1;
 	/* SEND event outstanding from ping */
 	unsigned int		lp_ping_notsent;
 	/* # times router went dead<->alive */
@@ -362,10 +378,17 @@ typedef struct lnet_peer {
 	cfs_time_t		lp_last_alive;
 	/* when lp_ni was queried last time */
 	cfs_time_t		lp_last_query;
+	/* when the outstanding router ping was sent */
+	ktime_t			lp_ping_sent;
+	/* EWMA of router ping round trip time in usecs, 0 until the first
+	 * reply, scaled by 1 << LNET_EWMA_SHIFT */
+	long			lp_rtt_avg;
+	/* EWMA of lp_txcredits sampled at route selection, scaled too */
+	long			lp_txcredits_avg;
 	/* interface peer is on */
 	lnet_ni_t		*lp_ni;
 	lnet_nid_t		lp_nid;		/* peer's NID */
-	int			lp_refcount;	/* # refs */
+	atomic_t		lp_refcount;	/* # refs */
 	int			lp_cpt;		/* CPT this peer attached on */
 	/* # refs from lnet_route_t::lr_gateway */
 	int			lp_rtr_refcount;
@@ -373,6 +396,7 @@ typedef struct lnet_peer {
 	unsigned int		lp_ping_feats;
 	struct list_head	lp_routes;	/* routers on this peer */
 	lnet_rc_data_t		*lp_rcd;	/* router checker state */
+	struct rcu_head		lp_rcu;		/* deferred free */
 } lnet_peer_t;
 
 /* peer hash size */
@@ -383,10 +407,39 @@ typedef struct lnet_peer {
 struct lnet_peer_table {
 	int			pt_version;	/* /proc validity stamp */
 	int			pt_number;	/* # peers extant */
-	int			pt_zombies;	/* # zombies to go to deathrow
-						 * (and not there yet) */
-	struct list_head	pt_deathrow;	/* zombie peers */
-	struct list_head	*pt_hash;	/* NID->peer hash */
+	int			pt_zombies;	/* # unhashed peers not yet
+						 * destroyed */
+	/* NID->peer hash, changed under lnet_net_lock(cpt) and walked
+	 * either under that lock or under RCU */
+	struct list_head	*pt_hash;
+};
+
+/* max # NIDs a multi-rail peer can be reached through, including its primary */
+#define LNET_PEER_RAILS_MAX	8
+
+/* A peer node with NIs on several of our local networks. Upper layers always
+ * address it by its primary NID; each message is sent on one of its rails. */
+struct lnet_peer_rail {
+	/* chain on ln_peer_rails */
+	struct list_head	lpr_list;
+	/* NID the peer is known by */
+	lnet_nid_t		lpr_primary;
+	/* # valid entries in lpr_rails[] */
+	int			lpr_nrails;
+	/* rotor to spread messages over equally loaded rails */
+	atomic_t		lpr_rotor;
+	/* rails, [0] is the primary NID */
+	lnet_nid_t		lpr_rails[LNET_PEER_RAILS_MAX];
+	/* # messages sent on each rail */
+	atomic_t		lpr_nsent[LNET_PEER_RAILS_MAX];
+	/* discovery ping to the primary NID in flight */
+	int			lpr_pinging;
+	/* MD of that ping, valid once it has been sent */
+	lnet_handle_md_t	lpr_mdh;
+	/* reply buffer of the discovery ping */
+	lnet_ping_info_t	*lpr_pinginfo;
+	/* when the primary NID was last pinged */
+	cfs_time_t		lpr_ping_time;
 };
 
 /* peer aliveness is enabled only on routers for peers in a network where the
@@ -399,7 +452,7 @@ typedef struct {
 	struct list_head	lr_gwlist;	/* chain on gateway */
 	lnet_peer_t		*lr_gateway;	/* router node */
 	__u32			lr_net;		/* remote network number */
-	int			lr_seq;		/* sequence for round-robin */
+	unsigned long		lr_nselected;	/* # times picked for a msg */
 	unsigned int		lr_downis;	/* number of down NIs */
 	__u32			lr_hops;	/* how far I am */
 	unsigned int		lr_priority;	/* route priority */
@@ -593,6 +646,15 @@ typedef struct
 	struct lnet_msg_container	**ln_msg_containers;
 	lnet_counters_t			**ln_counters;
 	struct lnet_peer_table		**ln_peer_tables;
+	/* multi-rail peers hashed by primary NID, changed under
+	 * LNET_LOCK_EX and read under any single CPT lock */
+	struct list_head		*ln_peer_rails;
+	/* # multi-rail peers */
+	int				ln_npeer_rails;
+	/* event queue of rail discovery pings */
+	lnet_handle_eq_t		ln_rail_eqh;
+	/* # rail discovery pings not unlinked yet */
+	atomic_t			ln_rail_npings;
 	/* failure simulation */
 	struct list_head		ln_test_peers;
 	struct list_head		ln_drop_rules;
@@ -39,9 +39,11 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_PROFILE	(1 << 1)	/* workload profiles, latency */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_PROFILE)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -468,7 +470,8 @@ typedef struct {
 
 typedef enum {
 	LST_BRW_READ	= 1,
-	LST_BRW_WRITE	= 2
+	LST_BRW_WRITE	= 2,
+	LST_BRW_MIX	= 3	/* reads and writes, see blk_write_pct */
 } lst_brw_type_t;
 
 typedef enum {
@@ -484,6 +487,9 @@ typedef struct {
 	int			blk_flags;		/* reserved flags */
 	int			blk_cli_off;		/* bulk offset on client */
 	int			blk_srv_off;		/* reserved: bulk offset on server */
+	int			blk_size_max;		/* sizes vary in [blk_size, blk_size_max] */
+	int			blk_write_pct;		/* % of writes for LST_BRW_MIX */
+	int			blk_think;		/* usecs between two RPCs */
 } lst_test_bulk_param_t;
 
 typedef struct {
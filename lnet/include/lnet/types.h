@@ -238,6 +238,16 @@ typedef struct lnet_counters {
 	__u64	drop_length;
 } WIRE_ATTR lnet_counters_t;
 
+/* An LND's view of its connections to a peer, see LNetPeerConnStats() */
+typedef struct lnet_conn_stats {
+	__u32	lcs_nconns;	/* # connections */
+	__u32	lcs_rtt;	/* smoothed round trip time (usecs), 0 unknown */
+	__u32	lcs_rttvar;	/* its mean deviation (usecs) */
+	__u32	lcs_txq;	/* # messages waiting to go on the wire */
+	__u64	lcs_stall;	/* usecs spent unable to send (no credits or
+				 * no buffer space) */
+} WIRE_ATTR lnet_conn_stats_t;
+
 #define LNET_NI_STATUS_UP	0x15aac0de
 #define LNET_NI_STATUS_DOWN	0xdeadface
 #define LNET_NI_STATUS_INVALID	0x00000000
@@ -411,6 +421,12 @@ typedef struct {
 	 * - LNET_MD_IOVEC: The start and length fields specify an array of
 	 *   struct iovec.
 	 * - LNET_MD_MAX_SIZE: The max_size field is valid.
+	 * - LNET_MD_PAGE_LOAN: With LNET_MD_KIOV, whole pages of this MD may
+	 *   be exchanged with those of another MD on the same node which
+	 *   also allows it, instead of being copied. The exchange updates
+	 *   the lnet_kiov_t array passed in \a start, so the owner must
+	 *   release the pages found there after the MD is unlinked. Once a
+	 *   send from such an MD has completed, its contents are undefined.
 	 *
 	 * Note:
 	 * - LNET_MD_KIOV or LNET_MD_IOVEC allows for a scatter/gather
@@ -464,6 +480,8 @@ typedef struct {
 #define LNET_MD_MAX_SIZE	     (1 << 7)
 /** See lnet_md_t::options. */
 #define LNET_MD_KIOV		     (1 << 8)
+/** See lnet_md_t::options. */
+#define LNET_MD_PAGE_LOAN	     (1 << 9)
 
 /* For compatibility with Cray Portals */
 #define LNET_MD_PHYS			     0
@@ -35,6 +35,8 @@
  */
 
 #include <asm/page.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include "o2iblnd.h"
 
 static lnd_t the_o2iblnd;
@@ -1169,6 +1171,61 @@ kiblnd_query(lnet_ni_t *ni, lnet_nid_t nid, cfs_time_t *when)
 	return;
 }
 
+int
+kiblnd_conn_stats(lnet_ni_t *ni, lnet_nid_t nid, lnet_conn_stats_t *stats)
+{
+	rwlock_t	*glock = &kiblnd_data.kib_global_lock;
+	kib_peer_t	*peer;
+	kib_conn_t	*conn;
+	kib_tx_t	*tx;
+	unsigned long	flags;
+
+	read_lock_irqsave(glock, flags);
+
+	peer = kiblnd_find_peer_locked(nid);
+	if (peer == NULL || list_empty(&peer->ibp_conns)) {
+		read_unlock_irqrestore(glock, flags);
+		return -ENOENT;
+	}
+
+	/* waiting for a connection */
+	list_for_each_entry(tx, &peer->ibp_tx_queue, tx_list)
+		stats->lcs_txq++;
+
+	list_for_each_entry(conn, &peer->ibp_conns, ibc_list) {
+		spin_lock(&conn->ibc_lock);
+
+		list_for_each_entry(tx, &conn->ibc_tx_noops, tx_list)
+			stats->lcs_txq++;
+		list_for_each_entry(tx, &conn->ibc_tx_queue, tx_list)
+			stats->lcs_txq++;
+		list_for_each_entry(tx, &conn->ibc_tx_queue_nocred, tx_list)
+			stats->lcs_txq++;
+		list_for_each_entry(tx, &conn->ibc_tx_queue_rsrvd, tx_list)
+			stats->lcs_txq++;
+
+		stats->lcs_stall += conn->ibc_stall;
+		if (ktime_to_ns(conn->ibc_stalled) != 0)
+			stats->lcs_stall +=
+				ktime_us_delta(ktime_get(), conn->ibc_stalled);
+
+		/* report the slowest connection */
+		if ((conn->ibc_rtt >> LNET_EWMA_SHIFT) > stats->lcs_rtt) {
+			stats->lcs_rtt = conn->ibc_rtt >> LNET_EWMA_SHIFT;
+			stats->lcs_rttvar = conn->ibc_rttvar >>
+					    LNET_EWMA_SHIFT;
+		}
+
+		spin_unlock(&conn->ibc_lock);
+
+		stats->lcs_nconns++;
+	}
+
+	read_unlock_irqrestore(glock, flags);
+
+	return 0;
+}
+
 static void
 kiblnd_free_pages(kib_pages_t *p)
 {
@@ -1403,6 +1460,9 @@ kiblnd_find_rd_dma_mr(struct lnet_ni *ni, kib_rdma_desc_t *rd,
 	return hdev->ibh_mrs;
 }
 
+/* room for the pages of a cached FastReg registration */
+#define KIBLND_FRD_PAGES_SIZE	(sizeof(__u64) * (LNET_MAX_PAYLOAD / PAGE_SIZE))
+
 static void
 kiblnd_destroy_fmr_pool(kib_fmr_pool_t *fpo)
 {
@@ -1422,6 +1482,9 @@ kiblnd_destroy_fmr_pool(kib_fmr_pool_t *fpo)
 			ib_free_fast_reg_page_list(frd->frd_frpl);
 #endif
 			ib_dereg_mr(frd->frd_mr);
+			if (frd->frd_pages)
+				LIBCFS_FREE(frd->frd_pages,
+					    KIBLND_FRD_PAGES_SIZE);
 			LIBCFS_FREE(frd, sizeof(*frd));
 			i++;
 		}
@@ -1508,6 +1571,18 @@ static int kiblnd_alloc_freg_pool(kib_fmr_poolset_t *fps, kib_fmr_pool_t *fpo)
 			goto out;
 		}
 		frd->frd_mr = NULL;
+		frd->frd_pool = fpo;
+		INIT_LIST_HEAD(&frd->frd_hash);
+
+		if (fps->fps_cache) {
+			LIBCFS_CPT_ALLOC(frd->frd_pages, lnet_cpt_table(),
+					 fps->fps_cpt, KIBLND_FRD_PAGES_SIZE);
+			if (!frd->frd_pages) {
+				CERROR("Failed to allocate registration cache key\n");
+				rc = -ENOMEM;
+				goto out_middle;
+			}
+		}
 
 #ifndef HAVE_IB_MAP_MR_SG
 		frd->frd_frpl = ib_alloc_fast_reg_page_list(fpo->fpo_hdev->ibh_ibdev,
@@ -1551,6 +1626,8 @@ out_middle:
 	if (frd->frd_frpl)
 		ib_free_fast_reg_page_list(frd->frd_frpl);
 #endif
+	if (frd->frd_pages)
+		LIBCFS_FREE(frd->frd_pages, KIBLND_FRD_PAGES_SIZE);
 	LIBCFS_FREE(frd, sizeof(*frd));
 
 out:
@@ -1561,6 +1638,8 @@ out:
 		ib_free_fast_reg_page_list(frd->frd_frpl);
 #endif
 		ib_dereg_mr(frd->frd_mr);
+		if (frd->frd_pages)
+			LIBCFS_FREE(frd->frd_pages, KIBLND_FRD_PAGES_SIZE);
 		LIBCFS_FREE(frd, sizeof(*frd));
 	}
 
@@ -1644,6 +1723,47 @@ out_dev_attr:
 	return rc;
 }
 
+static inline struct list_head *
+kiblnd_fmr_cache_bucket(kib_fmr_poolset_t *fps, __u64 addr, int npages)
+{
+	return &fps->fps_cache_hash[hash_64(addr + npages,
+					    IBLND_FMR_CACHE_HASH_BITS)];
+}
+
+/* Find an idle FastReg descriptor whose registration covers exactly these
+ * pages. Caller holds fps_lock */
+static struct kib_fast_reg_descriptor *
+kiblnd_fmr_cache_lookup(kib_fmr_poolset_t *fps, __u64 *pages, int npages,
+			__u64 addr, __u32 nob, __u64 iov)
+{
+	struct kib_fast_reg_descriptor *frd;
+
+	list_for_each_entry(frd, kiblnd_fmr_cache_bucket(fps, addr, npages),
+			    frd_hash) {
+		if (frd->frd_addr == addr && frd->frd_npages == npages &&
+		    frd->frd_nob == nob && frd->frd_iova == iov &&
+		    memcmp(frd->frd_pages, pages,
+			   sizeof(*pages) * npages) == 0)
+			return frd;
+	}
+
+	return NULL;
+}
+
+/* Forget the registrations cached by the idle descriptors of @fpo, which
+ * is failed or about to be destroyed. Caller holds fps_lock */
+static void
+kiblnd_fmr_pool_uncache(kib_fmr_pool_t *fpo)
+{
+	struct kib_fast_reg_descriptor *frd;
+
+	if (fpo->fpo_is_fmr)
+		return;
+
+	list_for_each_entry(frd, &fpo->fast_reg.fpo_pool_list, frd_list)
+		list_del_init(&frd->frd_hash);
+}
+
 static void
 kiblnd_fail_fmr_poolset(kib_fmr_poolset_t *fps, struct list_head *zombies)
 {
@@ -1656,6 +1776,7 @@ kiblnd_fail_fmr_poolset(kib_fmr_poolset_t *fps, struct list_head *zombies)
 		kib_fmr_pool_t *fpo = list_entry(fps->fps_pool_list.next,
                                                  kib_fmr_pool_t, fpo_list);
 		fpo->fpo_failed = 1;
+		kiblnd_fmr_pool_uncache(fpo);
 		list_del(&fpo->fpo_list);
 		if (fpo->fpo_map_count == 0)
 			list_add(&fpo->fpo_list, zombies);
@@ -1682,6 +1803,7 @@ kiblnd_init_fmr_poolset(kib_fmr_poolset_t *fps, int cpt, int ncpts,
 {
 	kib_fmr_pool_t *fpo;
 	int		rc;
+	int		i;
 
 	memset(fps, 0, sizeof(kib_fmr_poolset_t));
 
@@ -1695,6 +1817,8 @@ kiblnd_init_fmr_poolset(kib_fmr_poolset_t *fps, int cpt, int ncpts,
 	spin_lock_init(&fps->fps_lock);
 	INIT_LIST_HEAD(&fps->fps_pool_list);
 	INIT_LIST_HEAD(&fps->fps_failed_pool_list);
+	for (i = 0; i < ARRAY_SIZE(fps->fps_cache_hash); i++)
+		INIT_LIST_HEAD(&fps->fps_cache_hash[i]);
 
 	rc = kiblnd_create_fmr_pool(fps, &fpo);
 	if (rc == 0)
@@ -1766,6 +1890,18 @@ kiblnd_fmr_pool_unmap(kib_fmr_t *fmr, int status)
 		if (frd) {
 			frd->frd_valid = false;
 			spin_lock(&fps->fps_lock);
+			/* Lazy invalidation: a local registration (the only
+			 * kind with frd_npages set) stays valid for the next
+			 * map of the same pages, and is invalidated
+			 * only when the descriptor is taken for others.  The
+			 * free list is FIFO so that's the least recently used
+			 * one. */
+			if (frd->frd_npages != 0 && status == 0 &&
+			    !fpo->fpo_failed)
+				list_add(&frd->frd_hash,
+					 kiblnd_fmr_cache_bucket(fps,
+						frd->frd_addr,
+						frd->frd_npages));
 			list_add_tail(&frd->frd_list, &fpo->fast_reg.fpo_pool_list);
 			spin_unlock(&fps->fps_lock);
 			fmr->fmr_frd = NULL;
@@ -1782,6 +1918,7 @@ kiblnd_fmr_pool_unmap(kib_fmr_t *fmr, int status)
 			continue;
 
 		if (kiblnd_fmr_pool_is_idle(fpo, now)) {
+			kiblnd_fmr_pool_uncache(fpo);
 			list_move(&fpo->fpo_list, &zombies);
 			fps->fps_version++;
 		}
@@ -1792,21 +1929,64 @@ kiblnd_fmr_pool_unmap(kib_fmr_t *fmr, int status)
 		kiblnd_destroy_fmr_pool_list(&zombies);
 }
 
+/* Account a successful map, which has waited for a free MR since @busy
+ * unless that's zero. Caller holds fps_lock */
+static void
+kiblnd_fmr_map_done(kib_fmr_poolset_t *fps, ktime_t busy)
+{
+	fps->fps_nmap++;
+	if (ktime_to_ns(busy) != 0)
+		fps->fps_grow_wait += ktime_us_delta(ktime_get(), busy);
+}
+
 int
 kiblnd_fmr_pool_map(kib_fmr_poolset_t *fps, kib_tx_t *tx, kib_rdma_desc_t *rd,
 		    __u32 nob, __u64 iov, kib_fmr_t *fmr)
 {
 	kib_fmr_pool_t *fpo;
+	struct kib_fast_reg_descriptor *frd;
 	__u64 *pages = tx->tx_pages;
+	__u64 addr = rd->rd_frags[0].rf_addr;
 	__u64 version;
+	ktime_t busy = ktime_set(0, 0);
 	bool is_rx = (rd != tx->tx_rd);
 	bool tx_pages_mapped = 0;
 	int npages = 0;
 	int rc;
 
+	/* Only local registrations are cached: a sink's rkey has been given
+	 * to a peer, so it must be invalidated on unmap to fence any stale
+	 * RDMA from it. */
+	if (fps->fps_cache && !is_rx) {
+		/* the pages are the key of cached FastReg registrations */
+		npages = kiblnd_map_tx_pages(tx, rd);
+		tx_pages_mapped = 1;
+	}
+
 again:
 	spin_lock(&fps->fps_lock);
 	version = fps->fps_version;
+
+	frd = !tx_pages_mapped ? NULL :
+	      kiblnd_fmr_cache_lookup(fps, pages, npages, addr, nob, iov);
+	if (frd) {
+		fpo = frd->frd_pool;
+		list_del_init(&frd->frd_hash);
+		list_del(&frd->frd_list);
+		fpo->fpo_deadline = cfs_time_shift(IBLND_POOL_DEADLINE);
+		fpo->fpo_map_count++;
+		fps->fps_ncached++;
+		kiblnd_fmr_map_done(fps, busy);
+		spin_unlock(&fps->fps_lock);
+
+		frd->frd_reused = true;
+		fmr->fmr_key  = is_rx ? frd->frd_mr->rkey : frd->frd_mr->lkey;
+		fmr->fmr_frd  = frd;
+		fmr->fmr_pfmr = NULL;
+		fmr->fmr_pool = fpo;
+		return 0;
+	}
+
 	list_for_each_entry(fpo, &fps->fps_pool_list, fpo_list) {
 		fpo->fpo_deadline = cfs_time_shift(IBLND_POOL_DEADLINE);
 		fpo->fpo_map_count++;
@@ -1824,6 +2004,10 @@ again:
 			pfmr = ib_fmr_pool_map_phys(fpo->fmr.fpo_fmr_pool,
 						    pages, npages, iov);
 			if (likely(!IS_ERR(pfmr))) {
+				spin_lock(&fps->fps_lock);
+				kiblnd_fmr_map_done(fps, busy);
+				spin_unlock(&fps->fps_lock);
+
 				fmr->fmr_key  = is_rx ? pfmr->fmr->rkey
 						      : pfmr->fmr->lkey;
 				fmr->fmr_frd  = NULL;
@@ -1834,7 +2018,6 @@ again:
 			rc = PTR_ERR(pfmr);
 		} else {
 			if (!list_empty(&fpo->fast_reg.fpo_pool_list)) {
-				struct kib_fast_reg_descriptor *frd;
 #ifdef HAVE_IB_MAP_MR_SG
 				struct ib_reg_wr *wr;
 				int n;
@@ -1848,8 +2031,14 @@ again:
 							struct kib_fast_reg_descriptor,
 							frd_list);
 				list_del(&frd->frd_list);
+				/* evict whatever it has cached */
+				list_del_init(&frd->frd_hash);
+				kiblnd_fmr_map_done(fps, busy);
 				spin_unlock(&fps->fps_lock);
 
+				frd->frd_reused = false;
+				frd->frd_npages = 0;
+
 #ifndef HAVE_IB_MAP_MR_SG
 				frpl = frd->frd_frpl;
 #endif
@@ -1896,8 +2085,9 @@ again:
 				wr->wr.send_flags = 0;
 				wr->mr = mr;
 				wr->key = is_rx ? mr->rkey : mr->lkey;
-				wr->access = (IB_ACCESS_LOCAL_WRITE |
-					      IB_ACCESS_REMOTE_WRITE);
+				wr->access = is_rx ? (IB_ACCESS_LOCAL_WRITE |
+						      IB_ACCESS_REMOTE_WRITE) :
+						     IB_ACCESS_LOCAL_WRITE;
 #else
 				if (!tx_pages_mapped) {
 					npages = kiblnd_map_tx_pages(tx, rd);
@@ -1922,11 +2112,23 @@ again:
 				wr->wr.wr.fast_reg.length = nob;
 				wr->wr.wr.fast_reg.rkey =
 						is_rx ? mr->rkey : mr->lkey;
-				wr->wr.wr.fast_reg.access_flags =
+				wr->wr.wr.fast_reg.access_flags = is_rx ?
 						(IB_ACCESS_LOCAL_WRITE |
-						 IB_ACCESS_REMOTE_WRITE);
+						 IB_ACCESS_REMOTE_WRITE) :
+						IB_ACCESS_LOCAL_WRITE;
 #endif
 
+				if (frd->frd_pages && !is_rx) {
+					LASSERT(npages <=
+						LNET_MAX_PAYLOAD / PAGE_SIZE);
+					memcpy(frd->frd_pages, pages,
+					       sizeof(*pages) * npages);
+					frd->frd_npages = npages;
+					frd->frd_addr   = addr;
+					frd->frd_iova   = iov;
+					frd->frd_nob    = nob;
+				}
+
 				fmr->fmr_key  = is_rx ? mr->rkey : mr->lkey;
 				fmr->fmr_frd  = frd;
 				fmr->fmr_pfmr = NULL;
@@ -1934,7 +2136,7 @@ again:
 				return 0;
 			}
 			spin_unlock(&fps->fps_lock);
-			rc = -EBUSY;
+			rc = -EAGAIN;
 		}
 
 		spin_lock(&fps->fps_lock);
@@ -1951,6 +2153,12 @@ again:
 		}
 	}
 
+	if (ktime_to_ns(busy) == 0) {
+		/* every pool is exhausted */
+		busy = ktime_get();
+		fps->fps_nbusy++;
+	}
+
 	if (fps->fps_increasing) {
 		spin_unlock(&fps->fps_lock);
 		CDEBUG(D_NET, "Another thread is allocating new "
@@ -1975,6 +2183,7 @@ again:
 	fps->fps_increasing = 0;
 	if (rc == 0) {
 		fps->fps_version++;
+		fps->fps_ngrow++;
 		list_add_tail(&fpo->fpo_list, &fps->fps_pool_list);
 	} else {
 		fps->fps_next_retry = cfs_time_shift(IBLND_POOL_RETRY);
@@ -3260,13 +3469,108 @@ static lnd_t the_o2iblnd = {
 	.lnd_shutdown	= kiblnd_shutdown,
 	.lnd_ctl	= kiblnd_ctl,
 	.lnd_query	= kiblnd_query,
+	.lnd_conn_stats	= kiblnd_conn_stats,
 	.lnd_send	= kiblnd_send,
 	.lnd_recv	= kiblnd_recv,
 };
 
+#define KIBLND_PROC_FMR_POOLS	"fmr_pools"
+
+static struct proc_dir_entry *kiblnd_proc_root;
+
+static int
+kiblnd_fmr_pools_seq_show(struct seq_file *s, void *v)
+{
+	kib_dev_t		*dev;
+	kib_net_t		*net;
+	kib_fmr_poolset_t	*fps;
+	kib_fmr_pool_t		*fpo;
+	unsigned long		 flags;
+	int			 npools;
+	int			 i;
+
+	seq_printf(s, "%-12s %3s %5s %10s %10s %8s %6s %12s\n",
+		   "dev", "cpt", "pools", "maps", "cached", "busy", "grown",
+		   "wait_us");
+
+	read_lock_irqsave(&kiblnd_data.kib_global_lock, flags);
+	list_for_each_entry(dev, &kiblnd_data.kib_devs, ibd_list) {
+		list_for_each_entry(net, &dev->ibd_nets, ibn_list) {
+			/* the pools are going away */
+			if (net->ibn_shutdown || net->ibn_fmr_ps == NULL)
+				continue;
+
+			cfs_percpt_for_each(fps, i, net->ibn_fmr_ps) {
+				spin_lock(&fps->fps_lock);
+				npools = 0;
+				list_for_each_entry(fpo, &fps->fps_pool_list,
+						    fpo_list)
+					npools++;
+				seq_printf(s, "%-12s %3d %5d %10llu %10llu "
+					   "%8llu %6llu %12llu\n",
+					   dev->ibd_ifname, i, npools,
+					   fps->fps_nmap, fps->fps_ncached,
+					   fps->fps_nbusy, fps->fps_ngrow,
+					   fps->fps_grow_wait);
+				spin_unlock(&fps->fps_lock);
+			}
+		}
+	}
+	read_unlock_irqrestore(&kiblnd_data.kib_global_lock, flags);
+
+	return 0;
+}
+
+static int
+kiblnd_fmr_pools_seq_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, kiblnd_fmr_pools_seq_show, NULL);
+}
+
+static const struct file_operations kiblnd_fmr_pools_fops = {
+	.owner   = THIS_MODULE,
+	.open    = kiblnd_fmr_pools_seq_open,
+	.read    = seq_read,
+	.llseek  = seq_lseek,
+	.release = single_release,
+};
+
+static void
+kiblnd_proc_init(void)
+{
+	struct proc_dir_entry *pde;
+
+	kiblnd_proc_root = proc_mkdir(libcfs_lnd2modname(O2IBLND), NULL);
+	if (kiblnd_proc_root == NULL) {
+		CERROR("couldn't create proc dir %s\n",
+		       libcfs_lnd2modname(O2IBLND));
+		return;
+	}
+
+	pde = proc_create(KIBLND_PROC_FMR_POOLS, 0444, kiblnd_proc_root,
+			  &kiblnd_fmr_pools_fops);
+	if (pde == NULL) {
+		CERROR("couldn't create proc entry %s\n",
+		       KIBLND_PROC_FMR_POOLS);
+		remove_proc_entry(libcfs_lnd2modname(O2IBLND), NULL);
+		kiblnd_proc_root = NULL;
+	}
+}
+
+static void
+kiblnd_proc_fini(void)
+{
+	if (kiblnd_proc_root == NULL)
+		return;
+
+	remove_proc_entry(KIBLND_PROC_FMR_POOLS, kiblnd_proc_root);
+	remove_proc_entry(libcfs_lnd2modname(O2IBLND), NULL);
+}
+
 static void __exit ko2iblnd_exit(void)
 {
 	lnet_unregister_lnd(&the_o2iblnd);
+	kiblnd_proc_fini();
 }
 
 static int __init ko2iblnd_init(void)
@@ -3286,6 +3590,7 @@ static int __init ko2iblnd_init(void)
 		return rc;
 
 	lnet_register_lnd(&the_o2iblnd);
+	kiblnd_proc_init();
 
 	return 0;
 }
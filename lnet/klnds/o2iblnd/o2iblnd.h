@@ -57,6 +57,7 @@
 #include <linux/file.h>
 #include <linux/stat.h>
 #include <linux/list.h>
+#include <linux/hash.h>
 #include <linux/kmod.h>
 #include <linux/sysctl.h>
 #include <linux/pci.h>
@@ -145,6 +146,8 @@ extern kib_tunables_t  kiblnd_tunables;
 #define IBLND_TX_POOL			256
 #define IBLND_FMR_POOL			256
 #define IBLND_FMR_POOL_FLUSH		192
+/* # buckets (log2) of the FastReg registration cache */
+#define IBLND_FMR_CACHE_HASH_BITS	8
 
 /* RX messages (per connection) */
 #define IBLND_RX_MSGS(c)	\
@@ -304,6 +307,15 @@ typedef struct
 	int			fps_increasing;
 	/* time stamp for retry if failed to allocate */
 	cfs_time_t		fps_next_retry;
+	/* idle FastReg descriptors whose registration is still valid, hashed
+	 * by the pages they cover (if fps_cache) */
+	struct list_head	fps_cache_hash[1 << IBLND_FMR_CACHE_HASH_BITS];
+	/* pool pressure statistics, under fps_lock */
+	__u64			fps_nmap;		/* # maps */
+	__u64			fps_ncached;		/* # maps of cached regs */
+	__u64			fps_nbusy;		/* # maps finding no MR */
+	__u64			fps_ngrow;		/* # pools allocated */
+	__u64			fps_grow_wait;		/* usecs waiting for MRs */
 } kib_fmr_poolset_t;
 
 #ifndef HAVE_IB_RDMA_WR
@@ -323,9 +335,20 @@ struct kib_fast_reg_descriptor { /* For fast registration */
 #endif
 	struct ib_mr			*frd_mr;
 	bool				 frd_valid;
+	/* registration is reused as is, nothing to post */
+	bool				 frd_reused;
+	struct kib_fmr_pool		*frd_pool;	/* owner */
+	/* chain on fps_cache_hash while idle and cached */
+	struct list_head		 frd_hash;
+	/* what is registered, if caching: 0 frd_npages means nothing */
+	__u64				*frd_pages;
+	int				 frd_npages;
+	__u64				 frd_addr;	/* first byte */
+	__u64				 frd_iova;
+	__u32				 frd_nob;
 };
 
-typedef struct
+typedef struct kib_fmr_pool
 {
 	struct list_head	fpo_list;	/* chain on pool list */
 	struct kib_hca_dev     *fpo_hdev;	/* device for this pool */
@@ -599,6 +622,8 @@ typedef struct kib_tx                           /* transmit message */
 	int			tx_status;
 	/* completion deadline */
 	unsigned long		tx_deadline;
+	/* when last posted, to time its completion */
+	ktime_t			tx_posted;
 	/* completion cookie */
 	__u64			tx_cookie;
 	/* lnet msgs to finalize on completion */
@@ -681,6 +706,14 @@ typedef struct kib_conn
 	unsigned int		ibc_ready:1;
 	/* time of last send */
 	unsigned long		ibc_last_send;
+	/* smoothed send completion time (usecs), scaled, 0 until known */
+	long			ibc_rtt;
+	/* its mean deviation (usecs), scaled */
+	long			ibc_rttvar;
+	/* when sends ran out of credits, 0 if they haven't */
+	ktime_t			ibc_stalled;
+	/* total usecs sends have been out of credits */
+	__u64			ibc_stall;
 	/** link chain for kiblnd_check_conns only */
 	struct list_head	ibc_connd_list;
 	/** rxs completed before ESTABLISHED */
@@ -1185,6 +1218,7 @@ bool kiblnd_reconnect_peer(kib_peer_t *peer);
 void kiblnd_destroy_dev (kib_dev_t *dev);
 void kiblnd_unlink_peer_locked (kib_peer_t *peer);
 kib_peer_t *kiblnd_find_peer_locked (lnet_nid_t nid);
+int kiblnd_conn_stats(lnet_ni_t *ni, lnet_nid_t nid, lnet_conn_stats_t *stats);
 int  kiblnd_close_stale_conns_locked (kib_peer_t *peer,
                                       int version, __u64 incarnation);
 int  kiblnd_close_peer_conns_locked (kib_peer_t *peer, int why);
@@ -343,6 +343,12 @@ kiblnd_handle_rx (kib_rx_t *rx)
 
                 conn->ibc_credits += credits;
 
+		if (ktime_to_ns(conn->ibc_stalled) != 0) {
+			conn->ibc_stall += ktime_us_delta(ktime_get(),
+							  conn->ibc_stalled);
+			conn->ibc_stalled = ktime_set(0, 0);
+		}
+
                 /* This ensures the credit taken by NOOP can be returned */
                 if (msg->ibm_type == IBLND_MSG_NOOP &&
                     !IBLND_OOB_CAPABLE(conn->ibc_version)) /* v1 only */
@@ -749,6 +755,14 @@ kiblnd_setup_rd_kiov (lnet_ni_t *ni, kib_tx_t *tx, kib_rdma_desc_t *rd,
         return kiblnd_map_tx(ni, tx, rd, sg - tx->tx_frags);
 }
 
+/* sends are waiting for the peer to return credits */
+static void
+kiblnd_conn_stall_locked(kib_conn_t *conn)
+{
+	if (ktime_to_ns(conn->ibc_stalled) == 0)
+		conn->ibc_stalled = ktime_get();
+}
+
 static int
 kiblnd_post_tx_locked (kib_conn_t *conn, kib_tx_t *tx, int credit)
 __must_hold(&conn->ibc_lock)
@@ -782,6 +796,7 @@ __must_hold(&conn->ibc_lock)
         if (credit != 0 && conn->ibc_credits == 0) {   /* no credits */
                 CDEBUG(D_NET, "%s: no credits\n",
                        libcfs_nid2str(peer->ibp_nid));
+		kiblnd_conn_stall_locked(conn);
                 return -EAGAIN;
         }
 
@@ -790,6 +805,7 @@ __must_hold(&conn->ibc_lock)
             msg->ibm_type != IBLND_MSG_NOOP) {      /* for NOOP */
                 CDEBUG(D_NET, "%s: not using last credit\n",
                        libcfs_nid2str(peer->ibp_nid));
+		kiblnd_conn_stall_locked(conn);
                 return -EAGAIN;
         }
 
@@ -843,7 +859,8 @@ __must_hold(&conn->ibc_lock)
 		struct ib_send_wr *bad = &tx->tx_wrq[tx->tx_nwrq - 1].wr;
 		struct ib_send_wr *wr  = &tx->tx_wrq[0].wr;
 
-		if (frd != NULL) {
+		/* a cached registration needs no work requests */
+		if (frd != NULL && !frd->frd_reused) {
 			if (!frd->frd_valid) {
 				wr = &frd->frd_inv_wr.wr;
 				wr->next = &frd->frd_fastreg_wr.wr;
@@ -859,6 +876,7 @@ __must_hold(&conn->ibc_lock)
 			 libcfs_nid2str(conn->ibc_peer->ibp_nid));
 
 		bad = NULL;
+		tx->tx_posted = ktime_get();
 		rc = ib_post_send(conn->ibc_cmid->qp, wr, &bad);
 	}
 
@@ -999,6 +1017,22 @@ kiblnd_tx_complete (kib_tx_t *tx, int status)
         if (tx->tx_msg->ibm_type == IBLND_MSG_NOOP)
                 conn->ibc_noops_posted--;
 
+	/* A send with no RDMA completes when the peer's HCA has ACKed it,
+	 * so the time it took approximates the round trip */
+	if (!failed && tx->tx_nwrq == 1 && tx->fmr.fmr_frd == NULL) {
+		long rtt = ktime_us_delta(ktime_get(), tx->tx_posted);
+
+		if (conn->ibc_rtt == 0) {
+			conn->ibc_rtt = rtt << LNET_EWMA_SHIFT;
+			conn->ibc_rttvar = (rtt / 2) << LNET_EWMA_SHIFT;
+		} else {
+			lnet_ewma_add(&conn->ibc_rttvar,
+				      abs(rtt - (conn->ibc_rtt >>
+						 LNET_EWMA_SHIFT)));
+			lnet_ewma_add(&conn->ibc_rtt, rtt);
+		}
+	}
+
         if (failed) {
                 tx->tx_waiting = 0;             /* don't wait for peer */
                 tx->tx_status = -EIO;
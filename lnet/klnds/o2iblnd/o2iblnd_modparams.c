@@ -120,7 +120,7 @@ MODULE_PARM_DESC(fmr_flush_trigger, "# dirty FMRs that triggers pool flush");
 
 static int fmr_cache = 1;
 module_param(fmr_cache, int, 0444);
-MODULE_PARM_DESC(fmr_cache, "non-zero to enable FMR caching");
+MODULE_PARM_DESC(fmr_cache, "non-zero to enable FMR caching (FastReg: local registrations only)");
 
 /*
  * 0: disable failover
@@ -1848,6 +1848,74 @@ ksocknal_query (lnet_ni_t *ni, lnet_nid_t nid, cfs_time_t *when)
         return;
 }
 
+int
+ksocknal_conn_stats(lnet_ni_t *ni, lnet_nid_t nid, lnet_conn_stats_t *stats)
+{
+	rwlock_t		*glock = &ksocknal_data.ksnd_global_lock;
+	ksock_conn_t		*conns[SOCKLND_CONN_NTYPES];
+	ksock_peer_t		*peer;
+	ksock_conn_t		*conn;
+	ksock_sched_t		*sched;
+	ksock_tx_t		*tx;
+	__u32			 rtt;
+	__u32			 rttvar;
+	int			 nconns = 0;
+	int			 i;
+	lnet_process_id_t	 id = {
+		.nid = nid,
+		.pid = LNET_PID_LUSTRE,
+	};
+
+	read_lock(glock);
+
+	peer = ksocknal_find_peer_locked(ni, id);
+	if (peer == NULL || list_empty(&peer->ksnp_conns)) {
+		read_unlock(glock);
+		return -ENOENT;
+	}
+
+	/* waiting for a connection */
+	list_for_each_entry(tx, &peer->ksnp_tx_queue, tx_list)
+		stats->lcs_txq++;
+
+	list_for_each_entry(conn, &peer->ksnp_conns, ksnc_list) {
+		sched = conn->ksnc_scheduler;
+
+		spin_lock_bh(&sched->kss_lock);
+
+		list_for_each_entry(tx, &conn->ksnc_tx_queue, tx_list)
+			stats->lcs_txq++;
+
+		stats->lcs_stall += conn->ksnc_tx_stall;
+		if (ktime_to_ns(conn->ksnc_tx_stalled) != 0)
+			stats->lcs_stall +=
+				ktime_us_delta(ktime_get(),
+					       conn->ksnc_tx_stalled);
+
+		spin_unlock_bh(&sched->kss_lock);
+
+		stats->lcs_nconns++;
+		if (nconns < SOCKLND_CONN_NTYPES) {
+			ksocknal_conn_addref(conn);
+			conns[nconns++] = conn;
+		}
+	}
+
+	read_unlock(glock);
+
+	/* getsockopt() may sleep; report the slowest connection */
+	for (i = 0; i < nconns; i++) {
+		if (ksocknal_lib_get_conn_rtt(conns[i], &rtt, &rttvar) == 0 &&
+		    rtt > stats->lcs_rtt) {
+			stats->lcs_rtt = rtt;
+			stats->lcs_rttvar = rttvar;
+		}
+		ksocknal_conn_decref(conns[i]);
+	}
+
+	return 0;
+}
+
 static void
 ksocknal_push_peer (ksock_peer_t *peer)
 {
@@ -2876,6 +2944,7 @@ static int __init ksocklnd_init(void)
 	the_ksocklnd.lnd_recv     = ksocknal_recv;
 	the_ksocklnd.lnd_notify   = ksocknal_notify;
 	the_ksocklnd.lnd_query    = ksocknal_query;
+	the_ksocklnd.lnd_conn_stats = ksocknal_conn_stats;
 	the_ksocklnd.lnd_accept   = ksocknal_accept;
 
 	rc = ksocknal_tunables_init();
@@ -163,6 +163,9 @@ typedef struct
         unsigned int     *ksnd_zc_min_payload;  /* minimum zero copy payload size */
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
+	/* minimum payload size to receive by tcp_read_sock() */
+	unsigned int	 *ksnd_read_sock_min_payload;
+	int		 *ksnd_tx_batch;	/* max # txs per sendmsg() */
 #ifdef CPU_AFFINITY
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
 #endif
@@ -384,6 +387,10 @@ typedef struct ksock_conn
 	int			ksnc_tx_scheduled;
 	/* time stamp of the last posted TX */
 	cfs_time_t		ksnc_tx_last_post;
+	/* when the send buffer filled up, 0 if it isn't full */
+	ktime_t			ksnc_tx_stalled;
+	/* total usecs the send buffer has been full */
+	__u64			ksnc_tx_stall;
 } ksock_conn_t;
 
 typedef struct ksock_route
@@ -645,6 +652,8 @@ extern void ksocknal_txlist_done(lnet_ni_t *ni, struct list_head *txlist,
 				 int error);
 extern void ksocknal_notify (lnet_ni_t *ni, lnet_nid_t gw_nid, int alive);
 extern void ksocknal_query (struct lnet_ni *ni, lnet_nid_t nid, cfs_time_t *when);
+extern int ksocknal_conn_stats(struct lnet_ni *ni, lnet_nid_t nid,
+			       lnet_conn_stats_t *stats);
 extern int ksocknal_thread_start(int (*fn)(void *arg), void *arg, char *name);
 extern void ksocknal_thread_fini (void);
 extern void ksocknal_launch_all_connections_locked (ksock_peer_t *peer);
@@ -672,11 +681,14 @@ extern int ksocknal_lib_get_conn_addrs(ksock_conn_t *conn);
 extern int ksocknal_lib_setup_sock(struct socket *so);
 extern int ksocknal_lib_send_iov(ksock_conn_t *conn, ksock_tx_t *tx);
 extern int ksocknal_lib_send_kiov(ksock_conn_t *conn, ksock_tx_t *tx);
+extern int ksocknal_lib_send_txs(ksock_conn_t *conn, struct list_head *txs);
 extern void ksocknal_lib_eager_ack(ksock_conn_t *conn);
 extern int ksocknal_lib_recv_iov(ksock_conn_t *conn);
 extern int ksocknal_lib_recv_kiov(ksock_conn_t *conn);
 extern int ksocknal_lib_get_conn_tunables(ksock_conn_t *conn, int *txmem,
 					  int *rxmem, int *nagle);
+extern int ksocknal_lib_get_conn_rtt(ksock_conn_t *conn, __u32 *rtt,
+				     __u32 *rttvar);
 
 extern int ksocknal_tunables_init(void);
 
@@ -107,11 +107,47 @@ ksocknal_free_tx (ksock_tx_t *tx)
 	}
 }
 
+/* "consume" @nob bytes sent from the front of @tx: kvec frags first, then
+ * page frags */
+static void
+ksocknal_tx_consume(ksock_tx_t *tx, int nob)
+{
+	struct kvec	*iov = tx->tx_iov;
+	lnet_kiov_t	*kiov = tx->tx_kiov;
+
+	LASSERT(nob <= tx->tx_resid);
+	tx->tx_resid -= nob;
+
+	while (nob != 0 && tx->tx_niov > 0) {
+		if (nob < (int)iov->iov_len) {
+			iov->iov_base += nob;
+			iov->iov_len -= nob;
+			return;
+		}
+
+		nob -= iov->iov_len;
+		tx->tx_iov = ++iov;
+		tx->tx_niov--;
+	}
+
+	while (nob != 0) {
+		LASSERT(tx->tx_nkiov > 0);
+
+		if (nob < (int)kiov->kiov_len) {
+			kiov->kiov_offset += nob;
+			kiov->kiov_len -= nob;
+			return;
+		}
+
+		nob -= (int)kiov->kiov_len;
+		tx->tx_kiov = ++kiov;
+		tx->tx_nkiov--;
+	}
+}
+
 static int
 ksocknal_send_iov (ksock_conn_t *conn, ksock_tx_t *tx)
 {
-	struct kvec *iov = tx->tx_iov;
-        int    nob;
         int    rc;
 
         LASSERT (tx->tx_niov > 0);
@@ -122,33 +158,13 @@ ksocknal_send_iov (ksock_conn_t *conn, ksock_tx_t *tx)
         if (rc <= 0)                            /* sent nothing? */
                 return (rc);
 
-        nob = rc;
-        LASSERT (nob <= tx->tx_resid);
-        tx->tx_resid -= nob;
-
-        /* "consume" iov */
-        do {
-                LASSERT (tx->tx_niov > 0);
-
-                if (nob < (int) iov->iov_len) {
-			iov->iov_base += nob;
-                        iov->iov_len -= nob;
-                        return (rc);
-                }
-
-                nob -= iov->iov_len;
-                tx->tx_iov = ++iov;
-                tx->tx_niov--;
-        } while (nob != 0);
-
+	ksocknal_tx_consume(tx, rc);
         return (rc);
 }
 
 static int
 ksocknal_send_kiov (ksock_conn_t *conn, ksock_tx_t *tx)
 {
-        lnet_kiov_t    *kiov = tx->tx_kiov;
-        int     nob;
         int     rc;
 
         LASSERT (tx->tx_niov == 0);
@@ -160,31 +176,44 @@ ksocknal_send_kiov (ksock_conn_t *conn, ksock_tx_t *tx)
         if (rc <= 0)                            /* sent nothing? */
                 return (rc);
 
-        nob = rc;
-        LASSERT (nob <= tx->tx_resid);
-        tx->tx_resid -= nob;
+	ksocknal_tx_consume(tx, rc);
+        return (rc);
+}
 
-        /* "consume" kiov */
-        do {
-                LASSERT(tx->tx_nkiov > 0);
+static int
+ksocknal_send_txs(ksock_conn_t *conn, struct list_head *txs)
+{
+	ksock_tx_t	*tx;
+	int		 nob;
+	int		 rc;
 
-                if (nob < (int)kiov->kiov_len) {
-                        kiov->kiov_offset += nob;
-                        kiov->kiov_len -= nob;
-                        return rc;
-                }
+	/* Never touch tx->tx_[k]iov inside ksocknal_lib_send_txs() */
+	rc = ksocknal_lib_send_txs(conn, txs);
 
-                nob -= (int)kiov->kiov_len;
-                tx->tx_kiov = ++kiov;
-                tx->tx_nkiov--;
-        } while (nob != 0);
+	if (rc <= 0)				/* sent nothing? */
+		return rc;
 
-        return (rc);
+	/* the batch went out in order */
+	nob = rc;
+	list_for_each_entry(tx, txs, tx_list) {
+		int fragnob = min(nob, tx->tx_resid);
+
+		ksocknal_tx_consume(tx, fragnob);
+		nob -= fragnob;
+		if (nob == 0)
+			break;
+	}
+	LASSERT(nob == 0);
+
+	return rc;
 }
 
+/* send @txs, which are all sent once the last of them is */
 static int
-ksocknal_transmit(ksock_conn_t *conn, ksock_tx_t *tx)
+ksocknal_transmit(ksock_conn_t *conn, struct list_head *txs)
 {
+	ksock_tx_t *tx = list_entry(txs->next, ksock_tx_t, tx_list);
+	ksock_tx_t *last = list_entry(txs->prev, ksock_tx_t, tx_list);
 	int	rc;
 	int	bufnob;
 
@@ -206,6 +235,8 @@ ksocknal_transmit(ksock_conn_t *conn, ksock_tx_t *tx)
                         /* testing... */
                         ksocknal_data.ksnd_enomem_tx--;
                         rc = -EAGAIN;
+		} else if (tx != last) {
+			rc = ksocknal_send_txs(conn, txs);
                 } else if (tx->tx_niov != 0) {
                         rc = ksocknal_send_iov (conn, tx);
                 } else {
@@ -242,7 +273,7 @@ ksocknal_transmit(ksock_conn_t *conn, ksock_tx_t *tx)
 		atomic_sub (rc, &conn->ksnc_tx_nob);
                 rc = 0;
 
-        } while (tx->tx_resid != 0);
+	} while (last->tx_resid != 0);
 
         ksocknal_connsock_decref(conn);
         return (rc);
@@ -504,18 +535,21 @@ ksocknal_uncheck_zc_req(ksock_tx_t *tx)
 }
 
 static int
-ksocknal_process_transmit (ksock_conn_t *conn, ksock_tx_t *tx)
+ksocknal_process_transmit(ksock_conn_t *conn, struct list_head *txs)
 {
+	/* only ever the sole tx of its batch if it's zero-copy */
+	ksock_tx_t	*tx = list_entry(txs->next, ksock_tx_t, tx_list);
+	ksock_tx_t	*last = list_entry(txs->prev, ksock_tx_t, tx_list);
         int            rc;
 
         if (tx->tx_zc_capable && !tx->tx_zc_checked)
                 ksocknal_check_zc_req(tx);
 
-        rc = ksocknal_transmit (conn, tx);
+	rc = ksocknal_transmit(conn, txs);
 
-        CDEBUG (D_NET, "send(%d) %d\n", tx->tx_resid, rc);
+	CDEBUG(D_NET, "send(%d) %d\n", last->tx_resid, rc);
 
-        if (tx->tx_resid == 0) {
+	if (last->tx_resid == 0) {
                 /* Sent everything OK */
                 LASSERT (rc == 0);
 
@@ -1385,6 +1419,47 @@ ksocknal_sched_cansleep(ksock_sched_t *sched)
 	return rc;
 }
 
+/* Can @tx go out in the same sendmsg() as the txs queued next to it? */
+static inline int
+ksocknal_tx_batchable(ksock_tx_t *tx)
+{
+	/* not if it's for sendpage(), nor if it means kmap()ing more pages at
+	 * once than is safe */
+	return !SOCKNAL_SINGLE_FRAG_TX && !tx->tx_zc_capable &&
+	       (SOCKNAL_RISK_KMAP_DEADLOCK || tx->tx_nkiov == 0);
+}
+
+/* Dequeue the tx at the head of @conn's tx queue onto @txs, with as many of
+ * the txs behind it as can be sent in the same sendmsg().  Small messages
+ * then cost one socket call and one scheduling round between them, instead
+ * of one each.  Called holding kss_lock. */
+static void
+ksocknal_dequeue_txs_locked(ksock_conn_t *conn, struct list_head *txs)
+{
+	ksock_tx_t	*tx;
+	int		 nfrags = 0;
+	int		 ntx = 0;
+
+	do {
+		tx = list_entry(conn->ksnc_tx_queue.next, ksock_tx_t, tx_list);
+
+		if (ntx > 0 &&
+		    (!ksocknal_tx_batchable(tx) ||
+		     nfrags + tx->tx_niov + tx->tx_nkiov > LNET_MAX_IOV))
+			break;
+
+		if (conn->ksnc_tx_carrier == tx)
+			ksocknal_next_tx_carrier(conn);
+
+		/* dequeue now so empty list => more to send */
+		list_move_tail(&tx->tx_list, txs);
+		nfrags += tx->tx_niov + tx->tx_nkiov;
+		ntx++;
+	} while (ntx < *ksocknal_tunables.ksnd_tx_batch &&
+		 ksocknal_tx_batchable(tx) &&
+		 !list_empty(&conn->ksnc_tx_queue));
+}
+
 int ksocknal_scheduler(void *arg)
 {
 	struct ksock_sched_info	*info;
@@ -1459,6 +1534,8 @@ int ksocknal_scheduler(void *arg)
 
 		if (!list_empty(&sched->kss_tx_conns)) {
 			struct list_head zlist = LIST_HEAD_INIT(zlist);
+			struct list_head txs = LIST_HEAD_INIT(txs);
+			ksock_tx_t *tmp;
 
 			if (!list_empty(&sched->kss_zombie_noop_txs)) {
 				list_add(&zlist,
@@ -1474,14 +1551,7 @@ int ksocknal_scheduler(void *arg)
                         LASSERT(conn->ksnc_tx_ready);
 			LASSERT(!list_empty(&conn->ksnc_tx_queue));
 
-			tx = list_entry(conn->ksnc_tx_queue.next,
-                                            ksock_tx_t, tx_list);
-
-                        if (conn->ksnc_tx_carrier == tx)
-                                ksocknal_next_tx_carrier(conn);
-
-                        /* dequeue now so empty list => more to send */
-			list_del(&tx->tx_list);
+			ksocknal_dequeue_txs_locked(conn, &txs);
 
                         /* Clear tx_ready in case send isn't complete.  Do
                          * it BEFORE we call process_transmit, since
@@ -1496,16 +1566,35 @@ int ksocknal_scheduler(void *arg)
                                 ksocknal_txlist_done(NULL, &zlist, 0);
                         }
 
-                        rc = ksocknal_process_transmit(conn, tx);
+			rc = ksocknal_process_transmit(conn, &txs);
 
                         if (rc == -ENOMEM || rc == -EAGAIN) {
-                                /* Incomplete send: replace tx on HEAD of tx_queue */
+				/* Incomplete send: tx -ref the txs that got
+				 * out and replace the rest on HEAD of
+				 * tx_queue */
+				list_for_each_entry_safe(tx, tmp, &txs,
+							 tx_list) {
+					if (tx->tx_resid != 0)
+						break;
+					list_del(&tx->tx_list);
+					ksocknal_tx_decref(tx);
+				}
+
 				spin_lock_bh(&sched->kss_lock);
-				list_add(&tx->tx_list,
-					     &conn->ksnc_tx_queue);
+				list_splice(&txs, &conn->ksnc_tx_queue);
+
+				/* out of send buffer space until
+				 * ksocknal_write_callback() says otherwise */
+				if (rc == -EAGAIN && !conn->ksnc_tx_ready &&
+				    ktime_to_ns(conn->ksnc_tx_stalled) == 0)
+					conn->ksnc_tx_stalled = ktime_get();
 			} else {
 				/* Complete send; tx -ref */
-				ksocknal_tx_decref(tx);
+				list_for_each_entry_safe(tx, tmp, &txs,
+							 tx_list) {
+					list_del(&tx->tx_list);
+					ksocknal_tx_decref(tx);
+				}
 
 				spin_lock_bh(&sched->kss_lock);
                                 /* assume space for more */
@@ -1596,6 +1685,12 @@ void ksocknal_write_callback(ksock_conn_t *conn)
 
 	conn->ksnc_tx_ready = 1;
 
+	if (ktime_to_ns(conn->ksnc_tx_stalled) != 0) {
+		conn->ksnc_tx_stall += ktime_us_delta(ktime_get(),
+						      conn->ksnc_tx_stalled);
+		conn->ksnc_tx_stalled = ktime_set(0, 0);
+	}
+
 	if (!conn->ksnc_tx_scheduled && /* not being progressed */
 	    !list_empty(&conn->ksnc_tx_queue)) { /* packets to send */
 		list_add_tail(&conn->ksnc_tx_list, &sched->kss_tx_conns);
@@ -70,6 +70,16 @@ ksocknal_lib_zc_capable(ksock_conn_t *conn)
 	return ((caps & NETIF_F_SG) != 0 && (caps & NETIF_F_CSUM_MASK) != 0);
 }
 
+static void
+ksocknal_lib_csum_tx_first(ksock_conn_t *conn, ksock_tx_t *tx)
+{
+	if (*ksocknal_tunables.ksnd_enable_csum	       && /* checksum enabled */
+	    conn->ksnc_proto == &ksocknal_protocol_v2x && /* V2.x connection  */
+	    tx->tx_nob == tx->tx_resid		       && /* frist sending    */
+	    tx->tx_msg.ksm_csum == 0)			  /* not checksummed  */
+		ksocknal_lib_csum_tx(tx);
+}
+
 int
 ksocknal_lib_send_iov(ksock_conn_t *conn, ksock_tx_t *tx)
 {
@@ -77,11 +87,7 @@ ksocknal_lib_send_iov(ksock_conn_t *conn, ksock_tx_t *tx)
 	int		nob;
 	int		rc;
 
-	if (*ksocknal_tunables.ksnd_enable_csum	       && /* checksum enabled */
-	    conn->ksnc_proto == &ksocknal_protocol_v2x && /* V2.x connection  */
-	    tx->tx_nob == tx->tx_resid		       && /* frist sending    */
-	    tx->tx_msg.ksm_csum == 0)			  /* not checksummed  */
-		ksocknal_lib_csum_tx(tx);
+	ksocknal_lib_csum_tx_first(conn, tx);
 
 	/* NB we can't trust socket ops to either consume our iovs
 	 * or leave them alone. */
@@ -180,6 +186,54 @@ ksocknal_lib_send_kiov(ksock_conn_t *conn, ksock_tx_t *tx)
 	return rc;
 }
 
+/* Send what's left of a batch of txs in one sendmsg().  The scheduler only
+ * batches txs that aren't zero-copy and whose fragments fit in the scratch
+ * iov, see ksocknal_tx_batchable() */
+int
+ksocknal_lib_send_txs(ksock_conn_t *conn, struct list_head *txs)
+{
+	struct kvec	*scratchiov = conn->ksnc_scheduler->kss_scratch_iov;
+	struct msghdr	 msg = { .msg_flags = MSG_DONTWAIT };
+	ksock_tx_t	*tx;
+	lnet_kiov_t	*kiov;
+	unsigned int	 niov = 0;
+	int		 nob = 0;
+	int		 rc;
+	int		 i;
+
+	/* NB we can't trust socket ops to either consume our iovs
+	 * or leave them alone. */
+	list_for_each_entry(tx, txs, tx_list) {
+		LASSERT(niov + tx->tx_niov + tx->tx_nkiov <= LNET_MAX_IOV);
+		ksocknal_lib_csum_tx_first(conn, tx);
+
+		for (i = 0; i < tx->tx_niov; i++) {
+			scratchiov[niov] = tx->tx_iov[i];
+			nob += scratchiov[niov++].iov_len;
+		}
+
+		for (i = 0; i < tx->tx_nkiov; i++) {
+			kiov = &tx->tx_kiov[i];
+			scratchiov[niov].iov_base = kmap(kiov->kiov_page) +
+						    kiov->kiov_offset;
+			nob += scratchiov[niov++].iov_len = kiov->kiov_len;
+		}
+	}
+
+	/* cork across the batch, and beyond it if more is queued */
+	if (!list_empty(&conn->ksnc_tx_queue))
+		msg.msg_flags |= MSG_MORE;
+
+	rc = kernel_sendmsg(conn->ksnc_sock, &msg, scratchiov, niov, nob);
+
+	list_for_each_entry(tx, txs, tx_list) {
+		for (i = 0; i < tx->tx_nkiov; i++)
+			kunmap(tx->tx_kiov[i].kiov_page);
+	}
+
+	return rc;
+}
+
 void
 ksocknal_lib_eager_ack (ksock_conn_t *conn)
 {
@@ -300,6 +354,95 @@ ksocknal_lib_kiov_vmap(lnet_kiov_t *kiov, int niov,
         return addr;
 }
 
+/* where ksocknal_lib_read_actor() is up to in the rx kiov */
+typedef struct ksock_read_desc {
+	ksock_conn_t	*krd_conn;
+	lnet_kiov_t	*krd_kiov;		/* current fragment */
+	unsigned int	 krd_nkiov;		/* # fragments left */
+	unsigned int	 krd_offset;		/* bytes done in krd_kiov */
+} ksock_read_desc_t;
+
+/* copy straight from the skb into the pages, and checksum while the data
+ * is still in cache */
+static int
+ksocknal_lib_read_actor(read_descriptor_t *desc, struct sk_buff *skb,
+			unsigned int offset, size_t len)
+{
+	ksock_read_desc_t	*krd = desc->arg.data;
+	ksock_conn_t		*conn = krd->krd_conn;
+	lnet_kiov_t		*kiov;
+	size_t			 done = 0;
+	size_t			 fragnob;
+	char			*base;
+	int			 rc;
+
+	len = min_t(size_t, len, desc->count);
+
+	while (done < len) {
+		LASSERT(krd->krd_nkiov > 0);
+
+		kiov = krd->krd_kiov;
+		fragnob = min_t(size_t, kiov->kiov_len - krd->krd_offset,
+				len - done);
+
+		base = kmap(kiov->kiov_page) + kiov->kiov_offset +
+		       krd->krd_offset;
+		rc = skb_copy_bits(skb, offset + done, base, fragnob);
+		if (rc == 0 && conn->ksnc_msg.ksm_csum != 0)
+			conn->ksnc_rx_csum = ksocknal_csum(conn->ksnc_rx_csum,
+							   base, fragnob);
+		kunmap(kiov->kiov_page);
+
+		if (rc != 0) {
+			if (done == 0)
+				return rc;
+			break;
+		}
+
+		done += fragnob;
+		krd->krd_offset += fragnob;
+		if (krd->krd_offset == kiov->kiov_len) {
+			krd->krd_kiov++;
+			krd->krd_nkiov--;
+			krd->krd_offset = 0;
+		}
+	}
+
+	desc->count -= done;
+	return done;
+}
+
+/* Receive from the skbs on the receive queue with tcp_read_sock().  This is
+ * the same single copy recvmsg() makes, not a zero-copy receive: it only
+ * skips building the iovec and, when checksums are on, folds the checksum
+ * into the copy instead of a second pass over the pages.  Returns 0 if
+ * nothing was queued, which the caller mustn't take for EOF. */
+static int
+ksocknal_lib_read_sock(ksock_conn_t *conn)
+{
+	struct sock		*sk = conn->ksnc_sock->sk;
+	ksock_read_desc_t	 krd = {
+		.krd_conn	= conn,
+		.krd_kiov	= conn->ksnc_rx_kiov,
+		.krd_nkiov	= conn->ksnc_rx_nkiov,
+	};
+	read_descriptor_t	 desc = {
+		.arg.data	= &krd,
+	};
+	int			 i;
+	int			 rc;
+
+	for (i = 0; i < conn->ksnc_rx_nkiov; i++)
+		desc.count += conn->ksnc_rx_kiov[i].kiov_len;
+	LASSERT(desc.count <= (size_t)conn->ksnc_rx_nob_wanted);
+
+	lock_sock(sk);
+	rc = tcp_read_sock(sk, &desc, ksocknal_lib_read_actor);
+	release_sock(sk);
+
+	return rc;
+}
+
 int
 ksocknal_lib_recv_kiov (ksock_conn_t *conn)
 {
@@ -329,6 +472,18 @@ ksocknal_lib_recv_kiov (ksock_conn_t *conn)
         int          fragnob;
 	int n;
 
+	/* Not for Chelsio TOE sockets, which want the vmap()ed recvmsg().
+	 * tcp_read_sock() doesn't report EOF or socket errors, so leave an
+	 * empty receive queue to kernel_recvmsg() to sort out. */
+	if (!*ksocknal_tunables.ksnd_zc_recv &&
+	    *ksocknal_tunables.ksnd_read_sock_min_payload != 0 &&
+	    conn->ksnc_rx_nob_wanted >=
+	    *ksocknal_tunables.ksnd_read_sock_min_payload) {
+		rc = ksocknal_lib_read_sock(conn);
+		if (rc != 0)
+			return rc;
+	}
+
         /* NB we can't trust socket ops to either consume our iovs
          * or leave them alone. */
 	if ((addr = ksocknal_lib_kiov_vmap(kiov, niov, scratchiov, pages)) != NULL) {
@@ -449,6 +604,36 @@ ksocknal_lib_get_conn_tunables (ksock_conn_t *conn, int *txmem, int *rxmem, int
         return (rc);
 }
 
+/* the kernel's smoothed RTT estimate, in usecs */
+int
+ksocknal_lib_get_conn_rtt(ksock_conn_t *conn, __u32 *rtt, __u32 *rttvar)
+{
+	struct tcp_info	info;
+	int		len = sizeof(info);
+	int		rc;
+
+	rc = ksocknal_connsock_addref(conn);
+	if (rc != 0) {
+		LASSERT(conn->ksnc_closing);
+		*rtt = *rttvar = 0;
+		return -ESHUTDOWN;
+	}
+
+	rc = kernel_getsockopt(conn->ksnc_sock, SOL_TCP, TCP_INFO,
+			       (char *)&info, &len);
+
+	ksocknal_connsock_decref(conn);
+
+	if (rc == 0) {
+		*rtt = info.tcpi_rtt;
+		*rttvar = info.tcpi_rttvar;
+	} else {
+		*rtt = *rttvar = 0;
+	}
+
+	return rc;
+}
+
 int
 ksocknal_lib_setup_sock (struct socket *sock)
 {
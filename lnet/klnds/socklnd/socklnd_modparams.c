@@ -139,6 +139,14 @@ static unsigned int zc_recv_min_nfrags = 16;
 module_param(zc_recv_min_nfrags, int, 0644);
 MODULE_PARM_DESC(zc_recv_min_nfrags, "minimum # of fragments to enable ZC recv");
 
+static unsigned int read_sock_min_payload = (16 << 10);
+module_param(read_sock_min_payload, int, 0644);
+MODULE_PARM_DESC(read_sock_min_payload, "minimum payload size to receive by tcp_read_sock() (still one copy), 0 to disable");
+
+static int tx_batch = 8;
+module_param(tx_batch, int, 0644);
+MODULE_PARM_DESC(tx_batch, "max # of queued messages to send in one go, 1 to disable");
+
 #ifdef SOCKNAL_BACKOFF
 static int backoff_init = 3;
 module_param(backoff_init, int, 0644);
@@ -188,6 +196,8 @@ int ksocknal_tunables_init(void)
         ksocknal_tunables.ksnd_zc_min_payload     = &zc_min_payload;
         ksocknal_tunables.ksnd_zc_recv            = &zc_recv;
         ksocknal_tunables.ksnd_zc_recv_min_nfrags = &zc_recv_min_nfrags;
+	ksocknal_tunables.ksnd_read_sock_min_payload = &read_sock_min_payload;
+	ksocknal_tunables.ksnd_tx_batch		  = &tx_batch;
 
 #ifdef CPU_AFFINITY
 	if (enable_irq_affinity) {
@@ -211,5 +221,8 @@ int ksocknal_tunables_init(void)
         if (*ksocknal_tunables.ksnd_zc_min_payload < (2 << 10))
                 *ksocknal_tunables.ksnd_zc_min_payload = (2 << 10);
 
+	if (*ksocknal_tunables.ksnd_tx_batch < 1)
+		*ksocknal_tunables.ksnd_tx_batch = 1;
+
 	return 0;
 };
@@ -51,6 +51,10 @@ static char *routes = "";
 module_param(routes, charp, 0444);
 MODULE_PARM_DESC(routes, "routes to non-local networks");
 
+static char *peer_rails = "";
+module_param(peer_rails, charp, 0444);
+MODULE_PARM_DESC(peer_rails, "NIDs of multi-rail peers, primary NID first");
+
 static int rnet_htable_size = LNET_REMOTE_NETS_HASH_DEFAULT;
 module_param(rnet_htable_size, int, 0444);
 MODULE_PARM_DESC(rnet_htable_size, "size of remote network hash table");
@@ -626,6 +630,10 @@ lnet_prepare(lnet_pid_t requested_pid)
 	if (rc != 0)
 		goto failed;
 
+	rc = lnet_peer_rails_create();
+	if (rc != 0)
+		goto failed;
+
 	rc = lnet_msg_containers_create();
 	if (rc != 0)
 		goto failed;
@@ -695,6 +703,7 @@ lnet_unprepare (void)
 	lnet_res_container_cleanup(&the_lnet.ln_eq_container);
 
 	lnet_msg_containers_destroy();
+	lnet_peer_rails_destroy();
 	lnet_peer_tables_destroy();
 	lnet_rtrpools_free(0);
 
@@ -1610,6 +1619,10 @@ LNetNIInit(lnet_pid_t requested_pid)
 			goto failed2;
 	}
 
+	rc = lnet_parse_peer_rails(peer_rails);
+	if (rc != 0)
+		goto failed2;
+
 	rc = lnet_acceptor_start();
 	if (rc != 0)
 		goto failed2;
@@ -1622,10 +1635,14 @@ LNetNIInit(lnet_pid_t requested_pid)
 
 	lnet_ping_target_update(pinfo, md_handle);
 
-	rc = lnet_router_checker_start();
+	rc = lnet_peer_rail_discovery_start();
 	if (rc != 0)
 		goto failed4;
 
+	rc = lnet_router_checker_start();
+	if (rc != 0)
+		goto failed5;
+
 	lnet_fault_init();
 	lnet_proc_init();
 
@@ -1633,6 +1650,8 @@ LNetNIInit(lnet_pid_t requested_pid)
 
 	return 0;
 
+failed5:
+	lnet_peer_rail_discovery_stop();
 failed4:
 	lnet_ping_target_fini();
 failed3:
@@ -1682,6 +1701,7 @@ LNetNIFini()
 
 		lnet_proc_fini();
 		lnet_router_checker_stop();
+		lnet_peer_rail_discovery_stop();
 		lnet_ping_target_fini();
 
 		/* Teardown fns that use my own API functions BEFORE here */
@@ -2088,6 +2108,28 @@ LNetCtl(unsigned int cmd, void *arg)
 		   &peer_info->pr_lnd_u.pr_peer_credits.cr_peer_tx_qnob);
 	}
 
+	case IOC_LIBCFS_GET_PEER_CONNS: {
+		struct lnet_ioctl_peer *peer_info = arg;
+		char aliveness[LNET_MAX_STR_LEN];
+		__u32 unused;
+
+		if (peer_info->pr_hdr.ioc_len < sizeof(*peer_info))
+			return -EINVAL;
+
+		rc = lnet_get_peer_info(peer_info->pr_count,
+					&peer_info->pr_nid, aliveness,
+					&peer_info->pr_lnd_u.pr_peer_conns.cc_ncpt,
+					&unused, &unused, &unused, &unused,
+					&unused, &unused);
+		if (rc != 0)
+			return rc;
+
+		/* all 0 if the LND isn't connected to the peer */
+		LNetPeerConnStats(peer_info->pr_nid,
+				  &peer_info->pr_lnd_u.pr_peer_conns.cc_stats);
+		return 0;
+	}
+
 	case IOC_LIBCFS_NOTIFY_ROUTER:
 		return lnet_notify(NULL, data->ioc_nid, data->ioc_flags,
 				   cfs_time_current() -
@@ -2185,6 +2227,47 @@ LNetGetId(unsigned int index, lnet_process_id_t *id)
 }
 EXPORT_SYMBOL(LNetGetId);
 
+/**
+ * Tell whether messages from the network can be handled on CPU partition
+ * \a cpt of the LNet CPT table, i.e. whether \a cpt is one of the CPTs of
+ * an NI other than the loopback one. An NI not bound to some CPTs receives
+ * on all of them, see lnet_cpt_of_nid().
+ *
+ * \retval 1 if an NI receives on \a cpt.
+ * \retval 0 otherwise.
+ */
+int
+LNetCPTHasNI(int cpt)
+{
+	struct lnet_ni	*ni;
+	int		lcpt;
+	int		rc = 0;
+	int		i;
+
+	LASSERT(the_lnet.ln_refcount > 0);
+
+	lcpt = lnet_net_lock_current();
+
+	list_for_each_entry(ni, &the_lnet.ln_nis, ni_list) {
+		if (ni->ni_lnd->lnd_type == LOLND)
+			continue;
+
+		if (ni->ni_cpts == NULL) {
+			rc = 1;
+			break;
+		}
+
+		for (i = 0; i < ni->ni_ncpts && rc == 0; i++)
+			rc = ni->ni_cpts[i] == cpt;
+		if (rc != 0)
+			break;
+	}
+
+	lnet_net_unlock(lcpt);
+	return rc;
+}
+EXPORT_SYMBOL(LNetCPTHasNI);
+
 /**
  * Print a string representation of handle \a h into buffer \a str of
  * \a len bytes.
@@ -111,6 +111,11 @@ LNetEQAlloc(unsigned int count, lnet_eq_handler_t callback,
 	if (eq->eq_refs == NULL)
 		goto failed;
 
+	eq->eq_stats = cfs_percpt_alloc(lnet_cpt_table(),
+					sizeof(*eq->eq_stats[0]));
+	if (eq->eq_stats == NULL)
+		goto failed;
+
 	/* MUST hold both exclusive lnet_res_lock */
 	lnet_res_lock(LNET_LOCK_EX);
 	/* NB: hold lnet_eq_wait_lock for EQ link/unlink, so we can do
@@ -133,6 +138,9 @@ failed:
 	if (eq->eq_refs != NULL)
 		cfs_percpt_free(eq->eq_refs);
 
+	if (eq->eq_stats != NULL)
+		cfs_percpt_free(eq->eq_stats);
+
 	lnet_eq_free(eq);
 	return -ENOMEM;
 }
@@ -153,6 +161,7 @@ LNetEQFree(lnet_handle_eq_t eqh)
 {
 	struct lnet_eq	*eq;
 	lnet_event_t	*events = NULL;
+	lnet_eq_stats_t	**stats = NULL;
 	int		**refs = NULL;
 	int		*ref;
 	int		rc = 0;
@@ -187,6 +196,7 @@ LNetEQFree(lnet_handle_eq_t eqh)
 	events	= eq->eq_events;
 	size	= eq->eq_size;
 	refs	= eq->eq_refs;
+	stats	= eq->eq_stats;
 
 	lnet_res_lh_invalidate(&eq->eq_lh);
 	list_del(&eq->eq_list);
@@ -199,6 +209,8 @@ LNetEQFree(lnet_handle_eq_t eqh)
 		LIBCFS_FREE(events, size * sizeof(lnet_event_t));
 	if (refs != NULL)
 		cfs_percpt_free(refs);
+	if (stats != NULL)
+		cfs_percpt_free(stats);
 
 	return rc;
 }
@@ -208,7 +220,12 @@ void
 lnet_eq_enqueue_event(lnet_eq_t *eq, lnet_event_t *ev)
 {
 	/* MUST called with resource lock hold but w/o lnet_eq_wait_lock */
-	int index;
+	lnet_eq_stats_t	*stats;
+	int		index;
+
+	/* the resource lock held is the one of the MD's CPT */
+	stats = eq->eq_stats[lnet_cpt_of_cookie(ev->md_handle.cookie)];
+	stats->es_events++;
 
 	if (eq->eq_size == 0) {
 		LASSERT(eq->eq_callback != LNET_EQ_HANDLER_NONE);
@@ -216,7 +233,11 @@ lnet_eq_enqueue_event(lnet_eq_t *eq, lnet_event_t *ev)
 		return;
 	}
 
-	lnet_eq_wait_lock();
+	stats->es_queued++;
+	if (!spin_trylock(&the_lnet.ln_eq_wait_lock)) {
+		stats->es_contended++;
+		lnet_eq_wait_lock();
+	}
 	ev->sequence = eq->eq_enq_seq++;
 
 	LASSERT(eq->eq_size == LOWEST_BIT_SET(eq->eq_size));
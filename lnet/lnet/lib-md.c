@@ -227,6 +227,12 @@ lnet_md_validate(lnet_md_t *umd)
 		return -EINVAL;
 	}
 
+	if ((umd->options & LNET_MD_PAGE_LOAN) != 0 &&
+	    (umd->options & LNET_MD_KIOV) == 0) {
+		CERROR("Invalid option: page loan needs a kiov MD\n");
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -44,6 +44,10 @@ static int local_nid_dist_zero = 1;
 module_param(local_nid_dist_zero, int, 0444);
 MODULE_PARM_DESC(local_nid_dist_zero, "Reserved");
 
+static int multi_rail;
+module_param(multi_rail, int, 0444);
+MODULE_PARM_DESC(multi_rail, "Accept messages for a local NID from multi-rail peers on other local networks, and discover their rails by pinging their primary NID; both ends need multi_rail=1");
+
 int
 lnet_fail_nid(lnet_nid_t nid, unsigned int threshold)
 {
@@ -1135,11 +1139,11 @@ routing_off:
 	}
 }
 
+/* rank routes by the administrator's preferences only, so load can't
+ * override priority or hop count */
 static int
 lnet_compare_routes(lnet_route_t *r1, lnet_route_t *r2)
 {
-	lnet_peer_t *p1 = r1->lr_gateway;
-	lnet_peer_t *p2 = r2->lr_gateway;
 	int r1_hops = (r1->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r1->lr_hops;
 	int r2_hops = (r2->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r2->lr_hops;
 
@@ -1155,22 +1159,31 @@ lnet_compare_routes(lnet_route_t *r1, lnet_route_t *r2)
 	if (r1_hops > r2_hops)
 		return -ERANGE;
 
-	if (p1->lp_txqnob < p2->lp_txqnob)
-		return 1;
-
-	if (p1->lp_txqnob > p2->lp_txqnob)
-		return -ERANGE;
+	return 0;
+}
 
-	if (p1->lp_txcredits > p2->lp_txcredits)
-		return 1;
+/* weights are scaled so a gateway with one credit and a 1s round trip time
+ * still gets a non-zero share */
+#define LNET_ROUTE_WEIGHT_SCALE		(1 << 20)
+/* usecs added to every round trip time so unmeasured or very fast gateways
+ * are compared on credits */
+#define LNET_ROUTE_RTT_FLOOR		100
 
-	if (p1->lp_txcredits < p2->lp_txcredits)
-		return -ERANGE;
+/**
+ * Weight of a route among routes of equal priority and hops: the credits
+ * its gateway has had available of late, over its ping round trip time.
+ */
+static unsigned long
+lnet_route_weight(lnet_route_t *route)
+{
+	lnet_peer_t	*lp = route->lr_gateway;
+	long		credits;
+	long		rtt;
 
-	if (r1->lr_seq - r2->lr_seq <= 0)
-		return 1;
+	credits = max(lp->lp_txcredits_avg >> LNET_EWMA_SHIFT, 0L) + 1;
+	rtt = (lp->lp_rtt_avg >> LNET_EWMA_SHIFT) + LNET_ROUTE_RTT_FLOOR;
 
-	return -ERANGE;
+	return max(credits * LNET_ROUTE_WEIGHT_SCALE / rtt, 1L);
 }
 
 static lnet_peer_t *
@@ -1179,9 +1192,10 @@ lnet_find_route_locked(lnet_ni_t *ni, lnet_nid_t target, lnet_nid_t rtr_nid)
 	lnet_remotenet_t	*rnet;
 	lnet_route_t		*route;
 	lnet_route_t		*best_route;
-	lnet_route_t		*last_route;
-	struct lnet_peer	*lp_best;
 	struct lnet_peer	*lp;
+	unsigned long		total = 0;
+	unsigned long		weight;
+	unsigned long		pick;
 	int			rc;
 
 	/* If @rtr_nid is not LNET_NID_ANY, return the gateway with
@@ -1191,8 +1205,9 @@ lnet_find_route_locked(lnet_ni_t *ni, lnet_nid_t target, lnet_nid_t rtr_nid)
 	if (rnet == NULL)
 		return NULL;
 
-	lp_best = NULL;
-	best_route = last_route = NULL;
+	/* find the best priority and hop count among usable routes and the
+	 * total weight of the routes that have them */
+	best_route = NULL;
 	list_for_each_entry(route, &rnet->lrn_routes, lr_list) {
 		lp = route->lr_gateway;
 
@@ -1205,36 +1220,59 @@ lnet_find_route_locked(lnet_ni_t *ni, lnet_nid_t target, lnet_nid_t rtr_nid)
 		if (lp->lp_nid == rtr_nid) /* it's pre-determined router */
 			return lp;
 
-		if (lp_best == NULL) {
-			best_route = last_route = route;
-			lp_best = lp;
+		rc = best_route == NULL ? 1 :
+		     lnet_compare_routes(route, best_route);
+		if (rc < 0)
 			continue;
+
+		if (rc > 0) {
+			best_route = route;
+			total = 0;
 		}
 
-		/* no protection on below fields, but it's harmless */
-		if (last_route->lr_seq - route->lr_seq < 0)
-			last_route = route;
+		/* sample credits of every candidate at every selection, so the
+		 * average keeps moving for gateways that aren't being picked;
+		 * no protection on below fields, but it's harmless */
+		lnet_ewma_add(&lp->lp_txcredits_avg, lp->lp_txcredits);
+		total += lnet_route_weight(route);
+	}
 
-		rc = lnet_compare_routes(route, best_route);
-		if (rc < 0)
+	if (best_route == NULL)
+		return NULL;
+
+	/* then pick one of them with a probability proportional to its
+	 * weight, so load spreads instead of flapping to one router */
+	pick = cfs_rand() % total;
+	list_for_each_entry(route, &rnet->lrn_routes, lr_list) {
+		lp = route->lr_gateway;
+
+		if (!lnet_is_route_alive(route) ||
+		    (ni != NULL && lp->lp_ni != ni) ||
+		    lnet_compare_routes(route, best_route) != 0)
 			continue;
 
-		best_route = route;
-		lp_best = lp;
+		weight = lnet_route_weight(route);
+		if (pick < weight)
+			break;
+		pick -= weight;
 	}
 
-	/* set sequence number on the best router to the latest sequence + 1
-	 * so we can round-robin all routers, it's race and inaccurate but
-	 * harmless and functional  */
-	if (best_route != NULL)
-		best_route->lr_seq = last_route->lr_seq + 1;
-	return lp_best;
+	/* can't fall off the list unless an average moved under us */
+	if (&route->lr_list == &rnet->lrn_routes)
+		route = best_route;
+
+	/* no protection on below fields, but it's harmless */
+	route->lr_nselected++;
+	return route->lr_gateway;
 }
 
 int
 lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 {
 	lnet_nid_t		dst_nid = msg->msg_target.nid;
+	lnet_nid_t		rail_nid = LNET_NID_ANY;
+	lnet_nid_t		self_nid = LNET_NID_ANY;
+	lnet_nid_t		peer_nid;
 	struct lnet_ni		*src_ni;
 	struct lnet_ni		*local_ni;
 	struct lnet_peer	*lp;
@@ -1277,11 +1315,38 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 		LASSERT(!msg->msg_routing);
 	}
 
+	/* A multi-rail peer is sent to on its least loaded rail. The rail is
+	 * picked once and kept if we have to switch to the rail's CPT */
+	if (rail_nid == LNET_NID_ANY && rtr_nid == LNET_NID_ANY &&
+	    !msg->msg_routing && the_lnet.ln_npeer_rails > 0) {
+		rail_nid = lnet_peer_rail_select_locked(dst_nid, cpt,
+							&self_nid);
+		if (rail_nid != LNET_NID_ANY) {
+			cpt2 = lnet_cpt_of_nid_locked(rail_nid);
+			if (cpt2 != cpt) {
+				if (src_ni != NULL)
+					lnet_ni_decref_locked(src_ni, cpt);
+				lnet_net_unlock(cpt);
+
+				cpt = cpt2;
+				goto again;
+			}
+		}
+	}
+	peer_nid = rail_nid != LNET_NID_ANY ? rail_nid : dst_nid;
+
 	/* Is this for someone on a local network? */
-	local_ni = lnet_net2ni_locked(LNET_NIDNET(dst_nid), cpt);
+	local_ni = lnet_net2ni_locked(LNET_NIDNET(peer_nid), cpt);
 
 	if (local_ni != NULL) {
-		if (src_ni == NULL) {
+		if (rail_nid != LNET_NID_ANY) {
+			/* whichever rail carries it, the peer knows me by my
+			 * NID on its primary network */
+			if (src_ni != NULL)
+				lnet_ni_decref_locked(src_ni, cpt);
+			src_ni = local_ni;
+			src_nid = self_nid;
+		} else if (src_ni == NULL) {
 			src_ni = local_ni;
 			src_nid = src_ni->ni_nid;
 		} else if (src_ni == local_ni) {
@@ -1313,17 +1378,25 @@ lnet_send(lnet_nid_t src_nid, lnet_msg_t *msg, lnet_nid_t rtr_nid)
 			return 0;
 		}
 
-		rc = lnet_nid2peer_locked(&lp, dst_nid, cpt);
+		rc = lnet_nid2peer_locked(&lp, peer_nid, cpt);
 		/* lp has ref on src_ni; lose mine */
 		lnet_ni_decref_locked(src_ni, cpt);
 		if (rc != 0) {
 			lnet_net_unlock(cpt);
 			LCONSOLE_WARN("Error %d finding peer %s\n", rc,
-				      libcfs_nid2str(dst_nid));
+				      libcfs_nid2str(peer_nid));
 			/* ENOMEM or shutting down */
 			return rc;
 		}
 		LASSERT(lp->lp_ni == src_ni);
+
+		if (rail_nid != dst_nid && rail_nid != LNET_NID_ANY) {
+			CDEBUG(D_NET, "Rail %s for %s %s %d\n",
+			       libcfs_nid2str(rail_nid),
+			       libcfs_nid2str(dst_nid),
+			       lnet_msgtyp2str(msg->msg_type), msg->msg_len);
+			msg->msg_target.nid = rail_nid;
+		}
 	} else {
 		/* sending to a remote network */
 		lp = lnet_find_route_locked(src_ni, dst_nid, rtr_nid);
@@ -1834,6 +1907,18 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 	for_me = (ni->ni_nid == dest_nid);
 	cpt = lnet_cpt_of_nid(from_nid);
 
+	/* A multi-rail peer addresses me by my NID on its primary network
+	 * whichever of its rails it sends on, see lnet_send(). from_nid is
+	 * only used as a rail once the peer confirms it, see
+	 * lnet_peer_rail_learn() */
+	if (!for_me && multi_rail &&
+	    LNET_NIDNET(src_nid) == LNET_NIDNET(dest_nid) &&
+	    LNET_NIDNET(from_nid) != LNET_NIDNET(dest_nid) &&
+	    lnet_islocalnid(dest_nid)) {
+		for_me = 1;
+		lnet_peer_rail_learn(src_nid, from_nid);
+	}
+
 	switch (type) {
 	case LNET_MSG_ACK:
 	case LNET_MSG_GET:
@@ -1980,8 +2065,23 @@ lnet_parse(lnet_ni_t *ni, lnet_hdr_t *hdr, lnet_nid_t from_nid,
 		msg->msg_hdr.payload_length = payload_length;
 	}
 
+	/* Walk the peer hash for a known sender before taking the lock.
+	 * The lock is still taken once per message, for lnet_msg_commit()
+	 * and router state, but no longer covers the lookup; it's only
+	 * needed for the lookup to create a new peer */
+	msg->msg_rxpeer = lnet_find_peer(from_nid, cpt);
+
 	lnet_net_lock(cpt);
-	rc = lnet_nid2peer_locked(&msg->msg_rxpeer, from_nid, cpt);
+	if (msg->msg_rxpeer != NULL &&
+	    (msg->msg_rxpeer->lp_unhashed || the_lnet.ln_shutdown)) {
+		lnet_peer_decref_locked(msg->msg_rxpeer);
+		msg->msg_rxpeer = NULL;
+	}
+
+	if (msg->msg_rxpeer != NULL)
+		rc = 0;
+	else
+		rc = lnet_nid2peer_locked(&msg->msg_rxpeer, from_nid, cpt);
 	if (rc != 0) {
 		lnet_net_unlock(cpt);
 		CERROR("%s, src %s: Dropping %s "
@@ -2554,3 +2654,57 @@ LNetDist(lnet_nid_t dstnid, lnet_nid_t *srcnidp, __u32 *orderp)
 	return -EHOSTUNREACH;
 }
 EXPORT_SYMBOL(LNetDist);
+
+/**
+ * Get the statistics the LND keeps on its connections to a directly
+ * connected peer, which tell more about congestion on the way there than
+ * LNet's own credits do.  Don't call with spinlocks held, the LND may
+ * sleep.
+ *
+ * \param nid The NID of the peer.
+ * \param stats The statistics of the peer, all zero on failure.
+ *
+ * \retval 0 on success.
+ * \retval -EHOSTUNREACH If \a nid isn't a known peer on a local network.
+ * \retval -EOPNOTSUPP If the LND doesn't keep statistics.
+ * \retval -ENOENT If the LND isn't connected to \a nid.
+ */
+int
+LNetPeerConnStats(lnet_nid_t nid, lnet_conn_stats_t *stats)
+{
+	struct lnet_ni	*ni = NULL;
+	lnet_peer_t	*lp;
+	int		cpt;
+	int		rc;
+
+	LASSERT(the_lnet.ln_refcount > 0);
+
+	memset(stats, 0, sizeof(*stats));
+
+	/* the NI the peer is reached on, which for a multi-rail peer's rail
+	 * isn't necessarily the first one on the rail's network */
+	cpt = lnet_cpt_of_nid(nid);
+	lnet_net_lock(cpt);
+	if (!the_lnet.ln_shutdown) {
+		lp = lnet_find_peer_locked(the_lnet.ln_peer_tables[cpt], nid);
+		if (lp != NULL) {
+			ni = lp->lp_ni;
+			if (ni != NULL)
+				lnet_ni_addref_locked(ni, cpt);
+			lnet_peer_decref_locked(lp);
+		}
+	}
+	lnet_net_unlock(cpt);
+
+	if (ni == NULL)
+		return -EHOSTUNREACH;
+
+	if (ni->ni_lnd->lnd_conn_stats == NULL)
+		rc = -EOPNOTSUPP;
+	else
+		rc = (ni->ni_lnd->lnd_conn_stats)(ni, nid, stats);
+
+	lnet_ni_decref(ni);
+	return rc;
+}
+EXPORT_SYMBOL(LNetPeerConnStats);
@@ -31,6 +31,10 @@
 #define DEBUG_SUBSYSTEM S_LNET
 #include <lnet/lib-lnet.h>
 
+static int lo_page_loan = 1;
+module_param(lo_page_loan, int, 0644);
+MODULE_PARM_DESC(lo_page_loan, "Exchange whole pages between local MDs which allow it instead of copying");
+
 static int
 lolnd_send (lnet_ni_t *ni, void *private, lnet_msg_t *lntmsg)
 {
@@ -40,6 +44,87 @@ lolnd_send (lnet_ni_t *ni, void *private, lnet_msg_t *lntmsg)
 	return lnet_parse(ni, &lntmsg->msg_hdr, ni->ni_nid, lntmsg, 0);
 }
 
+/*
+ * Return the first fragment of the page-aligned range \a offset..+\a nob
+ * of \a md's kiov, or NULL if the MD doesn't allow its pages to be
+ * exchanged or the range isn't made of whole pages.
+ */
+static lnet_kiov_t *
+lolnd_loan_kiov(lnet_libmd_t *md, lnet_kiov_t *kiov,
+		unsigned int offset, unsigned int nob)
+{
+	lnet_kiov_t  *first;
+	unsigned int  niov = md->md_niov;
+
+	if ((md->md_options & LNET_MD_PAGE_LOAN) == 0 ||
+	    kiov != md->md_iov.kiov ||
+	    (offset & ~PAGE_MASK) != 0 || (nob & ~PAGE_MASK) != 0)
+		return NULL;
+
+	while (niov > 0 && offset > 0) {
+		if (kiov->kiov_len != PAGE_SIZE)
+			return NULL;
+		offset -= PAGE_SIZE;
+		kiov++;
+		niov--;
+	}
+
+	first = kiov;
+	while (nob > 0) {
+		if (niov == 0 || kiov->kiov_offset != 0 ||
+		    kiov->kiov_len != PAGE_SIZE)
+			return NULL;
+		nob -= PAGE_SIZE;
+		kiov++;
+		niov--;
+	}
+
+	return first;
+}
+
+/*
+ * Deliver \a nob bytes by swapping the pages of two local MDs which both
+ * allow it. Each owner gets the other's page in its own kiov array too,
+ * so page references change hands one for one and each side still
+ * releases exactly the pages it finds there.
+ */
+static int
+lolnd_loan_pages(lnet_msg_t *rxmsg, lnet_kiov_t *rxkiov,
+		 unsigned int rxoffset, lnet_msg_t *txmsg, unsigned int nob)
+{
+	lnet_libmd_t *rxmd = rxmsg->msg_md;
+	lnet_libmd_t *txmd = txmsg->msg_md;
+	lnet_kiov_t  *rxiov;
+	lnet_kiov_t  *txiov;
+	lnet_kiov_t  *rxuiov;
+	lnet_kiov_t  *txuiov;
+	struct page  *page;
+
+	if (!lo_page_loan || nob == 0 || rxmd == NULL || txmd == NULL)
+		return 0;
+
+	rxiov = lolnd_loan_kiov(rxmd, rxkiov, rxoffset, nob);
+	txiov = lolnd_loan_kiov(txmd, txmsg->msg_kiov,
+				txmsg->msg_offset, nob);
+	if (rxiov == NULL || txiov == NULL)
+		return 0;
+
+	rxuiov = (lnet_kiov_t *)rxmd->md_start + (rxiov - rxmd->md_iov.kiov);
+	txuiov = (lnet_kiov_t *)txmd->md_start + (txiov - txmd->md_iov.kiov);
+
+	for (; nob > 0; nob -= PAGE_SIZE) {
+		page = rxiov->kiov_page;
+		rxiov->kiov_page = rxuiov->kiov_page = txiov->kiov_page;
+		txiov->kiov_page = txuiov->kiov_page = page;
+		rxiov++;
+		rxuiov++;
+		txiov++;
+		txuiov++;
+	}
+
+	return 1;
+}
+
 static int
 lolnd_recv (lnet_ni_t *ni, void *private, lnet_msg_t *lntmsg,
 	    int delayed, unsigned int niov,
@@ -66,7 +151,8 @@ lolnd_recv (lnet_ni_t *ni, void *private, lnet_msg_t *lntmsg,
 						   sendmsg->msg_niov,
 						   sendmsg->msg_kiov,
 						   sendmsg->msg_offset, mlen);
-			else
+			else if (!lolnd_loan_pages(lntmsg, kiov, offset,
+						   sendmsg, mlen))
 				lnet_copy_kiov2kiov(niov, kiov, offset,
 						    sendmsg->msg_niov,
 						    sendmsg->msg_kiov,
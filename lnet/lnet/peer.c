@@ -53,8 +53,6 @@ lnet_peer_tables_create(void)
 	}
 
 	cfs_percpt_for_each(ptable, i, the_lnet.ln_peer_tables) {
-		INIT_LIST_HEAD(&ptable->pt_deathrow);
-
 		LIBCFS_CPT_ALLOC(hash, lnet_cpt_table(), i,
 				 LNET_PEER_HASH_SIZE * sizeof(*hash));
 		if (hash == NULL) {
@@ -82,13 +80,14 @@ lnet_peer_tables_destroy(void)
 	if (the_lnet.ln_peer_tables == NULL)
 		return;
 
+	/* wait for peers still in their RCU grace period */
+	rcu_barrier();
+
 	cfs_percpt_for_each(ptable, i, the_lnet.ln_peer_tables) {
 		hash = ptable->pt_hash;
 		if (hash == NULL) /* not intialized */
 			break;
 
-		LASSERT(list_empty(&ptable->pt_deathrow));
-
 		ptable->pt_hash = NULL;
 		for (j = 0; j < LNET_PEER_HASH_SIZE; j++)
 			LASSERT(list_empty(&hash[j]));
@@ -112,7 +111,8 @@ lnet_peer_table_cleanup_locked(lnet_ni_t *ni, struct lnet_peer_table *ptable)
 					 lp_hashlist) {
 			if (ni != NULL && ni != lp->lp_ni)
 				continue;
-			list_del_init(&lp->lp_hashlist);
+			list_del_rcu(&lp->lp_hashlist);
+			lp->lp_unhashed = 1;
 			/* Lose hash table's ref */
 			ptable->pt_zombies++;
 			lnet_peer_decref_locked(lp);
@@ -121,7 +121,7 @@ lnet_peer_table_cleanup_locked(lnet_ni_t *ni, struct lnet_peer_table *ptable)
 }
 
 static void
-lnet_peer_table_deathrow_wait_locked(struct lnet_peer_table *ptable,
+lnet_peer_table_zombies_wait_locked(struct lnet_peer_table *ptable,
 				     int cpt_locked)
 {
 	int	i;
@@ -172,10 +172,6 @@ lnet_peer_tables_cleanup(lnet_ni_t *ni)
 {
 	int			i;
 	struct lnet_peer_table	*ptable;
-	lnet_peer_t		*lp;
-	struct list_head	deathrow;
-
-	INIT_LIST_HEAD(&deathrow);
 
 	LASSERT(the_lnet.ln_shutdown || ni != NULL);
 	/* If just deleting the peers for a NI, get rid of any routes these
@@ -186,27 +182,27 @@ lnet_peer_tables_cleanup(lnet_ni_t *ni)
 		lnet_net_unlock(i);
 	}
 
-	/* Start the process of moving the applicable peers to
-	 * deathrow. */
+	/* Unhash the applicable peers and drop the hash's refs. */
 	cfs_percpt_for_each(ptable, i, the_lnet.ln_peer_tables) {
 		lnet_net_lock(i);
 		lnet_peer_table_cleanup_locked(ni, ptable);
 		lnet_net_unlock(i);
 	}
 
-	/* Cleanup all entries on deathrow. */
+	/* Wait for the unhashed peers to lose their last ref. */
 	cfs_percpt_for_each(ptable, i, the_lnet.ln_peer_tables) {
 		lnet_net_lock(i);
-		lnet_peer_table_deathrow_wait_locked(ptable, i);
-		list_splice_init(&ptable->pt_deathrow, &deathrow);
+		lnet_peer_table_zombies_wait_locked(ptable, i);
 		lnet_net_unlock(i);
 	}
+}
 
-	while (!list_empty(&deathrow)) {
-		lp = list_entry(deathrow.next, lnet_peer_t, lp_hashlist);
-		list_del(&lp->lp_hashlist);
-		LIBCFS_FREE(lp, sizeof(*lp));
-	}
+static void
+lnet_peer_free_rcu(struct rcu_head *head)
+{
+	lnet_peer_t *lp = container_of(head, lnet_peer_t, lp_rcu);
+
+	LIBCFS_FREE(lp, sizeof(*lp));
 }
 
 void
@@ -214,10 +210,10 @@ lnet_destroy_peer_locked(lnet_peer_t *lp)
 {
 	struct lnet_peer_table *ptable;
 
-	LASSERT(lp->lp_refcount == 0);
+	LASSERT(atomic_read(&lp->lp_refcount) == 0);
 	LASSERT(lp->lp_rtr_refcount == 0);
 	LASSERT(list_empty(&lp->lp_txq));
-	LASSERT(list_empty(&lp->lp_hashlist));
+	LASSERT(lp->lp_unhashed);
 	LASSERT(lp->lp_txqnob == 0);
 
 	ptable = the_lnet.ln_peer_tables[lp->lp_cpt];
@@ -227,9 +223,11 @@ lnet_destroy_peer_locked(lnet_peer_t *lp)
 	lnet_ni_decref_locked(lp->lp_ni, lp->lp_cpt);
 	lp->lp_ni = NULL;
 
-	list_add(&lp->lp_hashlist, &ptable->pt_deathrow);
 	LASSERT(ptable->pt_zombies > 0);
 	ptable->pt_zombies--;
+
+	/* lnet_find_peer() may still be looking at it */
+	call_rcu(&lp->lp_rcu, lnet_peer_free_rcu);
 }
 
 lnet_peer_t *
@@ -251,6 +249,33 @@ lnet_find_peer_locked(struct lnet_peer_table *ptable, lnet_nid_t nid)
 	return NULL;
 }
 
+/**
+ * Look up the peer for \a nid in the table of \a cpt, which must be
+ * lnet_cpt_of_nid(\a nid), without lnet_net_lock. The hash chain is walked
+ * under RCU and a peer whose last ref is already gone is skipped. The peer
+ * returned holds a ref but may have been unhashed since, which callers
+ * check with lp_unhashed once they hold the lock.
+ */
+lnet_peer_t *
+lnet_find_peer(lnet_nid_t nid, int cpt)
+{
+	struct lnet_peer_table	*ptable = the_lnet.ln_peer_tables[cpt];
+	lnet_peer_t		*lp;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(lp, &ptable->pt_hash[lnet_nid2peerhash(nid)],
+				lp_hashlist) {
+		if (lp->lp_nid == nid &&
+		    atomic_inc_not_zero(&lp->lp_refcount)) {
+			rcu_read_unlock();
+			return lp;
+		}
+	}
+	rcu_read_unlock();
+
+	return NULL;
+}
+
 int
 lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt)
 {
@@ -274,12 +299,6 @@ lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt)
 		return 0;
 	}
 
-	if (!list_empty(&ptable->pt_deathrow)) {
-		lp = list_entry(ptable->pt_deathrow.next,
-				lnet_peer_t, lp_hashlist);
-		list_del(&lp->lp_hashlist);
-	}
-
 	/*
 	 * take extra refcount in case another thread has shutdown LNet
 	 * and destroyed locks and peer-table before I finish the allocation
@@ -287,11 +306,7 @@ lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt)
 	ptable->pt_number++;
 	lnet_net_unlock(cpt);
 
-	if (lp != NULL)
-		memset(lp, 0, sizeof(*lp));
-	else
-		LIBCFS_CPT_ALLOC(lp, lnet_cpt_table(), cpt2, sizeof(*lp));
-
+	LIBCFS_CPT_ALLOC(lp, lnet_cpt_table(), cpt2, sizeof(*lp));
 	if (lp == NULL) {
 		rc = -ENOMEM;
 		lnet_net_lock(cpt);
@@ -311,10 +326,11 @@ lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt)
 	lp->lp_last_alive = cfs_time_current(); /* assumes alive */
 	lp->lp_last_query = 0; /* haven't asked NI yet */
 	lp->lp_ping_timestamp = 0;
+	lp->lp_rtt_avg = 0; /* no reply yet */
 	lp->lp_ping_feats = LNET_PING_FEAT_INVAL;
 	lp->lp_nid = nid;
 	lp->lp_cpt = cpt2;
-	lp->lp_refcount = 2;	/* 1 for caller; 1 for hash */
+	atomic_set(&lp->lp_refcount, 2);	/* 1 for caller; 1 for hash */
 	lp->lp_rtr_refcount = 0;
 
 	lnet_net_lock(cpt);
@@ -338,18 +354,20 @@ lnet_nid2peer_locked(lnet_peer_t **lpp, lnet_nid_t nid, int cpt)
 
 	lp->lp_txcredits    =
 	lp->lp_mintxcredits = lp->lp_ni->ni_peertxcredits;
+	lp->lp_txcredits_avg = lp->lp_txcredits << LNET_EWMA_SHIFT;
 	lp->lp_rtrcredits    =
 	lp->lp_minrtrcredits = lnet_peer_buffer_credits(lp->lp_ni);
 
-	list_add_tail(&lp->lp_hashlist,
-		      &ptable->pt_hash[lnet_nid2peerhash(nid)]);
+	list_add_tail_rcu(&lp->lp_hashlist,
+			  &ptable->pt_hash[lnet_nid2peerhash(nid)]);
 	ptable->pt_version++;
 	*lpp = lp;
 
 	return 0;
 out:
+	/* never hashed, so nobody else can see it */
 	if (lp != NULL)
-		list_add(&lp->lp_hashlist, &ptable->pt_deathrow);
+		LIBCFS_FREE(lp, sizeof(*lp));
 	ptable->pt_number--;
 	return rc;
 }
@@ -376,7 +394,7 @@ lnet_debug_peer(lnet_nid_t nid)
 		aliveness = lp->lp_alive ? "up" : "down";
 
 	CDEBUG(D_WARNING, "%-24s %4d %5s %5d %5d %5d %5d %5d %ld\n",
-	       libcfs_nid2str(lp->lp_nid), lp->lp_refcount,
+	       libcfs_nid2str(lp->lp_nid), atomic_read(&lp->lp_refcount),
 	       aliveness, lp->lp_ni->ni_peertxcredits,
 	       lp->lp_rtrcredits, lp->lp_minrtrcredits,
 	       lp->lp_txcredits, lp->lp_mintxcredits, lp->lp_txqnob);
@@ -430,7 +448,7 @@ int lnet_get_peer_info(__u32 peer_index, __u64 *nid,
 					 lp->lp_alive ? "up" : "down");
 
 			*nid = lp->lp_nid;
-			*refcount = lp->lp_refcount;
+			*refcount = atomic_read(&lp->lp_refcount);
 			*ni_peer_tx_credits = lp->lp_ni->ni_peertxcredits;
 			*peer_tx_credits = lp->lp_txcredits;
 			*peer_rtr_credits = lp->lp_rtrcredits;
@@ -447,3 +465,584 @@ int lnet_get_peer_info(__u32 peer_index, __u64 *nid,
 
 	return found ? 0 : -ENOENT;
 }
+
+/*
+ * Multi-rail peers
+ *
+ * A peer node with an NI on more than one of our local networks can be sent
+ * to over any of them. Upper layers keep addressing it by its primary NID;
+ * lnet_send() picks one of its rails for each message and puts our own NID
+ * on the primary's network in the header, so the peer sees the same source
+ * whichever rail carried it. Rails come from the peer_rails module parameter
+ * or, with multi_rail set, are discovered by pinging the primary NID of a
+ * peer that sent us a message over another of our networks.
+ */
+int
+lnet_peer_rails_create(void)
+{
+	struct list_head	*hash;
+	int			i;
+
+	LIBCFS_ALLOC(hash, LNET_PEER_HASH_SIZE * sizeof(*hash));
+	if (hash == NULL) {
+		CERROR("Failed to create peer rail hash table\n");
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < LNET_PEER_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&hash[i]);
+
+	the_lnet.ln_peer_rails = hash;
+	the_lnet.ln_npeer_rails = 0;
+	LNetInvalidateHandle(&the_lnet.ln_rail_eqh);
+	return 0;
+}
+
+void
+lnet_peer_rails_destroy(void)
+{
+	struct lnet_peer_rail	*lpr;
+	struct lnet_peer_rail	*tmp;
+	int			i;
+
+	if (the_lnet.ln_peer_rails == NULL)
+		return;
+
+	for (i = 0; i < LNET_PEER_HASH_SIZE; i++) {
+		list_for_each_entry_safe(lpr, tmp, &the_lnet.ln_peer_rails[i],
+					 lpr_list) {
+			list_del(&lpr->lpr_list);
+			if (lpr->lpr_pinginfo != NULL)
+				LIBCFS_FREE(lpr->lpr_pinginfo,
+					    LNET_PINGINFO_SIZE);
+			LIBCFS_FREE(lpr, sizeof(*lpr));
+		}
+	}
+
+	LIBCFS_FREE(the_lnet.ln_peer_rails,
+		    LNET_PEER_HASH_SIZE * sizeof(*the_lnet.ln_peer_rails));
+	the_lnet.ln_peer_rails = NULL;
+	the_lnet.ln_npeer_rails = 0;
+}
+
+struct lnet_peer_rail *
+lnet_peer_rail_find_locked(lnet_nid_t nid)
+{
+	struct lnet_peer_rail	*lpr;
+
+	if (the_lnet.ln_peer_rails == NULL)
+		return NULL;
+
+	list_for_each_entry(lpr,
+			    &the_lnet.ln_peer_rails[lnet_nid2peerhash(nid)],
+			    lpr_list) {
+		if (lpr->lpr_primary == nid)
+			return lpr;
+	}
+
+	return NULL;
+}
+
+int
+lnet_peer_rail_add(lnet_nid_t primary, lnet_nid_t rail)
+{
+	struct lnet_peer_rail	*lpr;
+	struct lnet_peer_rail	*new;
+	int			rc = 0;
+	int			i;
+
+	LIBCFS_ALLOC(new, sizeof(*new));
+	if (new == NULL)
+		return -ENOMEM;
+
+	new->lpr_primary = primary;
+	new->lpr_rails[0] = primary;
+	new->lpr_nrails = 1;
+	LNetInvalidateHandle(&new->lpr_mdh);
+
+	lnet_net_lock(LNET_LOCK_EX);
+
+	if (the_lnet.ln_shutdown || the_lnet.ln_peer_rails == NULL) {
+		rc = -ESHUTDOWN;
+		goto out;
+	}
+
+	lpr = lnet_peer_rail_find_locked(primary);
+	if (lpr == NULL) {
+		lpr = new;
+		new = NULL;
+		list_add_tail(&lpr->lpr_list,
+			      &the_lnet.ln_peer_rails[lnet_nid2peerhash(primary)]);
+		the_lnet.ln_npeer_rails++;
+	}
+
+	for (i = 0; i < lpr->lpr_nrails; i++) {
+		if (lpr->lpr_rails[i] == rail)
+			goto out;
+	}
+
+	if (lpr->lpr_nrails == LNET_PEER_RAILS_MAX) {
+		rc = -ENOSPC;
+		goto out;
+	}
+
+	lpr->lpr_rails[lpr->lpr_nrails++] = rail;
+out:
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (new != NULL)
+		LIBCFS_FREE(new, sizeof(*new));
+	return rc;
+}
+
+/* seconds between two discovery pings of the same multi-rail peer */
+#define LNET_PEER_RAIL_PING_INTERVAL	60
+
+static bool
+lnet_peer_rail_has_locked(struct lnet_peer_rail *lpr, lnet_nid_t nid)
+{
+	int i;
+
+	for (i = 0; i < lpr->lpr_nrails; i++) {
+		if (lpr->lpr_rails[i] == nid)
+			return true;
+	}
+
+	return false;
+}
+
+static bool
+lnet_peer_rail_ping_due_locked(struct lnet_peer_rail *lpr)
+{
+	if (lpr->lpr_pinging || lpr->lpr_nrails == LNET_PEER_RAILS_MAX)
+		return false;
+
+	return lpr->lpr_ping_time == 0 ||
+	       cfs_time_aftereq(cfs_time_current(),
+				cfs_time_add(lpr->lpr_ping_time,
+				cfs_time_seconds(LNET_PEER_RAIL_PING_INTERVAL)));
+}
+
+/* NB: ln_nis can be walked under any lnet_net_lock */
+static bool
+lnet_peer_rail_net_is_local_locked(__u32 net)
+{
+	struct lnet_ni *ni;
+
+	list_for_each_entry(ni, &the_lnet.ln_nis, ni_list) {
+		if (LNET_NIDNET(ni->ni_nid) == net)
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Add the NIDs listed by ping reply \a info of \a nob bytes, sent by the
+ * node the primary NID of \a lpr belongs to, as rails of \a lpr if they are
+ * up and on another of our local networks.
+ *
+ * \pre lnet_net_lock(LNET_LOCK_EX)
+ */
+static void
+lnet_peer_rail_ping_parse_locked(struct lnet_peer_rail *lpr,
+				 lnet_ping_info_t *info, int nob)
+{
+	lnet_nid_t	nid;
+	bool		found = false;
+	int		nnis;
+	int		i;
+
+	if (nob < offsetof(lnet_ping_info_t, pi_ni[0]))
+		goto bad;
+
+	if (info->pi_magic == __swab32(LNET_PROTO_PING_MAGIC))
+		lnet_swap_pinginfo(info);
+	else if (info->pi_magic != LNET_PROTO_PING_MAGIC)
+		goto bad;
+
+	if ((info->pi_features & LNET_PING_FEAT_NI_STATUS) == 0)
+		goto bad;
+
+	nnis = min_t(int, info->pi_nnis, LNET_MAX_RTR_NIS);
+	if (nob < offsetof(lnet_ping_info_t, pi_ni[nnis]))
+		goto bad;
+
+	for (i = 0; i < nnis && !found; i++)
+		found = info->pi_ni[i].ns_nid == lpr->lpr_primary;
+	if (!found)
+		goto bad;
+
+	for (i = 0; i < nnis; i++) {
+		nid = info->pi_ni[i].ns_nid;
+
+		if (LNET_NETTYP(LNET_NIDNET(nid)) == LOLND ||
+		    LNET_NIDNET(nid) == LNET_NIDNET(lpr->lpr_primary) ||
+		    info->pi_ni[i].ns_status == LNET_NI_STATUS_DOWN ||
+		    !lnet_peer_rail_net_is_local_locked(LNET_NIDNET(nid)) ||
+		    lnet_peer_rail_has_locked(lpr, nid))
+			continue;
+
+		if (lpr->lpr_nrails == LNET_PEER_RAILS_MAX)
+			break;
+
+		lpr->lpr_rails[lpr->lpr_nrails++] = nid;
+		CDEBUG(D_NET, "Peer %s reachable through %s\n",
+		       libcfs_nid2str(lpr->lpr_primary), libcfs_nid2str(nid));
+	}
+	return;
+bad:
+	CDEBUG(D_NET, "Peer %s: bad rail discovery reply of %d bytes\n",
+	       libcfs_nid2str(lpr->lpr_primary), nob);
+}
+
+static void
+lnet_peer_rail_ping_event(lnet_event_t *event)
+{
+	struct lnet_peer_rail *lpr = event->md.user_ptr;
+
+	LASSERT(lpr != NULL);
+
+	/* NB: it's called with holding lnet_res_lock, like
+	 * lnet_router_checker_event() */
+	lnet_net_lock(LNET_LOCK_EX);
+	if (event->type == LNET_EVENT_REPLY && event->status == 0)
+		lnet_peer_rail_ping_parse_locked(lpr, lpr->lpr_pinginfo,
+						 event->mlength);
+
+	if (event->unlinked) {
+		lpr->lpr_pinging = 0;
+		LNetInvalidateHandle(&lpr->lpr_mdh);
+	}
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (event->unlinked)
+		atomic_dec(&the_lnet.ln_rail_npings);
+}
+
+/**
+ * Ask the node \a primary belongs to for its NIDs, by pinging \a primary
+ * over its own network. The reply is handled by
+ * lnet_peer_rail_ping_event().
+ */
+static void
+lnet_peer_rail_ping(lnet_nid_t primary)
+{
+	struct lnet_peer_rail	*lpr;
+	struct lnet_peer_rail	*new;
+	lnet_ping_info_t	*info;
+	lnet_process_id_t	id;
+	lnet_handle_md_t	mdh;
+	lnet_md_t		md = { NULL };
+	int			rc;
+
+	LIBCFS_ALLOC(new, sizeof(*new));
+	LIBCFS_ALLOC(info, LNET_PINGINFO_SIZE);
+	if (new == NULL || info == NULL)
+		goto out;
+
+	new->lpr_primary = primary;
+	new->lpr_rails[0] = primary;
+	new->lpr_nrails = 1;
+	LNetInvalidateHandle(&new->lpr_mdh);
+
+	lnet_net_lock(LNET_LOCK_EX);
+
+	if (the_lnet.ln_shutdown || the_lnet.ln_peer_rails == NULL ||
+	    LNetHandleIsInvalid(the_lnet.ln_rail_eqh)) {
+		lnet_net_unlock(LNET_LOCK_EX);
+		goto out;
+	}
+
+	lpr = lnet_peer_rail_find_locked(primary);
+	if (lpr == NULL) {
+		lpr = new;
+		new = NULL;
+		list_add_tail(&lpr->lpr_list,
+			      &the_lnet.ln_peer_rails[lnet_nid2peerhash(primary)]);
+		the_lnet.ln_npeer_rails++;
+	}
+
+	if (!lnet_peer_rail_ping_due_locked(lpr)) {
+		lnet_net_unlock(LNET_LOCK_EX);
+		goto out;
+	}
+
+	if (lpr->lpr_pinginfo == NULL) {
+		lpr->lpr_pinginfo = info;
+		info = NULL;
+	}
+	lpr->lpr_pinging = 1;
+	lpr->lpr_ping_time = cfs_time_current();
+	atomic_inc(&the_lnet.ln_rail_npings);
+
+	md.start     = lpr->lpr_pinginfo;
+	md.length    = LNET_PINGINFO_SIZE;
+	md.threshold = 2; /* GET/REPLY */
+	md.options   = LNET_MD_TRUNCATE;
+	md.user_ptr  = lpr;
+	md.eq_handle = the_lnet.ln_rail_eqh;
+
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	rc = LNetMDBind(md, LNET_UNLINK, &mdh);
+	if (rc != 0) {
+		CDEBUG(D_NET, "Can't bind MD to ping %s: %d\n",
+		       libcfs_nid2str(primary), rc);
+		lnet_net_lock(LNET_LOCK_EX);
+		lpr->lpr_pinging = 0;
+		lnet_net_unlock(LNET_LOCK_EX);
+		atomic_dec(&the_lnet.ln_rail_npings);
+		goto out;
+	}
+
+	/* lnet_peer_rail_discovery_stop() unlinks it if it runs from now on */
+	lnet_net_lock(LNET_LOCK_EX);
+	lpr->lpr_mdh = mdh;
+	rc = LNetHandleIsInvalid(the_lnet.ln_rail_eqh) ? -ESHUTDOWN : 0;
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (rc == 0) {
+		id.nid = primary;
+		id.pid = LNET_PID_LUSTRE;
+		rc = LNetGet(LNET_NID_ANY, mdh, id, LNET_RESERVED_PORTAL,
+			     LNET_PROTO_PING_MATCHBITS, 0);
+	}
+
+	/* the unlink event ends the ping */
+	if (rc != 0)
+		LNetMDUnlink(mdh);
+out:
+	if (new != NULL)
+		LIBCFS_FREE(new, sizeof(*new));
+	if (info != NULL)
+		LIBCFS_FREE(info, LNET_PINGINFO_SIZE);
+}
+
+/**
+ * Called when a message from \a primary arrived on \a rail, one of our NIDs
+ * on another local network. Anybody on that network could have sent it, so
+ * \a rail isn't used until the node \a primary belongs to lists it in the
+ * reply to a ping sent to \a primary itself. Such a peer is pinged at most
+ * every LNET_PEER_RAIL_PING_INTERVAL seconds.
+ */
+void
+lnet_peer_rail_learn(lnet_nid_t primary, lnet_nid_t rail)
+{
+	struct lnet_peer_rail	*lpr;
+	bool			ping = true;
+	int			cpt;
+
+	cpt = lnet_net_lock_current();
+	lpr = lnet_peer_rail_find_locked(primary);
+	if (lpr != NULL)
+		ping = !lnet_peer_rail_has_locked(lpr, rail) &&
+		       lnet_peer_rail_ping_due_locked(lpr);
+	lnet_net_unlock(cpt);
+
+	if (ping)
+		lnet_peer_rail_ping(primary);
+}
+
+int
+lnet_peer_rail_discovery_start(void)
+{
+	lnet_handle_eq_t	eqh;
+	int			rc;
+
+	atomic_set(&the_lnet.ln_rail_npings, 0);
+
+	rc = LNetEQAlloc(0, lnet_peer_rail_ping_event, &eqh);
+	if (rc != 0) {
+		CERROR("Can't allocate rail discovery EQ: %d\n", rc);
+		return rc;
+	}
+
+	lnet_net_lock(LNET_LOCK_EX);
+	the_lnet.ln_rail_eqh = eqh;
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	return 0;
+}
+
+/* take the MD of one discovery ping still in flight */
+static bool
+lnet_peer_rail_next_ping_locked(lnet_handle_md_t *mdh)
+{
+	struct lnet_peer_rail	*lpr;
+	int			i;
+
+	for (i = 0; i < LNET_PEER_HASH_SIZE; i++) {
+		list_for_each_entry(lpr, &the_lnet.ln_peer_rails[i],
+				    lpr_list) {
+			if (LNetHandleIsInvalid(lpr->lpr_mdh))
+				continue;
+
+			*mdh = lpr->lpr_mdh;
+			LNetInvalidateHandle(&lpr->lpr_mdh);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+lnet_peer_rail_discovery_stop(void)
+{
+	lnet_handle_eq_t	eqh = the_lnet.ln_rail_eqh;
+	lnet_handle_md_t	mdh;
+	bool			found;
+	int			i = 0;
+	int			rc;
+
+	if (LNetHandleIsInvalid(eqh))
+		return;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	LNetInvalidateHandle(&the_lnet.ln_rail_eqh);
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	/* NB: MDs can't be unlinked under lnet_net_lock, which the event
+	 * callback takes under lnet_res_lock */
+	do {
+		lnet_net_lock(LNET_LOCK_EX);
+		found = lnet_peer_rail_next_ping_locked(&mdh);
+		lnet_net_unlock(LNET_LOCK_EX);
+
+		if (found)
+			LNetMDUnlink(mdh);
+	} while (found);
+
+	while (atomic_read(&the_lnet.ln_rail_npings) != 0) {
+		i++;
+		CDEBUG(((i & (-i)) == i) ? D_WARNING : D_NET,
+		       "Waiting for %d rail discovery pings to unlink\n",
+		       atomic_read(&the_lnet.ln_rail_npings));
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_timeout(cfs_time_seconds(1) / 4);
+	}
+
+	rc = LNetEQFree(eqh);
+	LASSERT(rc == 0);
+}
+
+/**
+ * Pick the rail of multi-rail peer \a nid whose local NI has the most free
+ * tx credits on the rail's CPT, rotating among equally loaded rails.
+ *
+ * \retval LNET_NID_ANY if \a nid isn't a multi-rail peer on a local network
+ * \retval rail NID otherwise, with our own NID on the primary's network
+ *	   returned in \a self
+ */
+lnet_nid_t
+lnet_peer_rail_select_locked(lnet_nid_t nid, int cpt, lnet_nid_t *self)
+{
+	struct lnet_peer_rail	*lpr;
+	struct lnet_ni		*ni;
+	lnet_nid_t		rail;
+	int			best = -1;
+	int			best_credits = 0;
+	int			credits;
+	int			start;
+	int			i;
+	int			j;
+
+	lpr = lnet_peer_rail_find_locked(nid);
+	if (lpr == NULL || lpr->lpr_nrails < 2)
+		return LNET_NID_ANY;
+
+	ni = lnet_net2ni_locked(LNET_NIDNET(nid), cpt);
+	if (ni == NULL)
+		return LNET_NID_ANY;
+
+	*self = ni->ni_nid;
+	lnet_ni_decref_locked(ni, cpt);
+
+	start = atomic_inc_return(&lpr->lpr_rotor);
+	for (i = 0; i < lpr->lpr_nrails; i++) {
+		j = (unsigned int)(start + i) % lpr->lpr_nrails;
+		rail = lpr->lpr_rails[j];
+
+		ni = lnet_net2ni_locked(LNET_NIDNET(rail), cpt);
+		if (ni == NULL)
+			continue;
+
+		/* NB: the queue may belong to another CPT whose lock isn't
+		 * held; a stale value only costs a less than ideal choice */
+		credits = ACCESS_ONCE(ni->ni_tx_queues[
+				lnet_cpt_of_nid_locked(rail)]->tq_credits);
+		lnet_ni_decref_locked(ni, cpt);
+
+		if (best < 0 || credits > best_credits) {
+			best = j;
+			best_credits = credits;
+		}
+	}
+
+	if (best < 0)
+		return LNET_NID_ANY;
+
+	atomic_inc(&lpr->lpr_nsent[best]);
+	return lpr->lpr_rails[best];
+}
+
+/**
+ * Parse the peer_rails module parameter, a ';' separated list of peers
+ * each given as a ',' separated list of its NIDs, primary NID first, e.g.
+ * "192.168.1.5@tcp,192.168.2.5@tcp1;192.168.1.6@tcp,192.168.2.6@tcp1"
+ */
+int
+lnet_parse_peer_rails(char *str)
+{
+	char		*buf;
+	char		*peer;
+	char		*next;
+	char		*tok;
+	lnet_nid_t	primary;
+	lnet_nid_t	nid;
+	int		len = strlen(str) + 1;
+	int		rc = 0;
+
+	if (len == 1)
+		return 0;
+
+	LIBCFS_ALLOC(buf, len);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	memcpy(buf, str, len);
+	next = buf;
+
+	while (rc == 0 && (peer = strsep(&next, ";")) != NULL) {
+		primary = LNET_NID_ANY;
+
+		while ((tok = strsep(&peer, ",")) != NULL) {
+			tok = cfs_trimwhite(tok);
+			if (*tok == '\0')
+				continue;
+
+			nid = libcfs_str2nid(tok);
+			if (nid == LNET_NID_ANY) {
+				rc = -EINVAL;
+				break;
+			}
+
+			if (primary == LNET_NID_ANY) {
+				primary = nid;
+				continue;
+			}
+
+			rc = lnet_peer_rail_add(primary, nid);
+			if (rc != 0)
+				break;
+		}
+
+		if (rc != 0)
+			LCONSOLE_ERROR_MSG(0x125, "Invalid peer_rails entry "
+					   "%s: %d\n", tok, rc);
+	}
+
+	LIBCFS_FREE(buf, len);
+	return rc;
+}
@@ -167,7 +167,7 @@ lnet_ni_notify_locked(lnet_ni_t *ni, lnet_peer_t *lp)
 static void
 lnet_rtr_addref_locked(lnet_peer_t *lp)
 {
-	LASSERT(lp->lp_refcount > 0);
+	LASSERT(atomic_read(&lp->lp_refcount) > 0);
 	LASSERT(lp->lp_rtr_refcount >= 0);
 
 	/* lnet_net_lock must be exclusively locked */
@@ -194,7 +194,7 @@ lnet_rtr_addref_locked(lnet_peer_t *lp)
 static void
 lnet_rtr_decref_locked(lnet_peer_t *lp)
 {
-	LASSERT(lp->lp_refcount > 0);
+	LASSERT(atomic_read(&lp->lp_refcount) > 0);
 	LASSERT(lp->lp_rtr_refcount > 0);
 
 	/* lnet_net_lock must be exclusively locked */
@@ -780,6 +780,16 @@ lnet_router_checker_event(lnet_event_t *event)
 	 * XXX If 'lp' stops being a router before then, it will still
 	 * have the notification pending!!! */
 
+	if (event->status == 0) {
+		long rtt = ktime_us_delta(ktime_get(), lp->lp_ping_sent);
+
+		/* feeds the weights of lnet_find_route_locked() */
+		if (lp->lp_rtt_avg == 0)
+			lp->lp_rtt_avg = rtt << LNET_EWMA_SHIFT;
+		else
+			lnet_ewma_add(&lp->lp_rtt_avg, rtt);
+	}
+
 	if (avoid_asym_router_failure && event->status == 0)
 		lnet_parse_rc_info(rcd);
 
@@ -1028,6 +1038,7 @@ lnet_ping_router_locked (lnet_peer_t *rtr)
 
 		rtr->lp_ping_notsent   = 1;
 		rtr->lp_ping_timestamp = now;
+		rtr->lp_ping_sent      = ktime_get();
 
 		mdh = rcd->rcd_mdh;
 
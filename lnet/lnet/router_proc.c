@@ -133,6 +133,32 @@ proc_lnet_stats(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_stats);
 }
 
+/* the @skip'th route of all remote nets, called with lnet_net_lock(0) */
+static lnet_route_t *
+lnet_proc_route_locked(int skip, lnet_remotenet_t **rnetp)
+{
+	struct list_head	*rn_list;
+	lnet_remotenet_t	*rnet;
+	lnet_route_t		*route;
+	int			i;
+
+	for (i = 0; i < LNET_REMOTE_NETS_HASH_SIZE; i++) {
+		rn_list = &the_lnet.ln_remote_nets_hash[i];
+
+		list_for_each_entry(rnet, rn_list, lrn_list) {
+			list_for_each_entry(route, &rnet->lrn_routes, lr_list) {
+				if (skip == 0) {
+					*rnetp = rnet;
+					return route;
+				}
+				skip--;
+			}
+		}
+	}
+
+	return NULL;
+}
+
 static int
 proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 		 size_t *lenp, loff_t *ppos)
@@ -175,13 +201,8 @@ proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 		lnet_net_unlock(0);
 		*ppos = LNET_PROC_POS_MAKE(0, ver, 0, off);
 	} else {
-		struct list_head	*n;
-		struct list_head	*r;
-		lnet_route_t		*route = NULL;
-		lnet_remotenet_t	*rnet  = NULL;
-		int			skip  = off - 1;
-		struct list_head	*rn_list;
-		int			i;
+		lnet_route_t		*route;
+		lnet_remotenet_t	*rnet;
 
 		lnet_net_lock(0);
 
@@ -191,34 +212,7 @@ proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 			return -ESTALE;
 		}
 
-		for (i = 0; i < LNET_REMOTE_NETS_HASH_SIZE && route == NULL;
-		     i++) {
-			rn_list = &the_lnet.ln_remote_nets_hash[i];
-
-			n = rn_list->next;
-
-			while (n != rn_list && route == NULL) {
-				rnet = list_entry(n, lnet_remotenet_t,
-						  lrn_list);
-
-				r = rnet->lrn_routes.next;
-
-				while (r != &rnet->lrn_routes) {
-					lnet_route_t *re =
-						list_entry(r, lnet_route_t,
-							   lr_list);
-					if (skip == 0) {
-						route = re;
-						break;
-					}
-
-					skip--;
-					r = r->next;
-				}
-
-				n = n->next;
-			}
-		}
+		route = lnet_proc_route_locked(off - 1, &rnet);
 
 		if (route != NULL) {
 			__u32	     net	= rnet->lrn_net;
@@ -260,6 +254,95 @@ proc_lnet_routes(struct ctl_table *table, int write, void __user *buffer,
 	return rc;
 }
 
+static int
+proc_lnet_route_stats(struct ctl_table *table, int write,
+		      void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	const int	tmpsiz = 256;
+	char		*tmpstr;
+	char		*s;
+	int		rc = 0;
+	int		len;
+	int		ver;
+	int		off;
+
+	off = LNET_PROC_HOFF_GET(*ppos);
+	ver = LNET_PROC_VER_GET(*ppos);
+
+	LASSERT(!write);
+
+	if (*lenp == 0)
+		return 0;
+
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	if (*ppos == 0) {
+		s += snprintf(s, tmpstr + tmpsiz - s,
+			      "%-8s %-20s %10s %7s %8s %s\n", "net", "router", "selected", "credits",
+			      "rtt_us", "state");
+		LASSERT(tmpstr + tmpsiz - s > 0);
+
+		lnet_net_lock(0);
+		ver = (unsigned int)the_lnet.ln_remote_nets_version;
+		lnet_net_unlock(0);
+		*ppos = LNET_PROC_POS_MAKE(0, ver, 0, off);
+	} else {
+		lnet_route_t		*route;
+		lnet_remotenet_t	*rnet;
+
+		lnet_net_lock(0);
+
+		if (ver != LNET_PROC_VERSION(the_lnet.ln_remote_nets_version)) {
+			lnet_net_unlock(0);
+			LIBCFS_FREE(tmpstr, tmpsiz);
+			return -ESTALE;
+		}
+
+		route = lnet_proc_route_locked(off - 1, &rnet);
+		if (route != NULL) {
+			lnet_peer_t *lp = route->lr_gateway;
+
+			/* averages are scaled by 1 << LNET_EWMA_SHIFT */
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%-8s %-20s %10lu %7ld %8ld %s\n",
+				      libcfs_net2str(rnet->lrn_net),
+				      libcfs_nid2str(lp->lp_nid),
+				      route->lr_nselected,
+				      lp->lp_txcredits_avg >> LNET_EWMA_SHIFT,
+				      lp->lp_rtt_avg >> LNET_EWMA_SHIFT,
+				      lnet_is_route_alive(route) ?
+				      "up" : "down");
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+
+		lnet_net_unlock(0);
+	}
+
+	len = s - tmpstr;     /* how many bytes was written */
+
+	if (len > *lenp) {    /* linux-supplied buffer is too small */
+		rc = -EINVAL;
+	} else if (len > 0) { /* wrote something */
+		if (copy_to_user(buffer, tmpstr, len))
+			rc = -EFAULT;
+		else {
+			off += 1;
+			*ppos = LNET_PROC_POS_MAKE(0, ver, 0, off);
+		}
+	}
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+
+	if (rc == 0)
+		*lenp = len;
+
+	return rc;
+}
+
 static int
 proc_lnet_routers(struct ctl_table *table, int write, void __user *buffer,
 		  size_t *lenp, loff_t *ppos)
@@ -331,7 +414,7 @@ proc_lnet_routers(struct ctl_table *table, int write, void __user *buffer,
 			lnet_nid_t nid = peer->lp_nid;
 			cfs_time_t now = cfs_time_current();
 			cfs_time_t deadline = peer->lp_ping_deadline;
-			int nrefs     = peer->lp_refcount;
+			int nrefs     = atomic_read(&peer->lp_refcount);
 			int nrtrrefs  = peer->lp_rtr_refcount;
 			int alive_cnt = peer->lp_alive_count;
 			int alive     = peer->lp_alive;
@@ -396,9 +479,11 @@ proc_lnet_routers(struct ctl_table *table, int write, void __user *buffer,
 	return rc;
 }
 
+/* list LNet's view of each peer, or the LND's view of its connections to it
+ * if \a conns */
 static int
-proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
-		size_t *lenp, loff_t *ppos)
+__proc_lnet_peers(int write, void __user *buffer, size_t *lenp, loff_t *ppos,
+		  int conns)
 {
 	const int		tmpsiz	= 256;
 	struct lnet_peer_table	*ptable;
@@ -428,7 +513,14 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 
 	s = tmpstr; /* points to current position in tmpstr[] */
 
-	if (*ppos == 0) {
+	if (*ppos == 0 && conns) {
+		s += snprintf(s, tmpstr + tmpsiz - s,
+			      "%-24s %5s %8s %8s %5s %s\n",
+			      "nid", "conns", "rtt", "rttvar", "txq", "stall");
+		LASSERT(tmpstr + tmpsiz - s > 0);
+
+		hoff++;
+	} else if (*ppos == 0) {
 		s += snprintf(s, tmpstr + tmpsiz - s,
 			      "%-24s %4s %5s %5s %5s %5s %5s %5s %5s %s\n",
 			      "nid", "refs", "state", "last", "max",
@@ -494,7 +586,7 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 
 		if (peer != NULL) {
 			lnet_nid_t nid	     = peer->lp_nid;
-			int	   nrefs     = peer->lp_refcount;
+			int	   nrefs     = atomic_read(&peer->lp_refcount);
 			int	   lastalive = -1;
 			char	  *aliveness = "NA";
 			int	   maxcr     = peer->lp_ni->ni_peertxcredits;
@@ -525,11 +617,25 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 
 			lnet_net_unlock(cpt);
 
-			s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%-24s %4d %5s %5d %5d %5d %5d %5d %5d %d\n",
-				      libcfs_nid2str(nid), nrefs, aliveness,
-				      lastalive, maxcr, rtrcr, minrtrcr, txcr,
-				      mintxcr, txqnob);
+			if (conns) {
+				lnet_conn_stats_t stats;
+
+				/* all 0 if not connected */
+				LNetPeerConnStats(nid, &stats);
+				s += snprintf(s, tmpstr + tmpsiz - s,
+					      "%-24s %5u %8u %8u %5u %llu\n",
+					      libcfs_nid2str(nid),
+					      stats.lcs_nconns, stats.lcs_rtt,
+					      stats.lcs_rttvar, stats.lcs_txq,
+					      stats.lcs_stall);
+			} else {
+				s += snprintf(s, tmpstr + tmpsiz - s,
+					      "%-24s %4d %5s %5d %5d %5d %5d %5d %5d %d\n",
+					      libcfs_nid2str(nid), nrefs,
+					      aliveness, lastalive, maxcr,
+					      rtrcr, minrtrcr, txcr, mintxcr,
+					      txqnob);
+			}
 			LASSERT(tmpstr + tmpsiz - s > 0);
 
 		} else { /* peer is NULL */
@@ -564,6 +670,20 @@ proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
 	return rc;
 }
 
+static int
+proc_lnet_peers(struct ctl_table *table, int write, void __user *buffer,
+		size_t *lenp, loff_t *ppos)
+{
+	return __proc_lnet_peers(write, buffer, lenp, ppos, 0);
+}
+
+static int
+proc_lnet_peer_conns(struct ctl_table *table, int write, void __user *buffer,
+		     size_t *lenp, loff_t *ppos)
+{
+	return __proc_lnet_peers(write, buffer, lenp, ppos, 1);
+}
+
 static int __proc_lnet_buffers(void *data, int write,
 			       loff_t pos, void __user *buffer, int nob)
 {
@@ -630,6 +750,85 @@ proc_lnet_buffers(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_buffers);
 }
 
+static int __proc_lnet_eqs(void *data, int write,
+			   loff_t pos, void __user *buffer, int nob)
+{
+	struct lnet_eq	*eq;
+	lnet_eq_stats_t	*stats;
+	char		*s;
+	char		*tmpstr;
+	int		tmpsiz;
+	int		neq = 0;
+	int		len;
+	int		rc;
+	int		i;
+
+	LASSERT(!write);
+
+	lnet_eq_wait_lock();
+	if (the_lnet.ln_eq_container.rec_type != 0) { /* LNet is up */
+		list_for_each_entry(eq, &the_lnet.ln_eq_container.rec_active,
+				    eq_list)
+			neq++;
+	}
+	lnet_eq_wait_unlock();
+
+	/* one line per EQ and CPT, EQs allocated meanwhile are skipped */
+	tmpsiz = 128 * (neq * LNET_CPT_NUMBER + 1);
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s,
+		      "%-18s %-32s %5s %3s %12s %12s %10s\n",
+		      "eq", "callback", "size", "cpt",
+		      "events", "queued", "contended");
+	LASSERT(tmpstr + tmpsiz - s > 0);
+
+	lnet_eq_wait_lock();
+	if (the_lnet.ln_eq_container.rec_type == 0)
+		goto out;
+
+	list_for_each_entry(eq, &the_lnet.ln_eq_container.rec_active,
+			    eq_list) {
+		if (neq-- == 0)
+			break;
+
+		cfs_percpt_for_each(stats, i, eq->eq_stats) {
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%#-18llx %-32ps %5u %3d %12llu %12llu "
+				      "%10llu\n", eq->eq_lh.lh_cookie,
+				      (void *)eq->eq_callback, eq->eq_size, i,
+				      stats->es_events, stats->es_queued,
+				      stats->es_contended);
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+	}
+ out:
+	lnet_eq_wait_unlock();
+
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+static int
+proc_lnet_eqs(struct ctl_table *table, int write, void __user *buffer,
+	      size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_eqs);
+}
+
 static int
 proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 	      size_t *lenp, loff_t *ppos)
@@ -787,6 +986,84 @@ static struct lnet_portal_rotors	portal_rotors[] = {
 	},
 };
 
+static int
+proc_lnet_peer_rails(struct ctl_table *table, int write, void __user *buffer,
+		     size_t *lenp, loff_t *ppos)
+{
+	int	tmpsiz = 64 * (LNET_PEER_RAILS_MAX + 1);
+	int	rc = 0;
+	char	*tmpstr;
+	char	*s;
+	int	len;
+
+	LASSERT(!write);
+
+	if (*lenp == 0)
+		return 0;
+
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	if (*ppos == 0) {
+		s += snprintf(s, tmpstr + tmpsiz - s, "%-24s %s\n",
+			      "nid", "rails (sent)");
+		LASSERT(tmpstr + tmpsiz - s > 0);
+	} else {
+		struct lnet_peer_rail	*lpr = NULL;
+		struct lnet_peer_rail	*tmp;
+		int			skip = *ppos - 1;
+		int			i;
+
+		lnet_net_lock(0);
+
+		for (i = 0; the_lnet.ln_peer_rails != NULL &&
+			    i < LNET_PEER_HASH_SIZE && lpr == NULL; i++) {
+			list_for_each_entry(tmp, &the_lnet.ln_peer_rails[i],
+					    lpr_list) {
+				if (skip-- == 0) {
+					lpr = tmp;
+					break;
+				}
+			}
+		}
+
+		if (lpr != NULL) {
+			s += snprintf(s, tmpstr + tmpsiz - s, "%-24s",
+				      libcfs_nid2str(lpr->lpr_primary));
+			for (i = 0; i < lpr->lpr_nrails; i++)
+				s += snprintf(s, tmpstr + tmpsiz - s,
+					      " %s (%d)",
+					      libcfs_nid2str(lpr->lpr_rails[i]),
+					      atomic_read(&lpr->lpr_nsent[i]));
+			s += snprintf(s, tmpstr + tmpsiz - s, "\n");
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+
+		lnet_net_unlock(0);
+	}
+
+	len = s - tmpstr;     /* how many bytes was written */
+
+	if (len > *lenp) {    /* linux-supplied buffer is too small */
+		rc = -EINVAL;
+	} else if (len > 0) { /* wrote something */
+		if (copy_to_user(buffer, tmpstr, len))
+			rc = -EFAULT;
+		else
+			*ppos += 1;
+	}
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+
+	if (rc == 0)
+		*lenp = len;
+
+	return rc;
+}
+
 static int __proc_lnet_portal_rotor(void *data, int write,
 				    loff_t pos, void __user *buffer, int nob)
 {
@@ -874,6 +1151,12 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_lnet_routes,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "route_stats",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_route_stats,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "routers",
@@ -886,6 +1169,12 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_lnet_peers,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "peer_conns",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_peer_conns,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "buffers",
@@ -904,6 +1193,18 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0644,
 		.proc_handler	= &proc_lnet_portal_rotor,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "peer_rails",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_peer_rails,
+	},
+	{
+		INIT_CTL_NAME
+		.procname	= "eqs",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_eqs,
+	},
 	{ 0 }
 };
 
@@ -75,6 +75,7 @@ brw_client_init (sfw_test_instance_t *tsi)
 	int		  npg;
 	int		  len;
 	int		  opc;
+	int		  mix = 0;
 	srpc_bulk_t	 *bulk;
 	sfw_test_unit_t	 *tsu;
 
@@ -92,7 +93,7 @@ brw_client_init (sfw_test_instance_t *tsi)
 		len   = npg * PAGE_SIZE;
 		off   = 0;
 
-	} else {
+	} else if ((sn->sn_features & LST_FEAT_PROFILE) == 0) {
 		test_bulk_req_v1_t  *breq = &tsi->tsi_u.bulk_v1;
 
 		/* I should never get this step if it's unknown feature
@@ -104,6 +105,24 @@ brw_client_init (sfw_test_instance_t *tsi)
 		len   = breq->blk_len;
 		off   = breq->blk_offset & ~PAGE_MASK;
 		npg   = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+	} else {
+		test_bulk_req_v2_t  *breq = &tsi->tsi_u.bulk_v2;
+
+		LASSERT((sn->sn_features & ~LST_FEATS_MASK) == 0);
+
+		if (breq->blk_len == 0 || breq->blk_write_pct > 100)
+			return -EINVAL;
+
+		opc   = breq->blk_opc;
+		flags = breq->blk_flags;
+		/* buffers fit the largest RPC of the profile */
+		len   = max(breq->blk_len, breq->blk_len_max);
+		off   = breq->blk_offset & ~PAGE_MASK;
+		npg   = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+		mix   = 1;
+
+		tsi->tsi_think = breq->blk_think;
 	}
 
 	if (off % BRW_MSIZE != 0)
@@ -112,7 +131,8 @@ brw_client_init (sfw_test_instance_t *tsi)
 	if (npg > LNET_MAX_IOV || npg <= 0)
 		return -EINVAL;
 
-	if (opc != LST_BRW_READ && opc != LST_BRW_WRITE)
+	if (opc != LST_BRW_READ && opc != LST_BRW_WRITE &&
+	    !(opc == LST_BRW_MIX && mix))
 		return -EINVAL;
 
 	if (flags != LST_BRW_CHECK_NONE &&
@@ -226,36 +246,39 @@ bad_data:
 	return 1;
 }
 
+/* only the first @nob bytes are transferred, the bulk can be larger */
 static void
-brw_fill_bulk(srpc_bulk_t *bk, int pattern, __u64 magic)
+brw_fill_bulk(srpc_bulk_t *bk, int pattern, __u64 magic, int nob)
 {
 	int	     i;
 	struct page *pg;
 
-	for (i = 0; i < bk->bk_niov; i++) {
+	for (i = 0; i < bk->bk_niov && nob > 0; i++) {
 		int	off;
 		int	len;
 
 		pg = bk->bk_iovs[i].kiov_page;
 		off = bk->bk_iovs[i].kiov_offset;
-		len = bk->bk_iovs[i].kiov_len;
+		len = min_t(int, bk->bk_iovs[i].kiov_len, nob);
 		brw_fill_page(pg, off, len, pattern, magic);
+		nob -= len;
 	}
 }
 
 static int
-brw_check_bulk(srpc_bulk_t *bk, int pattern, __u64 magic)
+brw_check_bulk(srpc_bulk_t *bk, int pattern, __u64 magic, int nob)
 {
 	int	     i;
 	struct page *pg;
 
-	for (i = 0; i < bk->bk_niov; i++) {
+	for (i = 0; i < bk->bk_niov && nob > 0; i++) {
 		int	off;
 		int	len;
 
 		pg = bk->bk_iovs[i].kiov_page;
 		off = bk->bk_iovs[i].kiov_offset;
-		len = bk->bk_iovs[i].kiov_len;
+		len = min_t(int, bk->bk_iovs[i].kiov_len, nob);
+		nob -= len;
 		if (brw_check_page(pg, off, len, pattern, magic) != 0) {
 			CERROR("Bulk page %p (%d/%d) is corrupted!\n",
 			       pg, i, bk->bk_niov);
@@ -266,6 +289,19 @@ brw_check_bulk(srpc_bulk_t *bk, int pattern, __u64 magic)
 	return 0;
 }
 
+/* Length of the next RPC of a profile, uniformly in [blk_len, blk_len_max]
+ * and a multiple of BRW_MSIZE past blk_len for data checking */
+static int
+brw_client_rpc_len(test_bulk_req_v2_t *breq)
+{
+	if (breq->blk_len_max <= breq->blk_len)
+		return breq->blk_len;
+
+	return breq->blk_len +
+	       ((cfs_rand() % (breq->blk_len_max - breq->blk_len + 1)) &
+		~(BRW_MSIZE - 1));
+}
+
 static int
 brw_client_prep_rpc(sfw_test_unit_t *tsu,
 		    lnet_process_id_t dest, srpc_client_rpc_t **rpcpp)
@@ -292,7 +328,7 @@ brw_client_prep_rpc(sfw_test_unit_t *tsu,
 		npg   = breq->blk_npg;
 		len   = npg * PAGE_SIZE;
 
-	} else {
+	} else if ((sn->sn_features & LST_FEAT_PROFILE) == 0) {
 		test_bulk_req_v1_t  *breq = &tsi->tsi_u.bulk_v1;
 		int		     off;
 
@@ -305,6 +341,18 @@ brw_client_prep_rpc(sfw_test_unit_t *tsu,
 		len   = breq->blk_len;
 		off   = breq->blk_offset;
 		npg   = (off + len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+	} else {
+		test_bulk_req_v2_t  *breq = &tsi->tsi_u.bulk_v2;
+
+		opc   = breq->blk_opc;
+		if (opc == LST_BRW_MIX)
+			opc = cfs_rand() % 100 < breq->blk_write_pct ?
+			      LST_BRW_WRITE : LST_BRW_READ;
+		flags = breq->blk_flags;
+		len   = brw_client_rpc_len(breq);
+		/* the whole buffer is posted, the server moves len bytes */
+		npg   = bulk->bk_niov;
 	}
 
 	rc = sfw_create_test_rpc(tsu, dest, sn->sn_features, npg, len, &rpc);
@@ -312,10 +360,11 @@ brw_client_prep_rpc(sfw_test_unit_t *tsu,
 		return rc;
 
 	memcpy(&rpc->crpc_bulk, bulk, offsetof(srpc_bulk_t, bk_iovs[npg]));
+	rpc->crpc_bulk.bk_sink = opc == LST_BRW_READ;
 	if (opc == LST_BRW_WRITE)
-		brw_fill_bulk(&rpc->crpc_bulk, flags, BRW_MAGIC);
+		brw_fill_bulk(&rpc->crpc_bulk, flags, BRW_MAGIC, len);
 	else
-		brw_fill_bulk(&rpc->crpc_bulk, flags, BRW_POISON);
+		brw_fill_bulk(&rpc->crpc_bulk, flags, BRW_POISON, len);
 
 	req = &rpc->crpc_reqstmsg.msg_body.brw_reqst;
 	req->brw_flags = flags;
@@ -364,7 +413,8 @@ brw_client_done_rpc(sfw_test_unit_t *tsu, srpc_client_rpc_t *rpc)
 	if (reqst->brw_rw == LST_BRW_WRITE)
 		return;
 
-	if (brw_check_bulk(&rpc->crpc_bulk, reqst->brw_flags, magic) != 0) {
+	if (brw_check_bulk(&rpc->crpc_bulk, reqst->brw_flags, magic,
+			   reqst->brw_len) != 0) {
 		CERROR("Bulk data from %s is corrupted!\n",
 		       libcfs_id2str(rpc->crpc_dest));
 		atomic_inc(&sn->sn_brw_errors);
@@ -421,7 +471,8 @@ brw_bulk_ready(srpc_server_rpc_t *rpc, int status)
         if (reqstmsg->msg_magic != SRPC_MSG_MAGIC)
                 __swab64s(&magic);
 
-        if (brw_check_bulk(rpc->srpc_bulk, reqst->brw_flags, magic) != 0) {
+        if (brw_check_bulk(rpc->srpc_bulk, reqst->brw_flags, magic,
+			   reqst->brw_len) != 0) {
                 CERROR ("Bulk data from %s is corrupted!\n",
                         libcfs_id2str(rpc->srpc_peer));
                 reply->brw_status = EBADMSG;
@@ -497,9 +548,11 @@ brw_server_handle(struct srpc_server_rpc *rpc)
 		return rc;
 
         if (reqst->brw_rw == LST_BRW_READ)
-                brw_fill_bulk(rpc->srpc_bulk, reqst->brw_flags, BRW_MAGIC);
+		brw_fill_bulk(rpc->srpc_bulk, reqst->brw_flags, BRW_MAGIC,
+			      reqst->brw_len);
         else
-                brw_fill_bulk(rpc->srpc_bulk, reqst->brw_flags, BRW_POISON);
+		brw_fill_bulk(rpc->srpc_bulk, reqst->brw_flags, BRW_POISON,
+			      reqst->brw_len);
 
         return 0;
 }
@@ -806,6 +806,24 @@ lstcon_bulkrpc_v1_prep(lst_test_bulk_param_t *param, bool is_client,
 	return 0;
 }
 
+static int
+lstcon_bulkrpc_v2_prep(lst_test_bulk_param_t *param, bool is_client,
+		       srpc_test_reqst_t *req)
+{
+	test_bulk_req_v2_t *brq = &req->tsr_u.bulk_v2;
+
+	brq->blk_opc	   = param->blk_opc;
+	brq->blk_flags	   = param->blk_flags;
+	brq->blk_len	   = param->blk_size;
+	brq->blk_offset	   = is_client ? param->blk_cli_off :
+					 param->blk_srv_off;
+	brq->blk_len_max   = param->blk_size_max;
+	brq->blk_write_pct = param->blk_write_pct;
+	brq->blk_think	   = param->blk_think;
+
+	return 0;
+}
+
 int
 lstcon_testrpc_prep(lstcon_node_t *nd, int transop, unsigned feats,
                     lstcon_test_t *test, lstcon_rpc_t **crpc)
@@ -899,10 +917,14 @@ lstcon_testrpc_prep(lstcon_node_t *nd, int transop, unsigned feats,
 		if ((feats & LST_FEAT_BULK_LEN) == 0) {
 			rc = lstcon_bulkrpc_v0_prep((lst_test_bulk_param_t *)
 						    &test->tes_param[0], trq);
-		} else {
+		} else if ((feats & LST_FEAT_PROFILE) == 0) {
 			rc = lstcon_bulkrpc_v1_prep((lst_test_bulk_param_t *)
 						    &test->tes_param[0],
 						    trq->tsr_is_client, trq);
+		} else {
+			rc = lstcon_bulkrpc_v2_prep((lst_test_bulk_param_t *)
+						    &test->tes_param[0],
+						    trq->tsr_is_client, trq);
 		}
 
                 break;
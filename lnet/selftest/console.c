@@ -1396,6 +1396,16 @@ lstcon_tsbrpc_readent(int transop, srpc_msg_t *msg,
                              &rep->bar_active, sizeof(rep->bar_active)))
                 return -EFAULT;
 
+	/* latency percentiles of a test, zero when queried for a batch */
+	if ((msg->msg_ses_feats & LST_FEAT_PROFILE) != 0 &&
+	    (copy_to_user(&ent_up->rpe_priv[1], &rep->bar_lat_p50,
+			  sizeof(rep->bar_lat_p50)) ||
+	     copy_to_user(&ent_up->rpe_priv[2], &rep->bar_lat_p99,
+			  sizeof(rep->bar_lat_p99)) ||
+	     copy_to_user(&ent_up->rpe_priv[3], &rep->bar_lat_p999,
+			  sizeof(rep->bar_lat_p999))))
+		return -EFAULT;
+
         return 0;
 }
 
@@ -639,6 +639,7 @@ sfw_destroy_test_instance (sfw_test_instance_t *tsi)
 		tsu = list_entry(tsi->tsi_units.next,
 				 sfw_test_unit_t, tsu_list);
 		list_del(&tsu->tsu_list);
+		cancel_delayed_work_sync(&tsu->tsu_think_work);
 		LIBCFS_FREE(tsu, sizeof(*tsu));
 	}
 
@@ -715,13 +716,24 @@ sfw_unpack_addtest_req(srpc_msg_t *msg)
 			__swab32s(&bulk->blk_npg);
 			__swab32s(&bulk->blk_flags);
 
-		} else {
+		} else if ((msg->msg_ses_feats & LST_FEAT_PROFILE) == 0) {
 			test_bulk_req_v1_t *bulk = &req->tsr_u.bulk_v1;
 
 			__swab16s(&bulk->blk_opc);
 			__swab16s(&bulk->blk_flags);
 			__swab32s(&bulk->blk_offset);
 			__swab32s(&bulk->blk_len);
+
+		} else {
+			test_bulk_req_v2_t *bulk = &req->tsr_u.bulk_v2;
+
+			__swab16s(&bulk->blk_opc);
+			__swab16s(&bulk->blk_flags);
+			__swab32s(&bulk->blk_offset);
+			__swab32s(&bulk->blk_len);
+			__swab32s(&bulk->blk_len_max);
+			__swab32s(&bulk->blk_write_pct);
+			__swab32s(&bulk->blk_think);
 		}
 
 		return;
@@ -739,6 +751,15 @@ sfw_unpack_addtest_req(srpc_msg_t *msg)
 	return;
 }
 
+static void
+sfw_test_unit_think_done(struct work_struct *work)
+{
+	sfw_test_unit_t *tsu = container_of(work, sfw_test_unit_t,
+					    tsu_think_work.work);
+
+	swi_schedule_workitem(&tsu->tsu_worker);
+}
+
 static int
 sfw_add_test_instance (sfw_batch_t *tsb, srpc_server_rpc_t *rpc)
 {
@@ -818,6 +839,8 @@ sfw_add_test_instance (sfw_batch_t *tsb, srpc_server_rpc_t *rpc)
 			tsu->tsu_dest.pid = id.pid;
 			tsu->tsu_instance = tsi;
 			tsu->tsu_private  = NULL;
+			INIT_DELAYED_WORK(&tsu->tsu_think_work,
+					  sfw_test_unit_think_done);
 			list_add_tail(&tsu->tsu_list, &tsi->tsi_units);
 		}
 	}
@@ -877,6 +900,52 @@ sfw_test_unit_done (sfw_test_unit_t *tsu)
 	return;
 }
 
+static inline int
+sfw_lat_bucket(__u32 usec)
+{
+	int shift = fls(usec) - 1 - SFW_LAT_SUB_BITS;
+
+	if (shift <= 0)
+		return usec;
+
+	return (shift << SFW_LAT_SUB_BITS) + (usec >> shift);
+}
+
+/* the highest latency falling into bucket @idx */
+static __u32
+sfw_lat_bucket_max(int idx)
+{
+	int shift = (idx >> SFW_LAT_SUB_BITS) - 1;
+
+	if (shift <= 0)
+		return idx;
+
+	return (((__u64)(idx - (shift << SFW_LAT_SUB_BITS)) + 1) << shift) - 1;
+}
+
+/* @pct is in hundredths of a percent, i.e. 9990 for p99.9 */
+static __u32
+sfw_lat_percentile(sfw_lat_hist_t *lh, unsigned int pct)
+{
+	__u64	target;
+	__u64	sum = 0;
+	int	i;
+
+	if (lh->lh_count == 0)
+		return 0;
+
+	target = lh->lh_count * pct + 9999;
+	do_div(target, 10000);
+
+	for (i = 0; i < SFW_LAT_NBUCKETS - 1; i++) {
+		sum += lh->lh_buckets[i];
+		if (sum >= target)
+			break;
+	}
+
+	return sfw_lat_bucket_max(i);
+}
+
 static void
 sfw_test_rpc_done (srpc_client_rpc_t *rpc)
 {
@@ -893,6 +962,14 @@ sfw_test_rpc_done (srpc_client_rpc_t *rpc)
 
 	list_del_init(&rpc->crpc_list);
 
+	if (rpc->crpc_status == 0) {
+		s64 usec = ktime_us_delta(ktime_get(), rpc->crpc_posted);
+
+		tsi->tsi_latency.lh_count++;
+		tsi->tsi_latency.lh_buckets[sfw_lat_bucket(
+			min_t(s64, usec, UINT_MAX))]++;
+	}
+
         /* batch is stopping or loop is done or get error */
         if (tsi->tsi_stopping ||
             tsu->tsu_loop == 0 ||
@@ -905,7 +982,11 @@ sfw_test_rpc_done (srpc_client_rpc_t *rpc)
 	spin_unlock(&tsi->tsi_lock);
 
         if (!done) {
-                swi_schedule_workitem(&tsu->tsu_worker);
+		if (tsi->tsi_think != 0)
+			schedule_delayed_work(&tsu->tsu_think_work,
+					      usecs_to_jiffies(tsi->tsi_think));
+		else
+			swi_schedule_workitem(&tsu->tsu_worker);
                 return;
         }
 
@@ -988,6 +1069,7 @@ sfw_run_test (swi_workitem_t *wi)
 
 	spin_lock(&rpc->crpc_lock);
 	rpc->crpc_timeout = rpc_timeout;
+	rpc->crpc_posted = ktime_get();
 	srpc_post_rpc(rpc);
 	spin_unlock(&rpc->crpc_lock);
 	return 0;
@@ -1025,6 +1107,11 @@ sfw_run_batch (sfw_batch_t *tsb)
 		LASSERT(!tsi->tsi_stopping);
 		LASSERT(!sfw_test_active(tsi));
 
+		/* latency is reported for the current run only */
+		spin_lock(&tsi->tsi_lock);
+		memset(&tsi->tsi_latency, 0, sizeof(tsi->tsi_latency));
+		spin_unlock(&tsi->tsi_lock);
+
 		atomic_inc(&tsb->bat_nactive);
 
 		list_for_each_entry(tsu, &tsi->tsi_units, tsu_list) {
@@ -1101,6 +1188,15 @@ sfw_query_batch (sfw_batch_t *tsb, int testidx, srpc_batch_reply_t *reply)
                         continue;
 
 		reply->bar_active = atomic_read(&tsi->tsi_nactive);
+
+		spin_lock(&tsi->tsi_lock);
+		reply->bar_lat_p50  = sfw_lat_percentile(&tsi->tsi_latency,
+							 5000);
+		reply->bar_lat_p99  = sfw_lat_percentile(&tsi->tsi_latency,
+							 9900);
+		reply->bar_lat_p999 = sfw_lat_percentile(&tsi->tsi_latency,
+							 9990);
+		spin_unlock(&tsi->tsi_lock);
                 return 0;
         }
 
@@ -1528,6 +1624,9 @@ sfw_unpack_message (srpc_msg_t *msg)
 
                 __swab32s(&rep->bar_status);
                 sfw_unpack_sid(rep->bar_sid);
+		__swab32s(&rep->bar_lat_p50);
+		__swab32s(&rep->bar_lat_p99);
+		__swab32s(&rep->bar_lat_p999);
                 return;
         }
 
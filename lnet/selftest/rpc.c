@@ -838,7 +838,7 @@ srpc_prepare_bulk (srpc_client_rpc_t *rpc)
         if (bk->bk_niov == 0) return 0; /* nothing to do */
 
         opt = bk->bk_sink ? LNET_MD_OP_PUT : LNET_MD_OP_GET;
-        opt |= LNET_MD_KIOV;
+        opt |= LNET_MD_KIOV | LNET_MD_PAGE_LOAN;
 
         ev->ev_fired = 0;
         ev->ev_data  = rpc;
@@ -868,7 +868,7 @@ srpc_do_bulk (srpc_server_rpc_t *rpc)
         LASSERT (bk != NULL);
 
         opt = bk->bk_sink ? LNET_MD_OP_GET : LNET_MD_OP_PUT;
-        opt |= LNET_MD_KIOV;
+        opt |= LNET_MD_KIOV | LNET_MD_PAGE_LOAN;
 
         ev->ev_fired = 0;
         ev->ev_data  = rpc;
@@ -148,6 +148,10 @@ typedef struct {
         lst_sid_t               bar_sid;        /* session id */
         __u32                   bar_active;     /* # of active tests in batch/test */
         __u32                   bar_time;       /* remained time */
+	/* RPC latency percentiles of a test in usecs (LST_FEAT_PROFILE) */
+	__u32			bar_lat_p50;
+	__u32			bar_lat_p99;
+	__u32			bar_lat_p999;
 } WIRE_ATTR srpc_batch_reply_t;
 
 typedef struct {
@@ -181,6 +185,23 @@ typedef struct {
 	__u32                   blk_offset;
 } WIRE_ATTR test_bulk_req_v1_t;
 
+typedef struct {
+	/** bulk operation code, LST_BRW_MIX for both */
+	__u16			blk_opc;
+	/** data check flags */
+	__u16			blk_flags;
+	/** minimum data length */
+	__u32			blk_len;
+	/** bulk offset */
+	__u32                   blk_offset;
+	/** maximum data length, each RPC picks one in between */
+	__u32			blk_len_max;
+	/** percentage of writes for LST_BRW_MIX */
+	__u32			blk_write_pct;
+	/** think time between two RPCs of a test unit, in usecs */
+	__u32			blk_think;
+} WIRE_ATTR test_bulk_req_v2_t;
+
 typedef struct {
 	__u32			png_size;       /* size of ping message */
 	__u32			png_flags;      /* reserved flags */
@@ -203,6 +224,7 @@ typedef struct {
 		test_ping_req_t		ping;
 		test_bulk_req_t		bulk_v0;
 		test_bulk_req_v1_t	bulk_v1;
+		test_bulk_req_v2_t	bulk_v2;
 	}		tsr_u;
 } WIRE_ATTR srpc_test_reqst_t;
 
@@ -206,6 +206,7 @@ typedef struct srpc_client_rpc {
 	stt_timer_t		crpc_timer;
 	swi_workitem_t		crpc_wi;
 	lnet_process_id_t	crpc_dest;
+	ktime_t			crpc_posted;	/* for latency stats */
 
         void               (*crpc_done)(struct srpc_client_rpc *);
         void               (*crpc_fini)(struct srpc_client_rpc *);
@@ -347,6 +348,17 @@ typedef struct {
 	struct list_head	bat_tests;	/* test instances */
 } sfw_batch_t;
 
+/* HDR-style histogram of RPC latencies in usecs: every power of two is
+ * split in 2^SFW_LAT_SUB_BITS linear buckets, which keeps 3 significant
+ * bits of any value up to ~71 minutes in under 1KB */
+#define SFW_LAT_SUB_BITS	3
+#define SFW_LAT_NBUCKETS	((32 - SFW_LAT_SUB_BITS + 1) << SFW_LAT_SUB_BITS)
+
+typedef struct {
+	__u64			lh_count;
+	__u32			lh_buckets[SFW_LAT_NBUCKETS];
+} sfw_lat_hist_t;
+
 typedef struct {
         int  (*tso_init)(struct sfw_test_instance *tsi); /* intialize test client */
         void (*tso_fini)(struct sfw_test_instance *tsi); /* finalize test client */
@@ -368,6 +380,7 @@ typedef struct sfw_test_instance {
 	unsigned int		tsi_stoptsu_onerr:1; /* stop tsu on error */
         int                     tsi_concur;          /* concurrency */
         int                     tsi_loop;            /* loop count */
+	unsigned int		tsi_think;	     /* usecs between RPCs */
 
 	/* status of test instance */
 	spinlock_t		tsi_lock;	/* serialize */
@@ -376,11 +389,13 @@ typedef struct sfw_test_instance {
 	struct list_head	tsi_units;	/* test units */
 	struct list_head	tsi_free_rpcs;	/* free rpcs */
 	struct list_head	tsi_active_rpcs;/* active rpcs */
+	sfw_lat_hist_t		tsi_latency;	/* since the batch started */
 
 	union {
 		test_ping_req_t		ping;	  /* ping parameter */
 		test_bulk_req_t		bulk_v0;  /* bulk parameter */
 		test_bulk_req_v1_t	bulk_v1;  /* bulk v1 parameter */
+		test_bulk_req_v2_t	bulk_v2;  /* bulk v2 parameter */
 	} tsi_u;
 } sfw_test_instance_t;
 
@@ -398,6 +413,9 @@ typedef struct sfw_test_unit {
 	sfw_test_instance_t	*tsu_instance;	/* pointer to test instance */
 	void			*tsu_private;	/* private data */
 	swi_workitem_t		tsu_worker;	/* workitem of the test unit */
+	/* resumes the unit after think time, from process context since
+	 * workitems can't be scheduled from timers */
+	struct delayed_work	tsu_think_work;
 } sfw_test_unit_t;
 
 typedef struct sfw_test_case {
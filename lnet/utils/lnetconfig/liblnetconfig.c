@@ -1154,6 +1154,126 @@ out:
 	return rc;
 }
 
+int lustre_lnet_show_peer_conns(int seq_no, struct cYAML **show_rc,
+				struct cYAML **err_rc)
+{
+	struct lnet_ioctl_peer peer_info;
+	lnet_conn_stats_t *stats = &peer_info.pr_lnd_u.pr_peer_conns.cc_stats;
+	int rc = LUSTRE_CFG_RC_OUT_OF_MEM, ncpt = 1, i, j = 0;
+	int l_errno = 0;
+	struct cYAML *root = NULL, *peer = NULL, *first_seq = NULL,
+		     *peer_root = NULL;
+	char err_str[LNET_MAX_STR_LEN];
+
+	snprintf(err_str, sizeof(err_str),
+		 "\"out of memory\"");
+
+	/* create struct cYAML root object */
+	root = cYAML_create_object(NULL, NULL);
+	if (root == NULL)
+		goto out;
+
+	peer_root = cYAML_create_seq(root, "peer_conns");
+	if (peer_root == NULL)
+		goto out;
+
+	do {
+		for (i = 0;; i++) {
+			LIBCFS_IOC_INIT_V2(peer_info, pr_hdr);
+			peer_info.pr_count = i;
+			peer_info.pr_lnd_u.pr_peer_conns.cc_ncpt = j;
+			rc = l_ioctl(LNET_DEV_ID,
+				     IOC_LIBCFS_GET_PEER_CONNS, &peer_info);
+			if (rc != 0) {
+				l_errno = errno;
+				break;
+			}
+
+			peer = cYAML_create_seq_item(peer_root);
+			if (peer == NULL)
+				goto out;
+
+			if (first_seq == NULL)
+				first_seq = peer;
+
+			if (cYAML_create_string(peer, "nid",
+						libcfs_nid2str
+						 (peer_info.pr_nid)) == NULL)
+				goto out;
+
+			if (cYAML_create_number(peer, "conns",
+						stats->lcs_nconns) == NULL)
+				goto out;
+
+			if (cYAML_create_number(peer, "rtt_us",
+						stats->lcs_rtt) == NULL)
+				goto out;
+
+			if (cYAML_create_number(peer, "rttvar_us",
+						stats->lcs_rttvar) == NULL)
+				goto out;
+
+			if (cYAML_create_number(peer, "tx_queued",
+						stats->lcs_txq) == NULL)
+				goto out;
+
+			if (cYAML_create_number(peer, "stall_us",
+						stats->lcs_stall) == NULL)
+				goto out;
+		}
+
+		if (l_errno != ENOENT) {
+			snprintf(err_str,
+				sizeof(err_str),
+				"\"cannot get peer connections: %s\"",
+				strerror(l_errno));
+			rc = -l_errno;
+			goto out;
+		}
+
+		/* the kernel returns the number of CPTs in cc_ncpt */
+		ncpt = peer_info.pr_lnd_u.pr_peer_conns.cc_ncpt;
+		j++;
+	} while (j < ncpt);
+
+	/* print output iff show_rc is not provided */
+	if (show_rc == NULL)
+		cYAML_print_tree(root);
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+	rc = LUSTRE_CFG_RC_NO_ERR;
+
+out:
+	if (show_rc == NULL || rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_free_tree(root);
+	} else if (show_rc != NULL && *show_rc != NULL) {
+		struct cYAML *show_node;
+		/* find the peer_conns node, if one doesn't exist then
+		 * insert one.  Otherwise add to the one there
+		 */
+		show_node = cYAML_get_object_item(*show_rc,
+						  "peer_conns");
+		if (show_node != NULL && cYAML_is_sequence(show_node)) {
+			cYAML_insert_child(show_node, first_seq);
+			free(peer_root);
+			free(root);
+		} else if (show_node == NULL) {
+			cYAML_insert_sibling((*show_rc)->cy_child,
+					     peer_root);
+			free(root);
+		} else {
+			cYAML_free_tree(root);
+		}
+	} else {
+		*show_rc = root;
+	}
+
+	cYAML_build_error(rc, seq_no, SHOW_CMD, "peer_conns", err_str,
+			  err_rc);
+
+	return rc;
+}
+
 int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc)
 {
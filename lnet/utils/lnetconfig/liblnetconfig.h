@@ -206,6 +206,17 @@ int lustre_lnet_show_routing(int seq_no, struct cYAML **show_rc,
 int lustre_lnet_show_peer_credits(int seq_no, struct cYAML **show_rc,
 				  struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_show_peer_conns
+ *   Shows the LNDs' connection statistics of the peers in the system
+ *
+ *     seq_no - sequence number of the command
+ *     show_rc - YAML structure of the resultant show
+ *     err_rc - YAML strucutre of the resultant return code.
+ */
+int lustre_lnet_show_peer_conns(int seq_no, struct cYAML **show_rc,
+				struct cYAML **err_rc);
+
 /*
  * lustre_lnet_show_stats
  *   Shows internal LNET statistics.  This is useful to display the
@@ -48,6 +48,7 @@ static int jt_show_net(int argc, char **argv);
 static int jt_show_routing(int argc, char **argv);
 static int jt_show_stats(int argc, char **argv);
 static int jt_show_peer_credits(int argc, char **argv);
+static int jt_show_peer_conns(int argc, char **argv);
 static int jt_set_tiny(int argc, char **argv);
 static int jt_set_small(int argc, char **argv);
 static int jt_set_large(int argc, char **argv);
@@ -110,6 +111,11 @@ command_t credits_cmds[] = {
 	{ 0, 0, 0, NULL }
 };
 
+command_t conns_cmds[] = {
+	{"show", jt_show_peer_conns, 0, "show peer connection statistics\n"},
+	{ 0, 0, 0, NULL }
+};
+
 command_t set_cmds[] = {
 	{"tiny_buffers", jt_set_tiny, 0, "set tiny routing buffers\n"
 	 "\tVALUE must be greater than 0\n"},
@@ -750,6 +756,27 @@ static int jt_show_peer_credits(int argc, char **argv)
 	return rc;
 }
 
+static int jt_show_peer_conns(int argc, char **argv)
+{
+	int rc;
+	struct cYAML *show_rc = NULL, *err_rc = NULL;
+
+	if (handle_help(conns_cmds, "peer_conns", "show", argc, argv) == 0)
+		return 0;
+
+	rc = lustre_lnet_show_peer_conns(-1, &show_rc, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+	else if (show_rc)
+		cYAML_print_tree(show_rc);
+
+	cYAML_free_tree(err_rc);
+	cYAML_free_tree(show_rc);
+
+	return rc;
+}
+
 static inline int jt_lnet(int argc, char **argv)
 {
 	if (argc < 2)
@@ -822,6 +849,18 @@ static inline int jt_peer_credits(int argc, char **argv)
 	return Parser_execarg(argc - 1, &argv[1], credits_cmds);
 }
 
+static inline int jt_peer_conns(int argc, char **argv)
+{
+	if (argc < 2)
+		return CMD_HELP;
+
+	if (argc == 2 &&
+	    handle_help(conns_cmds, "peer_conns", NULL, argc, argv) == 0)
+		return 0;
+
+	return Parser_execarg(argc - 1, &argv[1], conns_cmds);
+}
+
 static inline int jt_set(int argc, char **argv)
 {
 	if (argc < 2)
@@ -978,6 +1017,7 @@ command_t list[] = {
 	{"export", jt_export, 0, "export {--help} FILE.yaml"},
 	{"stats", jt_stats, 0, "stats {show | help}"},
 	{"peer_credits", jt_peer_credits, 0, "peer_credits {show | help}"},
+	{"peer_conns", jt_peer_conns, 0, "peer_conns {show | help}"},
 	{"help", Parser_help, 0, "help"},
 	{"exit", Parser_quit, 0, "quit"},
 	{"quit", Parser_quit, 0, "quit"},
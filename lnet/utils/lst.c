@@ -57,7 +57,8 @@ lst_sid_t LST_INVALID_SID = {LNET_NID_ANY, -1};
 static lst_sid_t           session_id;
 static int                 session_key;
 
-/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN */
+/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN,
+ * sessions with older nodes have to be created with features cleared */
 static unsigned		session_features = LST_FEATS_MASK;
 static lstcon_trans_stat_t	trans_stat;
 
@@ -2730,12 +2731,21 @@ lst_print_tsb_verbose(struct list_head *head,
                 if (ent->rpe_fwk_errno == 0 && error)
                         continue;
 
-                fprintf(stdout, "%s [%s]: %s\n",
+                fprintf(stdout, "%s [%s]: %s",
                         libcfs_id2str(ent->rpe_peer),
                         lst_node_state2str(ent->rpe_state),
                         ent->rpe_rpc_errno != 0 ?
                                 strerror(ent->rpe_rpc_errno) :
                                 (ent->rpe_priv[0] > 0 ? "Running" : "Idle"));
+
+		/* RPC latency percentiles, only reported for a test */
+		if (ent->rpe_rpc_errno == 0 && ent->rpe_priv[1] != 0)
+			fprintf(stdout, ", latency p50 %uus p99 %uus "
+				"p99.9 %uus",
+				(unsigned)ent->rpe_priv[1],
+				(unsigned)ent->rpe_priv[2],
+				(unsigned)ent->rpe_priv[3]);
+		fprintf(stdout, "\n");
         }
 }
 
@@ -2940,9 +2950,57 @@ lst_parse_distribute(char *dstr, int *dist, int *span)
         return 0;
 }
 
+static int
+lst_parse_size(char *str, char **end)
+{
+	int size = strtol(str, end, 0);
+
+	if (**end == 'k' || **end == 'K') {
+		size *= 1024;
+		(*end)++;
+	} else if (**end == 'm' || **end == 'M') {
+		size *= 1024 * 1024;
+		(*end)++;
+	}
+
+	return size;
+}
+
+/* Features the current session runs with, which are fewer than asked for
+ * by LST_FEATURES if some of its nodes don't understand them */
+static unsigned
+lst_session_features(void)
+{
+	lstcon_ndlist_ent_t ndinfo;
+	lst_sid_t	    sid;
+	char		    name[LST_NAME_SIZE];
+	unsigned	    feats;
+	int		    key;
+
+	if (lst_session_info_ioctl(name, sizeof(name), &key,
+				   &feats, &sid, &ndinfo) != 0)
+		return session_features;
+
+	return feats;
+}
+
+/* Refuse bulk parameter \a param if the session can't run it */
+static int
+lst_check_bulk_feature(unsigned feats, const char *param)
+{
+	if ((feats & LST_FEAT_PROFILE) != 0)
+		return 0;
+
+	fprintf(stderr, "%s needs session feature %x, which this session "
+		"doesn't have (features: %x)\n", param, LST_FEAT_PROFILE,
+		feats);
+	return -1;
+}
+
 int
 lst_get_bulk_param(int argc, char **argv, lst_test_bulk_param_t *bulk)
 {
+	unsigned feats = lst_session_features();
         char   *tok = NULL;
         char   *end = NULL;
         int     rc  = 0;
@@ -2973,23 +3031,31 @@ lst_get_bulk_param(int argc, char **argv, lst_test_bulk_param_t *bulk)
 
                         tok = strchr(argv[i], '=') + 1;
 
-                        bulk->blk_size = strtol(tok, &end, 0);
+			bulk->blk_size = lst_parse_size(tok, &end);
                         if (bulk->blk_size <= 0) {
                                 fprintf(stderr, "Invalid size %s\n", tok);
                                 return -1;
                         }
 
-                        if (end == NULL)
-                                return 0;
+			/* MIN-MAX: sizes spread uniformly in between */
+			bulk->blk_size_max = bulk->blk_size;
+			if (*end == '-')
+				bulk->blk_size_max = lst_parse_size(end + 1,
+								    &end);
+
+			if (*end != '\0' ||
+			    bulk->blk_size_max < bulk->blk_size) {
+				fprintf(stderr, "Invalid size %s\n", tok);
+				return -1;
+			}
 
-                        if (*end == 'k' || *end == 'K')
-                                bulk->blk_size *= 1024;
-                        else if (*end == 'm' || *end == 'M')
-                                bulk->blk_size *= 1024 * 1024;
+			if (bulk->blk_size_max != bulk->blk_size &&
+			    lst_check_bulk_feature(feats, argv[i]) != 0)
+				return -1;
 
-			if (bulk->blk_size > max_size) {
+			if (bulk->blk_size_max > max_size) {
                                 fprintf(stderr, "Size exceed limitation: %d bytes\n",
-                                        bulk->blk_size);
+					bulk->blk_size_max);
                                 return -1;
                         }
 
@@ -3022,6 +3088,34 @@ lst_get_bulk_param(int argc, char **argv, lst_test_bulk_param_t *bulk)
                            strcasecmp(argv[i], "w") == 0) {
                         bulk->blk_opc = LST_BRW_WRITE;
 
+		} else if (strcasestr(argv[i], "mix=") == argv[i]) {
+			/* percentage of writes, the rest are reads */
+			tok = strchr(argv[i], '=') + 1;
+
+			bulk->blk_write_pct = strtol(tok, &end, 0);
+			if (*end != '\0' || bulk->blk_write_pct < 0 ||
+			    bulk->blk_write_pct > 100) {
+				fprintf(stderr, "Invalid write percentage %s\n",
+					tok);
+				return -1;
+			}
+			if (lst_check_bulk_feature(feats, argv[i]) != 0)
+				return -1;
+			bulk->blk_opc = LST_BRW_MIX;
+
+		} else if (strcasestr(argv[i], "think=") == argv[i]) {
+			/* usecs between two RPCs of each concurrent stream */
+			tok = strchr(argv[i], '=') + 1;
+
+			bulk->blk_think = strtol(tok, &end, 0);
+			if (*end != '\0' || bulk->blk_think < 0) {
+				fprintf(stderr, "Invalid think time %s\n", tok);
+				return -1;
+			}
+			if (bulk->blk_think != 0 &&
+			    lst_check_bulk_feature(feats, argv[i]) != 0)
+				return -1;
+
                 } else {
                         fprintf(stderr, "Unknow parameter: %s\n", argv[i]);
                         return -1;
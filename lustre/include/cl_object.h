@@ -728,6 +728,11 @@ struct cl_page {
          * creation.
          */
         enum cl_page_type        cp_type;
+	/**
+	 * Slab the page was allocated from, index into the cl_page kmem
+	 * array, or -1 for kmalloc. See cl_page_alloc().
+	 */
+	signed char		 cp_kmem_index;
 
         /**
          * Owning IO in cl_page_state::CPS_OWNED state. Sub-page can be owned
@@ -1467,6 +1472,21 @@ static inline void cl_read_ahead_release(const struct lu_env *env,
 	memset(ra, 0, sizeof(*ra));
 }
 
+/**
+ * Page aligned direct IO handed down the stack by cl_io_dio_submit().
+ */
+struct cl_dio_pages {
+	/** pinned user pages, PAGE_SIZE of data each but the last one */
+	struct page		**cdp_pages;
+	/** number of pages in cdp_pages */
+	int			  cdp_nr;
+	/** object offset of the first page, in the layer's own object */
+	loff_t			  cdp_pos;
+	/** number of bytes to transfer */
+	size_t			  cdp_size;
+	/** completion anchor, one entry is accounted for each RPC */
+	struct cl_sync_io	 *cdp_anchor;
+};
 
 /**
  * Per-layer io operations.
@@ -1581,6 +1601,20 @@ struct cl_io_operations {
 	int (*cio_read_ahead)(const struct lu_env *env,
 			      const struct cl_io_slice *slice,
 			      pgoff_t start, struct cl_read_ahead *ra);
+	/**
+	 * Submit page aligned direct IO described by \a cdp without setting
+	 * up cl_page for the pages. Layers translate cl_dio_pages::cdp_pos
+	 * into their own object offset and pass it down; the layer doing the
+	 * transfer calls cl_sync_io_note() on cl_dio_pages::cdp_anchor for
+	 * every RPC it accounted there. Returns -ENOTSUPP, without sending
+	 * anything, if the IO has to go through the cl_page based path.
+	 *
+	 * \pre io->ci_type == CIT_READ || io->ci_type == CIT_WRITE
+	 */
+	int (*cio_dio_submit)(const struct lu_env *env,
+			      const struct cl_io_slice *slice,
+			      enum cl_req_type crt,
+			      struct cl_dio_pages *cdp);
         /**
          * Optional debugging helper. Print given io slice.
          */
@@ -2080,6 +2114,10 @@ struct cl_page *cl_page_alloc       (const struct lu_env *env,
 				     struct cl_object *o, pgoff_t ind,
 				     struct page *vmpage,
 				     enum cl_page_type type);
+int             cl_page_find_batch  (const struct lu_env *env,
+				     struct cl_object *o,
+				     struct page **vmpages,
+				     struct cl_page **pages, int nr);
 void            cl_page_get         (struct cl_page *page);
 void            cl_page_put         (const struct lu_env *env,
                                      struct cl_page *page);
@@ -2267,6 +2305,11 @@ int   cl_io_commit_async (const struct lu_env *env, struct cl_io *io,
 			  cl_commit_cbt cb);
 int   cl_io_read_ahead   (const struct lu_env *env, struct cl_io *io,
 			  pgoff_t start, struct cl_read_ahead *ra);
+int   cl_io_dio_submit   (const struct lu_env *env, struct cl_io *io,
+			  enum cl_req_type crt, struct cl_dio_pages *cdp);
+int   cl_io_dio_submit_sync(const struct lu_env *env, struct cl_io *io,
+			    enum cl_req_type crt, struct cl_dio_pages *cdp,
+			    long timeout);
 void  cl_io_rw_advance   (const struct lu_env *env, struct cl_io *io,
                           size_t nob);
 int   cl_io_cancel       (const struct lu_env *env, struct cl_io *io,
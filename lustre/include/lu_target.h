@@ -209,6 +209,8 @@ struct tgt_session_info {
 
 	const struct mdt_body	*tsi_mdt_body;
 	struct ost_body		*tsi_ost_body;
+	/* reply body of the current OST_COMPOUND operation */
+	struct ost_body		*tsi_ost_repbody;
 	struct lu_object	*tsi_corpus;
 
 	struct lu_fid		 tsi_fid;
@@ -340,6 +342,15 @@ static inline struct ptlrpc_request *tgt_ses_req(struct tgt_session_info *tsi)
 	return tsi->tsi_pill ? tsi->tsi_pill->rc_req : NULL;
 }
 
+/* OST reply body, either in the reply buffer or in an OST_COMPOUND slot */
+static inline struct ost_body *tgt_ost_repbody(struct tgt_session_info *tsi)
+{
+	if (tsi->tsi_ost_repbody != NULL)
+		return tsi->tsi_ost_repbody;
+
+	return req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
+}
+
 static inline __u64 tgt_conn_flags(struct tgt_session_info *tsi)
 {
 	LASSERT(tsi->tsi_exp);
@@ -384,6 +395,9 @@ int tgt_sec_ctx_fini(struct tgt_session_info *tsi);
 int tgt_sendpage(struct tgt_session_info *tsi, struct lu_rdpg *rdpg, int nob);
 int tgt_send_buffer(struct tgt_session_info *tsi, struct lu_rdbuf *rdbuf);
 int tgt_validate_obdo(struct tgt_session_info *tsi, struct obdo *oa);
+int tgt_compound_op_unpack(struct tgt_session_info *tsi,
+			   struct ost_compound_op *op,
+			   struct ost_compound_op *rep);
 int tgt_sync(const struct lu_env *env, struct lu_target *tgt,
 	     struct dt_object *obj, __u64 start, __u64 end);
 
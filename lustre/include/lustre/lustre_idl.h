@@ -1258,6 +1258,7 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT_FLAGS2	 0x8000000000000000ULL /* second flags word */
 /* ocd_connect_flags2 flags */
 #define OBD_CONNECT2_FILE_SECCTX	0x1ULL /* set file security context at create */
+#define OBD_CONNECT2_COMPOUND		0x2ULL /* OST_COMPOUND RPCs */
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -1324,8 +1325,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_LAYOUTLOCK | OBD_CONNECT_FID | \
 				OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK | \
 				OBD_CONNECT_BULK_MBITS | \
-				OBD_CONNECT_GRANT_PARAM)
-#define OST_CONNECT_SUPPORTED2 0
+				OBD_CONNECT_GRANT_PARAM | OBD_CONNECT_FLAGS2)
+#define OST_CONNECT_SUPPORTED2 OBD_CONNECT2_COMPOUND
 
 #define ECHO_CONNECT_SUPPORTED 0
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1430,6 +1431,7 @@ typedef enum {
         OST_QUOTACTL   = 19,
 	OST_QUOTA_ADJUST_QUNIT = 20, /* not used since 2.4 */
 	OST_LADVISE    = 21,
+	OST_COMPOUND   = 22,
 	OST_LAST_OPC /* must be < 33 to avoid MDS_GETATTR */
 } ost_cmd_t;
 #define OST_FIRST_OPC  OST_REPLY
@@ -1459,6 +1461,7 @@ enum obdo_flags {
         OBD_FL_NOSPC_BLK    = 0x00100000, /* no more block space on OST */
 	OBD_FL_FLUSH	    = 0x00200000, /* flush pages on the OST */
 	OBD_FL_SHORT_IO	    = 0x00400000, /* short io request */
+	OBD_FL_GRANT_REQUEST = 0x00800000, /* ask for grant in advance */
 
         /* Note that while these checksum values are currently separate bits,
          * in 2.x we can actually allow all values from 1-31 if we wanted. */
@@ -3406,6 +3409,18 @@ struct ost_body {
 	struct obdo oa;
 };
 
+/* One operation of an OST_COMPOUND RPC, which carries an array of them both
+ * in the request and in the reply. Only OST_SETATTR and OST_PUNCH are
+ * allowed. */
+struct ost_compound_op {
+	__u32		oco_opc;	/* opcode of the operation */
+	__s32		oco_rc;		/* reply: status of the operation */
+	struct ost_body	oco_body;	/* request or reply body */
+};
+
+/* maximum number of operations in an OST_COMPOUND RPC */
+#define OST_COMPOUND_MAX_OPS	32
+
 /* Key for FIEMAP to be used in get_info calls */
 struct ll_fiemap_info_key {
 	char		lfik_name[8];
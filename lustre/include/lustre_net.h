@@ -604,7 +604,20 @@ struct ptlrpc_request_set {
 	set_producer_func	set_producer;
 	/** opaq argument passed to the producer callback */
 	void			*set_producer_arg;
-	unsigned int		 set_allow_intr:1;
+	unsigned int		 set_allow_intr:1,
+	/**
+	 * Only requests signalled by an event are checked, see
+	 * ptlrpc_check_set_ready(). Used with ptlrpcd sets.
+	 */
+				 set_event_driven:1;
+	/** Lock for \a set_ready_list manipulations */
+	spinlock_t		set_ready_lock;
+	/** Requests woken up since they were last checked */
+	struct list_head	set_ready_list;
+	/** Set when all requests of the set need to be checked */
+	atomic_t		set_rescan;
+	/** Time of the next periodic check of all requests */
+	cfs_time_t		set_next_scan;
 };
 
 /**
@@ -665,6 +678,7 @@ struct ptlrpc_reply_state {
         unsigned long          rs_handled:1;  /* been handled yet? */
         unsigned long          rs_on_net:1;   /* reply_out_callback pending? */
         unsigned long          rs_prealloc:1; /* rs from prealloc list */
+	unsigned long		rs_pooled:1;   /* rs from ptlrpc_rs_alloc() pool */
         unsigned long          rs_committed:1;/* the transaction was committed
                                                  and the rs was dispatched
                                                  by ptlrpc_commit_replies */
@@ -682,6 +696,8 @@ struct ptlrpc_reply_state {
         __u64                  rs_xid;
 	struct obd_export     *rs_export;
 	struct ptlrpc_service_part *rs_svcpt;
+	/** When the reply was queued to a reply handling thread */
+	struct timeval		rs_hr_queued;
 	/** Lnet metadata handle for the reply */
 	lnet_handle_md_t	rs_md_h;
 
@@ -807,6 +823,8 @@ struct ptlrpc_cli_req {
 	wait_queue_head_t		 cr_set_waitq;
 	/** Link item for request set lists */
 	struct list_head		 cr_set_chain;
+	/** Link item for the set list of requests signalled by events */
+	struct list_head		 cr_ready_chain;
 	/** link to waited ctx */
 	struct list_head		 cr_ctx_chain;
 
@@ -859,6 +877,7 @@ struct ptlrpc_cli_req {
 #define rq_import_generation	rq_cli.cr_imp_gen
 #define rq_send_state		rq_cli.cr_send_state
 #define rq_set_chain		rq_cli.cr_set_chain
+#define rq_ready_chain		rq_cli.cr_ready_chain
 #define rq_ctx_chain		rq_cli.cr_ctx_chain
 #define rq_set			rq_cli.cr_set
 #define rq_set_waitq		rq_cli.cr_set_waitq
@@ -1614,6 +1633,8 @@ struct ptlrpc_request_buffer_desc {
 	int				rqbd_refcount;
 	/** The buffer itself */
 	char				*rqbd_buffer;
+	/** CPT the buffer was allocated on, CFS_CPT_ANY if unpartitioned */
+	int				rqbd_cpt;
 	struct ptlrpc_cb_id		rqbd_cbid;
 	/**
 	 * This "embedded" request structure is only used for the
@@ -1752,6 +1773,12 @@ struct ptlrpc_service_part {
 	struct ptlrpc_service		*scp_service __cfs_cacheline_aligned;
 	/* CPT id, reserved */
 	int				scp_cpt;
+	/**
+	 * CPT request buffers are allocated on and threads are bound to,
+	 * scp_cpt itself if an NI receives on it, otherwise one of the CPTs
+	 * NIs receive on, see ptlrpc_service_homes().
+	 */
+	int				scp_home_cpt;
 	/** always increasing number */
 	int				scp_thr_nextid;
 	/** # of starting threads */
@@ -1777,6 +1804,12 @@ struct ptlrpc_service_part {
 	int				scp_rqbd_allocating;
 	/** # incoming reqs */
 	int				scp_nreqs_incoming;
+	/**
+	 * # requests received into a buffer on the CPT of the CPU delivering
+	 * the LNet event, and # received into a buffer on another CPT
+	 */
+	__u64				scp_rqbd_local;
+	__u64				scp_rqbd_remote;
 	/** request buffers to be reposted */
 	struct list_head		scp_rqbd_idle;
 	/** req buffers receiving */
@@ -1910,9 +1943,23 @@ struct ptlrpcd_ctl {
 	 */
 	int				pc_npartners;
 	/**
-	 * Record the partner index to be processed next.
+	 * All ptlrpcd threads of the CPT, including this one, which can
+	 * have requests stolen by this thread when it is idle.
 	 */
-	int				pc_cursor;
+	struct ptlrpcd_ctl		*pc_siblings;
+	/**
+	 * Number of threads in pc_siblings.
+	 */
+	int				pc_nsiblings;
+	/**
+	 * NUMA node the thread last ran on, used for victim selection.
+	 */
+	int				pc_node;
+	/**
+	 * Number of successful steals, and requests taken by them.
+	 */
+	unsigned long			pc_steals;
+	unsigned long			pc_stolen;
 	/**
 	 * Error code if the thread failed to fully start.
 	 */
@@ -2099,6 +2146,8 @@ struct ptlrpc_request_set *ptlrpc_prep_fcset(int max, set_producer_func func,
 int ptlrpc_set_add_cb(struct ptlrpc_request_set *set,
                       set_interpreter_func fn, void *data);
 int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set);
+void ptlrpc_set_wake_req(struct ptlrpc_request_set *set,
+			 struct ptlrpc_request *req);
 int ptlrpc_set_wait(struct ptlrpc_request_set *);
 void ptlrpc_mark_interrupted(struct ptlrpc_request *req);
 void ptlrpc_set_destroy(struct ptlrpc_request_set *);
@@ -2507,10 +2556,12 @@ ptlrpc_client_recv_or_unlink(struct ptlrpc_request *req)
 static inline void
 ptlrpc_client_wake_req(struct ptlrpc_request *req)
 {
-	if (req->rq_set == NULL)
+	struct ptlrpc_request_set *set = req->rq_set;
+
+	if (set == NULL)
 		wake_up(&req->rq_reply_waitq);
 	else
-		wake_up(&req->rq_set->set_waitq);
+		ptlrpc_set_wake_req(set, req);
 }
 
 static inline void
@@ -2658,6 +2709,7 @@ void ptlrpcd_decref(void);
  * @{
  */
 const char* ll_opcode2str(__u32 opcode);
+int ll_str2opcode(const char *ops);
 #ifdef CONFIG_PROC_FS
 void ptlrpc_lprocfs_register_obd(struct obd_device *obd);
 void ptlrpc_lprocfs_unregister_obd(struct obd_device *obd);
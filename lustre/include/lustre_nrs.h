@@ -675,6 +675,7 @@ enum {
 #include <lustre_nrs_tbf.h>
 #include <lustre_nrs_crr.h>
 #include <lustre_nrs_orr.h>
+#include <lustre_nrs_edf.h>
 
 /**
  * NRS request
@@ -721,6 +722,10 @@ struct ptlrpc_nrs_request {
 		 * TBF request definition
 		 */
 		struct nrs_tbf_req	tbf;
+		/**
+		 * EDF request definition
+		 */
+		struct nrs_edf_req	edf;
 	} nr_u;
 	/**
 	 * Externally-registering policies may want to use this to allocate
@@ -0,0 +1,163 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_EDF_H
+#define _LUSTRE_NRS_EDF_H
+
+/* \name edf
+ *
+ * EDF policy
+ *
+ * @{
+ */
+
+/**
+ * Maximum number of classes per policy instance, including the default one.
+ */
+#define NRS_EDF_CLASS_MAX	16
+#define NRS_EDF_NAME_MAX	16
+/**
+ * Number of log2(usec) queue latency histogram buckets; the last bucket
+ * collects everything above ~8s.
+ */
+#define NRS_EDF_HIST_MAX	24
+
+/**
+ * RPC types a class can be restricted to.
+ */
+enum nrs_edf_rpc_type {
+	NRS_EDF_RPC_ANY		= 0,
+	/**
+	 * OST_READ and OST_WRITE
+	 */
+	NRS_EDF_RPC_IO,
+	/**
+	 * Everything else
+	 */
+	NRS_EDF_RPC_META,
+};
+
+/**
+ * A class of requests sharing a deadline and a rate limit.
+ */
+struct nrs_edf_class {
+	char			ec_name[NRS_EDF_NAME_MAX];
+	/**
+	 * JobID pattern; a trailing '*' matches any suffix, an empty pattern
+	 * matches every request.
+	 */
+	char			ec_jobid[LUSTRE_JOBID_SIZE];
+	/**
+	 * uid the requests must carry, NRS_UGID_NONE matches every uid.
+	 */
+	__u32			ec_uid;
+	enum nrs_edf_rpc_type	ec_type;
+	bool			ec_used;
+	/**
+	 * Target queueing latency in milliseconds.
+	 */
+	__u32			ec_deadline;
+	/**
+	 * Rate limit in RPCs/s, 0 means unlimited.
+	 */
+	__u64			ec_rpc_rate;
+	/**
+	 * Time to generate one token, in nanoseconds.
+	 */
+	__u64			ec_nsecs;
+	__u64			ec_depth;
+	__u64			ec_ntoken;
+	__u64			ec_check_time;
+	/**
+	 * Queued requests of this class, sorted by deadline.
+	 */
+	struct list_head	ec_list;
+	__u64			ec_queued;
+	/**
+	 * Statistics of requests taken for handling.
+	 */
+	__u64			ec_started;
+	__u64			ec_missed;
+	__u64			ec_wait_sum;
+	__u64			ec_wait_max;
+	__u64			ec_hist[NRS_EDF_HIST_MAX];
+};
+
+struct nrs_edf_head {
+	/**
+	 * Resource object for policy instance.
+	 */
+	struct ptlrpc_nrs_resource	eh_res;
+	/**
+	 * Protects eh_classes against changes via lprocfs.
+	 */
+	spinlock_t			eh_lock;
+	/**
+	 * Slot 0 holds the "default" class which matches every request not
+	 * matched by any other class.
+	 */
+	struct nrs_edf_class		eh_classes[NRS_EDF_CLASS_MAX];
+	/**
+	 * Timer for throttling while all queued classes are out of tokens.
+	 */
+	struct hrtimer			eh_timer;
+	__u64				eh_timer_expires;
+	__u64				eh_sequence;
+};
+
+struct nrs_edf_req {
+	/**
+	 * Linkage to nrs_edf_class::ec_list.
+	 */
+	struct list_head	er_list;
+	/**
+	 * Enqueue time and absolute deadline, in nanoseconds.
+	 */
+	__u64			er_arrival;
+	__u64			er_deadline;
+	__u64			er_sequence;
+	/**
+	 * Index into nrs_edf_head::eh_classes.
+	 */
+	unsigned int		er_class;
+};
+
+/**
+ * EDF policy operations.
+ */
+enum nrs_ctl_edf {
+	/**
+	 * Read the classes and statistics of an EDF policy.
+	 */
+	NRS_CTL_EDF_RD_CLASS = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	/**
+	 * Start, change or stop a class of an EDF policy.
+	 */
+	NRS_CTL_EDF_WR_CLASS,
+};
+
+/** @} edf */
+#endif
@@ -101,6 +101,21 @@ struct nrs_orr_key {
  */
 #define NRS_ORR_OBJ_NAME_MAX	(sizeof("nrs_orr_reg_") + 3)
 
+/**
+ * Number of backend-fs extents cached for each object by ORR policy instances
+ * that use physical disk offsets.
+ */
+#define NRS_ORR_EXT_CACHE	4
+
+/**
+ * A backend-fs extent, as reported by fiemap.
+ */
+struct nrs_orr_extent {
+	__u64		oe_logical;
+	__u64		oe_physical;
+	__u64		oe_length;
+};
+
 /**
  * private data structure for ORR and TRR NRS
  */
@@ -175,6 +190,21 @@ struct nrs_orr_object {
 	 * # of pending requests for this object or OST, on all existing rounds
 	 */
 	__u16				oo_active;
+	/**
+	 * Number of valid entries in nrs_orr_object::oo_extents.
+	 */
+	__u16				oo_nextents;
+	/**
+	 * Protects the extent cache.
+	 */
+	spinlock_t			oo_ext_lock;
+	/**
+	 * Extents of the object obtained by the last fiemap call, so that
+	 * requests for nearby offsets are mapped without calling into the
+	 * OSD again; ORR only. The cache lives as long as the object has
+	 * pending requests.
+	 */
+	struct nrs_orr_extent		oo_extents[NRS_ORR_EXT_CACHE];
 };
 
 /**
@@ -47,6 +47,11 @@ struct nrs_tbf_jobid {
 	struct list_head tj_linkage;
 };
 
+/**
+ * Key of a generic TBF client: "<jobid>_<nid>_<opcode>_<uid>_<gid>".
+ */
+#define NRS_TBF_KEY_LEN		(LUSTRE_JOBID_SIZE + 64)
+
 struct nrs_tbf_client {
 	/** Resource object for policy instance. */
 	struct ptlrpc_nrs_resource	 tc_res;
@@ -56,6 +61,13 @@ struct nrs_tbf_client {
 	lnet_nid_t			 tc_nid;
 	/** Jobid of the client. */
 	char				 tc_jobid[LUSTRE_JOBID_SIZE];
+	/** Opcode of the client's requests, generic type only. */
+	__u32				 tc_opcode;
+	/** Uid and gid of the client's requests, generic type only. */
+	__u32				 tc_uid;
+	__u32				 tc_gid;
+	/** Hash key of the client, generic type only. */
+	char				 tc_key[NRS_TBF_KEY_LEN];
 	/** Reference number of the client. */
 	atomic_t			 tc_ref;
 	/** Lock to protect rule and linkage. */
@@ -76,6 +88,11 @@ struct nrs_tbf_client {
 	__u64				 tc_depth;
 	/** Time check-point. */
 	__u64				 tc_check_time;
+	/**
+	 * Time before which the client is not served first again, after it
+	 * was served with a borrowed token.
+	 */
+	__u64				 tc_borrow_deadline;
 	/** List of queued requests. */
 	struct list_head		 tc_list;
 	/** Node in binary heap. */
@@ -93,6 +110,44 @@ struct nrs_tbf_client {
 
 #define MAX_TBF_NAME (16)
 
+/**
+ * Fields a generic TBF rule can match on.
+ */
+enum nrs_tbf_field {
+	NRS_TBF_FIELD_NID,
+	NRS_TBF_FIELD_JOBID,
+	NRS_TBF_FIELD_OPCODE,
+	NRS_TBF_FIELD_UID,
+	NRS_TBF_FIELD_GID,
+	NRS_TBF_FIELD_MAX
+};
+
+/**
+ * One "field={values}" term of a generic TBF rule.
+ */
+struct nrs_tbf_expression {
+	enum nrs_tbf_field	 te_field;
+	/**
+	 * NID list, list of nrs_tbf_jobid or list of cfs_expr_list for uid
+	 * and gid, depending on te_field.
+	 */
+	struct list_head	 te_cond;
+	/** Opcode bitmap, indexed by opcode_offset(). */
+	struct cfs_bitmap	*te_opcodes;
+	/** Linkage to nrs_tbf_conjunction::tc_expressions. */
+	struct list_head	 te_linkage;
+};
+
+/**
+ * Terms joined by '&'; a rule matches if any of its conjunctions, joined by
+ * ',', matches.
+ */
+struct nrs_tbf_conjunction {
+	struct list_head	 tc_expressions;
+	/** Linkage to nrs_tbf_rule::tr_conds. */
+	struct list_head	 tc_linkage;
+};
+
 #define NTRS_STOPPING	0x0000001
 #define NTRS_DEFAULT	0x0000002
 
@@ -111,6 +166,10 @@ struct nrs_tbf_rule {
 	struct list_head		 tr_jobids;
 	/** Jobid list string of the rule.*/
 	char				*tr_jobids_str;
+	/** Conjunctions of a generic rule. */
+	struct list_head		 tr_conds;
+	/** Condition string of a generic rule. */
+	char				*tr_conds_str;
 	/** RPC/s limit. */
 	__u64				 tr_rpc_rate;
 	/** Time to wait for next token. */
@@ -127,6 +186,30 @@ struct nrs_tbf_rule {
 	atomic_t			 tr_ref;
 	/** Generation of the rule. */
 	__u64				 tr_generation;
+	/**
+	 * Parent rule which unused tokens are borrowed from, holds a
+	 * reference. Protected by nrs_tbf_head::th_rule_lock.
+	 */
+	struct nrs_tbf_rule		*tr_parent;
+	/** Number of started rules having this rule as parent. */
+	int				 tr_nchildren;
+	/**
+	 * Ceiling RPC/s of a client including borrowed tokens. All clients
+	 * of the rule together borrow at most tr_ceil_rate - tr_rpc_rate
+	 * RPC/s.
+	 */
+	__u64				 tr_ceil_rate;
+	/** Tokens left to borrow for the clients of the rule. */
+	__u64				 tr_ceil_ntoken;
+	/** Time check-point of tr_ceil_ntoken. */
+	__u64				 tr_ceil_check_time;
+	/**
+	 * Token pool shared by the clients of this rule and of its child
+	 * rules; tokens left over are lent to the children.
+	 */
+	__u64				 tr_ntoken;
+	/** Time check-point of the token pool. */
+	__u64				 tr_check_time;
 };
 
 struct nrs_tbf_ops {
@@ -149,10 +232,12 @@ struct nrs_tbf_ops {
 
 #define NRS_TBF_TYPE_JOBID	"jobid"
 #define NRS_TBF_TYPE_NID	"nid"
+#define NRS_TBF_TYPE_GENERIC	"generic"
 #define NRS_TBF_TYPE_MAX_LEN	20
 #define NRS_TBF_FLAG_INVALID	0
 #define NRS_TBF_FLAG_JOBID	0x0000001
 #define NRS_TBF_FLAG_NID	0x0000002
+#define NRS_TBF_FLAG_GENERIC	0x0000004
 
 struct nrs_tbf_bucket {
 	/**
@@ -240,13 +325,18 @@ struct nrs_tbf_cmd {
 			char			*ts_nids_str;
 			struct list_head	 ts_jobids;
 			char			*ts_jobids_str;
+			struct list_head	 ts_conds;
+			char			*ts_conds_str;
 			__u32			 ts_valid_type;
 			__u32			 ts_rule_flags;
 			char			*ts_next_name;
+			char			*ts_parent_name;
+			__u64			 ts_ceil_rate;
 		} tc_start;
 		struct nrs_tbf_cmd_change {
 			__u64			 tc_rpc_rate;
 			char			*tc_next_name;
+			__u64			 tc_ceil_rate;
 		} tc_change;
 	} u;
 };
@@ -210,6 +210,7 @@ extern struct req_format RQF_OST_GET_INFO_LAST_FID;
 extern struct req_format RQF_OST_SET_INFO_LAST_FID;
 extern struct req_format RQF_OST_GET_INFO_FIEMAP;
 extern struct req_format RQF_OST_LADVISE;
+extern struct req_format RQF_OST_COMPOUND;
 
 /* LDLM req_format */
 extern struct req_format RQF_LDLM_ENQUEUE;
@@ -343,6 +344,7 @@ extern struct req_msg_field RMF_LFSCK_REPLY;
 
 extern struct req_msg_field RMF_OST_LADVISE_HDR;
 extern struct req_msg_field RMF_OST_LADVISE;
+extern struct req_msg_field RMF_OST_COMPOUND;
 /** @} req_layout */
 
 #endif /* _LUSTRE_REQ_LAYOUT_H__ */
@@ -87,6 +87,7 @@ void lustre_swab_lfsck_request(struct lfsck_request *lr);
 void lustre_swab_lfsck_reply(struct lfsck_reply *lr);
 void lustre_swab_obdo(struct obdo *o);
 void lustre_swab_ost_body(struct ost_body *b);
+void lustre_swab_ost_compound_op(struct ost_compound_op *op);
 void lustre_swab_ost_last_id(__u64 *id);
 void lustre_swab_fiemap(struct fiemap *fiemap);
 void lustre_swab_lov_user_md_v1(struct lov_user_md_v1 *lum);
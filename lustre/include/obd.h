@@ -160,6 +160,29 @@ enum obd_cl_sem_lock_class {
 
 struct mdc_rpc_lock;
 struct obd_import;
+
+/**
+ * Per-CPT partition of the LRU page cache of a client_obd. Pages are kept in
+ * the partition of the CPT they were cached from, so that threads running on
+ * different CPTs don't contend on one list lock and counter cacheline.
+ */
+struct cl_lru_part {
+	/** Lock for clp_list */
+	spinlock_t		 clp_lock;
+	/** List of LRU pages of this partition */
+	struct list_head	 clp_list;
+	/** # of LRU pages in clp_list */
+	atomic_long_t		 clp_in_list;
+	/** # of busy LRU pages of this partition. A page is considered busy
+	 * if it's in writeback queue, or in transfer. Busy pages can't be
+	 * discarded so they are not in clp_list. */
+	atomic_long_t		 clp_busy;
+	/** stats: # of pages ever added to clp_list */
+	__u64			 clp_added;
+	/** stats: # of pages dropped from clp_list by osc_lru_shrink() */
+	__u64			 clp_shrunk;
+};
+
 struct client_obd {
 	struct rw_semaphore	 cl_sem;
 	struct obd_uuid		 cl_target_uuid;
@@ -208,6 +231,21 @@ struct client_obd {
 	cfs_time_t		cl_next_shrink_grant;   /* jiffies */
 	struct list_head	cl_grant_shrink_list;  /* Timeout event list */
 	int			cl_grant_shrink_interval; /* seconds */
+	/* predictive grant: the dirty rate of this client is sampled so that
+	 * grant can be asked for before writers run out of it, see
+	 * osc_grant_predict() */
+	unsigned long		cl_grant_dirty_rate;	/* EWMA, bytes/sec */
+	unsigned long		cl_grant_dirty_bytes;	/* in current sample */
+	cfs_time_t		cl_grant_rate_stamp;	/* sample start */
+	int			cl_grant_requesting;	/* request in flight */
+	int			cl_grant_queue;		/* request to queue */
+	/* stats: grant requests sent ahead of need and grant they got */
+	__u64			cl_grant_requests;
+	__u64			cl_grant_requested_bytes;
+	/* stats: writers which had to wait for grant or cache space */
+	__u64			cl_grant_stalls;
+	__u64			cl_grant_stall_us;
+	__u64			cl_grant_stall_max_us;
 
 	/* A chunk is an optimal size used by osc_extent to determine
 	 * the extent size. A chunk is max(PAGE_SIZE, OST block size) */
@@ -262,12 +300,11 @@ struct client_obd {
 	 * Available LRU slots are shared by all OSCs of the same file system,
 	 * therefore this is a pointer to cl_client_cache::ccc_lru_left. */
 	atomic_long_t           *cl_lru_left;
-	/** # of busy LRU pages. A page is considered busy if it's in writeback
-	 * queue, or in transfer. Busy pages can't be discarded so they are not
-	 * in LRU cache. */
-	atomic_long_t            cl_lru_busy;
-	/** # of LRU pages in the cache for this client_obd */
-	atomic_long_t            cl_lru_in_list;
+	/** LRU pages of this client_obd, partitioned by the CPT of the
+	 * thread which cached them, see struct cl_lru_part. */
+	struct cl_lru_part     **cl_lru_parts;
+	/** partition osc_lru_shrink() starts from next time */
+	unsigned int             cl_lru_shrink_cpt;
 	/** # of threads are shrinking LRU cache. To avoid contention, it's not
 	 * allowed to have multiple threads shrinking LRU cache. */
 	atomic_t                 cl_lru_shrinkers;
@@ -278,10 +315,6 @@ struct client_obd {
 	 * reclaim is sync, initiated by IO thread when the LRU slots are
 	 * in shortage. */
 	__u64                    cl_lru_reclaim;
-	/** List of LRU pages for this client_obd */
-	struct list_head         cl_lru_list;
-	/** Lock for LRU page list */
-	spinlock_t		 cl_lru_list_lock;
 	/** # of unstable pages in this client_obd.
 	 * An unstable page is a page state that WRITE RPC has finished but
 	 * the transaction has NOT yet committed. */
@@ -292,6 +325,8 @@ struct client_obd {
 	/* number of in flight destroy rpcs is limited to max_rpcs_in_flight */
 	atomic_t		 cl_destroy_in_flight;
 	wait_queue_head_t	 cl_destroy_waitq;
+	/* direct IO RPCs built without cl_page wait here for an RPC slot */
+	wait_queue_head_t	 cl_dio_waitq;
 
         struct mdc_rpc_lock     *cl_rpc_lock;
 
@@ -330,6 +365,12 @@ struct client_obd {
 	/* ptlrpc work for writeback in ptlrpcd context */
 	void			*cl_writeback_work;
 	void			*cl_lru_work;
+	void			*cl_grant_work;
+	/* setattr/punch queued for the next OST_COMPOUND, and its sender */
+	void			*cl_compound_work;
+	spinlock_t		 cl_compound_lock;
+	struct list_head	 cl_compound_list;
+	int			 cl_compound_count;
 	/* hash tables for osc_quota_info */
 	struct cfs_hash		*cl_quota_hash[LL_MAXQUOTAS];
 
@@ -326,6 +326,7 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_OST_PAUSE_PUNCH         0x236
 #define OBD_FAIL_OST_LADVISE_PAUSE	 0x237
 #define OBD_FAIL_OST_FAKE_WRITE          0x238
+#define OBD_FAIL_OST_COMPOUND_NET	 0x239
 
 #define OBD_FAIL_LDLM                    0x300
 #define OBD_FAIL_LDLM_NAMESPACE_NEW      0x301
@@ -525,6 +526,8 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_LLITE_CREATE_FILE_PAUSE	    0x1409
 #define OBD_FAIL_LLITE_NEWNODE_PAUSE		    0x140a
 #define OBD_FAIL_LLITE_SETDIRSTRIPE_PAUSE	    0x140b
+#define OBD_FAIL_LLITE_NO_SECURITY_INIT		    0x140c
+#define OBD_FAIL_LLITE_WRITE_BEGIN		    0x140d
 
 
 #define OBD_FAIL_FID_INDIR	0x1501
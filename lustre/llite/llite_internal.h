@@ -226,6 +226,7 @@ struct ll_inode_info {
 	struct rw_semaphore		lli_xattrs_list_rwsem;
 	struct mutex			lli_xattrs_enq_lock;
 	struct list_head		lli_xattrs; /* ll_xattr_entry->xe_list */
+	struct hlist_head		*lli_xattrs_hash; /* xe_hash name index */
 };
 
 static inline __u32 ll_layout_version_get(struct ll_inode_info *lli)
@@ -280,6 +281,7 @@ static inline bool ll_file_test_and_clear_flag(struct ll_inode_info *lli,
 }
 
 int ll_xattr_cache_destroy(struct inode *inode);
+void ll_xattr_cache_fini(struct inode *inode);
 
 int ll_xattr_cache_get(struct inode *inode,
 			const char *name,
@@ -423,6 +425,7 @@ enum stats_track_type {
 				       * suppress_pings */
 #define LL_SBI_FAST_READ     0x400000 /* fast read support */
 #define LL_SBI_FILE_SECCTX   0x800000 /* set file security context at create */
+#define LL_SBI_LEAN_DIO     0x1000000 /* direct I/O bypasses cl_page */
 
 #define LL_SBI_FLAGS { 	\
 	"nolck",	\
@@ -449,6 +452,7 @@ enum stats_track_type {
 	"always_ping",	\
 	"fast_read",	\
 	"file_secctx",	\
+	"lean_dio",	\
 }
 
 /* This is embedded into llite super-blocks to keep track of connect
@@ -661,6 +665,11 @@ static inline bool ll_sbi_has_fast_read(struct ll_sb_info *sbi)
 	return !!(sbi->ll_flags & LL_SBI_FAST_READ);
 }
 
+static inline bool ll_sbi_has_lean_dio(struct ll_sb_info *sbi)
+{
+	return !!(sbi->ll_flags & LL_SBI_LEAN_DIO);
+}
+
 void ll_ras_enter(struct file *f);
 
 /* llite/lcommon_misc.c */
@@ -131,6 +131,7 @@ static struct ll_sb_info *ll_init_sbi(void)
 	atomic_set(&sbi->ll_agl_total, 0);
 	sbi->ll_flags |= LL_SBI_AGL_ENABLED;
 	sbi->ll_flags |= LL_SBI_FAST_READ;
+	sbi->ll_flags |= LL_SBI_LEAN_DIO;
 
 	/* root squash */
 	sbi->ll_squash.rsi_uid = 0;
@@ -394,9 +395,9 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				  OBD_CONNECT_JOBSTATS | OBD_CONNECT_LVB_TYPE |
 				  OBD_CONNECT_LAYOUTLOCK |
 				  OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK |
-				  OBD_CONNECT_BULK_MBITS;
+				  OBD_CONNECT_BULK_MBITS | OBD_CONNECT_FLAGS2;
 
-	data->ocd_connect_flags2 = 0;
+	data->ocd_connect_flags2 = OBD_CONNECT2_COMPOUND;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -933,6 +934,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 
 	init_rwsem(&lli->lli_xattrs_list_rwsem);
 	mutex_init(&lli->lli_xattrs_enq_lock);
+	lli->lli_xattrs_hash = NULL;
 
 	LASSERT(lli->lli_vfs_inode.i_mode != 0);
 	if (S_ISDIR(lli->lli_vfs_inode.i_mode)) {
@@ -1442,7 +1444,7 @@ void ll_clear_inode(struct inode *inode)
                 lli->lli_symlink_name = NULL;
         }
 
-	ll_xattr_cache_destroy(inode);
+	ll_xattr_cache_fini(inode);
 
 #ifdef CONFIG_FS_POSIX_ACL
 	if (lli->lli_posix_acl) {
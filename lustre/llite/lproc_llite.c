@@ -894,6 +894,40 @@ ll_fast_read_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(ll_fast_read);
 
+static int ll_lean_dio_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	seq_printf(m, "%u\n", !!(sbi->ll_flags & LL_SBI_LEAN_DIO));
+	return 0;
+}
+
+static ssize_t
+ll_lean_dio_seq_write(struct file *file, const char __user *buffer,
+		      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+	int rc;
+	__s64 val;
+
+	rc = lprocfs_str_to_s64(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	spin_lock(&sbi->ll_lock);
+	if (val == 1)
+		sbi->ll_flags |= LL_SBI_LEAN_DIO;
+	else
+		sbi->ll_flags &= ~LL_SBI_LEAN_DIO;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LPROC_SEQ_FOPS(ll_lean_dio);
+
 static int ll_unstable_stats_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block	*sb    = m->private;
@@ -1073,6 +1107,8 @@ struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_nosquash_nids_fops			},
 	{ .name =       "fast_read",
 	  .fops =       &ll_fast_read_fops,                     },
+	{ .name	=	"lean_dio",
+	  .fops	=	&ll_lean_dio_fops			},
 	{ NULL }
 };
 
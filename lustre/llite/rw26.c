@@ -297,6 +297,26 @@ ll_direct_IO_seg(const struct lu_env *env, struct cl_io *io, int rw,
 				     .ldp_start_offset	= file_offset
 				   };
 
+	/* With nothing cached for this file there is no page cache to keep
+	 * coherent, so hand the user pages straight to the transfer layers
+	 * instead of wrapping each of them in a transient cl_page. Layers
+	 * that cannot do this return -ENOTSUPP and we take the slow path. */
+	if (ll_sbi_has_lean_dio(ll_i2sbi(inode)) &&
+	    inode->i_mapping->nrpages == 0) {
+		struct cl_dio_pages cdp = { .cdp_pages	= pages,
+					    .cdp_nr	= page_count,
+					    .cdp_pos	= file_offset,
+					    .cdp_size	= size
+					  };
+		ssize_t rc;
+
+		rc = cl_io_dio_submit_sync(env, io,
+					   rw == READ ? CRT_READ : CRT_WRITE,
+					   &cdp, 0);
+		if (rc != -ENOTSUPP)
+			return rc == 0 ? size : rc;
+	}
+
 	return ll_direct_rw_pages(env, io, rw, inode, &pvec);
 }
 
@@ -623,6 +643,63 @@ static int ll_prepare_partial_page(const struct lu_env *env, struct cl_io *io,
 	return result;
 }
 
+/**
+ * Set up cl_pages for the VM pages following \a index which the current
+ * write is going to dirty, in one cl_page_find_batch() pass, so that the
+ * next ll_write_begin() calls only have to look them up. This is purely an
+ * optimization: it stops at the first page which is busy, already cached
+ * or cannot be allocated, and leaves it to ll_write_begin().
+ */
+static void ll_write_prep_pages(const struct lu_env *env, struct cl_io *io,
+				struct address_space *mapping, pgoff_t index)
+{
+	struct vvp_thread_info *vti = vvp_env_info(env);
+	struct vvp_io *vio = vvp_env_io(env);
+	struct page **vmpages = vti->vti_vmpvec;
+	loff_t end = io->u.ci_wr.wr.crw_pos + io->u.ci_wr.wr.crw_count;
+	pgoff_t last;
+	int nr = 0;
+	int rc;
+	int i;
+
+	if (index < vio->u.write.vui_prep_end || end == 0)
+		return;
+
+	last = (end - 1) >> PAGE_SHIFT;
+	if (last > index + VTI_PVEC_SIZE)
+		last = index + VTI_PVEC_SIZE;
+
+	vio->u.write.vui_prep_start = index + 1;
+	while (++index <= last) {
+		struct page *vmpage;
+
+		vmpage = grab_cache_page_nowait(mapping, index);
+		if (vmpage == NULL)
+			break;
+
+		if (vmpage->mapping != mapping || PagePrivate(vmpage) ||
+		    PageDirty(vmpage) || PageWriteback(vmpage)) {
+			unlock_page(vmpage);
+			put_page(vmpage);
+			break;
+		}
+		vmpages[nr++] = vmpage;
+	}
+	vio->u.write.vui_prep_end = index;
+
+	if (nr == 0)
+		return;
+
+	rc = cl_page_find_batch(env, io->ci_obj, vmpages, vti->vti_pvec, nr);
+	for (i = 0; i < rc; i++)
+		cl_page_put(env, vti->vti_pvec[i]);
+
+	for (i = 0; i < nr; i++) {
+		unlock_page(vmpages[i]);
+		put_page(vmpages[i]);
+	}
+}
+
 static int ll_write_begin(struct file *file, struct address_space *mapping,
 			  loff_t pos, unsigned len, unsigned flags,
 			  struct page **pagep, void **fsdata)
@@ -683,6 +760,9 @@ static int ll_write_begin(struct file *file, struct address_space *mapping,
 		}
 	}
 
+	if (!PagePrivate(vmpage))
+		ll_write_prep_pages(env, io, mapping, index);
+
 	page = cl_page_find(env, clob, vmpage->index, vmpage, CPT_CACHEABLE);
 	if (IS_ERR(page))
 		GOTO(out, result = PTR_ERR(page));
@@ -691,7 +771,9 @@ static int ll_write_begin(struct file *file, struct address_space *mapping,
 	lu_ref_add(&page->cp_reference, "cl_io", io);
 
 	cl_page_assume(env, io, page);
-	if (!PageUptodate(vmpage)) {
+	if (OBD_FAIL_CHECK_VALUE(OBD_FAIL_LLITE_WRITE_BEGIN, index)) {
+		result = -EIO;
+	} else if (!PageUptodate(vmpage)) {
 		/*
 		 * We're completely overwriting an existing page,
 		 * so _don't_ set it up to date until commit_write
@@ -708,8 +790,12 @@ static int ll_write_begin(struct file *file, struct address_space *mapping,
 				SetPageUptodate(vmpage);
 		}
 	}
-	if (result < 0)
+	if (result < 0) {
+		/* don't leave a page which failed to be read in the cache */
+		if (!PageUptodate(vmpage) && !PageDirty(vmpage))
+			cl_page_discard(env, io, page);
 		cl_page_unassume(env, io, page);
+	}
 	EXIT;
 out:
 	if (result < 0) {
@@ -104,6 +104,10 @@ struct vvp_io {
 			unsigned long vui_written;
 			int vui_from;
 			int vui_to;
+			/* pages in [vui_prep_start, vui_prep_end) had their
+			 * cl_page set up by ll_write_prep_pages() already */
+			pgoff_t vui_prep_start;
+			pgoff_t vui_prep_end;
 		} write;
 	} u;
 
@@ -134,11 +138,16 @@ extern struct lu_context_key vvp_thread_key;
 extern struct kmem_cache *vvp_lock_kmem;
 extern struct kmem_cache *vvp_object_kmem;
 
+#define VTI_PVEC_SIZE 16
+
 struct vvp_thread_info {
 	struct cl_lock		vti_lock;
 	struct cl_lock_descr	vti_descr;
 	struct cl_io		vti_io;
 	struct cl_attr		vti_attr;
+	/* used by ll_write_prep_pages() */
+	struct page		*vti_vmpvec[VTI_PVEC_SIZE];
+	struct cl_page		*vti_pvec[VTI_PVEC_SIZE];
 };
 
 static inline struct vvp_thread_info *vvp_env_info(const struct lu_env *env)
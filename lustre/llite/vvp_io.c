@@ -268,16 +268,60 @@ static int vvp_io_write_iter_init(const struct lu_env *env,
 	vio->u.write.vui_written = 0;
 	vio->u.write.vui_from = 0;
 	vio->u.write.vui_to = PAGE_SIZE;
+	vio->u.write.vui_prep_start = 0;
+	vio->u.write.vui_prep_end = 0;
 
 	return 0;
 }
 
+/**
+ * Discard the pages ll_write_prep_pages() set up ahead of a write which
+ * stopped short of them, so that they don't stay in the page cache with a
+ * cl_page attached and no data. Pages which got data in the meantime, from
+ * this write or a read, are left alone.
+ */
+static void vvp_io_write_prep_discard(const struct lu_env *env,
+				      const struct cl_io_slice *ios)
+{
+	struct cl_io		*io = ios->cis_io;
+	struct vvp_io		*vio = cl2vvp_io(env, ios);
+	struct cl_object	*obj = ios->cis_obj;
+	struct address_space	*mapping = vvp_object_inode(obj)->i_mapping;
+	struct cl_page		*page;
+	struct page		*vmpage;
+	pgoff_t			 index;
+
+	for (index = vio->u.write.vui_prep_start;
+	     index < vio->u.write.vui_prep_end; index++) {
+		vmpage = find_get_page(mapping, index);
+		if (vmpage == NULL)
+			continue;
+
+		page = NULL;
+		if (!PageUptodate(vmpage))
+			page = cl_vmpage_page(vmpage, obj);
+		put_page(vmpage);
+		if (page == NULL)
+			continue;
+
+		if (cl_page_own(env, io, page) == 0) {
+			if (!PageUptodate(vmpage) && !PageDirty(vmpage) &&
+			    !PageWriteback(vmpage))
+				cl_page_discard(env, io, page);
+			cl_page_disown(env, io, page);
+		}
+		cl_page_put(env, page);
+	}
+	vio->u.write.vui_prep_start = vio->u.write.vui_prep_end = 0;
+}
+
 static void vvp_io_write_iter_fini(const struct lu_env *env,
 				   const struct cl_io_slice *ios)
 {
 	struct vvp_io *vio = cl2vvp_io(env, ios);
 
 	LASSERT(vio->u.write.vui_queue.pl_nr == 0);
+	vvp_io_write_prep_discard(env, ios);
 }
 
 static int vvp_io_fault_iter_init(const struct lu_env *env,
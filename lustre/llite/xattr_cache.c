@@ -40,18 +40,62 @@
 #include <lustre_ver.h>
 #include "llite_internal.h"
 
-/* If we ever have hundreds of extended attributes, we might want to consider
- * using a hash or a tree structure instead of list for faster lookups.
+/* Number of per-inode hash chains used to index cached xattr names. */
+#define LL_XATTR_HASH_BITS	3
+#define LL_XATTR_HASH_SIZE	(1 << LL_XATTR_HASH_BITS)
+#define LL_XATTR_HASH_MASK	(LL_XATTR_HASH_SIZE - 1)
+
+/* Names that are looked up for nearly every inode (e.g. by the LSM on
+ * d_instantiate). If the MDT did not return them in the refill reply a
+ * negative entry is cached, so that subsequent lookups are answered with
+ * -ENODATA under the same XATTR lock instead of costing an RPC each.
  */
+static const char *ll_xattr_negative_names[] = {
+	"security.selinux",
+	NULL
+};
+
+/* Xattr values are reference counted and shared between all inodes of
+ * the client that carry identical values (ACLs, security labels, ...).
+ */
+struct ll_xattr_value_key {
+	const char		*xvk_data;
+	unsigned		 xvk_len;
+};
+
+struct ll_xattr_value {
+	struct hlist_node	 xv_hash;   /* ll_xattr_values chain */
+	atomic_t		 xv_ref;    /* number of ll_xattr_entry users */
+	struct ll_xattr_value_key xv_key;   /* points to xv_data */
+	char			 xv_data[0];
+};
+
 struct ll_xattr_entry {
 	struct list_head	xe_list;    /* protected with
 					     * lli_xattrs_list_rwsem */
+	struct hlist_node	xe_hash;    /* lli_xattrs_hash chain, protected
+					     * with lli_xattrs_list_rwsem */
 	char			*xe_name;   /* xattr name, \0-terminated */
-	char			*xe_value;  /* xattr value */
+	struct ll_xattr_value	*xe_value;  /* shared xattr value, NULL for a
+					     * negative entry */
 	unsigned		xe_namelen; /* strlen(xe_name) + 1 */
-	unsigned		xe_vallen;  /* xattr value length */
 };
 
+static inline bool ll_xattr_entry_negative(struct ll_xattr_entry *xattr)
+{
+	return xattr->xe_value == NULL;
+}
+
+static inline unsigned ll_xattr_entry_vallen(struct ll_xattr_entry *xattr)
+{
+	return xattr->xe_value != NULL ? xattr->xe_value->xv_key.xvk_len : 0;
+}
+
+static inline const char *ll_xattr_entry_value(struct ll_xattr_entry *xattr)
+{
+	return xattr->xe_value != NULL ? xattr->xe_value->xv_data : NULL;
+}
+
 static struct kmem_cache *xattr_kmem;
 static struct lu_kmem_descr xattr_caches[] = {
 	{
@@ -64,56 +108,262 @@ static struct lu_kmem_descr xattr_caches[] = {
 	}
 };
 
+#define LL_XATTR_VALUE_HASH_BITS	12
+#define LL_XATTR_VALUE_HASH_BKT_BITS	6
+
+static struct cfs_hash *ll_xattr_values;
+
+static unsigned ll_xattr_value_hop_hash(struct cfs_hash *hs, const void *key,
+					unsigned mask)
+{
+	const struct ll_xattr_value_key *xvk = key;
+
+	return cfs_hash_djb2_hash(xvk->xvk_data, xvk->xvk_len, mask);
+}
+
+static void *ll_xattr_value_hop_key(struct hlist_node *hnode)
+{
+	struct ll_xattr_value *val = hlist_entry(hnode, struct ll_xattr_value,
+						 xv_hash);
+
+	return &val->xv_key;
+}
+
+static int ll_xattr_value_hop_keycmp(const void *key, struct hlist_node *hnode)
+{
+	const struct ll_xattr_value_key *xvk = key;
+	struct ll_xattr_value *val = hlist_entry(hnode, struct ll_xattr_value,
+						 xv_hash);
+
+	return xvk->xvk_len == val->xv_key.xvk_len &&
+	       memcmp(xvk->xvk_data, val->xv_data, xvk->xvk_len) == 0;
+}
+
+static void *ll_xattr_value_hop_object(struct hlist_node *hnode)
+{
+	return hlist_entry(hnode, struct ll_xattr_value, xv_hash);
+}
+
+static void ll_xattr_value_hop_get(struct cfs_hash *hs,
+				   struct hlist_node *hnode)
+{
+	struct ll_xattr_value *val = hlist_entry(hnode, struct ll_xattr_value,
+						 xv_hash);
+
+	atomic_inc(&val->xv_ref);
+}
+
+static void ll_xattr_value_hop_put(struct cfs_hash *hs,
+				   struct hlist_node *hnode)
+{
+	struct ll_xattr_value *val = hlist_entry(hnode, struct ll_xattr_value,
+						 xv_hash);
+
+	atomic_dec(&val->xv_ref);
+}
+
+static void ll_xattr_value_hop_exit(struct cfs_hash *hs,
+				    struct hlist_node *hnode)
+{
+	struct ll_xattr_value *val = hlist_entry(hnode, struct ll_xattr_value,
+						 xv_hash);
+
+	CERROR("busy xattr value %p: len = %u, refcount = %d\n",
+	       val, val->xv_key.xvk_len, atomic_read(&val->xv_ref));
+}
+
+static struct cfs_hash_ops ll_xattr_value_hash_ops = {
+	.hs_hash	= ll_xattr_value_hop_hash,
+	.hs_key		= ll_xattr_value_hop_key,
+	.hs_keycmp	= ll_xattr_value_hop_keycmp,
+	.hs_object	= ll_xattr_value_hop_object,
+	.hs_get		= ll_xattr_value_hop_get,
+	.hs_put		= ll_xattr_value_hop_put,
+	.hs_put_locked	= ll_xattr_value_hop_put,
+	.hs_exit	= ll_xattr_value_hop_exit,
+};
+
+#define LL_XATTR_VALUE_HASH_FLAGS (CFS_HASH_SPIN_BKTLOCK | \
+				   CFS_HASH_NO_ITEMREF)
+
 int ll_xattr_init(void)
 {
-	return lu_kmem_init(xattr_caches);
+	int rc;
+
+	rc = lu_kmem_init(xattr_caches);
+	if (rc)
+		return rc;
+
+	ll_xattr_values = cfs_hash_create("ll_xattr_values",
+					  LL_XATTR_VALUE_HASH_BITS,
+					  LL_XATTR_VALUE_HASH_BITS,
+					  LL_XATTR_VALUE_HASH_BKT_BITS, 0,
+					  CFS_HASH_MIN_THETA,
+					  CFS_HASH_MAX_THETA,
+					  &ll_xattr_value_hash_ops,
+					  LL_XATTR_VALUE_HASH_FLAGS);
+	if (ll_xattr_values == NULL) {
+		lu_kmem_fini(xattr_caches);
+		return -ENOMEM;
+	}
+
+	return 0;
 }
 
 void ll_xattr_fini(void)
 {
+	cfs_hash_putref(ll_xattr_values);
+	ll_xattr_values = NULL;
 	lu_kmem_fini(xattr_caches);
 }
 
+/**
+ * Find a shared xattr value or insert a new one.
+ *
+ * Look up the value @data of @len bytes in the client-wide value hash and
+ * take a reference on it, allocating and inserting a new value if no
+ * identical one is cached yet.
+ *
+ * \retval value pointer on success
+ * \retval NULL if no memory could be allocated
+ */
+static struct ll_xattr_value *ll_xattr_value_get(const char *data,
+						 unsigned len)
+{
+	struct ll_xattr_value_key key = { .xvk_data = data, .xvk_len = len };
+	struct ll_xattr_value *val;
+	struct ll_xattr_value *new;
+	struct hlist_node *hnode;
+	struct cfs_hash_bd bd;
+
+	cfs_hash_bd_get_and_lock(ll_xattr_values, &key, &bd, 1);
+	hnode = cfs_hash_bd_peek_locked(ll_xattr_values, &bd, &key);
+	if (hnode != NULL) {
+		val = hlist_entry(hnode, struct ll_xattr_value, xv_hash);
+		atomic_inc(&val->xv_ref);
+		cfs_hash_bd_unlock(ll_xattr_values, &bd, 1);
+		return val;
+	}
+	cfs_hash_bd_unlock(ll_xattr_values, &bd, 1);
+
+	OBD_ALLOC_GFP(new, offsetof(struct ll_xattr_value, xv_data[len]),
+		      GFP_NOFS);
+	if (new == NULL)
+		return NULL;
+
+	INIT_HLIST_NODE(&new->xv_hash);
+	atomic_set(&new->xv_ref, 1);
+	memcpy(new->xv_data, data, len);
+	new->xv_key.xvk_data = new->xv_data;
+	new->xv_key.xvk_len = len;
+
+	/* somebody could have inserted the same value meanwhile */
+	cfs_hash_bd_lock(ll_xattr_values, &bd, 1);
+	hnode = cfs_hash_bd_peek_locked(ll_xattr_values, &bd, &key);
+	if (hnode != NULL) {
+		val = hlist_entry(hnode, struct ll_xattr_value, xv_hash);
+		atomic_inc(&val->xv_ref);
+	} else {
+		cfs_hash_bd_add_locked(ll_xattr_values, &bd, &new->xv_hash);
+		val = new;
+		new = NULL;
+	}
+	cfs_hash_bd_unlock(ll_xattr_values, &bd, 1);
+
+	if (new != NULL)
+		OBD_FREE(new, offsetof(struct ll_xattr_value, xv_data[len]));
+
+	return val;
+}
+
+/**
+ * Drop a reference on a shared xattr value, freeing it with the last one.
+ */
+static void ll_xattr_value_put(struct ll_xattr_value *val)
+{
+	struct cfs_hash_bd bd;
+	unsigned len = val->xv_key.xvk_len;
+
+	cfs_hash_bd_get(ll_xattr_values, &val->xv_key, &bd);
+	if (!cfs_hash_bd_dec_and_lock(ll_xattr_values, &bd, &val->xv_ref))
+		return;
+
+	cfs_hash_bd_del_locked(ll_xattr_values, &bd, &val->xv_hash);
+	cfs_hash_bd_unlock(ll_xattr_values, &bd, 1);
+
+	OBD_FREE(val, offsetof(struct ll_xattr_value, xv_data[len]));
+}
+
 /**
  * Initializes xattr cache for an inode.
  *
- * This initializes the xattr list and marks cache presence.
+ * This initializes the xattr list and name index and marks cache presence.
+ *
+ * \retval 0       success
+ * \retval -ENOMEM if the name index could not be allocated
  */
-static void ll_xattr_cache_init(struct ll_inode_info *lli)
+static int ll_xattr_cache_init(struct ll_inode_info *lli)
 {
+	int i;
+
 	ENTRY;
 
 	LASSERT(lli != NULL);
 
+	if (lli->lli_xattrs_hash == NULL) {
+		OBD_ALLOC_GFP(lli->lli_xattrs_hash, LL_XATTR_HASH_SIZE *
+			      sizeof(*lli->lli_xattrs_hash), GFP_NOFS);
+		if (lli->lli_xattrs_hash == NULL)
+			RETURN(-ENOMEM);
+	}
+
+	for (i = 0; i < LL_XATTR_HASH_SIZE; i++)
+		INIT_HLIST_HEAD(&lli->lli_xattrs_hash[i]);
 	INIT_LIST_HEAD(&lli->lli_xattrs);
 	ll_file_set_flag(lli, LLIF_XATTR_CACHE);
+
+	RETURN(0);
+}
+
+static inline struct hlist_head *
+ll_xattr_cache_chain(struct ll_inode_info *lli, const char *xattr_name,
+		     unsigned namelen)
+{
+	return &lli->lli_xattrs_hash[cfs_hash_djb2_hash(xattr_name, namelen,
+							LL_XATTR_HASH_MASK)];
 }
 
 /**
  *  This looks for a specific extended attribute.
  *
- *  Find in @cache and return @xattr_name attribute in @xattr,
- *  for the NULL @xattr_name return the first cached @xattr.
+ *  Find in the cache of @lli and return @xattr_name attribute in @xattr.
+ *  Negative entries are returned as well, the caller has to check them
+ *  with ll_xattr_entry_negative().
  *
  *  \retval 0        success
  *  \retval -ENODATA if not found
  */
-static int ll_xattr_cache_find(struct list_head *cache,
+static int ll_xattr_cache_find(struct ll_inode_info *lli,
 			       const char *xattr_name,
 			       struct ll_xattr_entry **xattr)
 {
 	struct ll_xattr_entry *entry;
+	struct hlist_node *node __maybe_unused;
+	unsigned namelen = strlen(xattr_name) + 1;
 
 	ENTRY;
 
-	list_for_each_entry(entry, cache, xe_list) {
-		/* xattr_name == NULL means look for any entry */
-		if (xattr_name == NULL ||
-		    strcmp(xattr_name, entry->xe_name) == 0) {
+	cfs_hlist_for_each_entry(entry, node,
+				 ll_xattr_cache_chain(lli, xattr_name, namelen),
+				 xe_hash) {
+		if (entry->xe_namelen == namelen &&
+		    memcmp(xattr_name, entry->xe_name, namelen) == 0) {
 			*xattr = entry;
-			CDEBUG(D_CACHE, "find: [%s]=%.*s\n",
-			       entry->xe_name, entry->xe_vallen,
-			       entry->xe_value);
+			CDEBUG(D_CACHE, "find: [%s]=%.*s%s\n",
+			       entry->xe_name, ll_xattr_entry_vallen(entry),
+			       ll_xattr_entry_value(entry),
+			       ll_xattr_entry_negative(entry) ?
+			       " (negative)" : "");
 			RETURN(0);
 		}
 	}
@@ -125,12 +375,13 @@ static int ll_xattr_cache_find(struct list_head *cache,
  * This adds an xattr.
  *
  * Add @xattr_name attr with @xattr_val value and @xattr_val_len length,
+ * a NULL @xattr_val adds a negative entry.
  *
  * \retval 0       success
  * \retval -ENOMEM if no memory could be allocated for the cached attr
  * \retval -EPROTO if duplicate xattr is being added
  */
-static int ll_xattr_cache_add(struct list_head *cache,
+static int ll_xattr_cache_add(struct ll_inode_info *lli,
 			      const char *xattr_name,
 			      const char *xattr_val,
 			      unsigned xattr_val_len)
@@ -139,7 +390,7 @@ static int ll_xattr_cache_add(struct list_head *cache,
 
 	ENTRY;
 
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
+	if (ll_xattr_cache_find(lli, xattr_name, &xattr) == 0) {
 		CDEBUG(D_CACHE, "duplicate xattr: [%s]\n", xattr_name);
 		RETURN(-EPROTO);
 	}
@@ -158,20 +409,26 @@ static int ll_xattr_cache_add(struct list_head *cache,
 		       xattr->xe_namelen);
 		goto err_name;
 	}
-	OBD_ALLOC(xattr->xe_value, xattr_val_len);
-	if (!xattr->xe_value) {
-		CDEBUG(D_CACHE, "failed to alloc xattr value %d\n",
-		       xattr_val_len);
-		goto err_value;
+	if (xattr_val != NULL) {
+		xattr->xe_value = ll_xattr_value_get(xattr_val, xattr_val_len);
+		if (!xattr->xe_value) {
+			CDEBUG(D_CACHE, "failed to alloc xattr value %d\n",
+			       xattr_val_len);
+			goto err_value;
+		}
 	}
 
 	memcpy(xattr->xe_name, xattr_name, xattr->xe_namelen);
-	memcpy(xattr->xe_value, xattr_val, xattr_val_len);
-	xattr->xe_vallen = xattr_val_len;
-	list_add(&xattr->xe_list, cache);
+	list_add(&xattr->xe_list, &lli->lli_xattrs);
+	hlist_add_head(&xattr->xe_hash,
+		       ll_xattr_cache_chain(lli, xattr->xe_name,
+					    xattr->xe_namelen));
 
-	CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xattr_name,
-		xattr_val_len, xattr_val);
+	if (xattr_val != NULL)
+		CDEBUG(D_CACHE, "set: [%s]=%.*s\n", xattr_name,
+		       xattr_val_len, xattr_val);
+	else
+		CDEBUG(D_CACHE, "set negative: [%s]\n", xattr_name);
 
 	RETURN(0);
 err_value:
@@ -183,32 +440,16 @@ err_name:
 }
 
 /**
- * This removes an extended attribute from cache.
- *
- * Remove @xattr_name attribute from @cache.
- *
- * \retval 0        success
- * \retval -ENODATA if @xattr_name is not cached
+ * This frees a cached extended attribute entry.
  */
-static int ll_xattr_cache_del(struct list_head *cache,
-			      const char *xattr_name)
+static void ll_xattr_cache_free(struct ll_xattr_entry *xattr)
 {
-	struct ll_xattr_entry *xattr;
-
-	ENTRY;
-
-	CDEBUG(D_CACHE, "del xattr: %s\n", xattr_name);
-
-	if (ll_xattr_cache_find(cache, xattr_name, &xattr) == 0) {
-		list_del(&xattr->xe_list);
-		OBD_FREE(xattr->xe_name, xattr->xe_namelen);
-		OBD_FREE(xattr->xe_value, xattr->xe_vallen);
-		OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
-
-		RETURN(0);
-	}
-
-	RETURN(-ENODATA);
+	list_del(&xattr->xe_list);
+	hlist_del(&xattr->xe_hash);
+	if (xattr->xe_value != NULL)
+		ll_xattr_value_put(xattr->xe_value);
+	OBD_FREE(xattr->xe_name, xattr->xe_namelen);
+	OBD_SLAB_FREE_PTR(xattr, xattr_kmem);
 }
 
 /**
@@ -231,6 +472,10 @@ static int ll_xattr_cache_list(struct list_head *cache,
 	ENTRY;
 
 	list_for_each_entry_safe(xattr, tmp, cache, xe_list) {
+		/* negative entries only exist to answer getxattr */
+		if (ll_xattr_entry_negative(xattr))
+			continue;
+
 		CDEBUG(D_CACHE, "list: buffer=%p[%d] name=%s\n",
 			xld_buffer, xld_tail, xattr->xe_name);
 
@@ -270,13 +515,17 @@ static int ll_xattr_cache_valid(struct ll_inode_info *lli)
  */
 static int ll_xattr_cache_destroy_locked(struct ll_inode_info *lli)
 {
+	struct ll_xattr_entry *xattr, *tmp;
+
 	ENTRY;
 
 	if (!ll_xattr_cache_valid(lli))
 		RETURN(0);
 
-	while (ll_xattr_cache_del(&lli->lli_xattrs, NULL) == 0)
-		/* empty loop */ ;
+	list_for_each_entry_safe(xattr, tmp, &lli->lli_xattrs, xe_list) {
+		CDEBUG(D_CACHE, "del xattr: %s\n", xattr->xe_name);
+		ll_xattr_cache_free(xattr);
+	}
 
 	ll_file_clear_flag(lli, LLIF_XATTR_CACHE);
 
@@ -297,6 +546,21 @@ int ll_xattr_cache_destroy(struct inode *inode)
 	RETURN(rc);
 }
 
+/**
+ * Release the xattr cache and its name index when the inode is cleared.
+ */
+void ll_xattr_cache_fini(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+
+	ll_xattr_cache_destroy(inode);
+	if (lli->lli_xattrs_hash != NULL) {
+		OBD_FREE(lli->lli_xattrs_hash, LL_XATTR_HASH_SIZE *
+			 sizeof(*lli->lli_xattrs_hash));
+		lli->lli_xattrs_hash = NULL;
+	}
+}
+
 /**
  * Match or enqueue a PR lock.
  *
@@ -428,7 +692,9 @@ static int ll_xattr_cache_refill(struct inode *inode)
 
 	CDEBUG(D_CACHE, "caching: xdata=%p xtail=%p\n", xdata, xtail);
 
-	ll_xattr_cache_init(lli);
+	rc = ll_xattr_cache_init(lli);
+	if (rc < 0)
+		GOTO(err_cancel, rc);
 
 	for (i = 0; i < body->mbo_max_mdsize; i++) {
 		CDEBUG(D_CACHE, "caching [%s]=%.*s\n", xdata, *xsizes, xval);
@@ -446,13 +712,8 @@ static int ll_xattr_cache_refill(struct inode *inode)
 			CDEBUG(D_CACHE, "not caching %s\n",
 			       XATTR_NAME_ACL_ACCESS);
 			rc = 0;
-		} else if (!strcmp(xdata, "security.selinux")) {
-			/* Filter out security.selinux, it is cached in slab */
-			CDEBUG(D_CACHE, "not caching security.selinux\n");
-			rc = 0;
 		} else {
-			rc = ll_xattr_cache_add(&lli->lli_xattrs, xdata, xval,
-						*xsizes);
+			rc = ll_xattr_cache_add(lli, xdata, xval, *xsizes);
 		}
 		if (rc < 0) {
 			ll_xattr_cache_destroy_locked(lli);
@@ -466,6 +727,23 @@ static int ll_xattr_cache_refill(struct inode *inode)
 	if (xdata != xtail || xval != xvtail)
 		CERROR("a hole in xattr data\n");
 
+	/* The reply carries all xattrs of the inode, so remember the absence
+	 * of the frequently looked up ones under the same lock. */
+	for (i = 0; ll_xattr_negative_names[i] != NULL; i++) {
+		struct ll_xattr_entry *xattr;
+
+		if (ll_xattr_cache_find(lli, ll_xattr_negative_names[i],
+					&xattr) == 0)
+			continue;
+
+		rc = ll_xattr_cache_add(lli, ll_xattr_negative_names[i],
+					NULL, 0);
+		if (rc < 0) {
+			ll_xattr_cache_destroy_locked(lli);
+			GOTO(err_cancel, rc);
+		}
+	}
+
 	ll_set_lock_data(sbi->ll_md_exp, inode, &oit, NULL);
 	ll_intent_drop_lock(&oit);
 
@@ -527,14 +805,16 @@ int ll_xattr_cache_get(struct inode *inode,
 	if (valid & OBD_MD_FLXATTR) {
 		struct ll_xattr_entry *xattr;
 
-		rc = ll_xattr_cache_find(&lli->lli_xattrs, name, &xattr);
-		if (rc == 0) {
-			rc = xattr->xe_vallen;
+		rc = ll_xattr_cache_find(lli, name, &xattr);
+		if (rc == 0 && ll_xattr_entry_negative(xattr)) {
+			rc = -ENODATA;
+		} else if (rc == 0) {
+			rc = ll_xattr_entry_vallen(xattr);
 			/* zero size means we are only requested size in rc */
 			if (size != 0) {
-				if (size >= xattr->xe_vallen)
-					memcpy(buffer, xattr->xe_value,
-						xattr->xe_vallen);
+				if (size >= rc)
+					memcpy(buffer,
+					       ll_xattr_entry_value(xattr), rc);
 				else
 					rc = -ERANGE;
 			}
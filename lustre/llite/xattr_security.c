@@ -65,7 +65,8 @@ int ll_dentry_init_security(struct dentry *dentry, int mode, struct qstr *name,
 	 * calls it and assumes that if anything is returned then it must come
 	 * from SELinux. */
 
-	if (!selinux_is_enabled())
+	if (!selinux_is_enabled() ||
+	    OBD_FAIL_CHECK(OBD_FAIL_LLITE_NO_SECURITY_INIT))
 		return 0;
 
 	rc = security_dentry_init_security(dentry, mode, name, secctx,
@@ -136,7 +137,8 @@ int
 ll_inode_init_security(struct dentry *dentry, struct inode *inode,
 		       struct inode *dir)
 {
-	if (!selinux_is_enabled())
+	if (!selinux_is_enabled() ||
+	    OBD_FAIL_CHECK(OBD_FAIL_LLITE_NO_SECURITY_INIT))
 		return 0;
 
 	return ll_security_inode_init_security(inode, dir, NULL, NULL, 0,
@@ -162,7 +164,8 @@ ll_inode_init_security(struct dentry *dentry, struct inode *inode,
 	void *value;
 	char *name, *full_name;
 
-	if (!selinux_is_enabled())
+	if (!selinux_is_enabled() ||
+	    OBD_FAIL_CHECK(OBD_FAIL_LLITE_NO_SECURITY_INIT))
 		return 0;
 
 	err = ll_security_inode_init_security(inode, dir, &name, &value, &len,
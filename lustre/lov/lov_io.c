@@ -779,6 +779,44 @@ static int lov_io_commit_async(const struct lu_env *env,
 	RETURN(rc);
 }
 
+/**
+ * lov implementation of cl_io_operations::cio_dio_submit(). The rw io loop
+ * (see lov_io_rw_iter_init()) never hands a range crossing a stripe
+ * boundary to llite, so the transfer is simply translated into the object
+ * offset of the stripe and passed to its sub-io.
+ */
+static int lov_io_dio_submit(const struct lu_env *env,
+			     const struct cl_io_slice *ios,
+			     enum cl_req_type crt, struct cl_dio_pages *cdp)
+{
+	struct lov_io		*lio = cl2lov_io(env, ios);
+	struct lov_stripe_md	*lsm = lio->lis_object->lo_lsm;
+	struct cl_dio_pages	 sub_cdp = *cdp;
+	struct lov_io_sub	*sub;
+	loff_t			 start = cdp->cdp_pos;
+	loff_t			 last = cdp->cdp_pos + cdp->cdp_size - 1;
+	int			 stripe;
+	int			 rc;
+	ENTRY;
+
+	if (lsm->lsm_stripe_count > 1) {
+		lov_do_div64(start, lsm->lsm_stripe_size);
+		lov_do_div64(last, lsm->lsm_stripe_size);
+		if (start != last)
+			RETURN(-ENOTSUPP);
+	}
+
+	stripe = lov_stripe_number(lsm, cdp->cdp_pos);
+	sub = lov_sub_get(env, lio, stripe);
+	if (IS_ERR(sub))
+		RETURN(PTR_ERR(sub));
+
+	lov_stripe_offset(lsm, cdp->cdp_pos, stripe, &sub_cdp.cdp_pos);
+	rc = cl_io_dio_submit(sub->sub_env, sub->sub_io, crt, &sub_cdp);
+
+	RETURN(rc);
+}
+
 static int lov_io_fault_start(const struct lu_env *env,
                               const struct cl_io_slice *ios)
 {
@@ -886,6 +924,7 @@ static const struct cl_io_operations lov_io_ops = {
 	.cio_read_ahead		       = lov_io_read_ahead,
 	.cio_submit                    = lov_io_submit,
 	.cio_commit_async              = lov_io_commit_async,
+	.cio_dio_submit		       = lov_io_dio_submit,
 };
 
 /*****************************************************************************
@@ -733,6 +733,60 @@ int cl_io_submit_sync(const struct lu_env *env, struct cl_io *io,
 }
 EXPORT_SYMBOL(cl_io_submit_sync);
 
+/**
+ * Submits page aligned direct IO without cl_page setup.
+ *
+ * \returns 0 if the transfer was submitted, -ENOTSUPP if no layer can do
+ * it without cl_page (nothing was sent then), other error code otherwise.
+ * \see cl_io_operations::cio_dio_submit()
+ */
+int cl_io_dio_submit(const struct lu_env *env, struct cl_io *io,
+		     enum cl_req_type crt, struct cl_dio_pages *cdp)
+{
+	const struct cl_io_slice *scan;
+	int result = -ENOTSUPP;
+	ENTRY;
+
+	LINVRNT(io->ci_type == CIT_READ || io->ci_type == CIT_WRITE);
+
+	cl_io_for_each(scan, io) {
+		if (scan->cis_iop->cio_dio_submit == NULL)
+			continue;
+		result = scan->cis_iop->cio_dio_submit(env, scan, crt, cdp);
+		if (result != 0)
+			break;
+	}
+	RETURN(result);
+}
+EXPORT_SYMBOL(cl_io_dio_submit);
+
+/**
+ * Submit page aligned direct IO without cl_page setup and wait for it to
+ * be finished, or error happens. If \a timeout is zero, it means to wait
+ * for the IO unconditionally.
+ */
+int cl_io_dio_submit_sync(const struct lu_env *env, struct cl_io *io,
+			  enum cl_req_type crt, struct cl_dio_pages *cdp,
+			  long timeout)
+{
+	struct cl_sync_io *anchor = &cl_env_info(env)->clt_anchor;
+	int rc;
+
+	/* the submitter holds one entry until everything is sent */
+	cl_sync_io_init(anchor, 1, &cl_sync_io_end);
+	cdp->cdp_anchor = anchor;
+
+	rc = cl_io_dio_submit(env, io, crt, cdp);
+	cl_sync_io_note(env, anchor, rc == -ENOTSUPP ? 0 : rc);
+
+	/* wait for the RPCs which were sent, even if submission failed */
+	rc = cl_sync_io_wait(env, anchor, timeout) ?: rc;
+	cdp->cdp_anchor = NULL;
+
+	return rc;
+}
+EXPORT_SYMBOL(cl_io_dio_submit_sync);
+
 /**
  * Cancel an IO which has been submitted by cl_io_submit_rw.
  */
@@ -1101,5 +1101,6 @@ void cl_global_fini(void)
 	cl_env_percpu_fini();
 	lu_context_key_degister(&cl_key);
 	lu_kmem_fini(cl_object_caches);
+	cl_page_kmem_fini();
 	OBD_FREE(cl_envs, sizeof(*cl_envs) * num_possible_cpus());
 }
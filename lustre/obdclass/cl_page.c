@@ -90,6 +90,105 @@ static void cl_page_delete0(const struct lu_env *env, struct cl_page *pg);
 #define CS_PAGESTATE_DEC(o, state)
 #endif
 
+/*
+ * cl_page buffers come from one slab per distinct layer stack size. There is
+ * only a handful of those on a client (one per combination of layers), so
+ * a small array searched linearly is enough. Entries are only ever added,
+ * under cl_page_kmem_mutex, and are published by setting the size last.
+ */
+#define CL_PAGE_KMEM_MAX 16
+static struct kmem_cache *cl_page_kmem_array[CL_PAGE_KMEM_MAX];
+static unsigned short cl_page_kmem_size_array[CL_PAGE_KMEM_MAX];
+static DEFINE_MUTEX(cl_page_kmem_mutex);
+
+/**
+ * Returns index of the slab for cl_page buffers of \a bufsize bytes,
+ * creating the slab if needed, or -1 if buffers of this size have to come
+ * from kmalloc.
+ */
+static int cl_page_kmem_index(unsigned short bufsize)
+{
+	int i;
+
+	for (i = 0; i < CL_PAGE_KMEM_MAX; i++) {
+		unsigned short size = cl_page_kmem_size_array[i];
+
+		if (size == bufsize) {
+			smp_rmb();
+			return i;
+		}
+		if (size == 0)
+			break;
+	}
+
+	mutex_lock(&cl_page_kmem_mutex);
+	for (; i < CL_PAGE_KMEM_MAX; i++) {
+		char name[32];
+
+		if (cl_page_kmem_size_array[i] == bufsize)
+			break;
+		if (cl_page_kmem_size_array[i] != 0)
+			continue;
+
+		snprintf(name, sizeof(name), "cl_page_kmem-%u", bufsize);
+		cl_page_kmem_array[i] = kmem_cache_create(name, bufsize, 0, 0,
+							  NULL);
+		if (cl_page_kmem_array[i] == NULL) {
+			i = CL_PAGE_KMEM_MAX;
+			break;
+		}
+		smp_wmb();
+		cl_page_kmem_size_array[i] = bufsize;
+		break;
+	}
+	mutex_unlock(&cl_page_kmem_mutex);
+
+	return i < CL_PAGE_KMEM_MAX ? i : -1;
+}
+
+/**
+ * Destroys cl_page slabs. Called from cl_global_fini(), when all cl_pages
+ * are long gone.
+ */
+void cl_page_kmem_fini(void)
+{
+	int i;
+
+	for (i = 0; i < CL_PAGE_KMEM_MAX; i++) {
+		if (cl_page_kmem_size_array[i] == 0)
+			break;
+		kmem_cache_destroy(cl_page_kmem_array[i]);
+		cl_page_kmem_array[i] = NULL;
+		cl_page_kmem_size_array[i] = 0;
+	}
+}
+
+static struct cl_page *cl_page_buf_alloc(int kmem_index, int bufsize)
+{
+	struct cl_page *page;
+
+	if (kmem_index >= 0) {
+		OBD_SLAB_ALLOC_GFP(page, cl_page_kmem_array[kmem_index],
+				   bufsize, GFP_NOFS);
+	} else {
+		OBD_ALLOC_GFP(page, bufsize, GFP_NOFS);
+	}
+	if (page != NULL)
+		page->cp_kmem_index = kmem_index;
+
+	return page;
+}
+
+static void cl_page_buf_free(struct cl_page *page, int bufsize)
+{
+	int kmem_index = page->cp_kmem_index;
+
+	if (kmem_index >= 0)
+		OBD_SLAB_FREE(page, cl_page_kmem_array[kmem_index], bufsize);
+	else
+		OBD_FREE(page, bufsize);
+}
+
 /**
  * Internal version of cl_page_get().
  *
@@ -150,7 +249,7 @@ static void cl_page_free(const struct lu_env *env, struct cl_page *page)
 	lu_object_ref_del_at(&obj->co_lu, &page->cp_obj_ref, "cl_page", page);
 	cl_object_put(env, obj);
 	lu_ref_fini(&page->cp_reference);
-	OBD_FREE(page, pagesize);
+	cl_page_buf_free(page, pagesize);
 	EXIT;
 }
 
@@ -165,51 +264,59 @@ static inline void cl_page_state_set_trust(struct cl_page *page,
         *(enum cl_page_state *)&page->cp_state = state;
 }
 
+/**
+ * Sets up a freshly allocated cl_page buffer \a page and lets every layer
+ * initialize its slice. Consumes \a page on error.
+ */
+static struct cl_page *cl_page_init0(const struct lu_env *env,
+				     struct cl_object *o, struct cl_page *page,
+				     pgoff_t ind, struct page *vmpage,
+				     enum cl_page_type type)
+{
+	struct lu_object_header *head;
+	int result = 0;
+
+	atomic_set(&page->cp_ref, 1);
+	page->cp_obj = o;
+	cl_object_get(o);
+	lu_object_ref_add_at(&o->co_lu, &page->cp_obj_ref, "cl_page", page);
+	page->cp_vmpage = vmpage;
+	cl_page_state_set_trust(page, CPS_CACHED);
+	page->cp_type = type;
+	INIT_LIST_HEAD(&page->cp_layers);
+	INIT_LIST_HEAD(&page->cp_batch);
+	lu_ref_init(&page->cp_reference);
+	head = o->co_lu.lo_header;
+	list_for_each_entry(o, &head->loh_layers, co_lu.lo_linkage) {
+		if (o->co_ops->coo_page_init != NULL) {
+			result = o->co_ops->coo_page_init(env, o, page, ind);
+			if (result != 0) {
+				cl_page_delete0(env, page);
+				cl_page_free(env, page);
+				return ERR_PTR(result);
+			}
+		}
+	}
+	CS_PAGE_INC(o, total);
+	CS_PAGE_INC(o, create);
+	CS_PAGESTATE_DEC(o, CPS_CACHED);
+
+	return page;
+}
+
 struct cl_page *cl_page_alloc(const struct lu_env *env,
 		struct cl_object *o, pgoff_t ind, struct page *vmpage,
 		enum cl_page_type type)
 {
-	struct cl_page          *page;
-	struct lu_object_header *head;
+	int bufsize = cl_object_header(o)->coh_page_bufsize;
+	struct cl_page *page;
 
 	ENTRY;
-	OBD_ALLOC_GFP(page, cl_object_header(o)->coh_page_bufsize,
-			GFP_NOFS);
-	if (page != NULL) {
-		int result = 0;
-		atomic_set(&page->cp_ref, 1);
-		page->cp_obj = o;
-		cl_object_get(o);
-		lu_object_ref_add_at(&o->co_lu, &page->cp_obj_ref, "cl_page",
-				     page);
-		page->cp_vmpage = vmpage;
-		cl_page_state_set_trust(page, CPS_CACHED);
-		page->cp_type = type;
-		INIT_LIST_HEAD(&page->cp_layers);
-		INIT_LIST_HEAD(&page->cp_batch);
-		lu_ref_init(&page->cp_reference);
-		head = o->co_lu.lo_header;
-		list_for_each_entry(o, &head->loh_layers,
-				    co_lu.lo_linkage) {
-			if (o->co_ops->coo_page_init != NULL) {
-				result = o->co_ops->coo_page_init(env, o, page,
-								  ind);
-				if (result != 0) {
-					cl_page_delete0(env, page);
-					cl_page_free(env, page);
-					page = ERR_PTR(result);
-					break;
-				}
-			}
-		}
-		if (result == 0) {
-			CS_PAGE_INC(o, total);
-			CS_PAGE_INC(o, create);
-			CS_PAGESTATE_DEC(o, CPS_CACHED);
-		}
-	} else {
+	page = cl_page_buf_alloc(cl_page_kmem_index(bufsize), bufsize);
+	if (page != NULL)
+		page = cl_page_init0(env, o, page, ind, vmpage, type);
+	else
 		page = ERR_PTR(-ENOMEM);
-	}
 	RETURN(page);
 }
 
@@ -269,6 +376,60 @@ struct cl_page *cl_page_find(const struct lu_env *env,
 }
 EXPORT_SYMBOL(cl_page_find);
 
+/**
+ * Batched version of cl_page_find() for \a nr locked cacheable VM pages
+ * covering a contiguous range of \a o.
+ *
+ * Pages already having a cl_page are looked up as cl_page_find() does, the
+ * rest get their cl_page allocated and set up by all layers in the same
+ * pass, resolving the object's buffer size and slab only once. A reference
+ * is returned in \a pages[i] for every VM page handled.
+ *
+ * \retval number of leading pages handled, it is less than \a nr only if
+ *	   an error happened after at least one page was handled
+ * \retval -ve error if the first page could not be handled
+ */
+int cl_page_find_batch(const struct lu_env *env, struct cl_object *o,
+		       struct page **vmpages, struct cl_page **pages, int nr)
+{
+	int bufsize = cl_object_header(o)->coh_page_bufsize;
+	int kmem_index = cl_page_kmem_index(bufsize);
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	might_sleep();
+	for (i = 0; i < nr; i++) {
+		struct page *vmpage = vmpages[i];
+		struct cl_page *page;
+
+		KLASSERT(PageLocked(vmpage));
+		LASSERT(i == 0 || vmpage->index == vmpages[i - 1]->index + 1);
+		CS_PAGE_INC(o, lookup);
+
+		page = cl_vmpage_page(vmpage, o);
+		if (page != NULL) {
+			CS_PAGE_INC(o, hit);
+			pages[i] = page;
+			continue;
+		}
+
+		page = cl_page_buf_alloc(kmem_index, bufsize);
+		if (page == NULL)
+			GOTO(out, rc = -ENOMEM);
+
+		page = cl_page_init0(env, o, page, vmpage->index, vmpage,
+				     CPT_CACHEABLE);
+		if (IS_ERR(page))
+			GOTO(out, rc = PTR_ERR(page));
+		pages[i] = page;
+	}
+	EXIT;
+out:
+	return i > 0 ? i : rc;
+}
+EXPORT_SYMBOL(cl_page_find_batch);
+
 static inline int cl_page_invariant(const struct cl_page *pg)
 {
 	return cl_page_in_use_noref(pg);
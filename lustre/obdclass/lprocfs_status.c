@@ -670,6 +670,7 @@ static const char *obd_connect_names[] = {
 	"second_flags",
 	/* flags2 names */
 	"file_secctx",
+	"compound",
 	NULL
 };
 
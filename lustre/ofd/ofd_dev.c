@@ -936,9 +936,15 @@ static int ofd_set_info_hdl(struct tgt_session_info *tsi)
 		repbody = req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
 		*repbody = *body;
 
-		/** handle grant shrink, similar to a read request */
-		ofd_grant_prepare_read(tsi->tsi_env, tsi->tsi_exp,
-				       &repbody->oa);
+		if ((body->oa.o_valid & OBD_MD_FLFLAGS) &&
+		    (body->oa.o_flags & OBD_FL_GRANT_REQUEST))
+			/** client asks for grant ahead of its writes */
+			ofd_grant_prepare_request(tsi->tsi_env, tsi->tsi_exp,
+						  &repbody->oa);
+		else
+			/** handle grant shrink, similar to a read request */
+			ofd_grant_prepare_read(tsi->tsi_env, tsi->tsi_exp,
+					       &repbody->oa);
 	} else if (KEY_IS(KEY_EVICT_BY_NID)) {
 		if (vallen > 0)
 			obd_export_evict_by_nid(tsi->tsi_exp->exp_obd, val);
@@ -1374,7 +1380,7 @@ static int ofd_setattr_hdl(struct tgt_session_info *tsi)
 
 	LASSERT(body != NULL);
 
-	repbody = req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
+	repbody = tgt_ost_repbody(tsi);
 	if (repbody == NULL)
 		RETURN(-ENOMEM);
 
@@ -2028,7 +2034,7 @@ static int ofd_punch_hdl(struct tgt_session_info *tsi)
 	    (OBD_MD_FLSIZE | OBD_MD_FLBLOCKS))
 		RETURN(err_serious(-EPROTO));
 
-	repbody = req_capsule_server_get(tsi->tsi_pill, &RMF_OST_BODY);
+	repbody = tgt_ost_repbody(tsi);
 	if (repbody == NULL)
 		RETURN(err_serious(-ENOMEM));
 
@@ -2383,20 +2389,23 @@ static inline int prolong_timeout(struct ptlrpc_request *req)
  * request may cover multiple locks.
  *
  * \param[in] tsi	target session environment for this request
+ * \param[in] oa	obdo of the operation, may carry the lock handle
+ * \param[in] resid	resource of the object the operation is about
  * \param[in] data	struct of data to prolong locks
  *
  */
 static void ofd_prolong_extent_locks(struct tgt_session_info *tsi,
-				    struct ldlm_prolong_args *data)
+				     struct obdo *oa,
+				     const struct ldlm_res_id *resid,
+				     struct ldlm_prolong_args *data)
 {
-	struct obdo		*oa  = &tsi->tsi_ost_body->oa;
 	struct ldlm_lock	*lock;
 
 	ENTRY;
 
 	data->lpa_timeout = prolong_timeout(tgt_ses_req(tsi));
 	data->lpa_export = tsi->tsi_exp;
-	data->lpa_resid = tsi->tsi_resid;
+	data->lpa_resid = *resid;
 
 	CDEBUG(D_RPCTRACE, "Prolong locks for req %p with x%llu"
 	       " ext(%llu->%llu)\n", tgt_ses_req(tsi),
@@ -2540,7 +2549,8 @@ static int ofd_rw_hpreq_check(struct ptlrpc_request *req)
 		  current->comm, PFID(&tsi->tsi_fid), pa.lpa_extent.start,
 		  pa.lpa_extent.end);
 
-	ofd_prolong_extent_locks(tsi, &pa);
+	ofd_prolong_extent_locks(tsi, &tsi->tsi_ost_body->oa, &tsi->tsi_resid,
+				 &pa);
 
 	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p.\n",
 	       tgt_name(tsi->tsi_tgt), pa.lpa_blocks_cnt, req);
@@ -2564,6 +2574,28 @@ static void ofd_rw_hpreq_fini(struct ptlrpc_request *req)
 	ofd_rw_hpreq_check(req);
 }
 
+/* Match \a lock against the extent and lock handle of the punch \a oa */
+static int ofd_punch_lock_match(struct obdo *oa, struct ldlm_lock *lock)
+{
+	struct ldlm_extent	 ext;
+
+	if (oa->o_valid & OBD_MD_FLHANDLE &&
+	    oa->o_handle.cookie == lock->l_handle.h_cookie)
+		return 1;
+
+	ext.start = oa->o_size;
+	ext.end   = oa->o_blocks;
+
+	LASSERT(lock->l_resource != NULL);
+	if (!ostid_res_name_eq(&oa->o_oi, &lock->l_resource->lr_name))
+		return 0;
+
+	if (!(lock->l_granted_mode & (LCK_PW | LCK_GROUP)))
+		return 0;
+
+	return ldlm_extent_overlap(&lock->l_policy_data.l_extent, &ext);
+}
+
 /**
  * Implementation of ptlrpc_hpreq_ops::hpreq_lock_match for OST_PUNCH request.
  *
@@ -2582,8 +2614,6 @@ static int ofd_punch_hpreq_lock_match(struct ptlrpc_request *req,
 				      struct ldlm_lock *lock)
 {
 	struct tgt_session_info	*tsi;
-	struct obdo		*oa;
-	struct ldlm_extent	 ext;
 
 	ENTRY;
 
@@ -2596,22 +2626,47 @@ static int ofd_punch_hpreq_lock_match(struct ptlrpc_request *req,
 	 * been filtered out in tgt_hpreq_handler().
 	 */
 	LASSERT(tsi->tsi_ost_body != NULL);
-	if (tsi->tsi_ost_body->oa.o_valid & OBD_MD_FLHANDLE &&
-	    tsi->tsi_ost_body->oa.o_handle.cookie == lock->l_handle.h_cookie)
-		RETURN(1);
 
-	oa = &tsi->tsi_ost_body->oa;
-	ext.start = oa->o_size;
-	ext.end   = oa->o_blocks;
+	RETURN(ofd_punch_lock_match(&tsi->tsi_ost_body->oa, lock));
+}
 
-	LASSERT(lock->l_resource != NULL);
-	if (!ostid_res_name_eq(&oa->o_oi, &lock->l_resource->lr_name))
-		RETURN(0);
+/**
+ * Prolong the locks covering the punch described by \a oa.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] oa	obdo of the punch
+ * \param[in] resid	resource of the punched object
+ *
+ * \retval		1 if the punch is blocking an LDLM lock cancel
+ * \retval		0 if it is not
+ * \retval		-ESTALE if lock is not found
+ */
+static int ofd_punch_prolong(struct tgt_session_info *tsi, struct obdo *oa,
+			     const struct ldlm_res_id *resid)
+{
+	struct ldlm_prolong_args pa = { 0 };
 
-	if (!(lock->l_granted_mode & (LCK_PW | LCK_GROUP)))
-		RETURN(0);
+	LASSERT(!(oa->o_valid & OBD_MD_FLFLAGS &&
+		  oa->o_flags & OBD_FL_SRVLOCK));
 
-	RETURN(ldlm_extent_overlap(&lock->l_policy_data.l_extent, &ext));
+	pa.lpa_mode = LCK_PW | LCK_GROUP;
+	pa.lpa_extent.start = oa->o_size;
+	pa.lpa_extent.end   = oa->o_blocks;
+
+	CDEBUG(D_DLMTRACE,
+	       "%s: refresh locks: %llu/%llu (%llu->%llu)\n",
+	       tgt_name(tsi->tsi_tgt), resid->name[0], resid->name[1],
+	       pa.lpa_extent.start, pa.lpa_extent.end);
+
+	ofd_prolong_extent_locks(tsi, oa, resid, &pa);
+
+	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p.\n",
+	       tgt_name(tsi->tsi_tgt), pa.lpa_blocks_cnt, tgt_ses_req(tsi));
+
+	if (pa.lpa_blocks_cnt > 0)
+		return 1;
+
+	return pa.lpa_locks_cnt > 0 ? 0 : -ESTALE;
 }
 
 /**
@@ -2632,8 +2687,6 @@ static int ofd_punch_hpreq_lock_match(struct ptlrpc_request *req,
 static int ofd_punch_hpreq_check(struct ptlrpc_request *req)
 {
 	struct tgt_session_info	*tsi;
-	struct obdo		*oa;
-	struct ldlm_prolong_args pa = { 0 };
 
 	ENTRY;
 
@@ -2641,29 +2694,9 @@ static int ofd_punch_hpreq_check(struct ptlrpc_request *req)
 	 * can be called while request has no processing thread yet. */
 	tsi = lu_context_key_get(&req->rq_session, &tgt_session_key);
 	LASSERT(tsi != NULL);
-	oa = &tsi->tsi_ost_body->oa;
 
-	LASSERT(!(oa->o_valid & OBD_MD_FLFLAGS &&
-		  oa->o_flags & OBD_FL_SRVLOCK));
-
-	pa.lpa_mode = LCK_PW | LCK_GROUP;
-	pa.lpa_extent.start = oa->o_size;
-	pa.lpa_extent.end   = oa->o_blocks;
-
-	CDEBUG(D_DLMTRACE,
-	       "%s: refresh locks: %llu/%llu (%llu->%llu)\n",
-	       tgt_name(tsi->tsi_tgt), tsi->tsi_resid.name[0],
-	       tsi->tsi_resid.name[1], pa.lpa_extent.start, pa.lpa_extent.end);
-
-	ofd_prolong_extent_locks(tsi, &pa);
-
-	CDEBUG(D_DLMTRACE, "%s: refreshed %u locks timeout for req %p.\n",
-	       tgt_name(tsi->tsi_tgt), pa.lpa_blocks_cnt, req);
-
-	if (pa.lpa_blocks_cnt > 0)
-		RETURN(1);
-
-	RETURN(pa.lpa_locks_cnt > 0 ? 0 : -ESTALE);
+	RETURN(ofd_punch_prolong(tsi, &tsi->tsi_ost_body->oa,
+				 &tsi->tsi_resid));
 }
 
 /**
@@ -2679,6 +2712,119 @@ static void ofd_punch_hpreq_fini(struct ptlrpc_request *req)
 	ofd_punch_hpreq_check(req);
 }
 
+/**
+ * Get the operations of an OST_COMPOUND request.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[out] count	number of operations
+ *
+ * \retval		array of operations, NULL if the request has none
+ */
+static struct ost_compound_op *ofd_compound_ops(struct tgt_session_info *tsi,
+						int *count)
+{
+	struct ost_compound_op *ops;
+
+	ops = req_capsule_client_get(tsi->tsi_pill, &RMF_OST_COMPOUND);
+	if (ops == NULL)
+		return NULL;
+
+	*count = req_capsule_get_size(tsi->tsi_pill, &RMF_OST_COMPOUND,
+				      RCL_CLIENT) / sizeof(*ops);
+	return ops;
+}
+
+/* A punch of a compound request which would be high priority on its own */
+static inline bool ofd_compound_op_hp(struct ost_compound_op *op)
+{
+	struct obdo *oa = &op->oco_body.oa;
+
+	return op->oco_opc == OST_PUNCH &&
+	       !(oa->o_valid & OBD_MD_FLFLAGS && oa->o_flags & OBD_FL_SRVLOCK);
+}
+
+/**
+ * Implementation of ptlrpc_hpreq_ops::hpreq_lock_match for OST_COMPOUND.
+ *
+ * The request matches \a lock if any of its punches does.
+ *
+ * \param[in] req	ptlrpc_request being processed
+ * \param[in] lock	contended lock to match
+ *
+ * \retval		1 if lock is matched
+ * \retval		0 otherwise
+ */
+static int ofd_compound_hpreq_lock_match(struct ptlrpc_request *req,
+					 struct ldlm_lock *lock)
+{
+	struct tgt_session_info	*tsi;
+	struct ost_compound_op	*ops;
+	int			 count;
+	int			 i;
+
+	ENTRY;
+
+	tsi = lu_context_key_get(&req->rq_session, &tgt_session_key);
+	ops = ofd_compound_ops(tsi, &count);
+	LASSERT(ops != NULL); /* checked by ofd_hp_compound() */
+
+	for (i = 0; i < count; i++) {
+		if (ofd_compound_op_hp(&ops[i]) &&
+		    ofd_punch_lock_match(&ops[i].oco_body.oa, lock))
+			RETURN(1);
+	}
+
+	RETURN(0);
+}
+
+/**
+ * Implementation of ptlrpc_hpreq_ops::hpreq_check for OST_COMPOUND.
+ *
+ * Prolongs the locks of every punch in the request. The request is high
+ * priority if any of them blocks a lock cancel. Unlike a plain punch, a
+ * punch whose lock is gone doesn't fail the request with -ESTALE, as that
+ * would fail the other operations batched with it.
+ *
+ * \param[in] req	the incoming request
+ *
+ * \retval		1 if \a req is blocking an LDLM lock cancel
+ * \retval		0 if it is not
+ */
+static int ofd_compound_hpreq_check(struct ptlrpc_request *req)
+{
+	struct tgt_session_info	*tsi;
+	struct ost_compound_op	*ops;
+	struct ldlm_res_id	 resid;
+	int			 count;
+	int			 blocking = 0;
+	int			 i;
+
+	ENTRY;
+
+	tsi = lu_context_key_get(&req->rq_session, &tgt_session_key);
+	LASSERT(tsi != NULL);
+	ops = ofd_compound_ops(tsi, &count);
+	LASSERT(ops != NULL);
+
+	for (i = 0; i < count; i++) {
+		struct obdo *oa = &ops[i].oco_body.oa;
+
+		if (!ofd_compound_op_hp(&ops[i]))
+			continue;
+
+		ost_fid_build_resid(&oa->o_oi.oi_fid, &resid);
+		if (ofd_punch_prolong(tsi, oa, &resid) > 0)
+			blocking = 1;
+	}
+
+	RETURN(blocking);
+}
+
+static void ofd_compound_hpreq_fini(struct ptlrpc_request *req)
+{
+	ofd_compound_hpreq_check(req);
+}
+
 static struct ptlrpc_hpreq_ops ofd_hpreq_rw = {
 	.hpreq_lock_match	= ofd_rw_hpreq_lock_match,
 	.hpreq_check		= ofd_rw_hpreq_check,
@@ -2691,6 +2837,12 @@ static struct ptlrpc_hpreq_ops ofd_hpreq_punch = {
 	.hpreq_fini		= ofd_punch_hpreq_fini
 };
 
+static struct ptlrpc_hpreq_ops ofd_hpreq_compound = {
+	.hpreq_lock_match	= ofd_compound_hpreq_lock_match,
+	.hpreq_check		= ofd_compound_hpreq_check,
+	.hpreq_fini		= ofd_compound_hpreq_fini
+};
+
 /**
  * Assign high priority operations to an IO request.
  *
@@ -2743,6 +2895,150 @@ static void ofd_hp_punch(struct tgt_session_info *tsi)
 	tgt_ses_req(tsi)->rq_ops = &ofd_hpreq_punch;
 }
 
+/**
+ * Assign high priority operations to an OST_COMPOUND request.
+ *
+ * A compound request carrying a punch is handled with high priority,
+ * just as that punch would be on its own, so that a batched truncate
+ * under a contended lock doesn't wait behind normal requests.
+ *
+ * \param[in] tsi	target session environment for this request
+ */
+static void ofd_hp_compound(struct tgt_session_info *tsi)
+{
+	struct ost_compound_op	*ops;
+	int			 count;
+	bool			 hp = false;
+	int			 i;
+
+	if (tgt_conn_flags(tsi) & OBD_CONNECT_MDS ||
+	    lustre_msg_get_flags(tgt_ses_req(tsi)->rq_reqmsg) & MSG_REPLAY)
+		return;
+
+	ops = ofd_compound_ops(tsi, &count);
+	if (ops == NULL || count > OST_COMPOUND_MAX_OPS)
+		return;
+
+	for (i = 0; i < count; i++) {
+		if (!ofd_compound_op_hp(&ops[i]))
+			continue;
+
+		/* Convert the object id to FID form now, as the plain punch
+		 * path does before its hp check. The handler validates the
+		 * obdo again, which then leaves it unchanged, so the lock
+		 * match never sees the id being rewritten. */
+		if (tgt_validate_obdo(tsi, &ops[i].oco_body.oa) != 0)
+			return;
+		hp = true;
+	}
+
+	if (hp)
+		tgt_ses_req(tsi)->rq_ops = &ofd_hpreq_compound;
+}
+
+/**
+ * Reset the OFD thread info between two requests.
+ *
+ * Called on lu_context_exit() and between the operations of an
+ * OST_COMPOUND request, which are handled in the same context.
+ *
+ * \param[in] info	ofd_thread_info
+ */
+static void ofd_info_reset(struct ofd_thread_info *info)
+{
+	info->fti_env = NULL;
+	info->fti_exp = NULL;
+
+	info->fti_xid = 0;
+	info->fti_pre_version = 0;
+	info->fti_used = 0;
+
+	memset(&info->fti_attr, 0, sizeof info->fti_attr);
+}
+
+/**
+ * OFD request handler for OST_COMPOUND RPC.
+ *
+ * Runs each operation of the request through its own OFD handler and
+ * stores the per-operation status and reply body in the reply. Only
+ * OST_SETATTR and OST_PUNCH can be batched this way, the client only
+ * sends them after both sides negotiated OBD_CONNECT2_COMPOUND.
+ *
+ * \param[in] tsi	target session environment for this request
+ *
+ * \retval		0 if successful
+ * \retval		negative value on error
+ */
+static int ofd_compound_hdl(struct tgt_session_info *tsi)
+{
+	struct req_capsule	*pill = tsi->tsi_pill;
+	struct ost_compound_op	*ops;
+	struct ost_compound_op	*reps;
+	struct ptlrpc_request	*req = tgt_ses_req(tsi);
+	__u64			 transno = 0;
+	int			 count;
+	int			 rc;
+	int			 i;
+
+	ENTRY;
+
+	ops = req_capsule_client_get(pill, &RMF_OST_COMPOUND);
+	if (ops == NULL)
+		RETURN(err_serious(-EPROTO));
+
+	count = req_capsule_get_size(pill, &RMF_OST_COMPOUND, RCL_CLIENT) /
+		sizeof(*ops);
+	if (count == 0 || count > OST_COMPOUND_MAX_OPS) {
+		CERROR("%s: bad OST_COMPOUND op count %d from %s\n",
+		       tgt_name(tsi->tsi_tgt), count,
+		       obd_export_nid2str(tsi->tsi_exp));
+		RETURN(err_serious(-EPROTO));
+	}
+
+	req_capsule_set_size(pill, &RMF_OST_COMPOUND, RCL_SERVER,
+			     count * sizeof(*reps));
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		RETURN(err_serious(rc));
+
+	reps = req_capsule_server_get(pill, &RMF_OST_COMPOUND);
+
+	for (i = 0; i < count; i++) {
+		rc = tgt_compound_op_unpack(tsi, &ops[i], &reps[i]);
+		if (rc == 0) {
+			switch (ops[i].oco_opc) {
+			case OST_SETATTR:
+				rc = ofd_setattr_hdl(tsi);
+				break;
+			case OST_PUNCH:
+				rc = ofd_punch_hdl(tsi);
+				break;
+			default:
+				rc = -EOPNOTSUPP;
+				break;
+			}
+		}
+		reps[i].oco_rc = ptlrpc_status_hton(clear_serious(rc));
+
+		/* each operation took a transno of its own, or none if it
+		 * failed; reply with the last one so that the client knows
+		 * the whole batch is on disk once it is committed */
+		if (req->rq_transno > transno)
+			transno = req->rq_transno;
+
+		ofd_info_reset(ofd_info(tsi->tsi_env));
+		tsi->tsi_ost_repbody = NULL;
+		tsi->tsi_ost_body = NULL;
+	}
+
+	if (transno != 0) {
+		req->rq_transno = transno;
+		lustre_msg_set_transno(req->rq_repmsg, transno);
+	}
+
+	RETURN(0);
+}
+
 #define OBD_FAIL_OST_READ_NET	OBD_FAIL_OST_BRW_NET
 #define OBD_FAIL_OST_WRITE_NET	OBD_FAIL_OST_BRW_NET
 #define OST_BRW_READ	OST_READ
@@ -2787,6 +3083,8 @@ TGT_OST_HDL_HP(HABEO_CORPUS| HABEO_REFERO | MUTABOR,
 TGT_OST_HDL(HABEO_CORPUS| HABEO_REFERO,	OST_SYNC,	ofd_sync_hdl),
 TGT_OST_HDL(0		| HABEO_REFERO,	OST_QUOTACTL,	ofd_quotactl),
 TGT_OST_HDL(HABEO_CORPUS | HABEO_REFERO, OST_LADVISE,	ofd_ladvise_hdl),
+TGT_OST_HDL_HP(0	| MUTABOR,	OST_COMPOUND,	ofd_compound_hdl,
+							ofd_hp_compound),
 };
 
 static struct tgt_opc_slice ofd_common_slice[] = {
@@ -2848,16 +3146,7 @@ LU_KEY_INIT_FINI(ofd, struct ofd_thread_info);
 static void ofd_key_exit(const struct lu_context *ctx,
 			 struct lu_context_key *key, void *data)
 {
-	struct ofd_thread_info *info = data;
-
-	info->fti_env = NULL;
-	info->fti_exp = NULL;
-
-	info->fti_xid = 0;
-	info->fti_pre_version = 0;
-	info->fti_used = 0;
-
-	memset(&info->fti_attr, 0, sizeof info->fti_attr);
+	ofd_info_reset(data);
 }
 
 struct lu_context_key ofd_thread_key = {
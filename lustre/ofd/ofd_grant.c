@@ -77,6 +77,9 @@
 /* Clients typically hold 2x their max_rpcs_in_flight of grant space */
 #define OFD_GRANT_SHRINK_LIMIT(exp)	(2ULL * 8 * exp_max_brw_size(exp))
 
+/* Grant chunks handed out at most for one explicit grant request */
+#define OFD_GRANT_REQUEST_CHUNKS	4
+
 /* Helpers to inflate/deflate grants for clients that do not support the grant
  * parameters */
 static inline u64 ofd_grant_inflate(struct ofd_device *ofd, u64 val)
@@ -1044,6 +1047,54 @@ void ofd_grant_prepare_read(const struct lu_env *env,
 	EXIT;
 }
 
+/**
+ * Handle an explicit grant request from a client.
+ *
+ * Clients predicting from their recent dirty rate that writers are about to
+ * run out of grant ask for more space ahead of time through a KEY_GRANT_SHRINK
+ * set_info RPC flagged with OBD_FL_GRANT_REQUEST, instead of waiting for a BRW
+ * reply to replenish it. Space is allocated as for a write that consumes no
+ * grant, except that up to OFD_GRANT_REQUEST_CHUNKS grant chunks can be handed
+ * out at once since the client told how much it expects to dirty.
+ *
+ * \param[in] env	LU environment provided by the caller
+ * \param[in] exp	export of the client which sent the request
+ * \param[in,out] oa	incoming obdo sent by the client
+ */
+void ofd_grant_prepare_request(const struct lu_env *env,
+			       struct obd_export *exp, struct obdo *oa)
+{
+	struct ofd_device	*ofd = ofd_exp(exp);
+	long			 chunk = ofd_grant_chunk(exp, ofd, NULL);
+	u64			 left;
+	ENTRY;
+
+	if ((oa->o_valid & OBD_MD_FLGRANT) == 0)
+		RETURN_EXIT;
+
+	/* get statfs information from OSD layer, cached data is fine */
+	ofd_grant_statfs(env, exp, 0, NULL);
+
+	spin_lock(&ofd->ofd_grant_lock); /* protect all grant counters */
+
+	left = ofd_grant_space_left(exp);
+
+	/* extract incoming grant information provided by the client,
+	 * and inflate grant counters if required */
+	ofd_grant_incoming(env, exp, oa, chunk);
+
+	if (oa->o_valid & OBD_MD_FLGRANT)
+		oa->o_grant = ofd_grant_alloc(exp, oa->o_grant, oa->o_undirty,
+					      left,
+					      chunk * OFD_GRANT_REQUEST_CHUNKS,
+					      true);
+
+	if (!ofd_grant_param_supp(exp))
+		oa->o_grant = ofd_grant_deflate(ofd, oa->o_grant);
+	spin_unlock(&ofd->ofd_grant_lock);
+	EXIT;
+}
+
 /**
  * Process grant information from incoming bulk write request.
  *
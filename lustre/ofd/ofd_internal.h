@@ -459,6 +459,8 @@ void ofd_grant_prepare_read(const struct lu_env *env, struct obd_export *exp,
 void ofd_grant_prepare_write(const struct lu_env *env, struct obd_export *exp,
 			     struct obdo *oa, struct niobuf_remote *rnb,
 			     int niocount);
+void ofd_grant_prepare_request(const struct lu_env *env,
+			       struct obd_export *exp, struct obdo *oa);
 void ofd_grant_commit(struct obd_export *exp, unsigned long grant_used, int rc);
 int ofd_grant_commit_cb_add(struct thandle *th, struct obd_export *exp,
 			    unsigned long grant);
@@ -204,9 +204,8 @@ static int osc_cached_mb_seq_show(struct seq_file *m, void *v)
 	seq_printf(m, "used_mb: %ld\n"
 		   "busy_cnt: %ld\n"
 		   "reclaim: %llu\n",
-		   (atomic_long_read(&cli->cl_lru_in_list) +
-		    atomic_long_read(&cli->cl_lru_busy)) >> shift,
-		    atomic_long_read(&cli->cl_lru_busy),
+		   (osc_lru_in_list(cli) + osc_lru_busy(cli)) >> shift,
+		   osc_lru_busy(cli),
 		   cli->cl_lru_reclaim);
 
 	return 0;
@@ -241,7 +240,7 @@ osc_cached_mb_seq_write(struct file *file, const char __user *buffer,
 	if (pages_number < 0)
 		return -ERANGE;
 
-	rc = atomic_long_read(&cli->cl_lru_in_list) - pages_number;
+	rc = osc_lru_in_list(cli) - pages_number;
 	if (rc > 0) {
 		struct lu_env *env;
 		__u16 refcheck;
@@ -257,6 +256,49 @@ osc_cached_mb_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(osc_cached_mb);
 
+static int osc_lru_partitions_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+	struct cl_lru_part *part;
+	int i;
+
+	seq_printf(m, "%-4s %12s %12s %16s %16s\n",
+		   "cpt", "in_list", "busy", "added", "shrunk");
+	cfs_percpt_for_each(part, i, cli->cl_lru_parts) {
+		seq_printf(m, "%-4d %12ld %12ld %16llu %16llu\n", i,
+			   atomic_long_read(&part->clp_in_list),
+			   atomic_long_read(&part->clp_busy),
+			   part->clp_added, part->clp_shrunk);
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(osc_lru_partitions);
+
+static int osc_grant_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *dev = m->private;
+	struct client_obd *cli = &dev->u.cli;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	seq_printf(m, "dirty_rate:        %lu\n"
+		   "predicted:         %lu\n"
+		   "requests:          %llu\n"
+		   "requested_bytes:   %llu\n"
+		   "stalls:            %llu\n"
+		   "stall_us:          %llu\n"
+		   "stall_max_us:      %llu\n",
+		   cli->cl_grant_dirty_rate, osc_grant_predict(cli),
+		   cli->cl_grant_requests, cli->cl_grant_requested_bytes,
+		   cli->cl_grant_stalls, cli->cl_grant_stall_us,
+		   cli->cl_grant_stall_max_us);
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(osc_grant_stats);
+
 static int osc_cur_dirty_bytes_seq_show(struct seq_file *m, void *v)
 {
 	struct obd_device *dev = m->private;
@@ -371,6 +413,8 @@ static ssize_t osc_grant_shrink_interval_seq_write(struct file *file,
 		return -ERANGE;
 
 	obd->u.cli.cl_grant_shrink_interval = val;
+	/* don't wait out the previous interval */
+	osc_update_next_shrink(&obd->u.cli);
 
 	return count;
 }
@@ -753,6 +797,10 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_max_dirty_mb_fops		},
 	{ .name	=	"osc_cached_mb",
 	  .fops	=	&osc_cached_mb_fops		},
+	{ .name	=	"lru_partitions",
+	  .fops	=	&osc_lru_partitions_fops	},
+	{ .name	=	"grant_stats",
+	  .fops	=	&osc_grant_stats_fops	},
 	{ .name	=	"cur_dirty_bytes",
 	  .fops	=	&osc_cur_dirty_bytes_fops	},
 	{ .name	=	"cur_grant_bytes",
@@ -923,6 +971,8 @@ static int osc_stats_seq_show(struct seq_file *seq, void *v)
 		   stats->os_lockless_reads);
 	seq_printf(seq, "lockless_truncate\t\t%llu\n",
 		   stats->os_lockless_truncates);
+	seq_printf(seq, "lean_dio_bytes\t\t\t%llu\n",
+		   stats->os_lean_dio);
 	return 0;
 }
 
@@ -1369,8 +1369,8 @@ static int osc_completion(const struct lu_env *env, struct osc_async_page *oap,
 	       __tmp->cl_lost_grant, __tmp->cl_avail_grant,		\
 	       __tmp->cl_dirty_grant,					\
 	       __tmp->cl_reserved_grant, __tmp->cl_w_in_flight,		\
-	       atomic_long_read(&__tmp->cl_lru_in_list),		\
-	       atomic_long_read(&__tmp->cl_lru_busy),			\
+	       osc_lru_in_list(__tmp),					\
+	       osc_lru_busy(__tmp),					\
 	       atomic_read(&__tmp->cl_lru_shrinkers), ##args);		\
 } while (0)
 
@@ -1386,6 +1386,7 @@ static void osc_consume_write_grant(struct client_obd *cli,
 	CDEBUG(D_CACHE, "using %lu grant credits for brw %p page %p\n",
 	       PAGE_SIZE, pga, pga->pg);
 	osc_update_next_shrink(cli);
+	osc_grant_consumed(cli, PAGE_SIZE);
 }
 
 /* the companion to osc_consume_write_grant, called when a brw has completed.
@@ -1563,6 +1564,9 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	struct lov_oinfo	*loi = osc->oo_oinfo;
 	struct osc_cache_waiter	 ocw;
 	struct l_wait_info	 lwi;
+	ktime_t			 start;
+	__u64			 stall_us;
+	bool			 waited = false;
 	int			 rc = -EDQUOT;
 	ENTRY;
 
@@ -1597,10 +1601,12 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	init_waitqueue_head(&ocw.ocw_waitq);
 	ocw.ocw_oap   = oap;
 	ocw.ocw_grant = bytes;
+	start = ktime_get();
 	while (cli->cl_dirty_pages > 0 || cli->cl_w_in_flight > 0) {
 		list_add_tail(&ocw.ocw_entry, &cli->cl_cache_waiters);
 		ocw.ocw_rc = 0;
 		spin_unlock(&cli->cl_loi_list_lock);
+		waited = true;
 
 		osc_io_unplug_async(env, cli, NULL);
 
@@ -1627,6 +1633,16 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 		}
 	}
 
+	/* writers stalled on grant or dirty cache, which the grant
+	 * prediction in osc_grant_consumed() is meant to avoid */
+	if (waited) {
+		stall_us = ktime_us_delta(ktime_get(), start);
+		cli->cl_grant_stalls++;
+		cli->cl_grant_stall_us += stall_us;
+		if (stall_us > cli->cl_grant_stall_max_us)
+			cli->cl_grant_stall_max_us = stall_us;
+	}
+
 	switch (rc) {
 	case 0:
 		OSC_DUMP_GRANT(D_CACHE, cli, "finally got grant space\n");
@@ -1656,6 +1672,7 @@ static int osc_enter_cache(const struct lu_env *env, struct client_obd *cli,
 	EXIT;
 out:
 	spin_unlock(&cli->cl_loi_list_lock);
+	osc_grant_request_queue(cli);
 	RETURN(rc);
 }
 
@@ -2450,6 +2467,7 @@ int osc_queue_async_io(const struct lu_env *env, struct cl_io *io,
 		spin_lock(&cli->cl_loi_list_lock);
 		rc = osc_enter_cache_try(cli, oap, grants, 0);
 		spin_unlock(&cli->cl_loi_list_lock);
+		osc_grant_request_queue(cli);
 		if (rc == 0) { /* try failed */
 			grants = 0;
 			need_release = 1;
@@ -357,6 +357,10 @@ struct osc_page {
 	 * lru page list. See osc_lru_{del|use}() in osc_page.c for usage.
 	 */
 	struct list_head	ops_lru;
+	/**
+	 * LRU partition (CPT) the page is accounted in, see struct cl_lru_part.
+	 */
+	int			ops_lru_cpt;
 	/**
 	 * Submit time - the time when the page is starting RPC. For debugging.
 	 */
@@ -93,6 +93,9 @@ struct osc_cache_waiter {
 void osc_wake_cache_waiters(struct client_obd *cli);
 int osc_shrink_grant_to_target(struct client_obd *cli, __u64 target_bytes);
 void osc_update_next_shrink(struct client_obd *cli);
+unsigned long osc_grant_predict(struct client_obd *cli);
+void osc_grant_consumed(struct client_obd *cli, unsigned long bytes);
+void osc_grant_request_queue(struct client_obd *cli);
 
 /*
  * cl integration.
@@ -132,10 +135,38 @@ int osc_ladvise_base(struct obd_export *exp, struct obdo *oa,
 int osc_process_config_base(struct obd_device *obd, struct lustre_cfg *cfg);
 int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  struct list_head *ext_list, int cmd);
+int osc_dio_submit(const struct lu_env *env, struct osc_object *osc,
+		   int cmd, int brw_flags, struct cl_dio_pages *cdp);
 long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		   long target, bool force);
 unsigned long osc_lru_reserve(struct client_obd *cli, unsigned long npages);
 void osc_lru_unreserve(struct client_obd *cli, unsigned long npages);
+int osc_lru_parts_init(struct client_obd *cli);
+void osc_lru_parts_fini(struct client_obd *cli);
+
+/* # of LRU pages in the cache of \a cli, summed over all partitions */
+static inline long osc_lru_in_list(struct client_obd *cli)
+{
+	struct cl_lru_part *part;
+	long count = 0;
+	int i;
+
+	cfs_percpt_for_each(part, i, cli->cl_lru_parts)
+		count += atomic_long_read(&part->clp_in_list);
+	return count;
+}
+
+/* # of busy LRU pages of \a cli, summed over all partitions */
+static inline long osc_lru_busy(struct client_obd *cli)
+{
+	struct cl_lru_part *part;
+	long count = 0;
+	int i;
+
+	cfs_percpt_for_each(part, i, cli->cl_lru_parts)
+		count += atomic_long_read(&part->clp_busy);
+	return count;
+}
 
 extern struct lu_kmem_descr osc_caches[];
 
@@ -183,6 +214,7 @@ struct osc_device {
                 uint64_t     os_lockless_writes;          /* by bytes */
                 uint64_t     os_lockless_reads;           /* by bytes */
                 uint64_t     os_lockless_truncates;       /* by times */
+		uint64_t     os_lean_dio;		  /* by bytes */
         } od_stats;
 
         /* configuration item(s) */
@@ -225,6 +225,43 @@ static int osc_io_submit(const struct lu_env *env,
 	return qout->pl_nr > 0 ? 0 : result;
 }
 
+/**
+ * An implementation of cl_io_operations::cio_dio_submit() method for osc
+ * layer. Sends the user pages to the OST without cl_page setup.
+ */
+static int osc_io_dio_submit(const struct lu_env *env,
+			     const struct cl_io_slice *ios,
+			     enum cl_req_type crt, struct cl_dio_pages *cdp)
+{
+	struct cl_object *obj = ios->cis_obj;
+	int cmd;
+	int brw_flags;
+	int result;
+
+	cmd = crt == CRT_WRITE ? OBD_BRW_WRITE : OBD_BRW_READ;
+	brw_flags = OBD_BRW_SYNC;
+	if (osc_io_srvlock(cl2osc_io(env, ios)))
+		brw_flags |= OBD_BRW_SRVLOCK;
+	if (cfs_capable(CFS_CAP_SYS_RESOURCE)) {
+		brw_flags |= OBD_BRW_NOQUOTA;
+		cmd |= OBD_BRW_NOQUOTA;
+	}
+
+	result = osc_dio_submit(env, cl2osc(obj), cmd, brw_flags, cdp);
+
+	/* Update c/mtime for sync write. LU-7310 */
+	if (crt == CRT_WRITE && result == 0) {
+		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+
+		cl_object_attr_lock(obj);
+		attr->cat_mtime = attr->cat_ctime = LTIME_S(CURRENT_TIME);
+		cl_object_attr_update(env, obj, attr, CAT_MTIME | CAT_CTIME);
+		cl_object_attr_unlock(obj);
+	}
+
+	return result;
+}
+
 /**
  * This is called when a page is accessed within file in a way that creates
  * new page, if one were missing (i.e., if there were a hole at that place in
@@ -976,7 +1013,8 @@ static const struct cl_io_operations osc_io_ops = {
 	},
 	.cio_read_ahead		    = osc_io_read_ahead,
 	.cio_submit                 = osc_io_submit,
-	.cio_commit_async           = osc_io_commit_async
+	.cio_commit_async           = osc_io_commit_async,
+	.cio_dio_submit		    = osc_io_dio_submit
 };
 
 /*****************************************************************************
@@ -362,7 +362,7 @@ static inline int lru_shrink_max(struct client_obd *cli)
 static int osc_cache_too_much(struct client_obd *cli)
 {
 	struct cl_client_cache *cache = cli->cl_cache;
-	long pages = atomic_long_read(&cli->cl_lru_in_list);
+	long pages = osc_lru_in_list(cli);
 	unsigned long budget;
 
 	LASSERT(cache != NULL);
@@ -407,41 +407,105 @@ int lru_queue_work(const struct lu_env *env, void *data)
 	RETURN(0);
 }
 
+int osc_lru_parts_init(struct client_obd *cli)
+{
+	struct cl_lru_part *part;
+	int i;
+
+	cli->cl_lru_parts = cfs_percpt_alloc(cfs_cpt_table, sizeof(*part));
+	if (cli->cl_lru_parts == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(part, i, cli->cl_lru_parts) {
+		spin_lock_init(&part->clp_lock);
+		INIT_LIST_HEAD(&part->clp_list);
+		atomic_long_set(&part->clp_in_list, 0);
+		atomic_long_set(&part->clp_busy, 0);
+	}
+	return 0;
+}
+
+void osc_lru_parts_fini(struct client_obd *cli)
+{
+	struct cl_lru_part *part;
+	int i;
+
+	if (cli->cl_lru_parts == NULL)
+		return;
+
+	cfs_percpt_for_each(part, i, cli->cl_lru_parts) {
+		LASSERT(list_empty(&part->clp_list));
+		LASSERT(atomic_long_read(&part->clp_busy) == 0);
+	}
+	cfs_percpt_free(cli->cl_lru_parts);
+	cli->cl_lru_parts = NULL;
+}
+
+static inline struct cl_lru_part *osc_lru_part(struct client_obd *cli,
+					       struct osc_page *opg)
+{
+	return cli->cl_lru_parts[opg->ops_lru_cpt];
+}
+
+/* Move \a npages busy pages of partition \a cpt in \a lru to its LRU list */
+static void osc_lru_splice(struct client_obd *cli, int cpt,
+			   struct list_head *lru, long npages)
+{
+	struct cl_lru_part *part = cli->cl_lru_parts[cpt];
+
+	spin_lock(&part->clp_lock);
+	list_splice_tail_init(lru, &part->clp_list);
+	atomic_long_sub(npages, &part->clp_busy);
+	atomic_long_add(npages, &part->clp_in_list);
+	part->clp_added += npages;
+	spin_unlock(&part->clp_lock);
+}
+
 void osc_lru_add_batch(struct client_obd *cli, struct list_head *plist)
 {
 	struct list_head lru = LIST_HEAD_INIT(lru);
 	struct osc_async_page *oap;
 	long npages = 0;
+	long added = 0;
+	int cpt = -1;
 
+	/* pages of one extent are normally cached by one thread, so this
+	 * usually takes a single partition lock */
 	list_for_each_entry(oap, plist, oap_pending_item) {
 		struct osc_page *opg = oap2osc_page(oap);
 
 		if (!opg->ops_in_lru)
 			continue;
 
+		if (opg->ops_lru_cpt != cpt && npages > 0) {
+			osc_lru_splice(cli, cpt, &lru, npages);
+			added += npages;
+			npages = 0;
+		}
+		cpt = opg->ops_lru_cpt;
+
 		++npages;
 		LASSERT(list_empty(&opg->ops_lru));
 		list_add(&opg->ops_lru, &lru);
 	}
 
 	if (npages > 0) {
-		spin_lock(&cli->cl_lru_list_lock);
-		list_splice_tail(&lru, &cli->cl_lru_list);
-		atomic_long_sub(npages, &cli->cl_lru_busy);
-		atomic_long_add(npages, &cli->cl_lru_in_list);
-		cli->cl_lru_last_used = cfs_time_current_sec();
-		spin_unlock(&cli->cl_lru_list_lock);
+		osc_lru_splice(cli, cpt, &lru, npages);
+		added += npages;
+	}
 
+	if (added > 0) {
+		cli->cl_lru_last_used = cfs_time_current_sec();
 		if (waitqueue_active(&osc_lru_waitq))
 			(void)ptlrpcd_queue_work(cli->cl_lru_work);
 	}
 }
 
-static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
+static void __osc_lru_del(struct cl_lru_part *part, struct osc_page *opg)
 {
-	LASSERT(atomic_long_read(&cli->cl_lru_in_list) > 0);
+	LASSERT(atomic_long_read(&part->clp_in_list) > 0);
 	list_del_init(&opg->ops_lru);
-	atomic_long_dec(&cli->cl_lru_in_list);
+	atomic_long_dec(&part->clp_in_list);
 }
 
 /**
@@ -451,14 +515,16 @@ static void __osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 static void osc_lru_del(struct client_obd *cli, struct osc_page *opg)
 {
 	if (opg->ops_in_lru) {
-		spin_lock(&cli->cl_lru_list_lock);
+		struct cl_lru_part *part = osc_lru_part(cli, opg);
+
+		spin_lock(&part->clp_lock);
 		if (!list_empty(&opg->ops_lru)) {
-			__osc_lru_del(cli, opg);
+			__osc_lru_del(part, opg);
 		} else {
-			LASSERT(atomic_long_read(&cli->cl_lru_busy) > 0);
-			atomic_long_dec(&cli->cl_lru_busy);
+			LASSERT(atomic_long_read(&part->clp_busy) > 0);
+			atomic_long_dec(&part->clp_busy);
 		}
-		spin_unlock(&cli->cl_lru_list_lock);
+		spin_unlock(&part->clp_lock);
 
 		atomic_long_inc(cli->cl_lru_left);
 		/* this is a great place to release more LRU pages if
@@ -482,10 +548,12 @@ static void osc_lru_use(struct client_obd *cli, struct osc_page *opg)
 	/* If page is being transferred for the first time,
 	 * ops_lru should be empty */
 	if (opg->ops_in_lru && !list_empty(&opg->ops_lru)) {
-		spin_lock(&cli->cl_lru_list_lock);
-		__osc_lru_del(cli, opg);
-		spin_unlock(&cli->cl_lru_list_lock);
-		atomic_long_inc(&cli->cl_lru_busy);
+		struct cl_lru_part *part = osc_lru_part(cli, opg);
+
+		spin_lock(&part->clp_lock);
+		__osc_lru_del(part, opg);
+		spin_unlock(&part->clp_lock);
+		atomic_long_inc(&part->clp_busy);
 	}
 }
 
@@ -530,47 +598,30 @@ static inline bool lru_page_busy(struct client_obd *cli, struct cl_page *page)
 }
 
 /**
- * Drop @target of pages from LRU at most.
+ * Drop @target of pages from LRU partition @part at most. Pages are discarded
+ * in batches under a cl_io of their object; the object, its io and the pages
+ * not discarded yet are passed in @clobjp/@indexp and carried over to the next
+ * partition by osc_lru_shrink(). An error initializing the io is returned in
+ * @rcp.
  */
-long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
-		   long target, bool force)
+static long osc_lru_shrink_part(const struct lu_env *env,
+				struct client_obd *cli,
+				struct cl_lru_part *part, long target,
+				bool force, struct cl_object **clobjp,
+				int *indexp, int *rcp)
 {
-	struct cl_io *io;
-	struct cl_object *clobj = NULL;
-	struct cl_page **pvec;
+	struct cl_io *io = &osc_env_info(env)->oti_io;
+	struct cl_page **pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
+	struct cl_object *clobj = *clobjp;
 	struct osc_page *opg;
 	long count = 0;
-	int maxscan = 0;
-	int index = 0;
+	long maxscan;
+	int index = *indexp;
 	int rc = 0;
-	ENTRY;
-
-	LASSERT(atomic_long_read(&cli->cl_lru_in_list) >= 0);
-	if (atomic_long_read(&cli->cl_lru_in_list) == 0 || target <= 0)
-		RETURN(0);
-
-	CDEBUG(D_CACHE, "%s: shrinkers: %d, force: %d\n",
-	       cli_name(cli), atomic_read(&cli->cl_lru_shrinkers), force);
-	if (!force) {
-		if (atomic_read(&cli->cl_lru_shrinkers) > 0)
-			RETURN(-EBUSY);
-
-		if (atomic_inc_return(&cli->cl_lru_shrinkers) > 1) {
-			atomic_dec(&cli->cl_lru_shrinkers);
-			RETURN(-EBUSY);
-		}
-	} else {
-		atomic_inc(&cli->cl_lru_shrinkers);
-	}
 
-	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
-	io = &osc_env_info(env)->oti_io;
-
-	spin_lock(&cli->cl_lru_list_lock);
-	if (force)
-		cli->cl_lru_reclaim++;
-	maxscan = min(target << 1, atomic_long_read(&cli->cl_lru_in_list));
-	while (!list_empty(&cli->cl_lru_list)) {
+	spin_lock(&part->clp_lock);
+	maxscan = min(target << 1, atomic_long_read(&part->clp_in_list));
+	while (!list_empty(&part->clp_list)) {
 		struct cl_page *page;
 		bool will_free = false;
 
@@ -580,11 +631,11 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		if (--maxscan < 0)
 			break;
 
-		opg = list_entry(cli->cl_lru_list.next, struct osc_page,
+		opg = list_entry(part->clp_list.next, struct osc_page,
 				 ops_lru);
 		page = opg->ops_cl.cpl_page;
 		if (lru_page_busy(cli, page)) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			list_move_tail(&opg->ops_lru, &part->clp_list);
 			continue;
 		}
 
@@ -593,7 +644,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			struct cl_object *tmp = page->cp_obj;
 
 			cl_object_get(tmp);
-			spin_unlock(&cli->cl_lru_list_lock);
+			spin_unlock(&part->clp_lock);
 
 			if (clobj != NULL) {
 				discard_pagevec(env, io, pvec, index);
@@ -609,7 +660,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			io->ci_ignore_layout = 1;
 			rc = cl_io_init(env, io, CIT_MISC, clobj);
 
-			spin_lock(&cli->cl_lru_list_lock);
+			spin_lock(&part->clp_lock);
 
 			if (rc != 0)
 				break;
@@ -622,7 +673,7 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 			if (!lru_page_busy(cli, page)) {
 				/* remove it from lru list earlier to avoid
 				 * lock contention */
-				__osc_lru_del(cli, opg);
+				__osc_lru_del(part, opg);
 				opg->ops_in_lru = 0; /* will be discarded */
 
 				cl_page_get(page);
@@ -633,24 +684,109 @@ long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
 		}
 
 		if (!will_free) {
-			list_move_tail(&opg->ops_lru, &cli->cl_lru_list);
+			list_move_tail(&opg->ops_lru, &part->clp_list);
 			continue;
 		}
 
-		/* Don't discard and free the page with cl_lru_list held */
+		/* Don't discard and free the page with clp_lock held */
 		pvec[index++] = page;
 		if (unlikely(index == OTI_PVEC_SIZE)) {
-			spin_unlock(&cli->cl_lru_list_lock);
+			spin_unlock(&part->clp_lock);
 			discard_pagevec(env, io, pvec, index);
 			index = 0;
 
-			spin_lock(&cli->cl_lru_list_lock);
+			spin_lock(&part->clp_lock);
 		}
 
 		if (++count >= target)
 			break;
 	}
-	spin_unlock(&cli->cl_lru_list_lock);
+	part->clp_shrunk += count;
+	spin_unlock(&part->clp_lock);
+
+	*clobjp = clobj;
+	*indexp = index;
+	*rcp = rc;
+	return count;
+}
+
+/**
+ * Drop @target of pages from LRU at most.
+ *
+ * The work is balanced over the LRU partitions: in the first pass each one
+ * gives up a share of @target proportional to the number of pages it holds,
+ * the second pass takes what is still missing from any partition. The
+ * partition to start from rotates so that rounding doesn't always hit the
+ * same one.
+ */
+long osc_lru_shrink(const struct lu_env *env, struct client_obd *cli,
+		   long target, bool force)
+{
+	struct cl_io *io;
+	struct cl_object *clobj = NULL;
+	struct cl_page **pvec;
+	long total;
+	long count = 0;
+	int ncpt;
+	int start;
+	int index = 0;
+	int pass;
+	int rc = 0;
+	int i;
+	ENTRY;
+
+	total = osc_lru_in_list(cli);
+	LASSERT(total >= 0);
+	if (total == 0 || target <= 0)
+		RETURN(0);
+
+	CDEBUG(D_CACHE, "%s: shrinkers: %d, force: %d\n",
+	       cli_name(cli), atomic_read(&cli->cl_lru_shrinkers), force);
+	if (!force) {
+		if (atomic_read(&cli->cl_lru_shrinkers) > 0)
+			RETURN(-EBUSY);
+
+		if (atomic_inc_return(&cli->cl_lru_shrinkers) > 1) {
+			atomic_dec(&cli->cl_lru_shrinkers);
+			RETURN(-EBUSY);
+		}
+	} else {
+		atomic_inc(&cli->cl_lru_shrinkers);
+	}
+
+	pvec = (struct cl_page **)osc_env_info(env)->oti_pvec;
+	io = &osc_env_info(env)->oti_io;
+
+	/* NB: racy, but it's only statistics */
+	if (force)
+		cli->cl_lru_reclaim++;
+
+	ncpt = cfs_percpt_number(cli->cl_lru_parts);
+	start = cli->cl_lru_shrink_cpt++ % ncpt;
+	for (pass = 0; pass < 2 && count < target && rc == 0; pass++) {
+		for (i = 0; i < ncpt && count < target && rc == 0; i++) {
+			struct cl_lru_part *part;
+			long nr;
+			long share;
+
+			if (!force && atomic_read(&cli->cl_lru_shrinkers) > 1)
+				break;
+
+			part = cli->cl_lru_parts[(start + i) % ncpt];
+			nr = atomic_long_read(&part->clp_in_list);
+			if (nr == 0)
+				continue;
+
+			share = target - count;
+			if (pass == 0)
+				share = min(share, DIV_ROUND_UP(target * nr,
+								total));
+
+			count += osc_lru_shrink_part(env, cli, part, share,
+						     force, &clobj, &index,
+						     &rc);
+		}
+	}
 
 	if (clobj != NULL) {
 		discard_pagevec(env, io, pvec, index);
@@ -703,8 +839,8 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 	}
 
 	CDEBUG(D_CACHE, "%s: cli %p no free slots, pages: %ld/%ld, want: %ld\n",
-		cli_name(cli), cli, atomic_long_read(&cli->cl_lru_in_list),
-		atomic_long_read(&cli->cl_lru_busy), npages);
+		cli_name(cli), cli, osc_lru_in_list(cli),
+		osc_lru_busy(cli), npages);
 
 	/* Reclaim LRU slots from other client_obd as it can't free enough
 	 * from its own. This should rarely happen. */
@@ -720,9 +856,8 @@ static long osc_lru_reclaim(struct client_obd *cli, unsigned long npages)
 				 cl_lru_osc);
 
 		CDEBUG(D_CACHE, "%s: cli %p LRU pages: %ld, busy: %ld.\n",
-			cli_name(cli), cli,
-			atomic_long_read(&cli->cl_lru_in_list),
-			atomic_long_read(&cli->cl_lru_busy));
+			cli_name(cli), cli, osc_lru_in_list(cli),
+			osc_lru_busy(cli));
 
 		list_move_tail(&cli->cl_lru_osc, &cache->ccc_lru);
 		if (osc_cache_too_much(cli) > 0) {
@@ -787,7 +922,8 @@ static int osc_lru_alloc(const struct lu_env *env, struct client_obd *cli,
 
 out:
 	if (rc >= 0) {
-		atomic_long_inc(&cli->cl_lru_busy);
+		opg->ops_lru_cpt = cfs_cpt_current(cfs_cpt_table, 1);
+		atomic_long_inc(&osc_lru_part(cli, opg)->clp_busy);
 		opg->ops_in_lru = 1;
 		rc = 0;
 	}
@@ -1007,7 +1143,7 @@ unsigned long osc_cache_shrink_count(struct shrinker *sk,
 
 	spin_lock(&osc_shrink_lock);
 	list_for_each_entry(cli, &osc_shrink_list, cl_shrink_list)
-		cached += atomic_long_read(&cli->cl_lru_in_list);
+		cached += osc_lru_in_list(cli);
 	spin_unlock(&osc_shrink_lock);
 
 	return (cached  * sysctl_vfs_cache_pressure) / 100;
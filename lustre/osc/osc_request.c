@@ -70,6 +70,18 @@ struct osc_brw_async_args {
 	struct client_obd	 *aa_cli;
 	struct list_head	  aa_oaps;
 	struct list_head	  aa_exts;
+	struct osc_dio_rpc	 *aa_dio;
+};
+
+/* Direct IO RPC built straight from user pages by osc_dio_submit(). */
+struct osc_dio_rpc {
+	struct osc_object	*odr_obj;
+	struct cl_sync_io	*odr_anchor;
+	/* object offset right after the last byte of the transfer */
+	loff_t			 odr_end;
+	unsigned int		 odr_srvlock:1;
+	u32			 odr_page_count;
+	struct brw_page		 odr_pga[0];
 };
 
 #define osc_grant_args osc_brw_async_args
@@ -80,6 +92,19 @@ struct osc_setattr_args {
 	void			*sa_cookie;
 };
 
+/* setattr or punch waiting in cl_compound_list for an OST_COMPOUND RPC */
+struct osc_compound_op {
+	struct list_head	 ocp_list;
+	struct obdo		*ocp_oa;
+	__u32			 ocp_opc;
+	obd_enqueue_update_f	 ocp_upcall;
+	void			*ocp_cookie;
+};
+
+struct osc_compound_args {
+	struct list_head	 ca_ops;
+};
+
 struct osc_fsync_args {
 	struct osc_object	*fa_obj;
 	struct obdo		*fa_oa;
@@ -106,6 +131,9 @@ struct osc_enqueue_args {
 };
 
 static void osc_release_ppga(struct brw_page **ppga, size_t count);
+static int osc_compound_queue(struct obd_export *exp, struct obdo *oa,
+			      __u32 opc, obd_enqueue_update_f upcall,
+			      void *cookie);
 static int brw_interpret(const struct lu_env *env, struct ptlrpc_request *req,
 			 void *data, int rc);
 
@@ -224,9 +252,9 @@ out:
         RETURN(rc);
 }
 
-int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
-		      obd_enqueue_update_f upcall, void *cookie,
-		      struct ptlrpc_request_set *rqset)
+static int osc_setattr_send(struct obd_import *imp, struct obdo *oa,
+			    obd_enqueue_update_f upcall, void *cookie,
+			    struct ptlrpc_request_set *rqset)
 {
 	struct ptlrpc_request	*req;
 	struct osc_setattr_args	*sa;
@@ -234,7 +262,7 @@ int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
 
 	ENTRY;
 
-	req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_OST_SETATTR);
+	req = ptlrpc_request_alloc(imp, &RQF_OST_SETATTR);
 	if (req == NULL)
 		RETURN(-ENOMEM);
 
@@ -271,6 +299,18 @@ int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
 	RETURN(0);
 }
 
+int osc_setattr_async(struct obd_export *exp, struct obdo *oa,
+		      obd_enqueue_update_f upcall, void *cookie,
+		      struct ptlrpc_request_set *rqset)
+{
+	if (rqset == PTLRPCD_SET &&
+	    osc_compound_queue(exp, oa, OST_SETATTR, upcall, cookie) == 0)
+		return 0;
+
+	return osc_setattr_send(class_exp2cliimp(exp), oa, upcall, cookie,
+				rqset);
+}
+
 static int osc_ladvise_interpret(const struct lu_env *env,
 				 struct ptlrpc_request *req,
 				 void *arg, int rc)
@@ -410,9 +450,9 @@ out:
 	RETURN(rc);
 }
 
-int osc_punch_base(struct obd_export *exp, struct obdo *oa,
-                   obd_enqueue_update_f upcall, void *cookie,
-                   struct ptlrpc_request_set *rqset)
+static int osc_punch_send(struct obd_import *imp, struct obdo *oa,
+			  obd_enqueue_update_f upcall, void *cookie,
+			  struct ptlrpc_request_set *rqset)
 {
         struct ptlrpc_request   *req;
         struct osc_setattr_args *sa;
@@ -420,7 +460,7 @@ int osc_punch_base(struct obd_export *exp, struct obdo *oa,
         int                      rc;
         ENTRY;
 
-        req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_OST_PUNCH);
+        req = ptlrpc_request_alloc(imp, &RQF_OST_PUNCH);
         if (req == NULL)
                 RETURN(-ENOMEM);
 
@@ -452,6 +492,218 @@ int osc_punch_base(struct obd_export *exp, struct obdo *oa,
 	RETURN(0);
 }
 
+int osc_punch_base(struct obd_export *exp, struct obdo *oa,
+		   obd_enqueue_update_f upcall, void *cookie,
+		   struct ptlrpc_request_set *rqset)
+{
+	if (rqset == PTLRPCD_SET &&
+	    osc_compound_queue(exp, oa, OST_PUNCH, upcall, cookie) == 0)
+		return 0;
+
+	return osc_punch_send(class_exp2cliimp(exp), oa, upcall, cookie,
+			      rqset);
+}
+
+/**
+ * Queue a setattr or punch to be sent in an OST_COMPOUND RPC.
+ *
+ * Small metadata-like OST operations issued back to back, e.g. by a
+ * truncate or utime over a striped file, are gathered per OSC and sent
+ * from ptlrpcd in as few RPCs as possible instead of one RPC each.
+ *
+ * \retval 0		the operation is queued, \a upcall will be called
+ * \retval -EOPNOTSUPP	OST_COMPOUND is not supported by the server
+ * \retval -ENOMEM	out of memory
+ */
+static int osc_compound_queue(struct obd_export *exp, struct obdo *oa,
+			      __u32 opc, obd_enqueue_update_f upcall,
+			      void *cookie)
+{
+	struct client_obd	*cli = &exp->exp_obd->u.cli;
+	struct obd_connect_data	*ocd = &class_exp2cliimp(exp)->imp_connect_data;
+	struct osc_compound_op	*op;
+
+	if (cli->cl_compound_work == NULL ||
+	    !(ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) ||
+	    !(ocd->ocd_connect_flags2 & OBD_CONNECT2_COMPOUND))
+		return -EOPNOTSUPP;
+
+	OBD_ALLOC_PTR(op);
+	if (op == NULL)
+		return -ENOMEM;
+
+	op->ocp_oa = oa;
+	op->ocp_opc = opc;
+	op->ocp_upcall = upcall;
+	op->ocp_cookie = cookie;
+
+	spin_lock(&cli->cl_compound_lock);
+	list_add_tail(&op->ocp_list, &cli->cl_compound_list);
+	cli->cl_compound_count++;
+	spin_unlock(&cli->cl_compound_lock);
+
+	ptlrpcd_queue_work(cli->cl_compound_work);
+	return 0;
+}
+
+/* Send the operations in \a ops one RPC each, or fail them with \a rc */
+static void osc_compound_flush(struct client_obd *cli, struct list_head *ops,
+			       int rc)
+{
+	struct osc_compound_op *op;
+	struct osc_compound_op *tmp;
+	int			err;
+
+	list_for_each_entry_safe(op, tmp, ops, ocp_list) {
+		list_del_init(&op->ocp_list);
+
+		err = rc;
+		if (err == 0 && op->ocp_opc == OST_PUNCH)
+			err = osc_punch_send(cli->cl_import, op->ocp_oa,
+					     op->ocp_upcall, op->ocp_cookie,
+					     PTLRPCD_SET);
+		else if (err == 0)
+			err = osc_setattr_send(cli->cl_import, op->ocp_oa,
+					       op->ocp_upcall, op->ocp_cookie,
+					       PTLRPCD_SET);
+		if (err != 0)
+			op->ocp_upcall(op->ocp_cookie, err);
+
+		OBD_FREE_PTR(op);
+	}
+}
+
+static int osc_compound_interpret(const struct lu_env *env,
+				  struct ptlrpc_request *req,
+				  void *arg, int rc)
+{
+	struct osc_compound_args *ca = arg;
+	struct ost_compound_op	 *reps = NULL;
+	struct osc_compound_op	 *op;
+	struct osc_compound_op	 *tmp;
+	int			  count = 0;
+	int			  i = 0;
+	ENTRY;
+
+	if (rc == 0) {
+		reps = req_capsule_server_get(&req->rq_pill,
+					      &RMF_OST_COMPOUND);
+		if (reps == NULL)
+			rc = -EPROTO;
+		else
+			count = req_capsule_get_size(&req->rq_pill,
+						     &RMF_OST_COMPOUND,
+						     RCL_SERVER) /
+				sizeof(*reps);
+	}
+
+	list_for_each_entry_safe(op, tmp, &ca->ca_ops, ocp_list) {
+		int op_rc = rc;
+
+		if (op_rc == 0 &&
+		    (i >= count || reps[i].oco_opc != op->ocp_opc))
+			op_rc = -EPROTO;
+		if (op_rc == 0)
+			op_rc = ptlrpc_status_ntoh(reps[i].oco_rc);
+		if (op_rc == 0)
+			lustre_get_wire_obdo(&req->rq_import->imp_connect_data,
+					     op->ocp_oa, &reps[i].oco_body.oa);
+		i++;
+
+		list_del_init(&op->ocp_list);
+		op->ocp_upcall(op->ocp_cookie, op_rc);
+		OBD_FREE_PTR(op);
+	}
+
+	RETURN(0);
+}
+
+/* Pack up to OST_COMPOUND_MAX_OPS operations of \a ops into one RPC */
+static void osc_compound_send(struct client_obd *cli, struct list_head *ops,
+			      int count)
+{
+	struct ptlrpc_request	 *req;
+	struct osc_compound_args *ca;
+	struct ost_compound_op	 *wops;
+	struct osc_compound_op	 *op;
+	int			  rc;
+	int			  i = 0;
+	ENTRY;
+
+	req = ptlrpc_request_alloc(cli->cl_import, &RQF_OST_COMPOUND);
+	if (req == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_COMPOUND, RCL_CLIENT,
+			     count * sizeof(*wops));
+	rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, OST_COMPOUND);
+	if (rc) {
+		ptlrpc_request_free(req);
+		GOTO(out, rc);
+	}
+	/* may carry punches, see osc_punch_send() */
+	req->rq_request_portal = OST_IO_PORTAL;
+	ptlrpc_at_set_req_timeout(req);
+
+	wops = req_capsule_client_get(&req->rq_pill, &RMF_OST_COMPOUND);
+	list_for_each_entry(op, ops, ocp_list) {
+		wops[i].oco_opc = op->ocp_opc;
+		wops[i].oco_rc = 0;
+		lustre_set_wire_obdo(&req->rq_import->imp_connect_data,
+				     &wops[i].oco_body.oa, op->ocp_oa);
+		i++;
+	}
+	LASSERT(i == count);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_OST_COMPOUND, RCL_SERVER,
+			     count * sizeof(*wops));
+	ptlrpc_request_set_replen(req);
+
+	req->rq_interpret_reply = osc_compound_interpret;
+	CLASSERT(sizeof(*ca) <= sizeof(req->rq_async_args));
+	ca = ptlrpc_req_async_args(req);
+	INIT_LIST_HEAD(&ca->ca_ops);
+	list_splice_init(ops, &ca->ca_ops);
+
+	ptlrpcd_add_req(req);
+	EXIT;
+	return;
+out:
+	/* fall back to plain RPCs rather than failing the operations */
+	osc_compound_flush(cli, ops, 0);
+	EXIT;
+}
+
+static int osc_compound_work(const struct lu_env *env, void *data)
+{
+	struct client_obd	*cli = data;
+	struct list_head	 ops = LIST_HEAD_INIT(ops);
+	struct list_head	 batch = LIST_HEAD_INIT(batch);
+	int			 count;
+	int			 nr;
+	int			 i;
+
+	spin_lock(&cli->cl_compound_lock);
+	list_splice_init(&cli->cl_compound_list, &ops);
+	count = cli->cl_compound_count;
+	cli->cl_compound_count = 0;
+	spin_unlock(&cli->cl_compound_lock);
+
+	while (count > 1) {
+		nr = min(count, OST_COMPOUND_MAX_OPS);
+		count -= nr;
+
+		for (i = 0; i < nr; i++)
+			list_move_tail(ops.next, &batch);
+		osc_compound_send(cli, &batch, nr);
+	}
+
+	/* a lone operation gains nothing from being wrapped */
+	osc_compound_flush(cli, &ops, 0);
+
+	return 0;
+}
+
 static int osc_sync_interpret(const struct lu_env *env,
                               struct ptlrpc_request *req,
                               void *arg, int rc)
@@ -740,6 +992,100 @@ static void osc_update_grant(struct client_obd *cli, struct ost_body *body)
         }
 }
 
+/* grant is requested ahead to cover this many seconds of dirtying */
+#define OSC_GRANT_PREDICT_SEC	2
+
+/* Fold the bytes dirtied since the last sample into the EWMA dirty rate,
+ * at most once a second.  Caller must hold cl_loi_list_lock. */
+static void osc_grant_rate_update(struct client_obd *cli)
+{
+	cfs_time_t now = cfs_time_current();
+	cfs_duration_t elapsed = cfs_time_sub(now, cli->cl_grant_rate_stamp);
+	__u64 sample;
+
+	if (elapsed < cfs_time_seconds(1))
+		return;
+
+	/* nothing dirtied over a whole prediction window: writers are idle */
+	if (cli->cl_grant_dirty_bytes == 0 &&
+	    elapsed >= cfs_time_seconds(OSC_GRANT_PREDICT_SEC)) {
+		cli->cl_grant_dirty_rate = 0;
+		cli->cl_grant_rate_stamp = now;
+		return;
+	}
+
+	sample = (__u64)cli->cl_grant_dirty_bytes * MSEC_PER_SEC;
+	do_div(sample, jiffies_to_msecs(elapsed));
+	cli->cl_grant_dirty_rate = (cli->cl_grant_dirty_rate * 3 + sample) / 4;
+	cli->cl_grant_dirty_bytes = 0;
+	cli->cl_grant_rate_stamp = now;
+}
+
+/* Grant expected to be consumed over the next OSC_GRANT_PREDICT_SEC seconds,
+ * capped to what can be dirty or in flight at once.
+ * Caller must hold cl_loi_list_lock. */
+unsigned long osc_grant_predict(struct client_obd *cli)
+{
+	unsigned long max_bytes;
+
+	osc_grant_rate_update(cli);
+	max_bytes = (cli->cl_dirty_max_pages + cli->cl_max_pages_per_rpc *
+		     cli->cl_max_rpcs_in_flight) << PAGE_SHIFT;
+
+	return min(cli->cl_grant_dirty_rate * OSC_GRANT_PREDICT_SEC,
+		   max_bytes);
+}
+
+/**
+ * Account \a bytes of grant consumed by dirtying pages. Once the available
+ * grant drops below half of the predicted need, mark a grant request to be
+ * queued by osc_grant_request_queue() when the caller drops the lock, so
+ * that the OST can top grant up before writers stall on it.
+ *
+ * Caller must hold cl_loi_list_lock.
+ */
+void osc_grant_consumed(struct client_obd *cli, unsigned long bytes)
+{
+	cli->cl_grant_dirty_bytes += bytes;
+
+	if (cli->cl_grant_requesting || cli->cl_grant_work == NULL)
+		return;
+
+	if (cli->cl_avail_grant >= osc_grant_predict(cli) / 2)
+		return;
+
+	if (!(cli->cl_import->imp_connect_data.ocd_connect_flags &
+	      OBD_CONNECT_GRANT_SHRINK))
+		return;
+
+	/* cleared by osc_grant_request_work() if it sends nothing, or by
+	 * osc_shrink_grant_interpret() once the request is answered */
+	cli->cl_grant_requesting = 1;
+	cli->cl_grant_queue = 1;
+}
+
+/**
+ * Queue the grant request marked by osc_grant_consumed(), if any.
+ *
+ * Caller must not hold cl_loi_list_lock.
+ */
+void osc_grant_request_queue(struct client_obd *cli)
+{
+	int queue;
+
+	/* unlocked peek, the flag is tested again under the lock */
+	if (!ACCESS_ONCE(cli->cl_grant_queue))
+		return;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	queue = cli->cl_grant_queue;
+	cli->cl_grant_queue = 0;
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	if (queue)
+		ptlrpcd_queue_work(cli->cl_grant_work);
+}
+
 static int osc_set_info_async(const struct lu_env *env, struct obd_export *exp,
 			      u32 keylen, void *key,
 			      u32 vallen, void *val,
@@ -751,10 +1097,14 @@ static int osc_shrink_grant_interpret(const struct lu_env *env,
 {
         struct client_obd *cli = &req->rq_import->imp_obd->u.cli;
         struct obdo *oa = ((struct osc_grant_args *)aa)->aa_oa;
-        struct ost_body *body;
+        struct ost_body *body = NULL;
+	bool request = oa->o_valid & OBD_MD_FLFLAGS &&
+		       oa->o_flags & OBD_FL_GRANT_REQUEST;
 
         if (rc != 0) {
-                __osc_update_grant(cli, oa->o_grant);
+		/* a grant request gave nothing back to the OST */
+		if (!request)
+			__osc_update_grant(cli, oa->o_grant);
                 GOTO(out, rc);
         }
 
@@ -762,14 +1112,70 @@ static int osc_shrink_grant_interpret(const struct lu_env *env,
         LASSERT(body);
         osc_update_grant(cli, body);
 out:
+	if (request) {
+		spin_lock(&cli->cl_loi_list_lock);
+		cli->cl_grant_requesting = 0;
+		if (body != NULL && body->oa.o_valid & OBD_MD_FLGRANT) {
+			cli->cl_grant_requests++;
+			cli->cl_grant_requested_bytes += body->oa.o_grant;
+		}
+		osc_wake_cache_waiters(cli);
+		spin_unlock(&cli->cl_loi_list_lock);
+	}
         OBDO_FREE(oa);
         return rc;
 }
 
+/* ptlrpcd work queued by osc_grant_request_queue() */
+static int osc_grant_request_work(const struct lu_env *env, void *data)
+{
+	struct client_obd	*cli = data;
+	struct ost_body		*body;
+	unsigned long		 need;
+	int			 rc;
+	ENTRY;
+
+	if (cli->cl_import->imp_state != LUSTRE_IMP_FULL)
+		GOTO(out, rc = -EAGAIN);
+
+	OBD_ALLOC_PTR(body);
+	if (body == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	/* o_grant tells the OST what we hold and o_undirty what we want to
+	 * hold: the predicted need, within the limit osc_announce_cached()
+	 * computed (0 if we may not dirty more) */
+	osc_announce_cached(cli, &body->oa, 0);
+	spin_lock(&cli->cl_loi_list_lock);
+	need = osc_grant_predict(cli);
+	spin_unlock(&cli->cl_loi_list_lock);
+	body->oa.o_undirty = min_t(__u64, body->oa.o_undirty, need);
+	body->oa.o_valid |= OBD_MD_FLFLAGS;
+	body->oa.o_flags = OBD_FL_GRANT_REQUEST;
+
+	rc = osc_set_info_async(NULL, cli->cl_import->imp_obd->obd_self_export,
+				sizeof(KEY_GRANT_SHRINK), KEY_GRANT_SHRINK,
+				sizeof(*body), body, NULL);
+	OBD_FREE_PTR(body);
+out:
+	if (rc != 0) {
+		spin_lock(&cli->cl_loi_list_lock);
+		cli->cl_grant_requesting = 0;
+		spin_unlock(&cli->cl_loi_list_lock);
+	}
+	RETURN(0);
+}
+
 static void osc_shrink_grant_local(struct client_obd *cli, struct obdo *oa)
 {
+	__u64 brw_size = cli->cl_max_pages_per_rpc << PAGE_SHIFT;
+
 	spin_lock(&cli->cl_loi_list_lock);
-	oa->o_grant = cli->cl_avail_grant / 4;
+	/* writers have gone idle, give back all but a single RPC's worth */
+	if (osc_grant_predict(cli) == 0 && cli->cl_avail_grant > brw_size)
+		oa->o_grant = cli->cl_avail_grant - brw_size;
+	else
+		oa->o_grant = cli->cl_avail_grant / 4;
 	cli->cl_avail_grant -= oa->o_grant;
 	spin_unlock(&cli->cl_loi_list_lock);
         if (!(oa->o_valid & OBD_MD_FLFLAGS)) {
@@ -790,7 +1196,8 @@ static int osc_shrink_grant(struct client_obd *cli)
 			     (cli->cl_max_pages_per_rpc << PAGE_SHIFT);
 
 	spin_lock(&cli->cl_loi_list_lock);
-	if (cli->cl_avail_grant <= target_bytes)
+	/* writers have gone idle, don't keep more than a single RPC's worth */
+	if (cli->cl_avail_grant <= target_bytes || osc_grant_predict(cli) == 0)
 		target_bytes = cli->cl_max_pages_per_rpc << PAGE_SHIFT;
 	spin_unlock(&cli->cl_loi_list_lock);
 
@@ -1297,7 +1704,9 @@ osc_brw_prep_request(int cmd, struct client_obd *cli, struct obdo *oa,
         aa->aa_resends = 0;
         aa->aa_ppga = pga;
         aa->aa_cli = cli;
+	aa->aa_dio = NULL;
 	INIT_LIST_HEAD(&aa->aa_oaps);
+	INIT_LIST_HEAD(&aa->aa_exts);
 
 	*reqp = req;
 	niobuf = req_capsule_client_get(pill, &RMF_NIOBUF_REMOTE);
@@ -1879,7 +2288,327 @@ static int brw_interpret(const struct lu_env *env,
 	osc_wake_cache_waiters(cli);
 	spin_unlock(&cli->cl_loi_list_lock);
 
+	wake_up(&cli->cl_dio_waitq);
+
+	osc_io_unplug(env, cli, NULL);
+	RETURN(rc);
+}
+
+static int osc_dio_interpret(const struct lu_env *env,
+			     struct ptlrpc_request *req, void *data, int rc)
+{
+	struct osc_brw_async_args *aa = data;
+	struct osc_dio_rpc *odr = aa->aa_dio;
+	struct client_obd *cli = aa->aa_cli;
+	struct cl_sync_io *anchor = odr->odr_anchor;
+	int opc = lustre_msg_get_opc(req->rq_reqmsg);
+	ENTRY;
+
+	qos_adjust(req->rq_import->imp_obd,
+		   &req->rq_arrival_time,
+		   &aa->aa_oa->o_sent_time,
+		   opc - OST_READ,
+		   req->rq_bulk->bd_nob_transferred);
+
+	rc = osc_brw_fini_request(req, rc);
+	CDEBUG(D_INODE, "dio request %p aa %p rc %d\n", req, aa, rc);
+	if (osc_recoverable_error(rc)) {
+		if (req->rq_import_generation !=
+		    req->rq_import->imp_generation) {
+			CDEBUG(D_HA, "%s: resend cross eviction for object: "
+			       ""DOSTID", rc = %d.\n",
+			       req->rq_import->imp_obd->obd_name,
+			       POSTID(&aa->aa_oa->o_oi), rc);
+		} else if (rc == -EINPROGRESS ||
+		    client_should_resend(aa->aa_resends, aa->aa_cli)) {
+			rc = osc_brw_redo_request(req, aa, rc);
+		} else {
+			CERROR("%s: too many resent retries for object: "
+			       "%llu:%llu, rc = %d.\n",
+			       req->rq_import->imp_obd->obd_name,
+			       POSTID(&aa->aa_oa->o_oi), rc);
+		}
+
+		if (rc == 0)
+			RETURN(0);
+		else if (rc == -EAGAIN || rc == -EINPROGRESS)
+			rc = -EIO;
+	}
+
+	if (rc == 0) {
+		struct obdo *oa = aa->aa_oa;
+		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
+		struct cl_object *obj = osc2cl(odr->odr_obj);
+		unsigned long valid = 0;
+
+		cl_object_attr_lock(obj);
+		if (oa->o_valid & OBD_MD_FLBLOCKS) {
+			attr->cat_blocks = oa->o_blocks;
+			valid |= CAT_BLOCKS;
+		}
+		if (oa->o_valid & OBD_MD_FLMTIME) {
+			attr->cat_mtime = oa->o_mtime;
+			valid |= CAT_MTIME;
+		}
+		if (oa->o_valid & OBD_MD_FLATIME) {
+			attr->cat_atime = oa->o_atime;
+			valid |= CAT_ATIME;
+		}
+		if (oa->o_valid & OBD_MD_FLCTIME) {
+			attr->cat_ctime = oa->o_ctime;
+			valid |= CAT_CTIME;
+		}
+
+		if (opc == OST_WRITE) {
+			struct lov_oinfo *loi = odr->odr_obj->oo_oinfo;
+
+			if (loi->loi_lvb.lvb_size < odr->odr_end) {
+				attr->cat_size = odr->odr_end;
+				valid |= CAT_SIZE;
+			}
+			if (loi->loi_kms < odr->odr_end && !odr->odr_srvlock) {
+				attr->cat_kms = odr->odr_end;
+				valid |= CAT_KMS;
+			}
+		}
+
+		if (valid != 0)
+			cl_object_attr_update(env, obj, attr, valid);
+		cl_object_attr_unlock(obj);
+	}
+	OBDO_FREE(aa->aa_oa);
+
+	osc_release_ppga(aa->aa_ppga, aa->aa_page_count);
+	ptlrpc_lprocfs_brw(req, req->rq_bulk->bd_nob_transferred);
+
+	spin_lock(&cli->cl_loi_list_lock);
+	if (opc == OST_WRITE)
+		cli->cl_w_in_flight--;
+	else
+		cli->cl_r_in_flight--;
+	osc_wake_cache_waiters(cli);
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	wake_up(&cli->cl_dio_waitq);
 	osc_io_unplug(env, cli, NULL);
+
+	OBD_FREE_LARGE(odr, offsetof(struct osc_dio_rpc,
+				     odr_pga[odr->odr_page_count]));
+	cl_sync_io_note(env, anchor, rc);
+	RETURN(rc);
+}
+
+/**
+ * Take an RPC slot for a direct IO RPC, honouring max_rpcs_in_flight just
+ * like RPCs built from the cache by osc_io_unplug() do.
+ */
+static int osc_dio_get_slot(struct client_obd *cli, int cmd)
+{
+	int rc = 0;
+
+	spin_lock(&cli->cl_loi_list_lock);
+	if (cli->cl_r_in_flight + cli->cl_w_in_flight <
+	    cli->cl_max_rpcs_in_flight) {
+		if (cmd & OBD_BRW_WRITE)
+			cli->cl_w_in_flight++;
+		else
+			cli->cl_r_in_flight++;
+		rc = 1;
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	return rc;
+}
+
+static bool osc_dio_covered(const struct lu_env *env, struct osc_object *osc,
+			    pgoff_t index)
+{
+	struct ldlm_lock *dlmlock;
+
+	dlmlock = osc_dlmlock_at_pgoff(env, osc, index, OSC_DAP_FL_TEST_LOCK);
+	if (dlmlock == NULL)
+		return false;
+
+	LDLM_LOCK_PUT(dlmlock);
+	return true;
+}
+
+/**
+ * Build and send one BRW RPC for \a page_count user pages starting at
+ * object offset \a pos. The pages are mapped into brw_page directly, no
+ * cl_page/osc_page is set up for them.
+ */
+static int osc_dio_build_rpc(const struct lu_env *env, struct osc_object *osc,
+			     int cmd, int brw_flags, struct page **pages,
+			     u32 page_count, loff_t pos, size_t size,
+			     struct cl_sync_io *anchor)
+{
+	struct client_obd		*cli = osc_cli(osc);
+	struct cl_req_attr		*crattr;
+	struct osc_brw_async_args	*aa;
+	struct ptlrpc_request		*req = NULL;
+	struct osc_dio_rpc		*odr = NULL;
+	struct brw_page			**pga = NULL;
+	struct ldlm_lock		*dlmlock;
+	struct ost_body			*body;
+	struct obdo			*oa = NULL;
+	struct l_wait_info		 lwi = { 0 };
+	size_t				 left = size;
+	u32				 i;
+	int				 rc;
+	ENTRY;
+
+	OBD_ALLOC_LARGE(odr, offsetof(struct osc_dio_rpc,
+				      odr_pga[page_count]));
+	if (odr == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	OBD_ALLOC(pga, sizeof(*pga) * page_count);
+	if (pga == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	OBDO_ALLOC(oa);
+	if (oa == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	odr->odr_obj = osc;
+	odr->odr_anchor = anchor;
+	odr->odr_end = pos + size;
+	odr->odr_srvlock = !!(brw_flags & OBD_BRW_SRVLOCK);
+	odr->odr_page_count = page_count;
+	for (i = 0; i < page_count; i++) {
+		struct brw_page *pg = &odr->odr_pga[i];
+
+		pg->pg = pages[i];
+		pg->off = pos + ((loff_t)i << PAGE_SHIFT);
+		pg->count = min_t(size_t, left, PAGE_SIZE);
+		pg->flag = brw_flags;
+		left -= pg->count;
+		pga[i] = pg;
+	}
+
+	crattr = &osc_env_info(env)->oti_req_attr;
+	memset(crattr, 0, sizeof(*crattr));
+	crattr->cra_type = (cmd & OBD_BRW_WRITE) ? CRT_WRITE : CRT_READ;
+	/* there is no cl_page to look the lock up, do it here */
+	crattr->cra_flags = ~0ULL & ~OBD_MD_FLHANDLE;
+	crattr->cra_oa = oa;
+	cl_req_attr_set(env, osc2cl(osc), crattr);
+
+	dlmlock = osc_dlmlock_at_pgoff(env, osc, pos >> PAGE_SHIFT,
+				       OSC_DAP_FL_TEST_LOCK |
+				       OSC_DAP_FL_CANCELING);
+	if (dlmlock != NULL) {
+		oa->o_handle = dlmlock->l_remote_handle;
+		oa->o_valid |= OBD_MD_FLHANDLE;
+		LDLM_LOCK_PUT(dlmlock);
+	}
+
+	if (cmd & OBD_BRW_WRITE)
+		oa->o_grant_used = 0;
+
+	rc = osc_brw_prep_request(cmd, cli, oa, page_count, pga, &req, 0);
+	if (rc != 0) {
+		CERROR("prep_req failed: %d\n", rc);
+		GOTO(out, rc);
+	}
+
+	req->rq_interpret_reply = osc_dio_interpret;
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
+	crattr->cra_oa = &body->oa;
+	crattr->cra_flags = OBD_MD_FLMTIME | OBD_MD_FLCTIME | OBD_MD_FLATIME;
+	cl_req_attr_set(env, osc2cl(osc), crattr);
+	lustre_msg_set_jobid(req->rq_reqmsg, crattr->cra_jobid);
+
+	aa = ptlrpc_req_async_args(req);
+	aa->aa_dio = odr;
+	/* sent_time is used by QoS */
+	do_gettimeofday(&aa->aa_oa->o_sent_time);
+
+	/* Wait until the number of RPCs in flight drops under
+	 * max_rpcs_in_flight, the slot is released by osc_dio_interpret() */
+	l_wait_event(cli->cl_dio_waitq, osc_dio_get_slot(cli, cmd), &lwi);
+
+	spin_lock(&cli->cl_loi_list_lock);
+	lu2osc_dev(osc->oo_cl.co_lu.lo_dev)->od_stats.os_lean_dio += size;
+	if (cmd & OBD_BRW_WRITE) {
+		lprocfs_oh_tally_log2(&cli->cl_write_page_hist, page_count);
+		lprocfs_oh_tally(&cli->cl_write_rpc_hist, cli->cl_w_in_flight);
+		lprocfs_oh_tally_log2(&cli->cl_write_offset_hist,
+				      (pos >> PAGE_SHIFT) + 1);
+	} else {
+		lprocfs_oh_tally_log2(&cli->cl_read_page_hist, page_count);
+		lprocfs_oh_tally(&cli->cl_read_rpc_hist, cli->cl_r_in_flight);
+		lprocfs_oh_tally_log2(&cli->cl_read_offset_hist,
+				      (pos >> PAGE_SHIFT) + 1);
+	}
+	spin_unlock(&cli->cl_loi_list_lock);
+
+	DEBUG_REQ(D_INODE, req, "%u dio pages, aa %p. now %ur/%uw in flight",
+		  page_count, aa, cli->cl_r_in_flight, cli->cl_w_in_flight);
+	OBD_FAIL_TIMEOUT(OBD_FAIL_OSC_DELAY_IO, cfs_fail_val);
+
+	/* account the RPC in the anchor before it can complete */
+	atomic_inc(&anchor->csi_sync_nr);
+	qos_throttle(&cli->qos);
+	ptlrpcd_add_req(req);
+	RETURN(0);
+
+out:
+	if (oa != NULL)
+		OBDO_FREE(oa);
+	if (pga != NULL)
+		OBD_FREE(pga, sizeof(*pga) * page_count);
+	if (odr != NULL)
+		OBD_FREE_LARGE(odr, offsetof(struct osc_dio_rpc,
+					     odr_pga[page_count]));
+	RETURN(rc);
+}
+
+/**
+ * Send page aligned direct IO of \a cdp to the OST in RPCs of at most
+ * cl_max_pages_per_rpc pages, without setting up cl_page for the pages.
+ * Every RPC sent is accounted in cl_dio_pages::cdp_anchor.
+ *
+ * \retval 0		all RPCs were sent
+ * \retval -ENOTSUPP	the extent is not covered by a DLM lock, nothing sent
+ * \retval negative	error, RPCs sent so far still complete on the anchor
+ */
+int osc_dio_submit(const struct lu_env *env, struct osc_object *osc,
+		   int cmd, int brw_flags, struct cl_dio_pages *cdp)
+{
+	struct client_obd *cli = osc_cli(osc);
+	struct page **pages = cdp->cdp_pages;
+	loff_t pos = cdp->cdp_pos;
+	size_t left = cdp->cdp_size;
+	int nr = cdp->cdp_nr;
+	int rc = 0;
+	ENTRY;
+
+	LASSERT(!(pos & ~PAGE_MASK));
+	LASSERT(nr > 0 && left > 0);
+
+	/* only handle extents covered by a granted lock, checking both ends
+	 * is enough since the io locks the whole range with one extent lock */
+	if (!(brw_flags & OBD_BRW_SRVLOCK) &&
+	    (!osc_dio_covered(env, osc, pos >> PAGE_SHIFT) ||
+	     !osc_dio_covered(env, osc, (pos + left - 1) >> PAGE_SHIFT)))
+		RETURN(-ENOTSUPP);
+
+	while (nr > 0 && rc == 0) {
+		u32 count = min_t(int, nr, cli->cl_max_pages_per_rpc);
+		size_t bytes = min_t(size_t, left,
+				     (size_t)count << PAGE_SHIFT);
+
+		rc = osc_dio_build_rpc(env, osc, cmd, brw_flags, pages, count,
+				       pos, bytes, cdp->cdp_anchor);
+		pages += count;
+		nr -= count;
+		pos += bytes;
+		left -= bytes;
+	}
+
 	RETURN(rc);
 }
 
@@ -2619,7 +3348,7 @@ static int osc_set_info_async(const struct lu_env *env, struct obd_export *exp,
 
 	if (KEY_IS(KEY_CACHE_LRU_SHRINK)) {
 		struct client_obd *cli = &obd->u.cli;
-		long nr = atomic_long_read(&cli->cl_lru_in_list) >> 1;
+		long nr = osc_lru_in_list(cli) >> 1;
 		long target = *(long *)val;
 
 		nr = osc_lru_shrink(env, cli, min(nr, target), true);
@@ -2904,6 +3633,10 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc)
 		GOTO(out_ptlrpcd, rc);
 
+	rc = osc_lru_parts_init(cli);
+	if (rc)
+		GOTO(out_client_setup, rc);
+
 	handler = ptlrpcd_alloc_work(cli->cl_import, brw_queue_work, cli);
 	if (IS_ERR(handler))
 		GOTO(out_client_setup, rc = PTR_ERR(handler));
@@ -2914,6 +3647,18 @@ int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
 		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
 	cli->cl_lru_work = handler;
 
+	handler = ptlrpcd_alloc_work(cli->cl_import, osc_grant_request_work,
+				     cli);
+	if (IS_ERR(handler))
+		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
+	cli->cl_grant_work = handler;
+	cli->cl_grant_rate_stamp = cfs_time_current();
+
+	handler = ptlrpcd_alloc_work(cli->cl_import, osc_compound_work, cli);
+	if (IS_ERR(handler))
+		GOTO(out_ptlrpcd_work, rc = PTR_ERR(handler));
+	cli->cl_compound_work = handler;
+
 	rc = osc_quota_setup(obd);
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
@@ -2983,7 +3728,16 @@ out_ptlrpcd_work:
 		ptlrpcd_destroy_work(cli->cl_lru_work);
 		cli->cl_lru_work = NULL;
 	}
+	if (cli->cl_grant_work != NULL) {
+		ptlrpcd_destroy_work(cli->cl_grant_work);
+		cli->cl_grant_work = NULL;
+	}
+	if (cli->cl_compound_work != NULL) {
+		ptlrpcd_destroy_work(cli->cl_compound_work);
+		cli->cl_compound_work = NULL;
+	}
 out_client_setup:
+	osc_lru_parts_fini(cli);
 	client_obd_cleanup(obd);
 out_ptlrpcd:
 	ptlrpcd_decref();
@@ -3015,6 +3769,24 @@ static int osc_precleanup(struct obd_device *obd)
 		cli->cl_lru_work = NULL;
 	}
 
+	if (cli->cl_grant_work) {
+		ptlrpcd_destroy_work(cli->cl_grant_work);
+		cli->cl_grant_work = NULL;
+	}
+
+	if (cli->cl_compound_work) {
+		struct list_head ops = LIST_HEAD_INIT(ops);
+
+		ptlrpcd_destroy_work(cli->cl_compound_work);
+		cli->cl_compound_work = NULL;
+
+		spin_lock(&cli->cl_compound_lock);
+		list_splice_init(&cli->cl_compound_list, &ops);
+		cli->cl_compound_count = 0;
+		spin_unlock(&cli->cl_compound_lock);
+		osc_compound_flush(cli, &ops, -ESHUTDOWN);
+	}
+
 	obd_cleanup_client_import(obd);
 	ptlrpc_lprocfs_unregister_obd(obd);
 	lprocfs_obd_cleanup(obd);
@@ -3042,6 +3814,7 @@ int osc_cleanup(struct obd_device *obd)
 		cl_cache_decref(cli->cl_cache);
 		cli->cl_cache = NULL;
 	}
+	osc_lru_parts_fini(cli);
 
 	/* free memory of osc quota cache */
 	osc_quota_cleanup(obd);
@@ -470,34 +470,6 @@ __must_hold(&req->rq_lock)
 	RETURN(rc);
 }
 
-static struct kmem_cache *request_cache;
-
-int ptlrpc_request_cache_init(void)
-{
-	request_cache = kmem_cache_create("ptlrpc_cache",
-					  sizeof(struct ptlrpc_request),
-					  0, SLAB_HWCACHE_ALIGN, NULL);
-	return request_cache == NULL ? -ENOMEM : 0;
-}
-
-void ptlrpc_request_cache_fini(void)
-{
-	kmem_cache_destroy(request_cache);
-}
-
-struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags)
-{
-	struct ptlrpc_request *req;
-
-	OBD_SLAB_ALLOC_PTR_GFP(req, request_cache, flags);
-	return req;
-}
-
-void ptlrpc_request_cache_free(struct ptlrpc_request *req)
-{
-	OBD_SLAB_FREE_PTR(req, request_cache);
-}
-
 /**
  * Wind down request pool \a pool.
  * Frees all requests from the pool too
@@ -955,6 +927,9 @@ struct ptlrpc_request_set *ptlrpc_prep_set(void)
 	spin_lock_init(&set->set_new_req_lock);
 	INIT_LIST_HEAD(&set->set_new_requests);
 	INIT_LIST_HEAD(&set->set_cblist);
+	spin_lock_init(&set->set_ready_lock);
+	INIT_LIST_HEAD(&set->set_ready_list);
+	atomic_set(&set->set_rescan, 0);
 	set->set_max_inflight = UINT_MAX;
 	set->set_producer     = NULL;
 	set->set_producer_arg = NULL;
@@ -1131,6 +1106,10 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 		 *      no other better choice. It maybe fixed in future. */
 		for (i = 0; i < pc->pc_npartners; i++)
 			wake_up(&pc->pc_partners[i]->pc_set->set_waitq);
+	} else {
+		/* the queue is building up, let another thread of the CPT
+		 * steal part of it */
+		ptlrpcd_wake_sibling(pc, count);
 	}
 }
 
@@ -1663,28 +1642,104 @@ static inline int ptlrpc_set_producer(struct ptlrpc_request_set *set)
 }
 
 /**
- * this sends any unsent RPCs in \a set and returns 1 if all are sent
- * and no more replies are expected.
- * (it is possible to get less replies than requests sent e.g. due to timed out
- * requests or requests that we had trouble to send out)
+ * Wake up the thread processing \a set because of an event on \a req.
  *
- * NOTE: This function contains a potential schedule point (cond_resched()).
+ * For event driven sets \a req is queued on the set ready list as well, so
+ * that only the requests which got an event need to be checked.
  */
-int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
+void ptlrpc_set_wake_req(struct ptlrpc_request_set *set,
+			 struct ptlrpc_request *req)
+{
+	if (set->set_event_driven) {
+		spin_lock(&set->set_ready_lock);
+		/* the request may have been moved to another set meanwhile,
+		 * only NEW requests are, which that set checks anyway */
+		if (set->set_event_driven && req->rq_set == set &&
+		    list_empty(&req->rq_ready_chain))
+			list_add_tail(&req->rq_ready_chain,
+				      &set->set_ready_list);
+		spin_unlock(&set->set_ready_lock);
+	}
+	wake_up(&set->set_waitq);
+}
+EXPORT_SYMBOL(ptlrpc_set_wake_req);
+
+/**
+ * Remove \a req from the ready list of \a set, before it leaves the set.
+ */
+void ptlrpc_set_del_ready(struct ptlrpc_request_set *set,
+			  struct ptlrpc_request *req)
 {
-	struct list_head *tmp, *next;
+	if (!set->set_event_driven)
+		return;
+
+	spin_lock(&set->set_ready_lock);
+	list_del_init(&req->rq_ready_chain);
+	spin_unlock(&set->set_ready_lock);
+}
+
+/**
+ * Empty the ready list of \a set, all its requests are about to be checked.
+ */
+void ptlrpc_set_clear_ready(struct ptlrpc_request_set *set)
+{
+	spin_lock(&set->set_ready_lock);
+	while (!list_empty(&set->set_ready_list))
+		list_del_init(set->set_ready_list.next);
+	spin_unlock(&set->set_ready_lock);
+}
+
+/**
+ * Return the next request for ptlrpc_check_set() to check: either the
+ * request at \a pos in the list of all requests of \a set, or the first
+ * request on the set ready list when \a ready is set.
+ */
+static struct ptlrpc_request *
+ptlrpc_check_set_next(struct ptlrpc_request_set *set, bool ready,
+		      struct list_head **pos)
+{
+	struct ptlrpc_request *req = NULL;
+
+	if (!ready) {
+		if (*pos == &set->set_requests)
+			return NULL;
+		req = list_entry(*pos, struct ptlrpc_request, rq_set_chain);
+		*pos = (*pos)->next;
+		return req;
+	}
+
+	spin_lock(&set->set_ready_lock);
+	if (!list_empty(&set->set_ready_list)) {
+		req = list_entry(set->set_ready_list.next,
+				 struct ptlrpc_request, rq_ready_chain);
+		list_del_init(&req->rq_ready_chain);
+	}
+	spin_unlock(&set->set_ready_lock);
+
+	return req;
+}
+
+static int __ptlrpc_check_set(const struct lu_env *env,
+			      struct ptlrpc_request_set *set, bool ready)
+{
+	struct ptlrpc_request *req;
+	struct list_head *pos = set->set_requests.next;
 	struct list_head  comp_reqs;
 	int force_timer_recalc = 0;
+	int budget = atomic_read(&set->set_remaining);
 	ENTRY;
 
 	if (atomic_read(&set->set_remaining) == 0)
 		RETURN(1);
 
+	if (!ready && set->set_event_driven)
+		ptlrpc_set_clear_ready(set);
+
 	INIT_LIST_HEAD(&comp_reqs);
-	list_for_each_safe(tmp, next, &set->set_requests) {
-		struct ptlrpc_request *req =
-			list_entry(tmp, struct ptlrpc_request,
-				   rq_set_chain);
+	/* a request can be woken up again while it is checked, bound the
+	 * work done in a single pass over the ready list */
+	while ((!ready || budget-- > 0) &&
+	       (req = ptlrpc_check_set_next(set, ready, &pos)) != NULL) {
 		struct obd_import *imp = req->rq_import;
 		int unregistered = 0;
 		int async = 1;
@@ -2084,8 +2139,36 @@ int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
 	/* If we hit an error, we want to recover promptly. */
 	RETURN(atomic_read(&set->set_remaining) == 0 || force_timer_recalc);
 }
+
+/**
+ * this sends any unsent RPCs in \a set and returns 1 if all are sent
+ * and no more replies are expected.
+ * (it is possible to get less replies than requests sent e.g. due to timed out
+ * requests or requests that we had trouble to send out)
+ *
+ * NOTE: This function contains a potential schedule point (cond_resched()).
+ */
+int ptlrpc_check_set(const struct lu_env *env, struct ptlrpc_request_set *set)
+{
+	return __ptlrpc_check_set(env, set, false);
+}
 EXPORT_SYMBOL(ptlrpc_check_set);
 
+/**
+ * Same as ptlrpc_check_set(), but only checks the requests on the ready list
+ * of the event driven \a set, so that the cost of an event does not depend
+ * on the number of requests in flight. The caller still has to check the
+ * whole set with ptlrpc_check_set() from time to time, for the requests
+ * waiting on timers rather than on events.
+ */
+int ptlrpc_check_set_ready(const struct lu_env *env,
+			   struct ptlrpc_request_set *set)
+{
+	LASSERT(set->set_event_driven);
+
+	return __ptlrpc_check_set(env, set, true);
+}
+
 /**
  * Time out request \a req. is \a async_unlink is set, that means do not wait
  * until LNet actually confirms network buffer unlinking.
@@ -2198,6 +2281,10 @@ int ptlrpc_expired_set(void *data)
                 ptlrpc_expire_one_request(req, 1);
         }
 
+	/* expired requests are not signalled by events */
+	if (set->set_event_driven)
+		atomic_set(&set->set_rescan, 1);
+
         /*
          * When waiting for a whole set, we always break out of the
          * sleep so we can recalculate the timeout, or enable interrupts
@@ -3349,6 +3436,7 @@ static int work_interpreter(const struct lu_env *env,
 			    struct ptlrpc_request *req, void *data, int rc)
 {
 	struct ptlrpc_work_async_args *arg = data;
+	struct ptlrpc_request_set *set = req->rq_set;
 
 	LASSERT(ptlrpcd_check_work(req));
 	LASSERT(arg->cb != NULL);
@@ -3357,6 +3445,7 @@ static int work_interpreter(const struct lu_env *env,
 
 	list_del_init(&req->rq_set_chain);
 	req->rq_set = NULL;
+	ptlrpc_set_del_ready(set, req);
 
 	if (atomic_dec_return(&req->rq_refcount) > 1) {
 		atomic_set(&req->rq_refcount, 2);
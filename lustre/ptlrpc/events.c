@@ -348,6 +348,16 @@ void request_in_callback(lnet_event_t *ev)
 
 	spin_lock(&svcpt->scp_lock);
 
+	/* LNet delivers the event on the CPU that received the message, so
+	 * this tells whether the buffer sits on the receiving NUMA node */
+	if (ev->type == LNET_EVENT_PUT && ev->status == 0 &&
+	    rqbd->rqbd_cpt >= 0) {
+		if (cfs_cpt_current(service->srv_cptable, 0) == rqbd->rqbd_cpt)
+			svcpt->scp_rqbd_local++;
+		else
+			svcpt->scp_rqbd_remote++;
+	}
+
 	ptlrpc_req_add_history(svcpt, req);
 
 	if (ev->unlinked) {
@@ -672,6 +672,11 @@ static const struct req_msg_field *ost_ladvise[] = {
 	&RMF_OST_LADVISE,
 };
 
+static const struct req_msg_field *ost_compound[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OST_COMPOUND,
+};
+
 static const struct req_msg_field *ost_get_fiemap_server[] = {
         &RMF_PTLRPC_BODY,
         &RMF_FIEMAP_VAL
@@ -797,6 +802,7 @@ static struct req_format *req_formats[] = {
 	&RQF_OST_SET_INFO_LAST_FID,
 	&RQF_OST_GET_INFO_FIEMAP,
 	&RQF_OST_LADVISE,
+	&RQF_OST_COMPOUND,
 	&RQF_LDLM_ENQUEUE,
 	&RQF_LDLM_ENQUEUE_LVB,
 	&RQF_LDLM_CONVERT,
@@ -1249,6 +1255,12 @@ struct req_msg_field RMF_OST_LADVISE =
 		    lustre_swab_ladvise, NULL);
 EXPORT_SYMBOL(RMF_OST_LADVISE);
 
+struct req_msg_field RMF_OST_COMPOUND =
+	DEFINE_MSGF("ost_compound", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ost_compound_op),
+		    lustre_swab_ost_compound_op, NULL);
+EXPORT_SYMBOL(RMF_OST_COMPOUND);
+
 struct req_msg_field RMF_OUT_UPDATE_HEADER = DEFINE_MSGF("out_update_header", 0,
 				-1, lustre_swab_out_update_header, NULL);
 EXPORT_SYMBOL(RMF_OUT_UPDATE_HEADER);
@@ -1727,6 +1739,10 @@ struct req_format RQF_OST_LADVISE =
 	DEFINE_REQ_FMT0("OST_LADVISE", ost_ladvise, ost_body_only);
 EXPORT_SYMBOL(RQF_OST_LADVISE);
 
+struct req_format RQF_OST_COMPOUND =
+	DEFINE_REQ_FMT0("OST_COMPOUND", ost_compound, ost_compound);
+EXPORT_SYMBOL(RQF_OST_COMPOUND);
+
 #if !defined(__REQ_LAYOUT_USER__)
 
 /* Convenience macro */
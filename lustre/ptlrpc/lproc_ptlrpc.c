@@ -67,6 +67,7 @@ static struct ll_rpc_opcode {
         { OST_QUOTACTL,     "ost_quotactl" },
         { OST_QUOTA_ADJUST_QUNIT, "ost_quota_adjust_qunit" },
 	{ OST_LADVISE,      "ost_ladvise" },
+	{ OST_COMPOUND,     "ost_compound" },
         { MDS_GETATTR,      "mds_getattr" },
         { MDS_GETATTR_NAME, "mds_getattr_lock" },
         { MDS_CLOSE,        "mds_close" },
@@ -175,6 +176,19 @@ const char *ll_opcode2str(__u32 opcode)
         return ll_rpc_opcode_table[offset].opname;
 }
 
+int ll_str2opcode(const char *ops)
+{
+	int i;
+
+	for (i = 0; i < LUSTRE_MAX_OPCODES; i++) {
+		if (ll_rpc_opcode_table[i].opname != NULL &&
+		    strcmp(ll_rpc_opcode_table[i].opname, ops) == 0)
+			return ll_rpc_opcode_table[i].opcode;
+	}
+
+	return -EINVAL;
+}
+
 static const char *ll_eopcode2str(__u32 opcode)
 {
         LASSERT(ll_eopcode_table[opcode].opcode == opcode);
@@ -219,6 +233,10 @@ static void ptlrpc_lprocfs_register(struct proc_dir_entry *root, char *dir,
                              svc_counter_config, "req_timeout", "sec");
         lprocfs_counter_init(svc_stats, PTLRPC_REQBUF_AVAIL_CNTR,
                              svc_counter_config, "reqbuf_avail", "bufs");
+	lprocfs_counter_init(svc_stats, PTLRPC_REPBATCH_CNTR,
+			     svc_counter_config, "rep_batch", "reps");
+	lprocfs_counter_init(svc_stats, PTLRPC_REPWAIT_CNTR,
+			     svc_counter_config, "rep_waittime", "usec");
         for (i = 0; i < EXTRA_LAST_OPC; i++) {
                 char *units;
 
@@ -1089,6 +1107,36 @@ ptlrpc_lprocfs_hp_ratio_seq_write(struct file *file, const char __user *buffer,
 }
 LPROC_SEQ_FOPS(ptlrpc_lprocfs_hp_ratio);
 
+/**
+ * Shows for each partition the CPT its request buffers and threads live on,
+ * how many buffers it has, and how many requests were received into a buffer
+ * on the receiving CPU's CPT (local) or on another one (remote).
+ */
+static int ptlrpc_lprocfs_rqbd_cpt_map_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	int				i;
+
+	seq_printf(m, "%-9s %-4s %-8s %-12s %s\n",
+		   "partition", "home", "buffers", "local", "remote");
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		if (svcpt->scp_cpt < 0)
+			break;
+
+		spin_lock(&svcpt->scp_lock);
+		seq_printf(m, "%-9d %-4d %-8d %-12llu %llu\n",
+			   svcpt->scp_cpt, svcpt->scp_home_cpt,
+			   svcpt->scp_nrqbds_total, svcpt->scp_rqbd_local,
+			   svcpt->scp_rqbd_remote);
+		spin_unlock(&svcpt->scp_lock);
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_rqbd_cpt_map);
+
 void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
                                      struct ptlrpc_service *svc)
 {
@@ -1102,6 +1150,9 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
 		{ .name = "req_buffer_history_max",
 		  .fops	= &ptlrpc_lprocfs_req_history_max_fops,
 		  .data	= svc },
+		{ .name	= "rqbd_cpt_map",
+		  .fops	= &ptlrpc_lprocfs_rqbd_cpt_map_fops,
+		  .data	= svc },
 		{ .name = "threads_min",
 		  .fops = &ptlrpc_lprocfs_threads_min_fops,
 		  .data = svc },
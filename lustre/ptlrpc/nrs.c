@@ -1811,6 +1811,10 @@ int ptlrpc_nrs_init(void)
 	rc = ptlrpc_nrs_policy_register(&nrs_conf_tbf);
 	if (rc != 0)
 		GOTO(fail, rc);
+
+	rc = ptlrpc_nrs_policy_register(&nrs_conf_edf);
+	if (rc != 0)
+		GOTO(fail, rc);
 #endif /* HAVE_SERVER_SUPPORT */
 
 	RETURN(rc);
@@ -1845,4 +1849,76 @@ void ptlrpc_nrs_fini(void)
 	}
 }
 
+/**
+ * Gets the uid and gid sent with request \a req of opcode \a opc, for the
+ * policies which classify requests by them: the caller's fsuid and fsgid
+ * for MDS requests, the owner of the object for OST requests. Both are
+ * NRS_UGID_NONE for the request types which carry neither. The request
+ * buffers may not have been swabbed yet.
+ */
+void nrs_req_ugid(struct ptlrpc_request *req, __u32 opc,
+		  __u32 *uid, __u32 *gid)
+{
+	struct lustre_msg	*msg = req->rq_reqmsg;
+	bool			 swab;
+
+	*uid = NRS_UGID_NONE;
+	*gid = NRS_UGID_NONE;
+	swab = ptlrpc_req_need_swab(req) &&
+	       !lustre_req_swabbed(req, REQ_REC_OFF);
+
+	switch (opc) {
+	case OST_READ:
+	case OST_WRITE:
+	case OST_GETATTR:
+	case OST_SETATTR:
+	case OST_PUNCH:
+	case OST_SYNC:
+	case OST_CREATE:
+	case OST_DESTROY: {
+		struct ost_body	*body;
+		__u64		 valid;
+
+		body = lustre_msg_buf(msg, REQ_REC_OFF, sizeof(*body));
+		if (body == NULL)
+			return;
+
+		valid = swab ? __swab64(body->oa.o_valid) : body->oa.o_valid;
+		if (valid & OBD_MD_FLUID)
+			*uid = swab ? __swab32(body->oa.o_uid) : body->oa.o_uid;
+		if (valid & OBD_MD_FLGID)
+			*gid = swab ? __swab32(body->oa.o_gid) : body->oa.o_gid;
+		break;
+	}
+	case MDS_GETATTR:
+	case MDS_GETATTR_NAME:
+	case MDS_READPAGE:
+	case MDS_GETXATTR:
+	case MDS_SYNC: {
+		struct mdt_body *body;
+
+		body = lustre_msg_buf(msg, REQ_REC_OFF, sizeof(*body));
+		if (body == NULL)
+			return;
+
+		*uid = swab ? __swab32(body->mbo_fsuid) : body->mbo_fsuid;
+		*gid = swab ? __swab32(body->mbo_fsgid) : body->mbo_fsgid;
+		break;
+	}
+	case MDS_REINT: {
+		struct mdt_rec_reint *rec;
+
+		rec = lustre_msg_buf(msg, REQ_REC_OFF, sizeof(*rec));
+		if (rec == NULL)
+			return;
+
+		*uid = swab ? __swab32(rec->rr_fsuid) : rec->rr_fsuid;
+		*gid = swab ? __swab32(rec->rr_fsgid) : rec->rr_fsgid;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
 /** @} nrs */
@@ -0,0 +1,994 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.  A copy is
+ * included in the COPYING file that accompanied this code.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_edf.c
+ *
+ * Network Request Scheduler (NRS) Earliest Deadline First (EDF) policy
+ *
+ * Requests are sorted into classes by JobID, uid and RPC type; each class has a
+ * target queueing latency and an optional token bucket rate limit. Among the
+ * classes that have tokens, the request with the earliest deadline is handled
+ * first. Per-class queueing latency histograms are exported via lprocfs.
+ */
+
+#ifdef HAVE_SERVER_SUPPORT
+
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <obd_support.h>
+#include <obd_class.h>
+#include <libcfs/libcfs.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name edf
+ *
+ * Earliest Deadline First over JobID/uid/RPC type classes
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_EDF	"edf"
+#define NRS_EDF_CLASS_DEFAULT	"default"
+
+static int edf_deadline = 1000;
+module_param(edf_deadline, int, 0644);
+MODULE_PARM_DESC(edf_deadline, "Default class deadline in milliseconds");
+
+static int edf_depth = 3;
+module_param(edf_depth, int, 0644);
+MODULE_PARM_DESC(edf_depth, "How many tokens that a class can save up");
+
+static const char *nrs_edf_type_names[] = {
+	[NRS_EDF_RPC_ANY]	= "any",
+	[NRS_EDF_RPC_IO]	= "io",
+	[NRS_EDF_RPC_META]	= "meta",
+};
+
+static enum hrtimer_restart nrs_edf_timer_cb(struct hrtimer *timer)
+{
+	struct nrs_edf_head *head = container_of(timer, struct nrs_edf_head,
+						 eh_timer);
+	struct ptlrpc_nrs   *nrs = head->eh_res.res_policy->pol_nrs;
+	struct ptlrpc_service_part *svcpt = nrs->nrs_svcpt;
+
+	nrs->nrs_throttling = 0;
+	wake_up(&svcpt->scp_waitq);
+
+	return HRTIMER_NORESTART;
+}
+
+static void nrs_edf_class_set_rate(struct nrs_edf_class *cls, __u64 rate)
+{
+	cls->ec_rpc_rate = rate;
+	cls->ec_nsecs = 0;
+	if (rate != 0) {
+		cls->ec_nsecs = NSEC_PER_SEC;
+		do_div(cls->ec_nsecs, rate);
+	}
+	cls->ec_depth = edf_depth > 0 ? edf_depth : 1;
+	cls->ec_ntoken = cls->ec_depth;
+	cls->ec_check_time = ktime_to_ns(ktime_get());
+}
+
+static void nrs_edf_class_init(struct nrs_edf_class *cls, const char *name,
+			       const char *jobid, __u32 uid,
+			       enum nrs_edf_rpc_type type, __u32 deadline,
+			       __u64 rate)
+{
+	LASSERT(!cls->ec_used && cls->ec_queued == 0);
+
+	memset(cls, 0, sizeof(*cls));
+	strlcpy(cls->ec_name, name, sizeof(cls->ec_name));
+	if (jobid != NULL)
+		strlcpy(cls->ec_jobid, jobid, sizeof(cls->ec_jobid));
+	cls->ec_uid = uid;
+	cls->ec_type = type;
+	cls->ec_deadline = deadline;
+	INIT_LIST_HEAD(&cls->ec_list);
+	nrs_edf_class_set_rate(cls, rate);
+	cls->ec_used = true;
+}
+
+/**
+ * Returns the number of tokens class \a cls would have at time \a now; a
+ * class without a rate limit always has one.
+ */
+static __u64 nrs_edf_class_tokens(struct nrs_edf_class *cls, __u64 now)
+{
+	__u64 passed;
+	__u64 ntoken;
+
+	if (cls->ec_rpc_rate == 0)
+		return 1;
+
+	if (now <= cls->ec_check_time)
+		return cls->ec_ntoken;
+
+	passed = now - cls->ec_check_time;
+	if (passed >= cls->ec_nsecs * cls->ec_depth)
+		return cls->ec_depth;
+
+	ntoken = passed * cls->ec_rpc_rate;
+	do_div(ntoken, NSEC_PER_SEC);
+	ntoken += cls->ec_ntoken;
+
+	return min(ntoken, cls->ec_depth);
+}
+
+static bool nrs_edf_jobid_match(const char *pattern, const char *jobid)
+{
+	size_t len = strlen(pattern);
+
+	if (len == 0)
+		return true;
+	if (jobid == NULL)
+		return false;
+	if (pattern[len - 1] == '*')
+		return strncmp(pattern, jobid, len - 1) == 0;
+
+	return strncmp(pattern, jobid, LUSTRE_JOBID_SIZE) == 0;
+}
+
+static enum nrs_edf_rpc_type nrs_edf_req_type(struct ptlrpc_request *req)
+{
+	switch (lustre_msg_get_opc(req->rq_reqmsg)) {
+	case OST_READ:
+	case OST_WRITE:
+		return NRS_EDF_RPC_IO;
+	default:
+		return NRS_EDF_RPC_META;
+	}
+}
+
+/**
+ * Finds the class of request \a req; classes are tried in slot order, with
+ * the default class in slot 0 catching everything else.
+ *
+ * \pre spin_is_locked(&head->eh_lock)
+ */
+static unsigned int nrs_edf_classify(struct nrs_edf_head *head,
+				     struct ptlrpc_request *req)
+{
+	enum nrs_edf_rpc_type type = nrs_edf_req_type(req);
+	char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+	__u32 uid = NRS_UGID_NONE;
+	__u32 gid;
+	bool ugid_read = false;
+	unsigned int i;
+
+	for (i = 1; i < NRS_EDF_CLASS_MAX; i++) {
+		struct nrs_edf_class *cls = &head->eh_classes[i];
+
+		if (!cls->ec_used)
+			continue;
+		if (cls->ec_type != NRS_EDF_RPC_ANY && cls->ec_type != type)
+			continue;
+		if (cls->ec_uid != NRS_UGID_NONE) {
+			if (!ugid_read) {
+				nrs_req_ugid(req,
+					     lustre_msg_get_opc(req->rq_reqmsg),
+					     &uid, &gid);
+				ugid_read = true;
+			}
+			if (uid != cls->ec_uid)
+				continue;
+		}
+		if (nrs_edf_jobid_match(cls->ec_jobid, jobid))
+			return i;
+	}
+
+	return 0;
+}
+
+static struct nrs_edf_class *
+nrs_edf_class_find(struct nrs_edf_head *head, const char *name)
+{
+	int i;
+
+	for (i = 0; i < NRS_EDF_CLASS_MAX; i++) {
+		if (head->eh_classes[i].ec_used &&
+		    strcmp(head->eh_classes[i].ec_name, name) == 0)
+			return &head->eh_classes[i];
+	}
+
+	return NULL;
+}
+
+static void nrs_edf_class_dump(struct nrs_edf_class *cls, struct seq_file *m)
+{
+	__u64 avg = 0;
+	char uid[16] = "*";
+	int i;
+
+	if (cls->ec_started != 0) {
+		avg = cls->ec_wait_sum;
+		do_div(avg, cls->ec_started);
+	}
+	if (cls->ec_uid != NRS_UGID_NONE)
+		snprintf(uid, sizeof(uid), "%u", cls->ec_uid);
+
+	seq_printf(m, "%s {jobid=%s uid=%s type=%s} deadline=%u rate=%llu "
+		   "queued=%llu started=%llu missed=%llu wait_avg=%lluus "
+		   "wait_max=%lluus\n", cls->ec_name,
+		   cls->ec_jobid[0] != '\0' ? cls->ec_jobid : "*", uid,
+		   nrs_edf_type_names[cls->ec_type], cls->ec_deadline,
+		   cls->ec_rpc_rate, cls->ec_queued, cls->ec_started,
+		   cls->ec_missed, avg, cls->ec_wait_max);
+
+	seq_printf(m, "  hist_us:");
+	for (i = 0; i < NRS_EDF_HIST_MAX; i++) {
+		if (cls->ec_hist[i] == 0)
+			continue;
+		if (i == NRS_EDF_HIST_MAX - 1)
+			seq_printf(m, " inf:%llu", cls->ec_hist[i]);
+		else
+			seq_printf(m, " %lu:%llu", 1UL << i, cls->ec_hist[i]);
+	}
+	seq_printf(m, "\n");
+}
+
+enum nrs_edf_cmd_type {
+	NRS_EDF_CMD_START,
+	NRS_EDF_CMD_CHANGE,
+	NRS_EDF_CMD_STOP,
+};
+
+struct nrs_edf_cmd {
+	enum nrs_edf_cmd_type	 ec_cmd;
+	char			*ec_name;
+	char			*ec_jobid;
+	__u32			 ec_uid;
+	enum nrs_edf_rpc_type	 ec_type;
+	__u32			 ec_deadline;
+	__u64			 ec_rpc_rate;
+	bool			 ec_rate_set;
+};
+
+static int nrs_edf_command(struct nrs_edf_head *head, struct nrs_edf_cmd *cmd)
+{
+	struct nrs_edf_class	*cls;
+	int			 rc = 0;
+	int			 i;
+
+	spin_lock(&head->eh_lock);
+	cls = nrs_edf_class_find(head, cmd->ec_name);
+
+	switch (cmd->ec_cmd) {
+	case NRS_EDF_CMD_START:
+		if (cls != NULL)
+			GOTO(out, rc = -EEXIST);
+
+		for (i = 1; i < NRS_EDF_CLASS_MAX; i++) {
+			if (!head->eh_classes[i].ec_used)
+				break;
+		}
+		if (i == NRS_EDF_CLASS_MAX)
+			GOTO(out, rc = -ENOSPC);
+
+		nrs_edf_class_init(&head->eh_classes[i], cmd->ec_name,
+				   cmd->ec_jobid, cmd->ec_uid, cmd->ec_type,
+				   cmd->ec_deadline ? : edf_deadline,
+				   cmd->ec_rpc_rate);
+		break;
+	case NRS_EDF_CMD_CHANGE:
+		if (cls == NULL)
+			GOTO(out, rc = -ENOENT);
+
+		/* Only affects the deadline of requests arriving from now on */
+		if (cmd->ec_deadline != 0)
+			cls->ec_deadline = cmd->ec_deadline;
+		if (cmd->ec_rate_set)
+			nrs_edf_class_set_rate(cls, cmd->ec_rpc_rate);
+		break;
+	case NRS_EDF_CMD_STOP:
+		if (cls == NULL)
+			GOTO(out, rc = -ENOENT);
+		if (cls == &head->eh_classes[0])
+			GOTO(out, rc = -EPERM);
+		if (cls->ec_queued != 0)
+			GOTO(out, rc = -EBUSY);
+
+		cls->ec_used = false;
+		break;
+	default:
+		rc = -EINVAL;
+		break;
+	}
+out:
+	spin_unlock(&head->eh_lock);
+
+	return rc;
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes a
+ * policy-specific private data structure.
+ *
+ * \param[in] policy The policy to start
+ * \param[in] arg    Unused in this policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_edf_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_edf_head *head;
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		return -ENOMEM;
+
+	spin_lock_init(&head->eh_lock);
+	nrs_edf_class_init(&head->eh_classes[0], NRS_EDF_CLASS_DEFAULT, NULL,
+			   NRS_UGID_NONE, NRS_EDF_RPC_ANY, edf_deadline, 0);
+	hrtimer_init(&head->eh_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	head->eh_timer.function = nrs_edf_timer_cb;
+
+	policy->pol_private = head;
+	return 0;
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the policy-specific
+ * private data structure.
+ *
+ * \param[in] policy The policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_edf_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	struct ptlrpc_nrs *nrs = policy->pol_nrs;
+	int i;
+
+	LASSERT(head != NULL);
+	hrtimer_cancel(&head->eh_timer);
+	for (i = 0; i < NRS_EDF_CLASS_MAX; i++)
+		LASSERT(head->eh_classes[i].ec_queued == 0);
+
+	OBD_FREE_PTR(head);
+	nrs->nrs_throttling = 0;
+	wake_up(&policy->pol_nrs->nrs_svcpt->scp_waitq);
+}
+
+/**
+ * Performs a policy-specific ctl function on EDF policy instances; similar
+ * to ioctl.
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_edf_ctl(struct ptlrpc_nrs_policy *policy,
+		       enum ptlrpc_nrs_ctl opc,
+		       void *arg)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+	int rc = 0;
+	ENTRY;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_edf)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	/**
+	 * Read the classes and their statistics.
+	 */
+	case NRS_CTL_EDF_RD_CLASS: {
+		struct seq_file *m = (struct seq_file *) arg;
+		int i;
+
+		seq_printf(m, "CPT %d:\n", policy->pol_nrs->nrs_svcpt->scp_cpt);
+
+		spin_lock(&head->eh_lock);
+		for (i = 0; i < NRS_EDF_CLASS_MAX; i++) {
+			if (head->eh_classes[i].ec_used)
+				nrs_edf_class_dump(&head->eh_classes[i], m);
+		}
+		spin_unlock(&head->eh_lock);
+		}
+		break;
+
+	/**
+	 * Start, change or stop a class.
+	 */
+	case NRS_CTL_EDF_WR_CLASS:
+		rc = nrs_edf_command(head, (struct nrs_edf_cmd *)arg);
+		break;
+	}
+
+	RETURN(rc);
+}
+
+/**
+ * Is called for obtaining an EDF policy resource; all requests share the
+ * resource embedded in nrs_edf_head.
+ *
+ * \param[in]  policy	  The policy on which the request is being asked for
+ * \param[in]  nrq	  The request for which resources are being taken
+ * \param[in]  parent	  Parent resource, unused in this policy
+ * \param[out] resp	  Resources references are placed in this array
+ * \param[in]  moving_req Signifies limited caller context; unused in this
+ *			  policy
+ *
+ * \retval 1 The EDF policy only has a one-level resource hierarchy
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_edf_res_get(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq,
+			   const struct ptlrpc_nrs_resource *parent,
+			   struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	*resp = &((struct nrs_edf_head *)policy->pol_private)->eh_res;
+	return 1;
+}
+
+/**
+ * Accounts the queueing latency of request \a nrq taken for handling from
+ * class \a cls.
+ */
+static void nrs_edf_class_account(struct nrs_edf_class *cls,
+				  struct ptlrpc_nrs_request *nrq, __u64 now)
+{
+	__u64	wait = now - nrq->nr_u.edf.er_arrival;
+	int	idx;
+
+	do_div(wait, NSEC_PER_USEC);
+	idx = wait == 0 ? 0 : fls64(wait);
+	if (idx >= NRS_EDF_HIST_MAX)
+		idx = NRS_EDF_HIST_MAX - 1;
+
+	cls->ec_hist[idx]++;
+	cls->ec_started++;
+	cls->ec_wait_sum += wait;
+	if (wait > cls->ec_wait_max)
+		cls->ec_wait_max = wait;
+	if (now > nrq->nr_u.edf.er_deadline)
+		cls->ec_missed++;
+}
+
+/**
+ * Called when getting a request from the EDF policy for handling, or just
+ * peeking; removes the request from the policy when it is to be handled.
+ *
+ * The request with the earliest deadline among the classes that have tokens
+ * is chosen; if every class with queued requests is out of tokens, the head
+ * is throttled until the first of them gets one.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Force the policy to return a request, ignoring the rate
+ *		     limits
+ *
+ * \retval The request to be handled
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_edf_req_get(struct ptlrpc_nrs_policy *policy,
+					   bool peek, bool force)
+{
+	struct nrs_edf_head	  *head = policy->pol_private;
+	struct ptlrpc_nrs_request *nrq = NULL;
+	struct nrs_edf_class	  *best = NULL;
+	__u64			   now = ktime_to_ns(ktime_get());
+	__u64			   wakeup = 0;
+	int			   i;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	if (!peek && !force && policy->pol_nrs->nrs_throttling)
+		return NULL;
+
+	spin_lock(&head->eh_lock);
+	for (i = 0; i < NRS_EDF_CLASS_MAX; i++) {
+		struct nrs_edf_class	  *cls = &head->eh_classes[i];
+		struct ptlrpc_nrs_request *tmp;
+
+		if (list_empty(&cls->ec_list))
+			continue;
+
+		if (!peek && !force && nrs_edf_class_tokens(cls, now) == 0) {
+			__u64 next = cls->ec_check_time + cls->ec_nsecs;
+
+			if (wakeup == 0 || next < wakeup)
+				wakeup = next;
+			continue;
+		}
+
+		tmp = list_entry(cls->ec_list.next, struct ptlrpc_nrs_request,
+				 nr_u.edf.er_list);
+		if (nrq == NULL ||
+		    tmp->nr_u.edf.er_deadline < nrq->nr_u.edf.er_deadline ||
+		    (tmp->nr_u.edf.er_deadline == nrq->nr_u.edf.er_deadline &&
+		     tmp->nr_u.edf.er_sequence < nrq->nr_u.edf.er_sequence)) {
+			nrq = tmp;
+			best = cls;
+		}
+	}
+
+	if (peek)
+		goto out;
+
+	if (nrq != NULL) {
+		struct ptlrpc_request *req = container_of(nrq,
+							  struct ptlrpc_request,
+							  rq_nrq);
+
+		if (best->ec_rpc_rate != 0) {
+			__u64 ntoken = nrs_edf_class_tokens(best, now);
+
+			best->ec_ntoken = ntoken > 0 ? ntoken - 1 : 0;
+			best->ec_check_time = now;
+		}
+		list_del_init(&nrq->nr_u.edf.er_list);
+		best->ec_queued--;
+		nrs_edf_class_account(best, nrq, now);
+
+		CDEBUG(D_RPCTRACE, "NRS start %s request from %s, class %s, "
+		       "seq: %llu\n", policy->pol_desc->pd_name,
+		       libcfs_id2str(req->rq_peer), best->ec_name,
+		       nrq->nr_u.edf.er_sequence);
+	} else if (wakeup != 0) {
+		policy->pol_nrs->nrs_throttling = 1;
+		head->eh_timer_expires = wakeup;
+		hrtimer_start(&head->eh_timer, ns_to_ktime(wakeup),
+			      HRTIMER_MODE_ABS);
+	}
+out:
+	spin_unlock(&head->eh_lock);
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to its class' queue, which is kept sorted by deadline.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0 success; nrs_request_enqueue() assumes this function will always
+ *		      succeed
+ */
+static int nrs_edf_req_add(struct ptlrpc_nrs_policy *policy,
+			   struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head	*head = policy->pol_private;
+	struct ptlrpc_request	*req = container_of(nrq, struct ptlrpc_request,
+						    rq_nrq);
+	struct nrs_edf_req	*er = &nrq->nr_u.edf;
+	struct nrs_edf_class	*cls;
+	struct list_head	*pos;
+	__u64			 now = ktime_to_ns(ktime_get());
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	spin_lock(&head->eh_lock);
+	er->er_class = nrs_edf_classify(head, req);
+	cls = &head->eh_classes[er->er_class];
+
+	er->er_arrival = now;
+	er->er_deadline = now + (__u64)cls->ec_deadline * NSEC_PER_MSEC;
+	er->er_sequence = head->eh_sequence++;
+
+	/* Deadlines only go backwards here after a class change */
+	list_for_each_prev(pos, &cls->ec_list) {
+		struct ptlrpc_nrs_request *tmp;
+
+		tmp = list_entry(pos, struct ptlrpc_nrs_request,
+				 nr_u.edf.er_list);
+		if (tmp->nr_u.edf.er_deadline <= er->er_deadline)
+			break;
+	}
+	list_add(&er->er_list, pos);
+	cls->ec_queued++;
+
+	/* A class with tokens to spare may end the throttling early */
+	if (policy->pol_nrs->nrs_throttling) {
+		__u64 next = now;
+
+		if (nrs_edf_class_tokens(cls, now) == 0)
+			next = cls->ec_check_time + cls->ec_nsecs;
+
+		if (next < head->eh_timer_expires &&
+		    hrtimer_try_to_cancel(&head->eh_timer) >= 0) {
+			head->eh_timer_expires = next;
+			hrtimer_start(&head->eh_timer, ns_to_ktime(next),
+				      HRTIMER_MODE_ABS);
+		}
+	}
+	spin_unlock(&head->eh_lock);
+
+	return 0;
+}
+
+/**
+ * Removes request \a nrq from \a policy's list of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_edf_req_del(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_edf_head *head = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	LASSERT(!list_empty(&nrq->nr_u.edf.er_list));
+	spin_lock(&head->eh_lock);
+	list_del_init(&nrq->nr_u.edf.er_list);
+	head->eh_classes[nrq->nr_u.edf.er_class].ec_queued--;
+	spin_unlock(&head->eh_lock);
+}
+
+/**
+ * Prints a debug statement right before the request \a nrq stops being
+ * handled.
+ *
+ * \param[in] policy The policy handling the request
+ * \param[in] nrq    The request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_edf_req_stop(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	assert_spin_locked(&policy->pol_nrs->nrs_svcpt->scp_req_lock);
+
+	CDEBUG(D_RPCTRACE, "NRS stop %s request from %s, seq: %llu\n",
+	       policy->pol_desc->pd_name, libcfs_id2str(req->rq_peer),
+	       nrq->nr_u.edf.er_sequence);
+}
+
+#ifdef CONFIG_PROC_FS
+
+/**
+ * lprocfs interface
+ */
+
+/**
+ * The maximum RPC rate.
+ */
+#define LPROCFS_NRS_RATE_MAX		65535
+
+static int
+ptlrpc_lprocfs_nrs_edf_class_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	    *svc = m->private;
+	int			     rc;
+
+	seq_printf(m, "regular_requests:\n");
+	/**
+	 * Perform two separate calls to this as only one of the NRS heads'
+	 * policies may be in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED or
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
+	 */
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_CLASS,
+				       false, m);
+	if (rc == -ENOSPC)
+		return 0;
+	/**
+	 * Ignore -ENODEV as the regular NRS head's policy may be in the
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+	 */
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return rc;
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_RD_CLASS,
+				       false, m);
+	if (rc == -ENOSPC)
+		return 0;
+
+	return rc;
+}
+
+static bool nrs_edf_name_is_valid(const char *name)
+{
+	int i;
+
+	for (i = 0; i < strlen(name); i++) {
+		if ((!isalnum(name[i])) &&
+		    (name[i] != '_'))
+			return false;
+	}
+	return i > 0 && i < NRS_EDF_NAME_MAX;
+}
+
+static int
+nrs_edf_parse_value_pair(struct nrs_edf_cmd *cmd, char *buffer)
+{
+	char	*key;
+	char	*val;
+	__u64	 num;
+	int	 rc;
+
+	val = buffer;
+	key = strsep(&val, "=");
+	if (val == NULL || strlen(val) == 0)
+		return -EINVAL;
+
+	if (strcmp(key, "deadline") == 0) {
+		rc = kstrtoull(val, 10, &num);
+		if (rc)
+			return rc;
+		if (num == 0 || num > UINT_MAX)
+			return -EINVAL;
+		cmd->ec_deadline = num;
+	} else if (strcmp(key, "rate") == 0) {
+		rc = kstrtoull(val, 10, &num);
+		if (rc)
+			return rc;
+		if (num >= LPROCFS_NRS_RATE_MAX)
+			return -EINVAL;
+		cmd->ec_rpc_rate = num;
+		cmd->ec_rate_set = true;
+	} else if (strcmp(key, "jobid") == 0) {
+		if (cmd->ec_cmd != NRS_EDF_CMD_START ||
+		    strlen(val) >= LUSTRE_JOBID_SIZE)
+			return -EINVAL;
+		cmd->ec_jobid = val;
+	} else if (strcmp(key, "uid") == 0) {
+		if (cmd->ec_cmd != NRS_EDF_CMD_START)
+			return -EINVAL;
+		rc = kstrtoull(val, 10, &num);
+		if (rc)
+			return rc;
+		if (num >= NRS_UGID_NONE)
+			return -EINVAL;
+		cmd->ec_uid = num;
+	} else if (strcmp(key, "type") == 0) {
+		int i;
+
+		if (cmd->ec_cmd != NRS_EDF_CMD_START)
+			return -EINVAL;
+		for (i = 0; i < ARRAY_SIZE(nrs_edf_type_names); i++) {
+			if (strcmp(val, nrs_edf_type_names[i]) == 0)
+				break;
+		}
+		if (i == ARRAY_SIZE(nrs_edf_type_names))
+			return -EINVAL;
+		cmd->ec_type = i;
+	} else {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/**
+ * Parses "start <name> [jobid=<pattern>] [uid=<uid>] [type=any|io|meta]
+ * [deadline=<ms>] [rate=<rpcs>]", "change <name> [deadline=<ms>]
+ * [rate=<rpcs>]" and "stop <name>". The uid is the one nrs_req_ugid() finds
+ * in the request: the fsuid for MDS requests, the file owner for OST I/O.
+ */
+static int nrs_edf_parse_cmd(struct nrs_edf_cmd *cmd, char *buffer)
+{
+	char *token;
+	char *val = buffer;
+	int   rc;
+
+	token = strsep(&val, " ");
+	if (strcmp(token, "start") == 0)
+		cmd->ec_cmd = NRS_EDF_CMD_START;
+	else if (strcmp(token, "change") == 0)
+		cmd->ec_cmd = NRS_EDF_CMD_CHANGE;
+	else if (strcmp(token, "stop") == 0)
+		cmd->ec_cmd = NRS_EDF_CMD_STOP;
+	else
+		return -EINVAL;
+
+	if (val == NULL)
+		return -EINVAL;
+	token = strsep(&val, " ");
+	if (!nrs_edf_name_is_valid(token))
+		return -EINVAL;
+	cmd->ec_name = token;
+	cmd->ec_uid = NRS_UGID_NONE;
+
+	while (val != NULL && strlen(val) != 0) {
+		token = strsep(&val, " ");
+		if (strlen(token) == 0)
+			continue;
+		if (cmd->ec_cmd == NRS_EDF_CMD_STOP)
+			return -EINVAL;
+		rc = nrs_edf_parse_value_pair(cmd, token);
+		if (rc)
+			return rc;
+	}
+
+	if (cmd->ec_cmd == NRS_EDF_CMD_CHANGE &&
+	    cmd->ec_deadline == 0 && !cmd->ec_rate_set)
+		return -EINVAL;
+
+	return 0;
+}
+
+extern struct nrs_core nrs_core;
+#define LPROCFS_WR_NRS_EDF_MAX_CMD (256)
+static ssize_t
+ptlrpc_lprocfs_nrs_edf_class_seq_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *off)
+{
+	struct seq_file		  *m = file->private_data;
+	struct ptlrpc_service	  *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_BOTH;
+	struct nrs_edf_cmd	   cmd = { 0 };
+	char			   kernbuf[LPROCFS_WR_NRS_EDF_MAX_CMD];
+	char			  *val;
+	char			  *token;
+	int			   rc;
+
+	if (count > sizeof(kernbuf) - 1)
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+	if (count > 0 && kernbuf[count - 1] == '\n')
+		kernbuf[count - 1] = '\0';
+
+	val = kernbuf;
+	token = strsep(&val, " ");
+	if (val == NULL)
+		return -EINVAL;
+
+	if (strcmp(token, "reg") == 0) {
+		queue = PTLRPC_NRS_QUEUE_REG;
+	} else if (strcmp(token, "hp") == 0) {
+		queue = PTLRPC_NRS_QUEUE_HP;
+	} else {
+		kernbuf[strlen(token)] = ' ';
+		val = kernbuf;
+	}
+
+	if (queue == PTLRPC_NRS_QUEUE_HP && !nrs_svc_has_hp(svc))
+		return -ENODEV;
+	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+	rc = nrs_edf_parse_cmd(&cmd, val);
+	if (rc)
+		return rc;
+
+	/**
+	 * Serialize NRS core lprocfs operations with policy registration/
+	 * unregistration.
+	 */
+	mutex_lock(&nrs_core.nrs_mutex);
+	rc = ptlrpc_nrs_policy_control(svc, queue,
+				       NRS_POL_NAME_EDF,
+				       NRS_CTL_EDF_WR_CLASS,
+				       false, &cmd);
+	mutex_unlock(&nrs_core.nrs_mutex);
+
+	return rc ? rc : count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_edf_class);
+
+/**
+ * Initializes an EDF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_edf_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_edf_lprocfs_vars[] = {
+		{ .name		= "nrs_edf_class",
+		  .fops		= &ptlrpc_lprocfs_nrs_edf_class_fops,
+		  .data = svc },
+		{ NULL }
+	};
+
+	if (svc->srv_procroot == NULL)
+		return 0;
+
+	return lprocfs_add_vars(svc->srv_procroot, nrs_edf_lprocfs_vars, NULL);
+}
+
+/**
+ * Cleans up an EDF policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ */
+static void nrs_edf_lprocfs_fini(struct ptlrpc_service *svc)
+{
+	if (svc->srv_procroot == NULL)
+		return;
+
+	lprocfs_remove_proc_entry("nrs_edf_class", svc->srv_procroot);
+}
+
+#endif /* CONFIG_PROC_FS */
+
+/**
+ * EDF policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_edf_ops = {
+	.op_policy_start	= nrs_edf_start,
+	.op_policy_stop		= nrs_edf_stop,
+	.op_policy_ctl		= nrs_edf_ctl,
+	.op_res_get		= nrs_edf_res_get,
+	.op_req_get		= nrs_edf_req_get,
+	.op_req_enqueue		= nrs_edf_req_add,
+	.op_req_dequeue		= nrs_edf_req_del,
+	.op_req_stop		= nrs_edf_req_stop,
+#ifdef CONFIG_PROC_FS
+	.op_lprocfs_init	= nrs_edf_lprocfs_init,
+	.op_lprocfs_fini	= nrs_edf_lprocfs_fini,
+#endif
+};
+
+/**
+ * EDF policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_edf = {
+	.nc_name		= NRS_POL_NAME_EDF,
+	.nc_ops			= &nrs_edf_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} edf */
+
+/** @} nrs */
+
+#endif /* HAVE_SERVER_SUPPORT */
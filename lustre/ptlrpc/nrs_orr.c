@@ -206,47 +206,137 @@ static void nrs_orr_range_fill_logical(struct niobuf_remote *nb, int niocount,
 }
 
 /**
- * We obtain information just for a single extent, as the request can only be in
- * a single place in the binary heap anyway.
+ * We obtain information just for a single extent when there is no extent
+ * cache, as the request can only be in a single place in the binary heap
+ * anyway.
  */
 #define ORR_NUM_EXTENTS 1
 
+/**
+ * Logical span asked from fiemap when filling an object's extent cache, so
+ * that subsequent requests for the object are likely to hit the cache.
+ */
+#define NRS_ORR_EXT_SPAN	(64ULL << 20)
+
+/**
+ * Maps the logical range in \a range to physical disk offsets using the
+ * extents cached for object \a orro.
+ *
+ * \retval true  \a range starts within a cached extent, and has been mapped
+ * \retval false \a range has not been changed
+ */
+static bool nrs_orr_extent_lookup(struct nrs_orr_object *orro,
+				  struct nrs_orr_req_range *range)
+{
+	struct nrs_orr_extent	*ext;
+	bool			 found = false;
+	int			 i;
+
+	spin_lock(&orro->oo_ext_lock);
+	for (i = 0; i < orro->oo_nextents; i++) {
+		ext = &orro->oo_extents[i];
+		if (range->or_start >= ext->oe_logical &&
+		    range->or_start < ext->oe_logical + ext->oe_length) {
+			__u64 start = ext->oe_physical + range->or_start -
+				      ext->oe_logical;
+
+			range->or_end = start + range->or_end - range->or_start;
+			range->or_start = start;
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&orro->oo_ext_lock);
+
+	return found;
+}
+
+/**
+ * Replaces the extent cache of object \a orro with the mapped extents in
+ * \a fiemap.
+ */
+static void nrs_orr_extent_fill(struct nrs_orr_object *orro,
+				struct fiemap *fiemap)
+{
+	struct fiemap_extent	*fe;
+	int			 i;
+	int			 n = 0;
+
+	spin_lock(&orro->oo_ext_lock);
+	for (i = 0; i < fiemap->fm_mapped_extents &&
+		    i < NRS_ORR_EXT_CACHE; i++) {
+		fe = &fiemap->fm_extents[i];
+		if (fe->fe_flags & (FIEMAP_EXTENT_UNKNOWN |
+				    FIEMAP_EXTENT_DELALLOC))
+			continue;
+
+		orro->oo_extents[n].oe_logical = fe->fe_logical;
+		orro->oo_extents[n].oe_physical = fe->fe_physical;
+		orro->oo_extents[n].oe_length = fe->fe_length;
+		n++;
+	}
+	orro->oo_nextents = n;
+	spin_unlock(&orro->oo_ext_lock);
+}
+
 /**
  * Converts the logical file offset range in \a range, to a physical disk offset
  * range in \a range, for a request. Uses obd_get_info() in order to carry out a
  * fiemap call and obtain backend-fs extent information. The returned range is
  * in physical block numbers.
  *
- * \param[in]	  nrq	the request
- * \param[in]	  oa	obdo struct for this request
- * \param[in,out] range	the offset range in bytes; logical range in, physical
- *			range out
+ * For ORR, the extents following the request's offset are cached in the
+ * object, and later requests for the object are mapped from the cache.
+ *
+ * \param[in]	  nrq	     the request
+ * \param[in]	  orro	     the ORR object of the request, or NULL for TRR
+ * \param[in]	  oa	     obdo struct for this request
+ * \param[in,out] range	     the offset range in bytes; logical range in,
+ *			     physical range out
+ * \param[in]	  moving_req the request is being moved to the high-priority
+ *			     NRS head, so only the extent cache can be used
  *
  * \retval 0	physical offsets obtained successfully
  * \retvall < 0 error
  */
 static int nrs_orr_range_fill_physical(struct ptlrpc_nrs_request *nrq,
+				       struct nrs_orr_object *orro,
 				       struct obdo *oa,
-				       struct nrs_orr_req_range *range)
+				       struct nrs_orr_req_range *range,
+				       bool moving_req)
 {
 	struct ptlrpc_request     *req = container_of(nrq,
 						      struct ptlrpc_request,
 						      rq_nrq);
 	char			   fiemap_buf[offsetof(struct fiemap,
-						  fm_extents[ORR_NUM_EXTENTS])];
+						  fm_extents[NRS_ORR_EXT_CACHE])];
 	struct fiemap              *fiemap = (struct fiemap *)fiemap_buf;
 	struct ll_fiemap_info_key  key;
+	__u64			   length = range->or_end - range->or_start;
 	loff_t			   start;
 	loff_t			   end;
 	int			   rc;
 
+	if (orro != NULL && nrs_orr_extent_lookup(orro, range))
+		GOTO(out_set, rc = 0);
+
+	/**
+	 * obd_get_info() may sleep, and ldlm_lock_reorder_req() calls in here
+	 * while holding a spinlock.
+	 */
+	if (moving_req)
+		GOTO(out, rc = -EAGAIN);
+
 	key = (typeof(key)) {
 		.lfik_name = KEY_FIEMAP,
 		.lfik_oa = *oa,
 		.lfik_fiemap = {
 			.fm_start = range->or_start,
-			.fm_length = range->or_end - range->or_start,
-			.fm_extent_count = ORR_NUM_EXTENTS
+			.fm_length = orro != NULL ?
+				     max_t(__u64, length, NRS_ORR_EXT_SPAN) :
+				     length,
+			.fm_extent_count = orro != NULL ? NRS_ORR_EXT_CACHE :
+							  ORR_NUM_EXTENTS
 		}
 	};
 
@@ -256,9 +346,16 @@ static int nrs_orr_range_fill_physical(struct ptlrpc_nrs_request *nrq,
 		GOTO(out, rc);
 
 	if (fiemap->fm_mapped_extents == 0 ||
-	    fiemap->fm_mapped_extents > ORR_NUM_EXTENTS)
+	    fiemap->fm_mapped_extents > key.lfik_fiemap.fm_extent_count)
 		GOTO(out, rc = -EFAULT);
 
+	if (orro != NULL) {
+		nrs_orr_extent_fill(orro, fiemap);
+		if (!nrs_orr_extent_lookup(orro, range))
+			GOTO(out, rc = -ENODATA);
+		GOTO(out_set, rc = 0);
+	}
+
 	/**
 	 * Calculate the physical offset ranges for the request from the extent
 	 * information and the logical request offsets.
@@ -269,7 +366,7 @@ static int nrs_orr_range_fill_physical(struct ptlrpc_nrs_request *nrq,
 
 	range->or_start = start;
 	range->or_end = end;
-
+out_set:
 	nrq->nr_u.orr.or_physical_set = 1;
 out:
 	return rc;
@@ -281,6 +378,7 @@ out:
  *
  * \param[in] nrq	 the request
  * \param[in] orrd	 the ORR/TRR policy scheduler instance
+ * \param[in] orro	 the ORR object of the request, or NULL for TRR
  * \param[in] opc	 the request's opcode
  * \param[in] moving_req is the request in the process of moving onto the
  *			 high-priority NRS head?
@@ -289,7 +387,8 @@ out:
  * \retval != 0 error
  */
 static int nrs_orr_range_fill(struct ptlrpc_nrs_request *nrq,
-			      struct nrs_orr_data *orrd, __u32 opc,
+			      struct nrs_orr_data *orrd,
+			      struct nrs_orr_object *orro, __u32 opc,
 			      bool moving_req)
 {
 	struct ptlrpc_request	    *req = container_of(nrq,
@@ -307,11 +406,7 @@ static int nrs_orr_range_fill(struct ptlrpc_nrs_request *nrq,
 	 * the offset information in the request previously
 	 * (i.e. ldlm_lock_reorder_req() is moving the request to the
 	 * high-priority NRS head), there is no need to do anything, and we can
-	 * exit. Moreover than the lack of need, we would be unable to perform
-	 * the obd_get_info() call required in nrs_orr_range_fill_physical(),
-	 * because ldlm_lock_reorder_lock() calls into here while holding a
-	 * spinlock, and retrieving fiemap information via obd_get_info() is a
-	 * potentially sleeping operation.
+	 * exit.
 	 */
 	if (orrd->od_physical && nrq->nr_u.orr.or_physical_set)
 		return 0;
@@ -332,14 +427,13 @@ static int nrs_orr_range_fill(struct ptlrpc_nrs_request *nrq,
 	nrs_orr_range_fill_logical(nb, niocount, &range);
 
 	/**
-	 * Obtain physical offsets if selected, and this is an OST_READ RPC
-	 * RPC. We do not enter this block if moving_req is set which indicates
-	 * that the request is being moved to the high-priority NRS head by
-	 * ldlm_lock_reorder_req(), as that function calls in here while holding
-	 * a spinlock, and nrs_orr_range_physical() can sleep, so we just use
-	 * logical file offsets for the range values for such requests.
+	 * Obtain physical offsets if selected, and this is an OST_READ RPC.
+	 * If moving_req is set, which indicates that the request is being
+	 * moved to the high-priority NRS head by ldlm_lock_reorder_req(), only
+	 * the object's extent cache is consulted, as that function calls in
+	 * here while holding a spinlock.
 	 */
-	if (orrd->od_physical && opc == OST_READ && !moving_req) {
+	if (orrd->od_physical && opc == OST_READ) {
 		body = req_capsule_client_get(&req->rq_pill, &RMF_OST_BODY);
 		if (body == NULL)
 			GOTO(out, rc = -EFAULT);
@@ -350,7 +444,8 @@ static int nrs_orr_range_fill(struct ptlrpc_nrs_request *nrq,
 		 * Ignore return values; if obtaining the physical offsets
 		 * fails, use the logical offsets.
 		 */
-		nrs_orr_range_fill_physical(nrq, &body->oa, &range);
+		nrs_orr_range_fill_physical(nrq, orro, &body->oa, &range,
+					    moving_req);
 	}
 
 	nrq->nr_u.orr.or_range = range;
@@ -833,6 +928,7 @@ static int nrs_orr_res_get(struct ptlrpc_nrs_policy *policy,
 	struct nrs_orr_object	       *tmp;
 	struct nrs_orr_key		key = { { { 0 } } };
 	__u32				opc;
+	bool				is_orr;
 	int				rc = 0;
 
 	/**
@@ -860,13 +956,6 @@ static int nrs_orr_res_get(struct ptlrpc_nrs_policy *policy,
 	if (rc < 0)
 		RETURN(rc);
 
-	/**
-	 * Set the offset range the request covers
-	 */
-	rc = nrs_orr_range_fill(nrq, orrd, opc, moving_req);
-	if (rc < 0)
-		RETURN(rc);
-
 	orro = cfs_hash_lookup(orrd->od_obj_hash, &key);
 	if (orro != NULL)
 		goto out;
@@ -879,6 +968,7 @@ static int nrs_orr_res_get(struct ptlrpc_nrs_policy *policy,
 
 	orro->oo_key = key;
 	orro->oo_ref = 1;
+	spin_lock_init(&orro->oo_ext_lock);
 
 	tmp = cfs_hash_findadd_unique(orrd->od_obj_hash, &orro->oo_key,
 				      &orro->oo_hnode);
@@ -887,6 +977,19 @@ static int nrs_orr_res_get(struct ptlrpc_nrs_policy *policy,
 		orro = tmp;
 	}
 out:
+	/**
+	 * Set the offset range the request covers; only ORR objects cache
+	 * extents, as TRR objects stand for a whole OST.
+	 */
+	is_orr = strncmp(policy->pol_desc->pd_name, NRS_POL_NAME_ORR,
+			 NRS_POL_NAME_MAX) == 0;
+	rc = nrs_orr_range_fill(nrq, orrd, is_orr ? orro : NULL, opc,
+				moving_req);
+	if (rc < 0) {
+		cfs_hash_put(orrd->od_obj_hash, &orro->oo_hnode);
+		RETURN(rc);
+	}
+
 	/**
 	 * For debugging purposes
 	 */
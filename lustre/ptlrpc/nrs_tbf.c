@@ -88,6 +88,8 @@ static void nrs_tbf_rule_fini(struct nrs_tbf_rule *rule)
 	LASSERT(list_empty(&rule->tr_linkage));
 
 	rule->tr_head->th_ops->o_rule_fini(rule);
+	if (rule->tr_parent != NULL)
+		nrs_tbf_rule_put(rule->tr_parent);
 	OBD_FREE_PTR(rule);
 }
 
@@ -111,6 +113,130 @@ static inline void nrs_tbf_rule_get(struct nrs_tbf_rule *rule)
 	atomic_inc(&rule->tr_ref);
 }
 
+/**
+ * Returns the number of tokens in a bucket holding \a ntoken tokens at
+ * \a check_time, refilled at \a rate up to \a depth.
+ */
+static __u64 nrs_tbf_tokens(__u64 now, __u64 check_time, __u64 ntoken,
+			    __u64 rate, __u64 depth)
+{
+	__u64 passed;
+
+	if (now <= check_time)
+		return ntoken;
+
+	passed = now - check_time;
+	/* Full anyway, and the product below could overflow */
+	if (passed >= NSEC_PER_SEC * depth)
+		return depth;
+
+	passed *= rate;
+	do_div(passed, NSEC_PER_SEC);
+	ntoken += passed;
+
+	return min(ntoken, depth);
+}
+
+/**
+ * Takes a token from the pools of \a rule and of its ancestors, if they
+ * have any, so that only the capacity left unused is lent to child rules.
+ */
+static void nrs_tbf_rule_charge(struct nrs_tbf_rule *rule, __u64 now)
+{
+	__u64 ntoken;
+
+	for (; rule != NULL; rule = rule->tr_parent) {
+		ntoken = nrs_tbf_tokens(now, rule->tr_check_time,
+					rule->tr_ntoken, rule->tr_rpc_rate,
+					rule->tr_depth);
+		rule->tr_ntoken = ntoken > 0 ? ntoken - 1 : 0;
+		rule->tr_check_time = now;
+	}
+}
+
+/**
+ * Charges a request \a cli handled with its own token to the pools of its
+ * rule hierarchy.
+ */
+static void nrs_tbf_cli_charge(struct nrs_tbf_client *cli, __u64 now)
+{
+	struct nrs_tbf_rule *rule = cli->tc_rule;
+
+	if (rule->tr_parent == NULL && rule->tr_nchildren == 0)
+		return;
+
+	nrs_tbf_rule_charge(rule, now);
+}
+
+/**
+ * Returns the time client \a cli is due to be served, which orders the
+ * clients in the heap.
+ */
+static inline __u64 nrs_tbf_cli_deadline(struct nrs_tbf_client *cli)
+{
+	return max(cli->tc_check_time + cli->tc_nsecs,
+		   cli->tc_borrow_deadline);
+}
+
+/**
+ * Tries to borrow a token for client \a cli, which has run out of its own,
+ * from the nearest ancestor of its rule that has unused tokens. Like the
+ * ceiling of an HTB class, the ceiling of the rule caps what its clients
+ * borrow together: at most tr_ceil_rate - tr_rpc_rate tokens per second.
+ *
+ * \param[out] next when borrowing fails, the time a token may be lent, or 0
+ *
+ * \retval true a token was borrowed
+ */
+static bool nrs_tbf_cli_borrow(struct nrs_tbf_client *cli, __u64 now,
+			       __u64 *next)
+{
+	struct nrs_tbf_rule	*rule = cli->tc_rule;
+	struct nrs_tbf_rule	*parent;
+	__u64			 rate;
+	__u64			 ceil;
+	__u64			 pool = 0;
+
+	*next = 0;
+	if (rule->tr_parent == NULL || rule->tr_ceil_rate <= rule->tr_rpc_rate)
+		return false;
+
+	rate = rule->tr_ceil_rate - rule->tr_rpc_rate;
+	ceil = nrs_tbf_tokens(now, rule->tr_ceil_check_time,
+			      rule->tr_ceil_ntoken, rate, rule->tr_depth);
+	if (ceil == 0) {
+		*next = NSEC_PER_SEC;
+		do_div(*next, rate);
+		*next += rule->tr_ceil_check_time;
+		return false;
+	}
+
+	for (parent = rule->tr_parent; parent != NULL;
+	     parent = parent->tr_parent) {
+		pool = nrs_tbf_tokens(now, parent->tr_check_time,
+				      parent->tr_ntoken, parent->tr_rpc_rate,
+				      parent->tr_depth);
+		if (pool > 0)
+			break;
+		if (*next == 0 ||
+		    parent->tr_check_time + parent->tr_nsecs < *next)
+			*next = parent->tr_check_time + parent->tr_nsecs;
+	}
+	if (parent == NULL)
+		return false;
+
+	rule->tr_ceil_ntoken = ceil - 1;
+	rule->tr_ceil_check_time = now;
+	parent->tr_ntoken = pool - 1;
+	parent->tr_check_time = now;
+	nrs_tbf_rule_charge(parent->tr_parent, now);
+
+	/* Its own deadline hasn't moved, let the other clients go first */
+	cli->tc_borrow_deadline = now + cli->tc_nsecs;
+
+	return true;
+}
+
 static void
 nrs_tbf_cli_rule_put(struct nrs_tbf_client *cli)
 {
@@ -135,6 +261,7 @@ nrs_tbf_cli_reset_value(struct nrs_tbf_head *head,
 	cli->tc_depth = rule->tr_depth;
 	cli->tc_ntoken = rule->tr_depth;
 	cli->tc_check_time = ktime_to_ns(ktime_get());
+	cli->tc_borrow_deadline = 0;
 	cli->tc_rule_sequence = atomic_read(&head->th_rule_sequence);
 	cli->tc_rule_generation = rule->tr_generation;
 
@@ -167,7 +294,13 @@ nrs_tbf_cli_reset(struct nrs_tbf_head *head,
 static int
 nrs_tbf_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
 {
-	return rule->tr_head->th_ops->o_rule_dump(rule, m);
+	int rc;
+
+	rc = rule->tr_head->th_ops->o_rule_dump(rule, m);
+	if (rc == 0 && rule->tr_parent != NULL)
+		seq_printf(m, "    parent %s, ceil %llu\n",
+			   rule->tr_parent->tr_name, rule->tr_ceil_rate);
+	return rc;
 }
 
 static int
@@ -284,7 +417,9 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	struct nrs_tbf_rule	*rule;
 	struct nrs_tbf_rule	*tmp_rule;
 	struct nrs_tbf_rule	*next_rule;
+	struct nrs_tbf_rule	*parent_rule = NULL;
 	char			*next_name = start->u.tc_start.ts_next_name;
+	char			*parent_name = start->u.tc_start.ts_parent_name;
 	int			 rc;
 
 	rule = nrs_tbf_rule_find(head, start->tc_name);
@@ -302,6 +437,11 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 	rule->tr_nsecs = NSEC_PER_SEC;
 	do_div(rule->tr_nsecs, rule->tr_rpc_rate);
 	rule->tr_depth = tbf_depth;
+	rule->tr_ntoken = rule->tr_depth;
+	rule->tr_check_time = ktime_to_ns(ktime_get());
+	rule->tr_ceil_rate = start->u.tc_start.ts_ceil_rate;
+	rule->tr_ceil_ntoken = rule->tr_depth;
+	rule->tr_ceil_check_time = rule->tr_check_time;
 	atomic_set(&rule->tr_ref, 1);
 	INIT_LIST_HEAD(&rule->tr_cli_list);
 	INIT_LIST_HEAD(&rule->tr_nids);
@@ -325,6 +465,22 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		return -EEXIST;
 	}
 
+	if (parent_name) {
+		/* The reference is kept by the rule, see nrs_tbf_rule_fini() */
+		parent_rule = nrs_tbf_rule_find_nolock(head, parent_name);
+		if (!parent_rule) {
+			spin_unlock(&head->th_rule_lock);
+			nrs_tbf_rule_put(rule);
+			return -ENOENT;
+		}
+		rule->tr_parent = parent_rule;
+		if (rule->tr_ceil_rate == 0) {
+			/* the parent's rate, but never below the rule's */
+			rule->tr_ceil_rate = max(parent_rule->tr_rpc_rate,
+						 rule->tr_rpc_rate);
+		}
+	}
+
 	if (next_name) {
 		next_rule = nrs_tbf_rule_find_nolock(head, next_name);
 		if (!next_rule) {
@@ -339,6 +495,8 @@ nrs_tbf_rule_start(struct ptlrpc_nrs_policy *policy,
 		/* Add on the top of the rule list */
 		list_add(&rule->tr_linkage, &head->th_list);
 	}
+	if (parent_rule)
+		parent_rule->tr_nchildren++;
 	spin_unlock(&head->th_rule_lock);
 	atomic_inc(&head->th_rule_sequence);
 	if (start->u.tc_start.ts_rule_flags & NTRS_DEFAULT) {
@@ -419,15 +577,67 @@ nrs_tbf_rule_change_rate(struct ptlrpc_nrs_policy *policy,
 	return 0;
 }
 
+static int
+nrs_tbf_rule_change_ceil(struct ptlrpc_nrs_policy *policy,
+			 struct nrs_tbf_head *head,
+			 char *name,
+			 __u64 ceil)
+{
+	struct nrs_tbf_rule *rule;
+	int rc = 0;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	rule = nrs_tbf_rule_find(head, name);
+	if (rule == NULL)
+		return -ENOENT;
+
+	if (rule->tr_parent == NULL)
+		GOTO(out, rc = -EINVAL);
+
+	rule->tr_ceil_rate = ceil;
+	rule->tr_generation++;
+out:
+	nrs_tbf_rule_put(rule);
+
+	return rc;
+}
+
 static int
 nrs_tbf_rule_change(struct ptlrpc_nrs_policy *policy,
 		    struct nrs_tbf_head *head,
 		    struct nrs_tbf_cmd *change)
 {
 	__u64	 rate = change->u.tc_change.tc_rpc_rate;
+	__u64	 ceil = change->u.tc_change.tc_ceil_rate;
 	char	*next_name = change->u.tc_change.tc_next_name;
 	int	 rc;
 
+	if ((rate != 0) != (ceil != 0)) {
+		struct nrs_tbf_rule *rule;
+
+		rule = nrs_tbf_rule_find(head, change->tc_name);
+		if (rule == NULL)
+			return -ENOENT;
+
+		/* the ceiling of a child rule can't go below its rate */
+		rc = 0;
+		if (rule->tr_parent != NULL &&
+		    (ceil != 0 ? ceil < rule->tr_rpc_rate :
+				 rate > rule->tr_ceil_rate))
+			rc = -EINVAL;
+		nrs_tbf_rule_put(rule);
+		if (rc)
+			return rc;
+	}
+
+	if (ceil != 0) {
+		rc = nrs_tbf_rule_change_ceil(policy, head, change->tc_name,
+					      ceil);
+		if (rc)
+			return rc;
+	}
+
 	if (rate != 0) {
 		rc = nrs_tbf_rule_change_rate(policy, head, change->tc_name,
 					      rate);
@@ -457,12 +667,25 @@ nrs_tbf_rule_stop(struct ptlrpc_nrs_policy *policy,
 	if (strcmp(stop->tc_name, NRS_TBF_DEFAULT_RULE) == 0)
 		return -EPERM;
 
-	rule = nrs_tbf_rule_find(head, stop->tc_name);
-	if (rule == NULL)
+	spin_lock(&head->th_rule_lock);
+	rule = nrs_tbf_rule_find_nolock(head, stop->tc_name);
+	if (rule == NULL) {
+		spin_unlock(&head->th_rule_lock);
 		return -ENOENT;
+	}
 
+	/* Children keep borrowing from their parent */
+	if (rule->tr_nchildren > 0) {
+		spin_unlock(&head->th_rule_lock);
+		nrs_tbf_rule_put(rule);
+		return -EBUSY;
+	}
+
+	if (rule->tr_parent != NULL)
+		rule->tr_parent->tr_nchildren--;
 	list_del_init(&rule->tr_linkage);
 	rule->tr_flags |= NTRS_STOPPING;
+	spin_unlock(&head->th_rule_lock);
 	nrs_tbf_rule_put(rule);
 	nrs_tbf_rule_put(rule);
 
@@ -517,11 +740,9 @@ tbf_cli_compare(struct cfs_binheap_node *e1, struct cfs_binheap_node *e2)
 	cli1 = container_of(e1, struct nrs_tbf_client, tc_node);
 	cli2 = container_of(e2, struct nrs_tbf_client, tc_node);
 
-	if (cli1->tc_check_time + cli1->tc_nsecs <
-	    cli2->tc_check_time + cli2->tc_nsecs)
+	if (nrs_tbf_cli_deadline(cli1) < nrs_tbf_cli_deadline(cli2))
 		return 1;
-	else if (cli1->tc_check_time + cli1->tc_nsecs >
-		 cli2->tc_check_time + cli2->tc_nsecs)
+	else if (nrs_tbf_cli_deadline(cli1) > nrs_tbf_cli_deadline(cli2))
 		return 0;
 
 	if (cli1->tc_check_time < cli2->tc_check_time)
@@ -690,7 +911,7 @@ nrs_tbf_jobid_cli_put(struct nrs_tbf_head *head,
 	struct list_head	zombies;
 
 	INIT_LIST_HEAD(&zombies);
-	cfs_hash_bd_get(hs, &cli->tc_jobid, &bd);
+	cfs_hash_bd_get(hs, cfs_hash_key(hs, &cli->tc_hnode), &bd);
 	bkt = cfs_hash_bd_extra_get(hs, &bd);
 	if (!cfs_hash_bd_dec_and_lock(hs, &bd, &cli->tc_ref))
 		return;
@@ -1229,6 +1450,574 @@ static struct nrs_tbf_ops nrs_tbf_nid_ops = {
 	.o_rule_fini = nrs_tbf_nid_rule_fini,
 };
 
+/**
+ * Generic TBF type: rules are expressions over NID, JobID, opcode, uid and
+ * gid, e.g. "opcode={ost_write}&uid={500 1000-1010},jobid={dd.0}". Rules are
+ * parsed into lists of conjunctions when they are added, and matched once
+ * per client; a client is the combination of all of these fields, so it
+ * is kept in an LRU hash like the JobID clients.
+ */
+static void nrs_tbf_generic_key(struct ptlrpc_request *req, char *key,
+				__u32 *opcode, __u32 *uid, __u32 *gid)
+{
+	char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+
+	if (jobid == NULL)
+		jobid = NRS_TBF_JOBID_NULL;
+	*opcode = lustre_msg_get_opc(req->rq_reqmsg);
+	nrs_req_ugid(req, *opcode, uid, gid);
+
+	snprintf(key, NRS_TBF_KEY_LEN, "%.*s_%llx_%u_%u_%u",
+		 LUSTRE_JOBID_SIZE, jobid, req->rq_peer.nid, *opcode,
+		 *uid, *gid);
+}
+
+static unsigned nrs_tbf_generic_hop_hash(struct cfs_hash *hs, const void *key,
+					 unsigned mask)
+{
+	return cfs_hash_djb2_hash(key, strlen(key), mask);
+}
+
+static int nrs_tbf_generic_hop_keycmp(const void *key, struct hlist_node *hnode)
+{
+	struct nrs_tbf_client *cli = hlist_entry(hnode,
+						 struct nrs_tbf_client,
+						 tc_hnode);
+
+	return (strcmp(cli->tc_key, key) == 0);
+}
+
+static void *nrs_tbf_generic_hop_key(struct hlist_node *hnode)
+{
+	struct nrs_tbf_client *cli = hlist_entry(hnode,
+						 struct nrs_tbf_client,
+						 tc_hnode);
+
+	return cli->tc_key;
+}
+
+static struct cfs_hash_ops nrs_tbf_generic_hash_ops = {
+	.hs_hash	= nrs_tbf_generic_hop_hash,
+	.hs_keycmp	= nrs_tbf_generic_hop_keycmp,
+	.hs_key		= nrs_tbf_generic_hop_key,
+	.hs_object	= nrs_tbf_jobid_hop_object,
+	.hs_get		= nrs_tbf_jobid_hop_get,
+	.hs_put		= nrs_tbf_jobid_hop_put,
+	.hs_put_locked	= nrs_tbf_jobid_hop_put,
+	.hs_exit	= nrs_tbf_jobid_hop_exit,
+};
+
+static struct nrs_tbf_client *
+nrs_tbf_generic_cli_find(struct nrs_tbf_head *head,
+			 struct ptlrpc_request *req)
+{
+	char			 key[NRS_TBF_KEY_LEN];
+	struct nrs_tbf_client	*cli;
+	struct cfs_hash		*hs = head->th_cli_hash;
+	struct cfs_hash_bd	 bd;
+	__u32			 opcode;
+	__u32			 uid;
+	__u32			 gid;
+
+	nrs_tbf_generic_key(req, key, &opcode, &uid, &gid);
+	cfs_hash_bd_get_and_lock(hs, (void *)key, &bd, 1);
+	cli = nrs_tbf_jobid_hash_lookup(hs, &bd, key);
+	cfs_hash_bd_unlock(hs, &bd, 1);
+
+	return cli;
+}
+
+static struct nrs_tbf_client *
+nrs_tbf_generic_cli_findadd(struct nrs_tbf_head *head,
+			    struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_client	*ret;
+	struct cfs_hash		*hs = head->th_cli_hash;
+	struct cfs_hash_bd	 bd;
+
+	cfs_hash_bd_get_and_lock(hs, (void *)cli->tc_key, &bd, 1);
+	ret = nrs_tbf_jobid_hash_lookup(hs, &bd, cli->tc_key);
+	if (ret == NULL) {
+		cfs_hash_bd_add_locked(hs, &bd, &cli->tc_hnode);
+		ret = cli;
+	}
+	cfs_hash_bd_unlock(hs, &bd, 1);
+
+	return ret;
+}
+
+static void
+nrs_tbf_generic_cli_init(struct nrs_tbf_client *cli,
+			 struct ptlrpc_request *req)
+{
+	char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+
+	if (jobid == NULL)
+		jobid = NRS_TBF_JOBID_NULL;
+	INIT_LIST_HEAD(&cli->tc_lru);
+	strlcpy(cli->tc_jobid, jobid, sizeof(cli->tc_jobid));
+	cli->tc_nid = req->rq_peer.nid;
+	nrs_tbf_generic_key(req, cli->tc_key, &cli->tc_opcode, &cli->tc_uid,
+			    &cli->tc_gid);
+}
+
+static int
+nrs_tbf_generic_startup(struct ptlrpc_nrs_policy *policy,
+			struct nrs_tbf_head *head)
+{
+	struct nrs_tbf_cmd	 start;
+	struct nrs_tbf_bucket	*bkt;
+	int			 bits;
+	int			 i;
+	struct cfs_hash_bd	 bd;
+
+	bits = nrs_tbf_jobid_hash_order();
+	if (bits < NRS_TBF_JOBID_BKT_BITS)
+		bits = NRS_TBF_JOBID_BKT_BITS;
+	head->th_cli_hash = cfs_hash_create("nrs_tbf_hash",
+					    bits,
+					    bits,
+					    NRS_TBF_JOBID_BKT_BITS,
+					    sizeof(*bkt),
+					    0,
+					    0,
+					    &nrs_tbf_generic_hash_ops,
+					    NRS_TBF_JOBID_HASH_FLAGS);
+	if (head->th_cli_hash == NULL)
+		return -ENOMEM;
+
+	cfs_hash_for_each_bucket(head->th_cli_hash, &bd, i) {
+		bkt = cfs_hash_bd_extra_get(head->th_cli_hash, &bd);
+		INIT_LIST_HEAD(&bkt->ntb_lru);
+	}
+
+	memset(&start, 0, sizeof(start));
+	start.u.tc_start.ts_conds_str = "*";
+
+	start.u.tc_start.ts_rpc_rate = tbf_rate;
+	start.u.tc_start.ts_rule_flags = NTRS_DEFAULT;
+	start.tc_name = NRS_TBF_DEFAULT_RULE;
+	INIT_LIST_HEAD(&start.u.tc_start.ts_conds);
+
+	return nrs_tbf_rule_start(policy, head, &start);
+}
+
+/**
+ * Like cfs_gettok(), but does not split inside "{...}" value lists, which
+ * may themselves contain the delimiter (e.g. NID ranges).
+ */
+static int nrs_tbf_gettok(struct cfs_lstr *next, char delim,
+			  struct cfs_lstr *res)
+{
+	int depth = 0;
+	int i;
+
+	if (next->ls_str == NULL)
+		return 0;
+
+	for (i = 0; i < next->ls_len; i++) {
+		if (next->ls_str[i] == '{')
+			depth++;
+		else if (next->ls_str[i] == '}')
+			depth--;
+		else if (next->ls_str[i] == delim && depth == 0)
+			break;
+	}
+
+	res->ls_str = next->ls_str;
+	res->ls_len = i;
+	if (i == next->ls_len) {
+		next->ls_str = NULL;
+		next->ls_len = 0;
+	} else {
+		next->ls_str += i + 1;
+		next->ls_len -= i + 1;
+	}
+
+	return res->ls_len > 0;
+}
+
+static int
+nrs_tbf_opcode_list_parse(char *str, int len, struct cfs_bitmap **bitmapp)
+{
+	struct cfs_bitmap	*opcodes;
+	struct cfs_lstr		 src;
+	struct cfs_lstr		 res;
+	char			 name[64];
+	int			 opcode;
+	int			 rc = 0;
+
+	opcodes = CFS_ALLOCATE_BITMAP(LUSTRE_MAX_OPCODES);
+	if (opcodes == NULL)
+		return -ENOMEM;
+
+	src.ls_str = str;
+	src.ls_len = len;
+	while (src.ls_str) {
+		rc = cfs_gettok(&src, ' ', &res);
+		if (rc == 0 || res.ls_len >= sizeof(name)) {
+			rc = -EINVAL;
+			break;
+		}
+		memcpy(name, res.ls_str, res.ls_len);
+		name[res.ls_len] = '\0';
+
+		opcode = ll_str2opcode(name);
+		if (opcode < 0) {
+			rc = -EINVAL;
+			break;
+		}
+		cfs_bitmap_set(opcodes, opcode_offset(opcode));
+		rc = 0;
+	}
+
+	if (rc)
+		CFS_FREE_BITMAP(opcodes);
+	else
+		*bitmapp = opcodes;
+
+	return rc;
+}
+
+static int
+nrs_tbf_ugid_list_parse(char *str, int len, struct list_head *ugid_list)
+{
+	struct cfs_expr_list	*el;
+	struct cfs_lstr		 src;
+	struct cfs_lstr		 res;
+	int			 rc = 0;
+
+	src.ls_str = str;
+	src.ls_len = len;
+	INIT_LIST_HEAD(ugid_list);
+	while (src.ls_str) {
+		rc = cfs_gettok(&src, ' ', &res);
+		if (rc == 0) {
+			rc = -EINVAL;
+			break;
+		}
+		rc = cfs_expr_list_parse(res.ls_str, res.ls_len, 0,
+					 NRS_UGID_NONE - 1, &el);
+		if (rc)
+			break;
+		list_add_tail(&el->el_link, ugid_list);
+	}
+
+	if (rc)
+		cfs_expr_list_free_list(ugid_list);
+
+	return rc;
+}
+
+static int nrs_tbf_ugid_list_match(struct list_head *ugid_list, __u32 id)
+{
+	struct cfs_expr_list *el;
+
+	list_for_each_entry(el, ugid_list, el_link) {
+		if (cfs_expr_list_match(id, el))
+			return 1;
+	}
+	return 0;
+}
+
+static void nrs_tbf_expression_free(struct nrs_tbf_expression *expr)
+{
+	switch (expr->te_field) {
+	case NRS_TBF_FIELD_NID:
+		cfs_free_nidlist(&expr->te_cond);
+		break;
+	case NRS_TBF_FIELD_JOBID:
+		nrs_tbf_jobid_list_free(&expr->te_cond);
+		break;
+	case NRS_TBF_FIELD_OPCODE:
+		CFS_FREE_BITMAP(expr->te_opcodes);
+		break;
+	case NRS_TBF_FIELD_UID:
+	case NRS_TBF_FIELD_GID:
+		cfs_expr_list_free_list(&expr->te_cond);
+		break;
+	default:
+		LBUG();
+	}
+	OBD_FREE_PTR(expr);
+}
+
+static void nrs_tbf_conjunction_free(struct nrs_tbf_conjunction *conjunction)
+{
+	struct nrs_tbf_expression *expr, *n;
+
+	list_for_each_entry_safe(expr, n, &conjunction->tc_expressions,
+				 te_linkage) {
+		list_del_init(&expr->te_linkage);
+		nrs_tbf_expression_free(expr);
+	}
+	OBD_FREE_PTR(conjunction);
+}
+
+static void nrs_tbf_conds_free(struct list_head *cond_list)
+{
+	struct nrs_tbf_conjunction *conjunction, *n;
+
+	list_for_each_entry_safe(conjunction, n, cond_list, tc_linkage) {
+		list_del_init(&conjunction->tc_linkage);
+		nrs_tbf_conjunction_free(conjunction);
+	}
+}
+
+static bool nrs_tbf_field_is(const struct cfs_lstr *field, const char *name)
+{
+	return field->ls_len == strlen(name) &&
+	       strncmp(field->ls_str, name, field->ls_len) == 0;
+}
+
+static int
+nrs_tbf_expression_parse(struct cfs_lstr *src, struct list_head *expr_list)
+{
+	struct nrs_tbf_expression	*expr;
+	struct cfs_lstr			 field;
+	int				 rc = 0;
+
+	OBD_ALLOC_PTR(expr);
+	if (expr == NULL)
+		return -ENOMEM;
+
+	rc = cfs_gettok(src, '=', &field);
+	if (rc == 0 || src->ls_len <= 2 || src->ls_str[0] != '{' ||
+	    src->ls_str[src->ls_len - 1] != '}')
+		GOTO(out, rc = -EINVAL);
+
+	/* Skip '{' and '}' */
+	src->ls_str++;
+	src->ls_len -= 2;
+
+	INIT_LIST_HEAD(&expr->te_cond);
+	if (nrs_tbf_field_is(&field, "nid")) {
+		expr->te_field = NRS_TBF_FIELD_NID;
+		if (cfs_parse_nidlist(src->ls_str, src->ls_len,
+				      &expr->te_cond) <= 0)
+			GOTO(out, rc = -EINVAL);
+		rc = 0;
+	} else if (nrs_tbf_field_is(&field, "jobid")) {
+		expr->te_field = NRS_TBF_FIELD_JOBID;
+		rc = nrs_tbf_jobid_list_parse(src->ls_str, src->ls_len,
+					      &expr->te_cond);
+	} else if (nrs_tbf_field_is(&field, "opcode")) {
+		expr->te_field = NRS_TBF_FIELD_OPCODE;
+		rc = nrs_tbf_opcode_list_parse(src->ls_str, src->ls_len,
+					       &expr->te_opcodes);
+	} else if (nrs_tbf_field_is(&field, "uid")) {
+		expr->te_field = NRS_TBF_FIELD_UID;
+		rc = nrs_tbf_ugid_list_parse(src->ls_str, src->ls_len,
+					     &expr->te_cond);
+	} else if (nrs_tbf_field_is(&field, "gid")) {
+		expr->te_field = NRS_TBF_FIELD_GID;
+		rc = nrs_tbf_ugid_list_parse(src->ls_str, src->ls_len,
+					     &expr->te_cond);
+	} else {
+		rc = -EINVAL;
+	}
+out:
+	if (rc) {
+		OBD_FREE_PTR(expr);
+		return rc;
+	}
+
+	list_add_tail(&expr->te_linkage, expr_list);
+	return 0;
+}
+
+static int
+nrs_tbf_conjunction_parse(struct cfs_lstr *src, struct list_head *cond_list)
+{
+	struct nrs_tbf_conjunction	*conjunction;
+	struct cfs_lstr			 expr;
+	int				 rc = 0;
+
+	OBD_ALLOC_PTR(conjunction);
+	if (conjunction == NULL)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&conjunction->tc_expressions);
+	list_add_tail(&conjunction->tc_linkage, cond_list);
+
+	while (src->ls_str) {
+		rc = nrs_tbf_gettok(src, '&', &expr);
+		if (rc == 0)
+			return -EINVAL;
+		rc = nrs_tbf_expression_parse(&expr,
+					      &conjunction->tc_expressions);
+		if (rc)
+			return rc;
+	}
+	return 0;
+}
+
+static int
+nrs_tbf_conds_parse(char *str, int len, struct list_head *cond_list)
+{
+	struct cfs_lstr	src;
+	struct cfs_lstr	res;
+	int		rc = 0;
+
+	src.ls_str = str;
+	src.ls_len = len;
+	INIT_LIST_HEAD(cond_list);
+	while (src.ls_str) {
+		rc = nrs_tbf_gettok(&src, ',', &res);
+		if (rc == 0) {
+			rc = -EINVAL;
+			break;
+		}
+		rc = nrs_tbf_conjunction_parse(&res, cond_list);
+		if (rc)
+			break;
+	}
+	if (rc)
+		nrs_tbf_conds_free(cond_list);
+	return rc;
+}
+
+static void nrs_tbf_generic_cmd_fini(struct nrs_tbf_cmd *cmd)
+{
+	if (!list_empty(&cmd->u.tc_start.ts_conds))
+		nrs_tbf_conds_free(&cmd->u.tc_start.ts_conds);
+	if (cmd->u.tc_start.ts_conds_str)
+		OBD_FREE(cmd->u.tc_start.ts_conds_str,
+			 strlen(cmd->u.tc_start.ts_conds_str) + 1);
+}
+
+static int nrs_tbf_generic_parse(struct nrs_tbf_cmd *cmd, const char *id)
+{
+	int rc;
+
+	OBD_ALLOC(cmd->u.tc_start.ts_conds_str, strlen(id) + 1);
+	if (cmd->u.tc_start.ts_conds_str == NULL)
+		return -ENOMEM;
+
+	memcpy(cmd->u.tc_start.ts_conds_str, id, strlen(id));
+
+	/* Parse NID, JobID, opcode, uid and gid conditions */
+	rc = nrs_tbf_conds_parse(cmd->u.tc_start.ts_conds_str,
+				 strlen(cmd->u.tc_start.ts_conds_str),
+				 &cmd->u.tc_start.ts_conds);
+	if (rc)
+		nrs_tbf_generic_cmd_fini(cmd);
+
+	return rc;
+}
+
+static int nrs_tbf_generic_rule_init(struct ptlrpc_nrs_policy *policy,
+				     struct nrs_tbf_rule *rule,
+				     struct nrs_tbf_cmd *start)
+{
+	int rc = 0;
+
+	LASSERT(start->u.tc_start.ts_conds_str);
+	OBD_ALLOC(rule->tr_conds_str,
+		  strlen(start->u.tc_start.ts_conds_str) + 1);
+	if (rule->tr_conds_str == NULL)
+		return -ENOMEM;
+
+	memcpy(rule->tr_conds_str,
+	       start->u.tc_start.ts_conds_str,
+	       strlen(start->u.tc_start.ts_conds_str));
+
+	INIT_LIST_HEAD(&rule->tr_conds);
+	if (!list_empty(&start->u.tc_start.ts_conds)) {
+		rc = nrs_tbf_conds_parse(rule->tr_conds_str,
+					 strlen(rule->tr_conds_str),
+					 &rule->tr_conds);
+		if (rc)
+			CERROR("conditions {%s} illegal\n",
+			       rule->tr_conds_str);
+	}
+	if (rc)
+		OBD_FREE(rule->tr_conds_str,
+			 strlen(start->u.tc_start.ts_conds_str) + 1);
+	return rc;
+}
+
+static int
+nrs_tbf_generic_rule_dump(struct nrs_tbf_rule *rule, struct seq_file *m)
+{
+	seq_printf(m, "%s {%s} %llu, ref %d\n", rule->tr_name,
+		   rule->tr_conds_str, rule->tr_rpc_rate,
+		   atomic_read(&rule->tr_ref) - 1);
+	return 0;
+}
+
+static int
+nrs_tbf_expression_match(struct nrs_tbf_expression *expr,
+			 struct nrs_tbf_client *cli)
+{
+	int offset;
+
+	switch (expr->te_field) {
+	case NRS_TBF_FIELD_NID:
+		return cfs_match_nid(cli->tc_nid, &expr->te_cond);
+	case NRS_TBF_FIELD_JOBID:
+		return nrs_tbf_jobid_list_match(&expr->te_cond, cli->tc_jobid);
+	case NRS_TBF_FIELD_OPCODE:
+		offset = opcode_offset(cli->tc_opcode);
+		if (offset < 0 || offset >= LUSTRE_MAX_OPCODES)
+			return 0;
+		return cfs_bitmap_check(expr->te_opcodes, offset);
+	case NRS_TBF_FIELD_UID:
+		return nrs_tbf_ugid_list_match(&expr->te_cond, cli->tc_uid);
+	case NRS_TBF_FIELD_GID:
+		return nrs_tbf_ugid_list_match(&expr->te_cond, cli->tc_gid);
+	default:
+		return 0;
+	}
+}
+
+static int
+nrs_tbf_conjunction_match(struct nrs_tbf_conjunction *conjunction,
+			  struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_expression *expr;
+
+	list_for_each_entry(expr, &conjunction->tc_expressions, te_linkage) {
+		if (!nrs_tbf_expression_match(expr, cli))
+			return 0;
+	}
+	return 1;
+}
+
+static int
+nrs_tbf_generic_rule_match(struct nrs_tbf_rule *rule,
+			   struct nrs_tbf_client *cli)
+{
+	struct nrs_tbf_conjunction *conjunction;
+
+	list_for_each_entry(conjunction, &rule->tr_conds, tc_linkage) {
+		if (nrs_tbf_conjunction_match(conjunction, cli))
+			return 1;
+	}
+	return 0;
+}
+
+static void nrs_tbf_generic_rule_fini(struct nrs_tbf_rule *rule)
+{
+	if (!list_empty(&rule->tr_conds))
+		nrs_tbf_conds_free(&rule->tr_conds);
+	LASSERT(rule->tr_conds_str != NULL);
+	OBD_FREE(rule->tr_conds_str, strlen(rule->tr_conds_str) + 1);
+}
+
+static struct nrs_tbf_ops nrs_tbf_generic_ops = {
+	.o_name = NRS_TBF_TYPE_GENERIC,
+	.o_startup = nrs_tbf_generic_startup,
+	.o_cli_find = nrs_tbf_generic_cli_find,
+	.o_cli_findadd = nrs_tbf_generic_cli_findadd,
+	.o_cli_put = nrs_tbf_jobid_cli_put,
+	.o_cli_init = nrs_tbf_generic_cli_init,
+	.o_rule_init = nrs_tbf_generic_rule_init,
+	.o_rule_dump = nrs_tbf_generic_rule_dump,
+	.o_rule_match = nrs_tbf_generic_rule_match,
+	.o_rule_fini = nrs_tbf_generic_rule_fini,
+};
+
 /**
  * Is called before the policy transitions into
  * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes a
@@ -1258,6 +2047,9 @@ static int nrs_tbf_start(struct ptlrpc_nrs_policy *policy, char *arg)
 	} else if (strcmp(arg, NRS_TBF_TYPE_JOBID) == 0) {
 		ops = &nrs_tbf_jobid_ops;
 		type = NRS_TBF_FLAG_JOBID;
+	} else if (strcmp(arg, NRS_TBF_TYPE_GENERIC) == 0) {
+		ops = &nrs_tbf_generic_ops;
+		type = NRS_TBF_FLAG_GENERIC;
 	} else
 		GOTO(out, rc = -ENOTSUPP);
 
@@ -1539,9 +2331,9 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		__u64 passed;
 		__u64 ntoken;
 		__u64 deadline;
+		__u64 next;
 
-		deadline = cli->tc_check_time +
-			  cli->tc_nsecs;
+		deadline = nrs_tbf_cli_deadline(cli);
 		LASSERT(now >= cli->tc_check_time);
 		passed = now - cli->tc_check_time;
 		ntoken = passed * cli->tc_rpc_rate;
@@ -1549,7 +2341,7 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		ntoken += cli->tc_ntoken;
 		if (ntoken > cli->tc_depth)
 			ntoken = cli->tc_depth;
-		if (ntoken > 0) {
+		if (ntoken > 0 || nrs_tbf_cli_borrow(cli, now, &next)) {
 			struct ptlrpc_request *req;
 			nrq = list_entry(cli->tc_list.next,
 					     struct ptlrpc_nrs_request,
@@ -1557,9 +2349,13 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 			req = container_of(nrq,
 					   struct ptlrpc_request,
 					   rq_nrq);
-			ntoken--;
-			cli->tc_ntoken = ntoken;
-			cli->tc_check_time = now;
+			/* Borrowed tokens leave the client's own bucket alone */
+			if (ntoken > 0) {
+				ntoken--;
+				cli->tc_ntoken = ntoken;
+				cli->tc_check_time = now;
+				nrs_tbf_cli_charge(cli, now);
+			}
 			list_del_init(&nrq->nr_u.tbf.tr_list);
 			if (list_empty(&cli->tc_list)) {
 				cfs_binheap_remove(head->th_binheap,
@@ -1578,6 +2374,8 @@ struct ptlrpc_nrs_request *nrs_tbf_req_get(struct ptlrpc_nrs_policy *policy,
 		} else {
 			ktime_t time;
 
+			if (next != 0 && next < deadline)
+				deadline = next;
 			policy->pol_nrs->nrs_throttling = 1;
 			head->th_deadline = deadline;
 			time = ktime_set(0, 0);
@@ -1768,7 +2566,9 @@ static int nrs_tbf_id_parse(struct nrs_tbf_cmd *cmd, char *token)
 {
 	int rc;
 
-	if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_JOBID)
+	if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_GENERIC)
+		rc = nrs_tbf_generic_parse(cmd, token);
+	else if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_JOBID)
 		rc = nrs_tbf_jobid_parse(cmd, token);
 	else if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_NID)
 		rc = nrs_tbf_nid_parse(cmd, token);
@@ -1784,7 +2584,9 @@ static int nrs_tbf_id_parse(struct nrs_tbf_cmd *cmd, char *token)
 static void nrs_tbf_cmd_fini(struct nrs_tbf_cmd *cmd)
 {
 	if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE) {
-		if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_JOBID)
+		if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_GENERIC)
+			nrs_tbf_generic_cmd_fini(cmd);
+		else if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_JOBID)
 			nrs_tbf_jobid_cmd_fini(cmd);
 		else if (cmd->u.tc_start.ts_valid_type & NRS_TBF_FLAG_NID)
 			nrs_tbf_nid_cmd_fini(cmd);
@@ -1831,6 +2633,26 @@ nrs_tbf_parse_value_pair(struct nrs_tbf_cmd *cmd, char *buffer)
 			cmd->u.tc_change.tc_rpc_rate = rate;
 		else
 			return -EINVAL;
+	} else if (strcmp(key, "ceil") == 0) {
+		rc = kstrtoull(val, 10, &rate);
+		if (rc)
+			return rc;
+
+		if (rate <= 0 || rate >= LPROCFS_NRS_RATE_MAX)
+			return -EINVAL;
+
+		if (cmd->tc_cmd == NRS_CTL_TBF_START_RULE)
+			cmd->u.tc_start.ts_ceil_rate = rate;
+		else if (cmd->tc_cmd == NRS_CTL_TBF_CHANGE_RULE)
+			cmd->u.tc_change.tc_ceil_rate = rate;
+		else
+			return -EINVAL;
+	} else if (strcmp(key, "parent") == 0) {
+		if (!name_is_valid(val) ||
+		    cmd->tc_cmd != NRS_CTL_TBF_START_RULE)
+			return -EINVAL;
+
+		cmd->u.tc_start.ts_parent_name = val;
 	}  else if (strcmp(key, "rank") == 0) {
 		if (!name_is_valid(val))
 			return -EINVAL;
@@ -1866,11 +2688,25 @@ nrs_tbf_parse_value_pairs(struct nrs_tbf_cmd *cmd, char *buffer)
 	case NRS_CTL_TBF_START_RULE:
 		if (cmd->u.tc_start.ts_rpc_rate == 0)
 			cmd->u.tc_start.ts_rpc_rate = tbf_rate;
+		/* A ceiling only limits borrowing from a parent, and can't
+		 * be below the rate the rule's clients get anyway */
+		if (cmd->u.tc_start.ts_ceil_rate != 0 &&
+		    (cmd->u.tc_start.ts_parent_name == NULL ||
+		     cmd->u.tc_start.ts_ceil_rate <
+		     cmd->u.tc_start.ts_rpc_rate))
+			return -EINVAL;
 		break;
 	case NRS_CTL_TBF_CHANGE_RULE:
 		if (cmd->u.tc_change.tc_rpc_rate == 0 &&
+		    cmd->u.tc_change.tc_ceil_rate == 0 &&
 		    cmd->u.tc_change.tc_next_name == NULL)
 			return -EINVAL;
+		/* if only one is given, nrs_tbf_rule_change() checks it
+		 * against the rule's */
+		if (cmd->u.tc_change.tc_ceil_rate != 0 &&
+		    cmd->u.tc_change.tc_ceil_rate <
+		    cmd->u.tc_change.tc_rpc_rate)
+			return -EINVAL;
 		break;
 	case NRS_CTL_TBF_STOP_RULE:
 		break;
@@ -0,0 +1,489 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/objpool.c
+ *
+ * Per-CPT object pools for the hot ptlrpc descriptors.
+ *
+ * Requests, reply states and request buffer descriptors are allocated and
+ * freed for every RPC a server handles.  Each pool keeps a bounded stack of
+ * free objects per CPU partition in front of its slab cache, so that in the
+ * common case an object is recycled on the partition which freed it without
+ * touching the allocator.  Objects are always cached on the partition whose
+ * NUMA node they live on, an object freed by a thread of another partition
+ * is handed back to its home partition.  Cached objects are given back to
+ * the slabs by a shrinker under memory pressure.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <linux/mm.h>
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lprocfs_status.h>
+#include <libcfs/libcfs.h>
+#include "ptlrpc_internal.h"
+
+/** free objects and counters of one CPU partition */
+struct ptlrpc_objpool_cpt {
+	spinlock_t		 ooc_lock;
+	/** cached free objects, most recently freed first */
+	struct list_head	 ooc_free;
+	unsigned int		 ooc_count;
+	/** allocations served from ooc_free */
+	__u64			 ooc_hits;
+	/** allocations which went to the slab */
+	__u64			 ooc_misses;
+	/** frees which went back to the slab because the pool was full */
+	__u64			 ooc_releases;
+	/** objects freed by a thread of another partition */
+	__u64			 ooc_remote;
+	/** cached objects released by the shrinker */
+	__u64			 ooc_shrunk;
+};
+
+struct ptlrpc_objpool {
+	struct list_head		 op_link;
+	const char			*op_name;
+	struct kmem_cache		*op_cache;
+	size_t				 op_size;
+	/** max number of free objects cached per partition */
+	unsigned int			 op_max;
+	struct ptlrpc_objpool_cpt	**op_cpts;
+};
+
+static LIST_HEAD(ptlrpc_objpools);
+static DEFINE_MUTEX(ptlrpc_objpools_mutex);
+static struct shrinker *ptlrpc_objpool_shrinker;
+
+/**
+ * Create a pool of \a size bytes objects, caching up to \a max free objects
+ * per CPU partition.
+ */
+static struct ptlrpc_objpool *
+ptlrpc_objpool_create(const char *name, size_t size, unsigned int max)
+{
+	struct ptlrpc_objpool		*pool;
+	struct ptlrpc_objpool_cpt	*pc;
+	int				 i;
+
+	LASSERT(size >= sizeof(struct list_head));
+
+	OBD_ALLOC_PTR(pool);
+	if (pool == NULL)
+		return NULL;
+
+	pool->op_name = name;
+	pool->op_size = size;
+	pool->op_max = max;
+	INIT_LIST_HEAD(&pool->op_link);
+
+	pool->op_cache = kmem_cache_create(name, size, 0, SLAB_HWCACHE_ALIGN,
+					   NULL);
+	if (pool->op_cache == NULL)
+		goto failed;
+
+	pool->op_cpts = cfs_percpt_alloc(cfs_cpt_table, sizeof(*pc));
+	if (pool->op_cpts == NULL)
+		goto failed;
+
+	cfs_percpt_for_each(pc, i, pool->op_cpts) {
+		spin_lock_init(&pc->ooc_lock);
+		INIT_LIST_HEAD(&pc->ooc_free);
+	}
+
+	mutex_lock(&ptlrpc_objpools_mutex);
+	list_add_tail(&pool->op_link, &ptlrpc_objpools);
+	mutex_unlock(&ptlrpc_objpools_mutex);
+
+	return pool;
+failed:
+	if (pool->op_cache != NULL)
+		kmem_cache_destroy(pool->op_cache);
+	OBD_FREE_PTR(pool);
+	return NULL;
+}
+
+/** Release all cached objects and destroy \a pool. */
+static void ptlrpc_objpool_destroy(struct ptlrpc_objpool *pool)
+{
+	struct ptlrpc_objpool_cpt	*pc;
+	struct list_head		*obj;
+	int				 i;
+
+	if (pool == NULL)
+		return;
+
+	mutex_lock(&ptlrpc_objpools_mutex);
+	list_del(&pool->op_link);
+	mutex_unlock(&ptlrpc_objpools_mutex);
+
+	cfs_percpt_for_each(pc, i, pool->op_cpts) {
+		while (!list_empty(&pc->ooc_free)) {
+			obj = pc->ooc_free.next;
+			list_del(obj);
+			OBD_SLAB_FREE(obj, pool->op_cache, pool->op_size);
+		}
+		pc->ooc_count = 0;
+	}
+
+	cfs_percpt_free(pool->op_cpts);
+	kmem_cache_destroy(pool->op_cache);
+	OBD_FREE_PTR(pool);
+}
+
+/**
+ * Allocate a zeroed object from \a pool for partition \a cpt, or for the
+ * partition of the calling CPU if \a cpt is CFS_CPT_ANY.
+ */
+static void *ptlrpc_objpool_alloc(struct ptlrpc_objpool *pool, int cpt,
+				  gfp_t flags)
+{
+	struct ptlrpc_objpool_cpt	*pc;
+	struct list_head		*obj = NULL;
+
+	if (cpt == CFS_CPT_ANY)
+		cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	pc = pool->op_cpts[cpt];
+
+	spin_lock(&pc->ooc_lock);
+	if (!list_empty(&pc->ooc_free)) {
+		obj = pc->ooc_free.next;
+		list_del(obj);
+		pc->ooc_count--;
+		pc->ooc_hits++;
+	} else {
+		pc->ooc_misses++;
+	}
+	spin_unlock(&pc->ooc_lock);
+
+	if (obj != NULL) {
+		memset(obj, 0, pool->op_size);
+		return obj;
+	}
+
+	OBD_SLAB_CPT_ALLOC_GFP(obj, pool->op_cache, cfs_cpt_table, cpt,
+			       pool->op_size, flags);
+	return obj;
+}
+
+/* partition of the NUMA node holding \a obj, preferring \a cpt */
+static int ptlrpc_objpool_home(void *obj, int cpt)
+{
+	int nid = page_to_nid(virt_to_page(obj));
+	int i;
+
+	if (node_isset(nid, *cfs_cpt_nodemask(cfs_cpt_table, cpt)))
+		return cpt;
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_table); i++) {
+		if (node_isset(nid, *cfs_cpt_nodemask(cfs_cpt_table, i)))
+			return i;
+	}
+
+	return cpt;
+}
+
+/** Return \a ptr to \a pool. */
+static void ptlrpc_objpool_free(struct ptlrpc_objpool *pool, void *ptr)
+{
+	struct ptlrpc_objpool_cpt	*pc;
+	struct list_head		*obj = ptr;
+	int				 cpt;
+	int				 home;
+
+	cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	home = ptlrpc_objpool_home(ptr, cpt);
+	pc = pool->op_cpts[home];
+
+	spin_lock(&pc->ooc_lock);
+	if (home != cpt)
+		pc->ooc_remote++;
+	if (pc->ooc_count < pool->op_max) {
+		list_add(obj, &pc->ooc_free);
+		pc->ooc_count++;
+		obj = NULL;
+	} else {
+		pc->ooc_releases++;
+	}
+	spin_unlock(&pc->ooc_lock);
+
+	if (obj != NULL)
+		OBD_SLAB_FREE(obj, pool->op_cache, pool->op_size);
+}
+
+/*
+ * memory shrinker
+ */
+static unsigned long ptlrpc_objpool_shrink_count(struct shrinker *s,
+						 struct shrink_control *sc)
+{
+	struct ptlrpc_objpool		*pool;
+	struct ptlrpc_objpool_cpt	*pc;
+	unsigned long			 count = 0;
+	int				 i;
+
+	/* a racy count is fine here */
+	mutex_lock(&ptlrpc_objpools_mutex);
+	list_for_each_entry(pool, &ptlrpc_objpools, op_link) {
+		cfs_percpt_for_each(pc, i, pool->op_cpts)
+			count += pc->ooc_count;
+	}
+	mutex_unlock(&ptlrpc_objpools_mutex);
+
+	return count;
+}
+
+/*
+ * Release the least recently freed objects of every partition of every
+ * pool, each in proportion to what it caches.
+ */
+static unsigned long ptlrpc_objpool_shrink_scan(struct shrinker *s,
+						struct shrink_control *sc)
+{
+	struct ptlrpc_objpool		*pool;
+	struct ptlrpc_objpool_cpt	*pc;
+	struct list_head		*obj;
+	unsigned long			 total;
+	unsigned long			 freed = 0;
+	unsigned long			 nr;
+	int				 i;
+
+	total = ptlrpc_objpool_shrink_count(s, sc);
+	if (total == 0)
+		return SHRINK_STOP;
+
+	mutex_lock(&ptlrpc_objpools_mutex);
+	list_for_each_entry(pool, &ptlrpc_objpools, op_link) {
+		cfs_percpt_for_each(pc, i, pool->op_cpts) {
+			LIST_HEAD(zombies);
+
+			spin_lock(&pc->ooc_lock);
+			nr = min_t(unsigned long, pc->ooc_count,
+				   DIV_ROUND_UP(pc->ooc_count * sc->nr_to_scan,
+						total));
+			pc->ooc_count -= nr;
+			pc->ooc_shrunk += nr;
+			while (nr-- > 0)
+				list_move(pc->ooc_free.prev, &zombies);
+			spin_unlock(&pc->ooc_lock);
+
+			while (!list_empty(&zombies)) {
+				obj = zombies.next;
+				list_del(obj);
+				OBD_SLAB_FREE(obj, pool->op_cache,
+					      pool->op_size);
+				freed++;
+			}
+		}
+	}
+	mutex_unlock(&ptlrpc_objpools_mutex);
+
+	CDEBUG(D_RPCTRACE, "released %lu of %lu pooled objects\n",
+	       freed, total);
+	return freed;
+}
+
+#ifndef HAVE_SHRINKER_COUNT
+static int ptlrpc_objpool_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	struct shrink_control scv = {
+		.nr_to_scan = shrink_param(sc, nr_to_scan),
+		.gfp_mask   = shrink_param(sc, gfp_mask)
+	};
+#if !defined(HAVE_SHRINKER_WANT_SHRINK_PTR) && !defined(HAVE_SHRINK_CONTROL)
+	struct shrinker *shrinker = NULL;
+#endif
+
+	if (scv.nr_to_scan != 0)
+		ptlrpc_objpool_shrink_scan(shrinker, &scv);
+
+	return ptlrpc_objpool_shrink_count(shrinker, &scv);
+}
+#endif /* HAVE_SHRINKER_COUNT */
+
+static struct ptlrpc_objpool *request_pool;
+static struct ptlrpc_objpool *reply_state_pool;
+static struct ptlrpc_objpool *rqbd_pool;
+
+/* number of free objects cached per CPT for each pool */
+#define PTLRPC_REQUEST_POOL_MAX		512
+#define PTLRPC_RS_POOL_MAX		512
+#define PTLRPC_RQBD_POOL_MAX		64
+
+/*
+ * Reply states are sized by the reply message, only those up to
+ * PTLRPC_RS_POOL_MSGSIZE bytes of message come from the pool.  That covers
+ * the OST replies and most of the MDT ones.
+ */
+#define PTLRPC_RS_POOL_MSGSIZE		2048
+#define PTLRPC_RS_POOL_SIZE		(sizeof(struct ptlrpc_reply_state) + \
+					 PTLRPC_RS_POOL_MSGSIZE)
+
+struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags)
+{
+	return ptlrpc_objpool_alloc(request_pool, CFS_CPT_ANY, flags);
+}
+
+void ptlrpc_request_cache_free(struct ptlrpc_request *req)
+{
+	ptlrpc_objpool_free(request_pool, req);
+}
+
+/**
+ * Allocate a zeroed reply state of \a rs_size bytes for the sptlrpc
+ * policies.  rs_size is set by the caller.
+ */
+struct ptlrpc_reply_state *ptlrpc_rs_alloc(int rs_size)
+{
+	struct ptlrpc_reply_state *rs;
+
+	if (rs_size <= PTLRPC_RS_POOL_SIZE) {
+		rs = ptlrpc_objpool_alloc(reply_state_pool, CFS_CPT_ANY,
+					  GFP_NOFS);
+		if (rs != NULL)
+			rs->rs_pooled = 1;
+		return rs;
+	}
+
+	OBD_ALLOC_LARGE(rs, rs_size);
+	return rs;
+}
+
+void ptlrpc_rs_free(struct ptlrpc_reply_state *rs)
+{
+	if (rs->rs_pooled)
+		ptlrpc_objpool_free(reply_state_pool, rs);
+	else
+		OBD_FREE_LARGE(rs, rs->rs_size);
+}
+
+struct ptlrpc_request_buffer_desc *ptlrpc_rqbd_alloc(int cpt)
+{
+	return ptlrpc_objpool_alloc(rqbd_pool, cpt, GFP_NOFS);
+}
+
+void ptlrpc_rqbd_free(struct ptlrpc_request_buffer_desc *rqbd)
+{
+	ptlrpc_objpool_free(rqbd_pool, rqbd);
+}
+
+#ifdef CONFIG_PROC_FS
+static struct proc_dir_entry *ptlrpc_objpool_proc_root;
+
+static int ptlrpc_objpool_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpc_objpool		*pool;
+	struct ptlrpc_objpool_cpt	*pc;
+	int				 i;
+
+	seq_printf(m, "%-16s %4s %8s %12s %12s %12s %12s %12s\n",
+		   "pool", "cpt", "cached", "hits", "misses", "releases",
+		   "remote", "shrunk");
+
+	mutex_lock(&ptlrpc_objpools_mutex);
+	list_for_each_entry(pool, &ptlrpc_objpools, op_link) {
+		cfs_percpt_for_each(pc, i, pool->op_cpts) {
+			spin_lock(&pc->ooc_lock);
+			seq_printf(m, "%-16s %4d %8u %12llu %12llu %12llu "
+				   "%12llu %12llu\n", pool->op_name, i,
+				   pc->ooc_count, pc->ooc_hits,
+				   pc->ooc_misses, pc->ooc_releases,
+				   pc->ooc_remote, pc->ooc_shrunk);
+			spin_unlock(&pc->ooc_lock);
+		}
+	}
+	mutex_unlock(&ptlrpc_objpools_mutex);
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpc_objpool);
+
+static struct lprocfs_vars ptlrpc_objpool_lprocfs_vars[] = {
+	{ .name	=	"object_pools",
+	  .fops	=	&ptlrpc_objpool_fops	},
+	{ NULL }
+};
+#endif /* CONFIG_PROC_FS */
+
+int ptlrpc_objpools_init(void)
+{
+	DEF_SHRINKER_VAR(shvar, ptlrpc_objpool_shrink,
+			 ptlrpc_objpool_shrink_count,
+			 ptlrpc_objpool_shrink_scan);
+
+	request_pool = ptlrpc_objpool_create("ptlrpc_cache",
+					     sizeof(struct ptlrpc_request),
+					     PTLRPC_REQUEST_POOL_MAX);
+	if (request_pool == NULL)
+		goto failed;
+
+	reply_state_pool = ptlrpc_objpool_create("ptlrpc_rs_cache",
+						 PTLRPC_RS_POOL_SIZE,
+						 PTLRPC_RS_POOL_MAX);
+	if (reply_state_pool == NULL)
+		goto failed;
+
+	rqbd_pool = ptlrpc_objpool_create("ptlrpc_rqbd_cache",
+				sizeof(struct ptlrpc_request_buffer_desc),
+				PTLRPC_RQBD_POOL_MAX);
+	if (rqbd_pool == NULL)
+		goto failed;
+
+	ptlrpc_objpool_shrinker = set_shrinker(DEFAULT_SEEKS, &shvar);
+	if (ptlrpc_objpool_shrinker == NULL)
+		goto failed;
+
+#ifdef CONFIG_PROC_FS
+	ptlrpc_objpool_proc_root = lprocfs_register("ptlrpc", proc_lustre_root,
+						ptlrpc_objpool_lprocfs_vars,
+						NULL);
+	if (IS_ERR(ptlrpc_objpool_proc_root)) {
+		/* not fatal, only the stats are missing */
+		CWARN("cannot register ptlrpc pool proc entries: rc = %ld\n",
+		      PTR_ERR(ptlrpc_objpool_proc_root));
+		ptlrpc_objpool_proc_root = NULL;
+	}
+#endif
+	return 0;
+failed:
+	ptlrpc_objpools_fini();
+	return -ENOMEM;
+}
+
+void ptlrpc_objpools_fini(void)
+{
+	if (ptlrpc_objpool_shrinker != NULL) {
+		remove_shrinker(ptlrpc_objpool_shrinker);
+		ptlrpc_objpool_shrinker = NULL;
+	}
+#ifdef CONFIG_PROC_FS
+	if (ptlrpc_objpool_proc_root != NULL)
+		lprocfs_remove(&ptlrpc_objpool_proc_root);
+#endif
+	ptlrpc_objpool_destroy(rqbd_pool);
+	rqbd_pool = NULL;
+	ptlrpc_objpool_destroy(reply_state_pool);
+	reply_state_pool = NULL;
+	ptlrpc_objpool_destroy(request_pool);
+	request_pool = NULL;
+}
@@ -1772,6 +1772,13 @@ void lustre_swab_ost_body (struct ost_body *b)
         lustre_swab_obdo (&b->oa);
 }
 
+void lustre_swab_ost_compound_op(struct ost_compound_op *op)
+{
+	__swab32s(&op->oco_opc);
+	__swab32s(&op->oco_rc);
+	lustre_swab_ost_body(&op->oco_body);
+}
+
 void lustre_swab_ost_last_id(u64 *id)
 {
         __swab64s(id);
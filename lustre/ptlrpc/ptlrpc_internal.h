@@ -51,6 +51,7 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_crrn;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_edf;
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -65,6 +66,17 @@ extern struct mutex pinger_mutex;
 int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait);
 /* ptlrpcd.c */
 int ptlrpcd_start(struct ptlrpcd_ctl *pc);
+void ptlrpcd_wake_sibling(struct ptlrpcd_ctl *pc, int depth);
+
+/* objpool.c */
+int ptlrpc_objpools_init(void);
+void ptlrpc_objpools_fini(void);
+struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags);
+void ptlrpc_request_cache_free(struct ptlrpc_request *req);
+struct ptlrpc_reply_state *ptlrpc_rs_alloc(int rs_size);
+void ptlrpc_rs_free(struct ptlrpc_reply_state *rs);
+struct ptlrpc_request_buffer_desc *ptlrpc_rqbd_alloc(int cpt);
+void ptlrpc_rqbd_free(struct ptlrpc_request_buffer_desc *rqbd);
 
 /* client.c */
 void ptlrpc_at_adj_net_latency(struct ptlrpc_request *req,
@@ -74,13 +86,14 @@ struct ptlrpc_bulk_desc *ptlrpc_new_bulk(unsigned npages, unsigned max_brw,
 					 unsigned portal,
 					 const struct ptlrpc_bulk_frag_ops
 						*ops);
-int ptlrpc_request_cache_init(void);
-void ptlrpc_request_cache_fini(void);
-struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags);
-void ptlrpc_request_cache_free(struct ptlrpc_request *req);
 void ptlrpc_init_xid(void);
 void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 			    struct ptlrpc_request *req);
+int ptlrpc_check_set_ready(const struct lu_env *env,
+			   struct ptlrpc_request_set *set);
+void ptlrpc_set_del_ready(struct ptlrpc_request_set *set,
+			  struct ptlrpc_request *req);
+void ptlrpc_set_clear_ready(struct ptlrpc_request_set *set);
 int ptlrpc_expired_set(void *data);
 int ptlrpc_set_next_timeout(struct ptlrpc_request_set *);
 void ptlrpc_resend_req(struct ptlrpc_request *request);
@@ -148,6 +161,11 @@ void ptlrpc_nrs_req_stop_nolock(struct ptlrpc_request *req);
 void ptlrpc_nrs_req_add(struct ptlrpc_service_part *svcpt,
 			struct ptlrpc_request *req, bool hp);
 
+/* no uid or gid in the request, see nrs_req_ugid() */
+#define NRS_UGID_NONE	((__u32)~0U)
+void nrs_req_ugid(struct ptlrpc_request *req, __u32 opc,
+		  __u32 *uid, __u32 *gid);
+
 struct ptlrpc_request *
 ptlrpc_nrs_req_get_nolock0(struct ptlrpc_service_part *svcpt, bool hp,
 			   bool peek, bool force);
@@ -371,6 +389,7 @@ static inline void ptlrpc_cli_req_init(struct ptlrpc_request *req)
 	req->rq_req_unlinked = req->rq_reply_unlinked = 1;
 
 	INIT_LIST_HEAD(&cr->cr_set_chain);
+	INIT_LIST_HEAD(&cr->cr_ready_chain);
 	INIT_LIST_HEAD(&cr->cr_ctx_chain);
 	INIT_LIST_HEAD(&cr->cr_unreplied_list);
 	init_waitqueue_head(&cr->cr_reply_waitq);
@@ -73,7 +73,7 @@ static __init int ptlrpc_init(void)
 	if (rc)
 		GOTO(err_tgt, rc);
 
-	rc = ptlrpc_request_cache_init();
+	rc = ptlrpc_objpools_init();
 	if (rc)
 		GOTO(err_hr, rc);
 
@@ -121,7 +121,7 @@ err_conn:
 err_portals:
 	ptlrpc_exit_portals();
 err_cache:
-	ptlrpc_request_cache_fini();
+	ptlrpc_objpools_fini();
 err_hr:
 	ptlrpc_hr_fini();
 err_tgt:
@@ -139,7 +139,7 @@ static void __exit ptlrpc_exit(void)
 	ldlm_exit();
 	ptlrpc_stop_pinger();
 	ptlrpc_exit_portals();
-	ptlrpc_request_cache_fini();
+	ptlrpc_objpools_fini();
 	ptlrpc_hr_fini();
 	ptlrpc_connection_fini();
 	tgt_mod_exit();
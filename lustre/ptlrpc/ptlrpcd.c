@@ -107,7 +107,8 @@ MODULE_PARM_DESC(ptlrpcd_per_cpt_max,
  * ptlrpcd_partner_group_size: The desired number of threads in each
  * ptlrpcd partner thread group. Default is 2, corresponding to the
  * old PDB_POLICY_PAIR. A negative value makes all ptlrpcd threads in
- * a CPT partners of each other.
+ * a CPT partners of each other. With 1, threads have no partners and
+ * never steal requests from any other thread.
  */
 static int ptlrpcd_partner_group_size;
 module_param(ptlrpcd_partner_group_size, int, 0644);
@@ -151,6 +152,53 @@ static struct ptlrpcd	**ptlrpcds;
  */
 static struct ptlrpcd_ctl ptlrpcd_rcv;
 
+#ifdef CONFIG_PROC_FS
+static struct proc_dir_entry *ptlrpcd_proc_root;
+
+static int ptlrpcd_threads_seq_show(struct seq_file *m, void *v)
+{
+	struct ptlrpcd_ctl *pc;
+	int i;
+	int j;
+
+	seq_printf(m, "%-16s %4s %4s %8s %8s %12s %12s\n", "thread", "cpt",
+		   "node", "queued", "active", "steals", "stolen");
+
+	/* the file only exists while the threads are set up, see
+	 * ptlrpcd_init() and ptlrpcd_fini() */
+	for (i = 0; i < ptlrpcds_num; i++) {
+		if (ptlrpcds[i] == NULL)
+			break;
+		for (j = 0; j < ptlrpcds[i]->pd_nthreads; j++) {
+			int queued = 0;
+			int active = 0;
+
+			pc = &ptlrpcds[i]->pd_threads[j];
+			spin_lock(&pc->pc_lock);
+			if (pc->pc_set != NULL) {
+				queued = atomic_read(&pc->pc_set->set_new_count);
+				active = atomic_read(&pc->pc_set->set_remaining);
+			}
+			spin_unlock(&pc->pc_lock);
+
+			seq_printf(m, "%-16s %4d %4d %8d %8d %12lu %12lu\n",
+				   pc->pc_name, pc->pc_cpt, pc->pc_node,
+				   queued, active, pc->pc_steals,
+				   pc->pc_stolen);
+		}
+	}
+
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ptlrpcd_threads);
+
+static struct lprocfs_vars ptlrpcd_lprocfs_vars[] = {
+	{ .name	=	"threads",
+	  .fops	=	&ptlrpcd_threads_fops	},
+	{ NULL }
+};
+#endif /* CONFIG_PROC_FS */
+
 struct mutex ptlrpcd_mutex;
 static int ptlrpcd_users = 0;
 
@@ -159,7 +207,7 @@ void ptlrpcd_wake(struct ptlrpc_request *req)
 	struct ptlrpc_request_set *set = req->rq_set;
 
 	LASSERT(set != NULL);
-	wake_up(&set->set_waitq);
+	ptlrpc_set_wake_req(set, req);
 }
 EXPORT_SYMBOL(ptlrpcd_wake);
 
@@ -231,32 +279,138 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 }
 
 /**
+ * Move the older half of the new requests of \a src to \a des, leaving the
+ * rest to the owner of \a src so that neither thread ends up idle.
+ *
  * Return transferred RPCs count.
  */
 static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
                                struct ptlrpc_request_set *src)
 {
-	struct list_head *tmp, *pos;
 	struct ptlrpc_request *req;
+	struct list_head stolen;
+	int count;
 	int rc = 0;
 
+	INIT_LIST_HEAD(&stolen);
 	spin_lock(&src->set_new_req_lock);
-	if (likely(!list_empty(&src->set_new_requests))) {
-		list_for_each_safe(pos, tmp, &src->set_new_requests) {
-			req = list_entry(pos, struct ptlrpc_request,
-					 rq_set_chain);
-			req->rq_set = des;
-		}
-		list_splice_init(&src->set_new_requests,
-				 &des->set_requests);
-		rc = atomic_read(&src->set_new_count);
-		atomic_add(rc, &des->set_remaining);
-		atomic_set(&src->set_new_count, 0);
+	spin_lock(&src->set_ready_lock);
+	count = (atomic_read(&src->set_new_count) + 1) / 2;
+	while (rc < count && !list_empty(&src->set_new_requests)) {
+		req = list_entry(src->set_new_requests.next,
+				 struct ptlrpc_request, rq_set_chain);
+		list_move_tail(&req->rq_set_chain, &des->set_requests);
+		/* the request was maybe woken up while queued */
+		list_del_init(&req->rq_ready_chain);
+		list_add_tail(&req->rq_ready_chain, &stolen);
+		rc++;
 	}
+	atomic_sub(rc, &src->set_new_count);
+	atomic_add(rc, &des->set_remaining);
+	spin_unlock(&src->set_ready_lock);
 	spin_unlock(&src->set_new_req_lock);
+
+	/* Stolen requests are checked along with the ready ones. rq_set is
+	 * only switched under des->set_ready_lock, once rq_ready_chain is
+	 * already on the stolen list: ptlrpc_set_wake_req() then either sees
+	 * the old set, or the new one with the request queued as ready, and
+	 * never links the request into a list it doesn't own the lock of.
+	 * Taking des->set_ready_lock inside src's would deadlock against a
+	 * steal the other way round. */
+	spin_lock(&des->set_ready_lock);
+	list_for_each_entry(req, &stolen, rq_ready_chain)
+		req->rq_set = des;
+	list_splice_tail(&stolen, &des->set_ready_list);
+	spin_unlock(&des->set_ready_lock);
+
 	return rc;
 }
 
+/* Number of new requests which could be stolen from \a pc */
+static int ptlrpcd_stealable(struct ptlrpcd_ctl *pc)
+{
+	int count = 0;
+
+	spin_lock(&pc->pc_lock);
+	if (pc->pc_set != NULL)
+		count = atomic_read(&pc->pc_set->set_new_count);
+	spin_unlock(&pc->pc_lock);
+
+	return count;
+}
+
+/**
+ * Pick the thread an idle \a pc should steal requests from.
+ *
+ * Partners are tried first since they are meant to share each other's
+ * load. Failing that, the thread with the deepest queue in the CPT is
+ * taken, with queues of threads last seen on the same NUMA node weighted
+ * double so that requests and their buffers rather stay node local.
+ */
+static struct ptlrpcd_ctl *ptlrpcd_select_victim(struct ptlrpcd_ctl *pc)
+{
+	struct ptlrpcd_ctl	*victim = NULL;
+	struct ptlrpcd_ctl	*cand;
+	int			 node = numa_node_id();
+	int			 best = 0;
+	int			 count;
+	int			 i;
+
+	for (i = 0; i < pc->pc_npartners; i++) {
+		cand = pc->pc_partners[i];
+		count = ptlrpcd_stealable(cand);
+		if (count > best) {
+			best = count;
+			victim = cand;
+		}
+	}
+	if (victim != NULL)
+		return victim;
+
+	for (i = 0; i < pc->pc_nsiblings; i++) {
+		cand = &pc->pc_siblings[i];
+		if (cand == pc)
+			continue;
+
+		count = ptlrpcd_stealable(cand);
+		if (cand->pc_node == node)
+			count *= 2;
+		if (count > best) {
+			best = count;
+			victim = cand;
+		}
+	}
+
+	return victim;
+}
+
+/* a sibling is woken up to steal each time this many requests queue up */
+#define PTLRPCD_STEAL_BATCH	8
+
+/**
+ * Called when a request was queued to \a pc making its queue \a depth
+ * long. Every PTLRPCD_STEAL_BATCH requests another thread of the CPT is
+ * woken up, so that a backlog behind a single busy thread gets stolen
+ * without waiting for the siblings to time out.
+ */
+void ptlrpcd_wake_sibling(struct ptlrpcd_ctl *pc, int depth)
+{
+	struct ptlrpcd_ctl *sibling;
+
+	if (pc->pc_nsiblings <= 1 || depth % PTLRPCD_STEAL_BATCH != 0)
+		return;
+
+	sibling = &pc->pc_siblings[(pc->pc_index + depth / PTLRPCD_STEAL_BATCH)
+				   % pc->pc_nsiblings];
+	if (sibling == pc)
+		return;
+
+	spin_lock(&sibling->pc_lock);
+	if (sibling->pc_set != NULL)
+		wake_up(&sibling->pc_set->set_waitq);
+	spin_unlock(&sibling->pc_lock);
+}
+
 /**
  * Requests that are added to the ptlrpcd queue are sent via
  * ptlrpcd_check->ptlrpc_check_set().
@@ -285,7 +439,7 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 		/* ptlrpc_check_set will decrease the count */
 		atomic_inc(&req->rq_set->set_remaining);
 		spin_unlock(&req->rq_lock);
-		wake_up(&req->rq_set->set_waitq);
+		ptlrpc_client_wake_req(req);
 		return;
 	} else {
 		spin_unlock(&req->rq_lock);
@@ -321,6 +475,15 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 	if (atomic_read(&set->set_new_count)) {
 		spin_lock(&set->set_new_req_lock);
 		if (likely(!list_empty(&set->set_new_requests))) {
+			/* new requests are checked along with the ready ones */
+			spin_lock(&set->set_ready_lock);
+			list_for_each_entry(req, &set->set_new_requests,
+					    rq_set_chain) {
+				if (list_empty(&req->rq_ready_chain))
+					list_add_tail(&req->rq_ready_chain,
+						      &set->set_ready_list);
+			}
+			spin_unlock(&set->set_ready_lock);
 			list_splice_init(&set->set_new_requests,
 					     &set->set_requests);
 			atomic_add(atomic_read(&set->set_new_count),
@@ -353,8 +516,18 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 		RETURN(rc);
 	}
 
-	if (atomic_read(&set->set_remaining))
-		rc |= ptlrpc_check_set(env, set);
+	/* Only the requests signalled by events need to be checked. All of
+	 * them are checked when a timeout expired and once a second, for the
+	 * few states which are left on timers (delayed send and resend). */
+	if (atomic_read(&set->set_remaining)) {
+		if (atomic_xchg(&set->set_rescan, 0) ||
+		    cfs_time_aftereq(cfs_time_current(), set->set_next_scan)) {
+			set->set_next_scan = cfs_time_shift(1);
+			rc |= ptlrpc_check_set(env, set);
+		} else {
+			rc |= ptlrpc_check_set_ready(env, set);
+		}
+	}
 
 	/* NB: ptlrpc_check_set has already moved complted request at the
 	 * head of seq::set_requests */
@@ -365,49 +538,47 @@ static int ptlrpcd_check(struct lu_env *env, struct ptlrpcd_ctl *pc)
 
 		list_del_init(&req->rq_set_chain);
 		req->rq_set = NULL;
+		ptlrpc_set_del_ready(set, req);
 		ptlrpc_req_finished(req);
 	}
 
+	/* the ready list was not drained in a single pass */
+	if (!list_empty(&set->set_ready_list))
+		rc = 1;
+
 	if (rc == 0) {
 		/*
 		 * If new requests have been added, make sure to wake up.
 		 */
 		rc = atomic_read(&set->set_new_count);
 
-                /* If we have nothing to do, check whether we can take some
-                 * work from our partner threads. */
-                if (rc == 0 && pc->pc_npartners > 0) {
-                        struct ptlrpcd_ctl *partner;
-                        struct ptlrpc_request_set *ps;
-                        int first = pc->pc_cursor;
-
-                        do {
-                                partner = pc->pc_partners[pc->pc_cursor++];
-                                if (pc->pc_cursor >= pc->pc_npartners)
-                                        pc->pc_cursor = 0;
-                                if (partner == NULL)
-                                        continue;
-
-				spin_lock(&partner->pc_lock);
-				ps = partner->pc_set;
-				if (ps == NULL) {
-					spin_unlock(&partner->pc_lock);
-					continue;
-				}
-
-				ptlrpc_reqset_get(ps);
-				spin_unlock(&partner->pc_lock);
+		/* If we have nothing to do, check whether we can take some
+		 * work from the other threads of our CPT. */
+		if (rc == 0 && pc->pc_nsiblings > 1) {
+			struct ptlrpcd_ctl *victim;
+			struct ptlrpc_request_set *ps = NULL;
+
+			victim = ptlrpcd_select_victim(pc);
+			if (victim != NULL) {
+				spin_lock(&victim->pc_lock);
+				ps = victim->pc_set;
+				if (ps != NULL)
+					ptlrpc_reqset_get(ps);
+				spin_unlock(&victim->pc_lock);
+			}
 
-				if (atomic_read(&ps->set_new_count)) {
-					rc = ptlrpcd_steal_rqset(set, ps);
-					if (rc > 0)
-						CDEBUG(D_RPCTRACE, "transfer %d"
-						       " async RPCs [%d->%d]\n",
-						       rc, partner->pc_index,
-						       pc->pc_index);
+			if (ps != NULL) {
+				rc = ptlrpcd_steal_rqset(set, ps);
+				if (rc > 0) {
+					pc->pc_steals++;
+					pc->pc_stolen += rc;
+					CDEBUG(D_RPCTRACE, "transfer %d"
+					       " async RPCs [%d->%d]\n",
+					       rc, victim->pc_index,
+					       pc->pc_index);
 				}
 				ptlrpc_reqset_put(ps);
-			} while (rc == 0 && pc->pc_cursor != first);
+			}
 		}
 	}
 
@@ -444,6 +615,8 @@ static int ptlrpcd(void *arg)
 	set = ptlrpc_prep_set();
 	if (set == NULL)
 		GOTO(failed, rc = -ENOMEM);
+	set->set_event_driven = 1;
+	set->set_next_scan = cfs_time_current();
 	spin_lock(&pc->pc_lock);
 	pc->pc_set = set;
 	spin_unlock(&pc->pc_lock);
@@ -480,6 +653,7 @@ static int ptlrpcd(void *arg)
                 lwi = LWI_TIMEOUT(cfs_time_seconds(timeout ? timeout : 1),
                                   ptlrpc_expired_set, set);
 
+		pc->pc_node = numa_node_id();
 		lu_context_enter(&env.le_ctx);
 		lu_context_enter(env.le_ses);
 		l_wait_event(set->set_waitq, ptlrpcd_check(&env, pc), &lwi);
@@ -504,6 +678,10 @@ static int ptlrpcd(void *arg)
         /*
          * Wait for inflight requests to drain.
          */
+	spin_lock(&set->set_ready_lock);
+	set->set_event_driven = 0;
+	spin_unlock(&set->set_ready_lock);
+	ptlrpc_set_clear_ready(set);
 	if (!list_empty(&set->set_requests))
                 ptlrpc_set_wait(set);
 	lu_context_fini(&env.le_ctx);
@@ -525,6 +703,7 @@ static void ptlrpcd_ctl_init(struct ptlrpcd_ctl *pc, int index, int cpt)
 
 	pc->pc_index = index;
 	pc->pc_cpt = cpt;
+	pc->pc_node = NUMA_NO_NODE;
 	init_completion(&pc->pc_starting);
 	init_completion(&pc->pc_finishing);
 	spin_lock_init(&pc->pc_lock);
@@ -557,6 +736,10 @@ static void ptlrpcd_ctl_init(struct ptlrpcd_ctl *pc, int index, int cpt)
  *      The desired number of partner threads can be tuned by setting
  *      ptlrpcd_partner_group_size. The default is to create pairs of
  *      partner threads.
+ *
+ *      Partners are only the preferred victims: an idle thread steals
+ *      half of the queued requests of the busiest thread in its CPT,
+ *      see ptlrpcd_select_victim().
  */
 static int ptlrpcd_partners(struct ptlrpcd *pd, int index)
 {
@@ -570,6 +753,11 @@ static int ptlrpcd_partners(struct ptlrpcd *pd, int index)
 	LASSERT(index >= 0 && index < pd->pd_nthreads);
 	pc = &pd->pd_threads[index];
 	pc->pc_npartners = pd->pd_groupsize - 1;
+	/* a thread without partners keeps to its own requests */
+	if (pc->pc_npartners > 0) {
+		pc->pc_siblings = pd->pd_threads;
+		pc->pc_nsiblings = pd->pd_nthreads;
+	}
 
 	if (pc->pc_npartners <= 0)
 		GOTO(out, rc);
@@ -653,6 +841,7 @@ void ptlrpcd_stop(struct ptlrpcd_ctl *pc, int force)
 	set_bit(LIOD_STOP, &pc->pc_flags);
 	if (force)
 		set_bit(LIOD_FORCE, &pc->pc_flags);
+	atomic_set(&pc->pc_set->set_rescan, 1);
 	wake_up(&pc->pc_set->set_waitq);
 
 out:
@@ -690,6 +879,8 @@ out:
                 pc->pc_partners = NULL;
         }
         pc->pc_npartners = 0;
+	pc->pc_siblings = NULL;
+	pc->pc_nsiblings = 0;
 	pc->pc_error = 0;
         EXIT;
 }
@@ -701,6 +892,11 @@ static void ptlrpcd_fini(void)
 	int	ncpts;
 	ENTRY;
 
+#ifdef CONFIG_PROC_FS
+	if (ptlrpcd_proc_root != NULL)
+		lprocfs_remove(&ptlrpcd_proc_root);
+#endif
+
 	if (ptlrpcds != NULL) {
 		for (i = 0; i < ptlrpcds_num; i++) {
 			if (ptlrpcds[i] == NULL)
@@ -941,6 +1137,17 @@ static int ptlrpcd_init(void)
 				GOTO(out, rc);
 		}
 	}
+
+#ifdef CONFIG_PROC_FS
+	ptlrpcd_proc_root = lprocfs_register("ptlrpcd", proc_lustre_root,
+					     ptlrpcd_lprocfs_vars, NULL);
+	if (IS_ERR(ptlrpcd_proc_root)) {
+		/* not fatal, only the stats are missing */
+		CWARN("cannot register ptlrpcd proc entries: rc = %ld\n",
+		      PTR_ERR(ptlrpcd_proc_root));
+		ptlrpcd_proc_root = NULL;
+	}
+#endif
 out:
 	if (rc != 0)
 		ptlrpcd_fini();
@@ -315,7 +315,7 @@ int null_alloc_rs(struct ptlrpc_request *req, int msgsize)
                 /* pre-allocated */
                 LASSERT(rs->rs_size >= rs_size);
         } else {
-		OBD_ALLOC_LARGE(rs, rs_size);
+		rs = ptlrpc_rs_alloc(rs_size);
 		if (rs == NULL)
 			return -ENOMEM;
 
@@ -340,7 +340,7 @@ void null_free_rs(struct ptlrpc_reply_state *rs)
 	atomic_dec(&rs->rs_svc_ctx->sc_refcount);
 
 	if (!rs->rs_prealloc)
-		OBD_FREE_LARGE(rs, rs->rs_size);
+		ptlrpc_rs_free(rs);
 }
 
 static
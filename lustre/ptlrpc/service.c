@@ -70,20 +70,24 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 {
 	struct ptlrpc_service		  *svc = svcpt->scp_service;
 	struct ptlrpc_request_buffer_desc *rqbd;
+	int				   cpt = svcpt->scp_home_cpt;
 
-	OBD_CPT_ALLOC_PTR(rqbd, svc->srv_cptable, svcpt->scp_cpt);
+	/* the descriptor pools are partitioned by the global CPT table */
+	rqbd = ptlrpc_rqbd_alloc(svc->srv_cptable == cfs_cpt_table ?
+				 cpt : CFS_CPT_ANY);
 	if (rqbd == NULL)
 		return NULL;
 
 	rqbd->rqbd_svcpt = svcpt;
 	rqbd->rqbd_refcount = 0;
+	rqbd->rqbd_cpt = cpt;
 	rqbd->rqbd_cbid.cbid_fn = request_in_callback;
 	rqbd->rqbd_cbid.cbid_arg = rqbd;
 	INIT_LIST_HEAD(&rqbd->rqbd_reqs);
 	OBD_CPT_ALLOC_LARGE(rqbd->rqbd_buffer, svc->srv_cptable,
-			    svcpt->scp_cpt, svc->srv_buf_size);
+			    cpt, svc->srv_buf_size);
 	if (rqbd->rqbd_buffer == NULL) {
-		OBD_FREE_PTR(rqbd);
+		ptlrpc_rqbd_free(rqbd);
 		return NULL;
 	}
 
@@ -109,7 +113,7 @@ ptlrpc_free_rqbd(struct ptlrpc_request_buffer_desc *rqbd)
 	spin_unlock(&svcpt->scp_lock);
 
 	OBD_FREE_LARGE(rqbd->rqbd_buffer, svcpt->scp_service->srv_buf_size);
-	OBD_FREE_PTR(rqbd);
+	ptlrpc_rqbd_free(rqbd);
 }
 
 static int
@@ -205,6 +209,8 @@ struct ptlrpc_hr_thread {
 	spinlock_t			hrt_lock;
 	wait_queue_head_t		hrt_waitq;
 	struct list_head			hrt_queue;	/* RS queue */
+	/* # of replies on hrt_queue */
+	unsigned int			hrt_nqueued;
 	struct ptlrpc_hr_partition	*hrt_partition;
 };
 
@@ -288,6 +294,34 @@ ptlrpc_hr_select(struct ptlrpc_service_part *svcpt)
 	return &hrp->hrp_thrs[rotor % hrp->hrp_nthrs];
 }
 
+/**
+ * Queue \a n replies of \a replies on \a hrt.
+ *
+ * The thread is only woken when its queue becomes non-empty. Replies queued
+ * while it is busy are taken together on its next pass, so they are batched
+ * without ever being held back.
+ */
+static void ptlrpc_hr_queue(struct ptlrpc_hr_thread *hrt,
+			    struct list_head *replies, unsigned int n)
+{
+	struct ptlrpc_reply_state	*rs;
+	struct timeval			now;
+	bool				wake;
+
+	do_gettimeofday(&now);
+	list_for_each_entry(rs, replies, rs_list)
+		rs->rs_hr_queued = now;
+
+	spin_lock(&hrt->hrt_lock);
+	wake = hrt->hrt_nqueued == 0;
+	list_splice_init(replies, &hrt->hrt_queue);
+	hrt->hrt_nqueued += n;
+	spin_unlock(&hrt->hrt_lock);
+
+	if (wake)
+		wake_up(&hrt->hrt_waitq);
+}
+
 /**
  * Dispatch all replies accumulated in the batch to one from
  * dedicated reply handling threads.
@@ -300,12 +334,7 @@ static void rs_batch_dispatch(struct rs_batch *b)
 		struct ptlrpc_hr_thread	*hrt;
 
 		hrt = ptlrpc_hr_select(b->rsb_svcpt);
-
-		spin_lock(&hrt->hrt_lock);
-		list_splice_init(&b->rsb_replies, &hrt->hrt_queue);
-		spin_unlock(&hrt->hrt_lock);
-
-		wake_up(&hrt->hrt_waitq);
+		ptlrpc_hr_queue(hrt, &b->rsb_replies, b->rsb_n_replies);
 		b->rsb_n_replies = 0;
 	}
 }
@@ -364,18 +393,17 @@ static void rs_batch_fini(struct rs_batch *b)
  */
 void ptlrpc_dispatch_difficult_reply(struct ptlrpc_reply_state *rs)
 {
-	struct ptlrpc_hr_thread *hrt;
+	struct ptlrpc_hr_thread	*hrt;
+	struct list_head	 replies;
 	ENTRY;
 
 	LASSERT(list_empty(&rs->rs_list));
 
 	hrt = ptlrpc_hr_select(rs->rs_svcpt);
 
-	spin_lock(&hrt->hrt_lock);
-	list_add_tail(&rs->rs_list, &hrt->hrt_queue);
-	spin_unlock(&hrt->hrt_lock);
-
-	wake_up(&hrt->hrt_waitq);
+	INIT_LIST_HEAD(&replies);
+	list_add_tail(&rs->rs_list, &replies);
+	ptlrpc_hr_queue(hrt, &replies, 1);
 	EXIT;
 }
 
@@ -588,12 +616,50 @@ ptlrpc_server_nthreads_check(struct ptlrpc_service *svc,
 	}
 }
 
+/**
+ * Fill \a homes, indexed by partition of the LNet CPT table (\a nhomes
+ * CPTs), with the CPT each partition allocates request buffers on and binds
+ * its threads to. That is the partition's own CPT if an NI receives on it;
+ * partitions on CPTs no NI receives on are spread in turn over the CPTs NIs
+ * do receive on.
+ * Threads post the buffers with LNET_INS_LOCAL, so they end up in the match
+ * tables of the CPTs LNet delivers requests on.
+ */
+static void
+ptlrpc_service_homes(int *homes, int nhomes)
+{
+	int	nnis = 0;
+	int	next = -1;
+	int	i;
+
+	for (i = 0; i < nhomes; i++) {
+		homes[i] = LNetCPTHasNI(i) ? i : -1;
+		if (homes[i] >= 0)
+			nnis++;
+	}
+
+	for (i = 0; i < nhomes; i++) {
+		if (homes[i] >= 0)
+			continue;
+
+		if (nnis == 0) {
+			homes[i] = i;
+			continue;
+		}
+
+		do {
+			next = (next + 1) % nhomes;
+		} while (homes[next] != next);
+		homes[i] = next;
+	}
+}
+
 /**
  * Initialize percpt data for a service
  */
 static int
 ptlrpc_service_part_init(struct ptlrpc_service *svc,
-			 struct ptlrpc_service_part *svcpt, int cpt)
+			 struct ptlrpc_service_part *svcpt, int cpt, int home)
 {
 	struct ptlrpc_at_array	*array;
 	int			size;
@@ -601,6 +667,7 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	int			rc;
 
 	svcpt->scp_cpt = cpt;
+	svcpt->scp_home_cpt = home;
 	INIT_LIST_HEAD(&svcpt->scp_threads);
 
 	/* rqbd and incoming request queue */
@@ -691,6 +758,7 @@ ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	struct ptlrpc_service_part	*svcpt;
 	struct cfs_cpt_table		*cptable;
 	__u32				*cpts = NULL;
+	int				*homes = NULL;
 	int				ncpts;
 	int				cpt;
 	int				rc;
@@ -776,6 +844,15 @@ ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 	service->srv_hpreq_ratio	= PTLRPC_SVC_HP_RATIO;
 	service->srv_ops		= conf->psc_ops;
 
+	/* LNet only tells which CPTs of its own table receive requests */
+	if (conf->psc_thr.tc_cpu_affinity && cptable == cfs_cpt_table) {
+		OBD_ALLOC(homes, sizeof(*homes) * cfs_cpt_number(cptable));
+		if (homes == NULL)
+			GOTO(failed, rc = -ENOMEM);
+
+		ptlrpc_service_homes(homes, cfs_cpt_number(cptable));
+	}
+
 	for (i = 0; i < ncpts; i++) {
 		if (!conf->psc_thr.tc_cpu_affinity)
 			cpt = CFS_CPT_ANY;
@@ -787,11 +864,17 @@ ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 			GOTO(failed, rc = -ENOMEM);
 
 		service->srv_parts[i] = svcpt;
-		rc = ptlrpc_service_part_init(service, svcpt, cpt);
+		rc = ptlrpc_service_part_init(service, svcpt, cpt,
+					      homes != NULL ? homes[cpt] : cpt);
 		if (rc != 0)
 			GOTO(failed, rc);
 	}
 
+	if (homes != NULL) {
+		OBD_FREE(homes, sizeof(*homes) * cfs_cpt_number(cptable));
+		homes = NULL;
+	}
+
 	ptlrpc_server_nthreads_check(service, conf);
 
 	rc = LNetSetLazyPortal(service->srv_req_portal);
@@ -820,6 +903,8 @@ ptlrpc_register_service(struct ptlrpc_service_conf *conf,
 
 	RETURN(service);
 failed:
+	if (homes != NULL)
+		OBD_FREE(homes, sizeof(*homes) * cfs_cpt_number(cptable));
 	ptlrpc_unregister_service(service);
 	RETURN(ERR_PTR(rc));
 }
@@ -2395,10 +2480,10 @@ static int ptlrpc_main(void *arg)
 	/* NB: we will call cfs_cpt_bind() for all threads, because we
 	 * might want to run lustre server only on a subset of system CPUs,
 	 * in that case ->scp_cpt is CFS_CPT_ANY */
-	rc = cfs_cpt_bind(svc->srv_cptable, svcpt->scp_cpt);
+	rc = cfs_cpt_bind(svc->srv_cptable, svcpt->scp_home_cpt);
 	if (rc != 0) {
 		CWARN("%s: failed to bind %s on CPT %d\n",
-		      svc->srv_name, thread->t_name, svcpt->scp_cpt);
+		      svc->srv_name, thread->t_name, svcpt->scp_home_cpt);
 	}
 
 	ginfo = groups_alloc(0);
@@ -2560,20 +2645,26 @@ out:
 	return rc;
 }
 
-static int hrt_dont_sleep(struct ptlrpc_hr_thread *hrt,
-			  struct list_head *replies)
+static int hrt_dont_sleep(struct ptlrpc_hr_thread *hrt)
 {
 	int result;
 
 	spin_lock(&hrt->hrt_lock);
-
-	list_splice_init(&hrt->hrt_queue, replies);
-	result = ptlrpc_hr.hr_stopping || !list_empty(replies);
-
+	result = ptlrpc_hr.hr_stopping || hrt->hrt_nqueued != 0;
 	spin_unlock(&hrt->hrt_lock);
+
 	return result;
 }
 
+/**
+ * Account \a n replies of \a svc handled in one pass of an hr thread.
+ */
+static void ptlrpc_hr_batch_stats(struct ptlrpc_service *svc, unsigned int n)
+{
+	if (svc != NULL && svc->srv_stats != NULL && n != 0)
+		lprocfs_counter_add(svc->srv_stats, PTLRPC_REPBATCH_CNTR, n);
+}
+
 /**
  * Main body of "handle reply" function.
  * It processes acked reply states
@@ -2601,8 +2692,18 @@ static int ptlrpc_hr_main(void *arg)
 	wake_up(&ptlrpc_hr.hr_waitq);
 
 	while (!ptlrpc_hr.hr_stopping) {
-		l_wait_condition(hrt->hrt_waitq, hrt_dont_sleep(hrt, &replies));
+		struct ptlrpc_service	*svc = NULL;
+		struct timeval		now;
+		unsigned int		n = 0;
 
+		l_wait_condition(hrt->hrt_waitq, hrt_dont_sleep(hrt));
+
+		spin_lock(&hrt->hrt_lock);
+		list_splice_init(&hrt->hrt_queue, &replies);
+		hrt->hrt_nqueued = 0;
+		spin_unlock(&hrt->hrt_lock);
+
+		do_gettimeofday(&now);
 		while (!list_empty(&replies)) {
 			struct ptlrpc_reply_state *rs;
 
@@ -2610,8 +2711,24 @@ static int ptlrpc_hr_main(void *arg)
 					struct ptlrpc_reply_state,
 					rs_list);
 			list_del_init(&rs->rs_list);
+
+			/* rs may be freed by ptlrpc_handle_rs(), the service
+			 * outlives its replies */
+			if (rs->rs_svcpt->scp_service != svc) {
+				ptlrpc_hr_batch_stats(svc, n);
+				svc = rs->rs_svcpt->scp_service;
+				n = 0;
+			}
+			n++;
+			if (svc->srv_stats != NULL)
+				lprocfs_counter_add(svc->srv_stats,
+					PTLRPC_REPWAIT_CNTR,
+					cfs_timeval_sub(&now, &rs->rs_hr_queued,
+							NULL));
+
 			ptlrpc_handle_rs(rs);
 		}
+		ptlrpc_hr_batch_stats(svc, n);
 	}
 
 	atomic_inc(&hrp->hrp_nstopped);
@@ -2808,7 +2925,7 @@ int ptlrpc_start_thread(struct ptlrpc_service_part *svcpt, int wait)
 	     svcpt->scp_nthrs_running == svc->srv_nthrs_cpt_init - 1))
 		RETURN(-EMFILE);
 
-	OBD_CPT_ALLOC_PTR(thread, svc->srv_cptable, svcpt->scp_cpt);
+	OBD_CPT_ALLOC_PTR(thread, svc->srv_cptable, svcpt->scp_home_cpt);
 	if (thread == NULL)
 		RETURN(-ENOMEM);
 	init_waitqueue_head(&thread->t_ctl_waitq);
@@ -238,26 +238,19 @@ static int tgt_io_data_unpack(struct tgt_session_info *tsi, struct ost_id *oi)
 	RETURN(0);
 }
 
-static int tgt_ost_body_unpack(struct tgt_session_info *tsi, __u32 flags)
+/* Validate the obdo of \a body and map its ids through the client nodemap */
+static int tgt_ost_body_map(struct tgt_session_info *tsi, struct ost_body *body)
 {
-	struct ost_body		*body;
-	struct req_capsule	*pill = tsi->tsi_pill;
 	struct lu_nodemap	*nodemap;
 	int			 rc;
 
-	ENTRY;
-
-	body = req_capsule_client_get(pill, &RMF_OST_BODY);
-	if (body == NULL)
-		RETURN(-EFAULT);
-
 	rc = tgt_validate_obdo(tsi, &body->oa);
 	if (rc)
-		RETURN(rc);
+		return rc;
 
 	nodemap = nodemap_get_from_exp(tsi->tsi_exp);
 	if (IS_ERR(nodemap))
-		RETURN(PTR_ERR(nodemap));
+		return PTR_ERR(nodemap);
 
 	body->oa.o_uid = nodemap_map_id(nodemap, NODEMAP_UID,
 					NODEMAP_CLIENT_TO_FS,
@@ -267,6 +260,25 @@ static int tgt_ost_body_unpack(struct tgt_session_info *tsi, __u32 flags)
 					body->oa.o_gid);
 	nodemap_putref(nodemap);
 
+	return 0;
+}
+
+static int tgt_ost_body_unpack(struct tgt_session_info *tsi, __u32 flags)
+{
+	struct ost_body		*body;
+	struct req_capsule	*pill = tsi->tsi_pill;
+	int			 rc;
+
+	ENTRY;
+
+	body = req_capsule_client_get(pill, &RMF_OST_BODY);
+	if (body == NULL)
+		RETURN(-EFAULT);
+
+	rc = tgt_ost_body_map(tsi, body);
+	if (rc)
+		RETURN(rc);
+
 	tsi->tsi_ost_body = body;
 	tsi->tsi_fid = body->oa.o_oi.oi_fid;
 
@@ -471,6 +483,56 @@ out:
 	RETURN(0);
 }
 
+/**
+ * Unpack one operation of an OST_COMPOUND request.
+ *
+ * Does for the ost_body embedded in a compound operation what
+ * tgt_request_preprocess() does for the ost_body of a plain OST RPC, so
+ * that the handler of the operation finds the session set up as usual.
+ * The reply body of the operation is set as tgt_ost_repbody().
+ *
+ * Every operation gets a transaction number of its own, as updates do in
+ * out_handle(), so that each of them updates last_rcvd, the object version
+ * and gets a commit callback. A replayed request keeps the single transno
+ * it is replayed with.
+ *
+ * \param[in] tsi	target session environment for this request
+ * \param[in] op	compound operation from the request
+ * \param[in] rep	reply slot of this operation
+ *
+ * \retval		0 if successful
+ * \retval		negative value on error
+ */
+int tgt_compound_op_unpack(struct tgt_session_info *tsi,
+			   struct ost_compound_op *op,
+			   struct ost_compound_op *rep)
+{
+	struct ost_body	*body = &op->oco_body;
+	int		 rc;
+
+	rc = tgt_ost_body_map(tsi, body);
+	if (rc)
+		return rc;
+
+	if (!(body->oa.o_valid & OBD_MD_FLID))
+		return -EPROTO;
+
+	tsi->tsi_ost_body = body;
+	tsi->tsi_fid = body->oa.o_oi.oi_fid;
+	ost_fid_build_resid(&tsi->tsi_fid, &tsi->tsi_resid);
+	tsi->tsi_corpus = NULL;
+	tsi->tsi_vbr_obj = NULL;
+	tgt_th_info(tsi->tsi_env)->tti_mult_trans =
+		!req_is_replay(tgt_ses_req(tsi));
+
+	memset(rep, 0, sizeof(*rep));
+	rep->oco_opc = op->oco_opc;
+	tsi->tsi_ost_repbody = &rep->oco_body;
+
+	return 0;
+}
+EXPORT_SYMBOL(tgt_compound_op_unpack);
+
 static int tgt_filter_recovery_request(struct ptlrpc_request *req,
 				       struct obd_device *obd, int *process)
 {
@@ -162,6 +162,381 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+# brw throughput of group s in the last "lst stat" sample of log $1
+lst_brw_bw () {
+    local log=$1
+
+    awk '/LNet Bandwidth of s/ { bw = 1; next }
+         bw && /^\[[RW]\]/ { last[$1] = $3 " " $4 }
+         /^\[LNet/ { bw = 0 }
+         END { print "read", last["[R]"], "write", last["[W]"] }' $log
+}
+
+# RPC rate of group s in the last "lst stat" sample of log $1
+lst_rpc_rate () {
+    local log=$1
+
+    awk '/LNet Rates of s/ { rt = 1; next }
+         rt && /^\[[RW]\]/ { last[$1] = $3 " " $4 }
+         /^\[LNet/ { rt = 0 }
+         END { print "recv", last["[R]"], "send", last["[W]"] }' $log
+}
+
+# brw between groups on this node only; 0@lo is the NID ptlrpc uses for
+# local peers, so all bulk goes through the loopback LND
+test_loopback_sub () {
+    local nid=$1
+
+    echo '#!/bin/bash'
+    echo 'set -e'
+
+    echo "$LST new_session --timeo 100000 hh"
+    echo "$LST add_group c $nid"
+    echo "$LST add_group s $nid"
+    echo "$LST add_batch b"
+
+    for t in "brw read" "brw write" ; do
+        echo "$LST add_test --batch b --loop $lst_LOOP --concurrency 8" \
+             "--from c --to s $t check=full size=1M"
+    done
+
+    echo $LST run b
+    echo sleep 1
+    echo "$LST stat --delay 10 --count 3 c s"
+}
+
+test_loopback () {
+    local param=/sys/module/lnet/parameters/lo_page_loan
+    [ -f $param ] || { skip "no loopback page loan" && return 0; }
+
+    lst_prepare
+
+    local runlst=$TMP/loopback.sh
+    local log=$TMP/$tfile.log
+    local saved=$(cat $param)
+    local rc=0
+    local loan
+
+    test_loopback_sub 0@lo > $runlst
+    cat $runlst
+
+    # copy (0) vs page loan (1); check=full fails the brw on bad data
+    for loan in 0 1; do
+        echo $loan > $param
+
+        run_lst $runlst | tee $log.$loan
+        rc=${PIPESTATUS[0]}
+        [ $rc = 0 ] || break
+
+        echo "loopback brw lo_page_loan=$loan:" $(lst_brw_bw $log.$loan)
+
+        lst_end_session --verbose | tee -a $log.$loan
+    done
+    echo $saved > $param
+
+    [ $rc = 0 ] || error "$runlst failed: $rc"
+    check_lst_err $log.0
+    check_lst_err $log.1
+    lst_cleanup_all
+}
+run_test loopback "lst brw over the loopback NI, copy vs page loan"
+
+test_socklnd_sub () {
+    local servers=$1
+    local clients=$2
+
+    local nc=$(echo ${clients//,/ } | wc -w)
+    local ns=$(echo ${servers//,/ } | wc -w)
+
+    echo '#!/bin/bash'
+    echo 'set -e'
+
+    echo "$LST new_session --timeo 100000 hh"
+    echo "$LST add_group c $(nids_list $clients)"
+    echo "$LST add_group s $(nids_list $servers)"
+    echo "$LST add_batch b"
+
+    for t in "brw read" "brw write" ; do
+        echo "$LST add_test --batch b --loop $lst_LOOP --concurrency 8" \
+             "--distribute ${nc}:${ns} --from c --to s $t" \
+             "check=full size=1M"
+    done
+
+    echo $LST run b
+    echo sleep 1
+    echo "$LST stat --delay 10 --count 3 c s"
+}
+
+# set ksocklnd module parameter $1 to $2 on all nodes
+socklnd_set_param () {
+    do_nodes $(comma_list $(all_nodes)) \
+        "echo $2 > /sys/module/ksocklnd/parameters/$1"
+}
+
+# run lst script $1 once, and report its brw bandwidth as $2
+socklnd_brw_run () {
+    local runlst=$1
+    local log=$TMP/$tfile.log
+    local rc
+
+    # socket parameters are applied when a connection is set up
+    do_nodes $(comma_list $(all_nodes)) "$LCTL --net $NETTYPE disconnect"
+
+    run_lst $runlst | tee $log
+    rc=${PIPESTATUS[0]}
+    [ $rc = 0 ] || error "$runlst failed: $rc"
+
+    echo "tcp brw $2:" $(lst_brw_bw $log)
+
+    lst_end_session --verbose | tee -a $log
+    check_lst_err $log
+}
+
+test_socklnd () {
+    [ "$NETTYPE" = tcp ] || { skip "needs NETTYPE=tcp" && return; }
+    local_mode && { skip "needs separate clients and servers" && return; }
+
+    local param=/sys/module/ksocklnd/parameters
+    local tx_batch=$(do_facet ost1 cat $param/tx_batch)
+    local txbuf=$(do_facet ost1 cat $param/tx_buffer_size)
+    local rxbuf=$(do_facet ost1 cat $param/rx_buffer_size)
+    local rsmp=$(do_facet ost1 cat $param/read_sock_min_payload)
+    local runlst=$TMP/socklnd.sh
+    local batch
+    local buf
+    local min
+
+    lst_prepare
+    test_socklnd_sub $lst_SERVERS $lst_CLIENTS > $runlst
+    cat $runlst
+
+    # 1M bulk with check=full received by recvmsg() (0) and by
+    # tcp_read_sock() (the default), with default socket settings
+    for min in 0 $rsmp; do
+        socklnd_set_param read_sock_min_payload $min
+        socklnd_brw_run $runlst "read_sock_min_payload=$min"
+    done
+    socklnd_set_param read_sock_min_payload $rsmp
+
+    # Small socket buffers make most sends partial or fail with EAGAIN,
+    # and split the payload over many small skbs on the receive side.
+    for buf in 0 16384; do
+        for batch in 1 8; do
+            socklnd_set_param tx_batch $batch
+            socklnd_set_param tx_buffer_size $buf
+            socklnd_set_param rx_buffer_size $buf
+            socklnd_brw_run $runlst "tx_batch=$batch sockbuf=$buf"
+        done
+    done
+
+    socklnd_set_param tx_batch $tx_batch
+    socklnd_set_param tx_buffer_size $txbuf
+    socklnd_set_param rx_buffer_size $rxbuf
+    do_nodes $(comma_list $(all_nodes)) "$LCTL --net $NETTYPE disconnect"
+    lst_cleanup_all
+}
+run_test socklnd "lst brw over socklnd: rx path, tx batching, socket buffers"
+
+test_peer_conns () {
+    [ "$NETTYPE" = tcp ] || { skip "needs NETTYPE=tcp" && return; }
+    local_mode && { skip "needs separate clients and servers" && return; }
+
+    local client=$(echo ${CLIENTS:-$HOSTNAME} | cut -d, -f1)
+    local snid=$(do_facet ost1 $LCTL list_nids | grep -m1 "@$NETTYPE$")
+    local runlst=$TMP/peer_conns.sh
+    local row
+
+    lst_prepare
+    test_socklnd_sub $lst_SERVERS $lst_CLIENTS > $runlst
+    socklnd_brw_run $runlst "default"
+
+    # nid conns rtt rttvar txq stall, as seen by the client's socklnd
+    do_node $client cat /proc/sys/lnet/peer_conns
+    row=($(do_node $client cat /proc/sys/lnet/peer_conns |
+           awk '$1 == "'$snid'"'))
+    [ ${#row[@]} = 6 ] || error "no peer_conns entry for $snid on $client"
+    [ ${row[1]} -gt 0 ] || error "no connection to $snid: ${row[*]}"
+    [ ${row[2]} -gt 0 ] || error "no RTT for $snid: ${row[*]}"
+
+    if do_node $client which lnetctl > /dev/null 2>&1; then
+        do_node $client lnetctl peer_conns show |
+            grep -A1 "nid: $snid" | grep -q "conns: [1-9]" ||
+            error "lnetctl peer_conns show has no connection to $snid"
+    fi
+
+    lst_cleanup_all
+}
+run_test peer_conns "socklnd connection stats in peer_conns and lnetctl"
+
+# Small RPCs from all clients at high concurrency: every message takes a
+# trip through lnet_parse() and its sender lookup on the servers
+test_msg_rate () {
+    local_mode && { skip "needs separate clients and servers" && return; }
+
+    local nc=$(echo ${lst_CLIENTS//,/ } | wc -w)
+    local ns=$(echo ${lst_SERVERS//,/ } | wc -w)
+    local runlst=$TMP/msg_rate.sh
+    local log=$TMP/$tfile.log
+    local rc
+
+    lst_prepare
+    {
+        echo '#!/bin/bash'
+        echo 'set -e'
+        echo "$LST new_session --timeo 100000 hh"
+        echo "$LST add_group c $(nids_list $lst_CLIENTS)"
+        echo "$LST add_group s $(nids_list $lst_SERVERS)"
+        echo "$LST add_batch b"
+        echo "$LST add_test --batch b --loop $lst_LOOP --concurrency 64" \
+             "--distribute ${nc}:${ns} --from c --to s ping"
+        echo "$LST add_test --batch b --loop $lst_LOOP --concurrency 64" \
+             "--distribute ${nc}:${ns} --from c --to s brw write size=4k"
+        echo "$LST run b"
+        echo sleep 1
+        echo "$LST stat --delay 10 --count 3 c s"
+    } > $runlst
+    cat $runlst
+
+    run_lst $runlst | tee $log
+    rc=${PIPESTATUS[0]}
+    [ $rc = 0 ] || error "$runlst failed: $rc"
+
+    echo "server RPC rate:" $(lst_rpc_rate $log)
+
+    lst_end_session --verbose | tee -a $log
+    check_lst_err $log
+    lst_cleanup_all
+}
+run_test msg_rate "lst ping and 4k brw rate at high concurrency"
+
+# "<rail> <sent>" for each rail of multi-rail peer $2 on node $1
+peer_rails_of () {
+    do_node $1 cat /proc/sys/lnet/peer_rails |
+        awk '$1 == "'$2'" {
+            for (i = 2; i < NF; i += 2) {
+                gsub(/[()]/, "", $(i + 1)); print $i, $(i + 1)
+            }
+        }'
+}
+
+test_multirail () {
+    local_mode && { skip "needs separate clients and servers" && return; }
+
+    local client=$(echo ${CLIENTS:-$HOSTNAME} | cut -d, -f1)
+    local server=$(facet_active_host ost1)
+    local runlst=$TMP/multirail.sh
+    local log=$TMP/$tfile.log
+    local node
+    local rails
+    local nid
+
+    for node in $client $server; do
+        [ "$(do_node $node cat /sys/module/lnet/parameters/multi_rail)" = 1 ] ||
+            { skip "needs multi_rail=1 on $node" && return; }
+    done
+
+    local cnid=$(do_node $client $LCTL list_nids | grep -m1 "@$NETTYPE$")
+    local snid=$(do_node $server $LCTL list_nids | grep -m1 "@$NETTYPE$")
+
+    # the client stripes to the server's rails given in its peer_rails,
+    # the server has to discover the client's
+    [ $(peer_rails_of $client $snid | wc -l) -ge 2 ] ||
+        { skip "needs peer_rails for $snid on $client" && return; }
+
+    lst_prepare
+    {
+        echo '#!/bin/bash'
+        echo 'set -e'
+        echo "$LST new_session --timeo 100000 mr"
+        echo "$LST add_group c $cnid"
+        echo "$LST add_group s $snid"
+        echo "$LST add_batch b"
+        for t in "brw read" "brw write" ; do
+            echo "$LST add_test --batch b --loop $lst_LOOP --concurrency 8" \
+                 "--from c --to s $t check=full size=1M"
+        done
+        echo "$LST run b"
+        echo sleep 1
+        echo "$LST stat --delay 10 --count 3 c s"
+    } > $runlst
+    cat $runlst
+
+    run_lst $runlst | tee $log
+    [ ${PIPESTATUS[0]} = 0 ] || error "$runlst failed"
+    lst_end_session --verbose | tee -a $log
+    check_lst_err $log
+
+    rails=$(peer_rails_of $server $cnid)
+    echo "$snid rails of $cnid:" $rails
+
+    [ $(echo "$rails" | wc -l) -ge 2 ] ||
+        error "$server discovered no rail of $cnid"
+    # only NIDs the client itself lists may be used
+    for nid in $(echo "$rails" | awk '{ print $1 }'); do
+        do_node $client $LCTL list_nids | grep -qx "$nid" ||
+            error "rail $nid of $cnid isn't a NID of $client"
+    done
+    [ $(echo "$rails" | awk '$2 > 0' | wc -l) -ge 2 ] ||
+        error "$server sent to $cnid on one rail only"
+
+    lst_cleanup_all
+}
+run_test multirail "lst brw between multi-rail peers, rail discovery"
+
+test_profile () {
+    local_mode && { skip "needs separate clients and servers" && return; }
+
+    local nc=$(echo ${lst_CLIENTS//,/ } | wc -w)
+    local ns=$(echo ${lst_SERVERS//,/ } | wc -w)
+    local runlst=$TMP/profile.sh
+    local log=$TMP/$tfile.log
+    local rc
+
+    lst_prepare
+    {
+        echo '#!/bin/bash'
+        echo 'set -e'
+        echo "$LST new_session --timeo 100000 hh"
+        echo "$LST add_group c $(nids_list $lst_CLIENTS)"
+        echo "$LST add_group s $(nids_list $lst_SERVERS)"
+        echo "$LST add_batch b"
+        echo "$LST add_test --batch b --loop $lst_LOOP --concurrency 8" \
+             "--distribute ${nc}:${ns} --from c --to s" \
+             "brw mix=50 size=4K-1M think=100 check=full"
+        echo "$LST run b"
+        echo sleep 10
+        echo "$LST query --test 1 --all b"
+        echo "$LST stat --delay 10 --count 3 c s"
+    } > $runlst
+    cat $runlst
+
+    run_lst $runlst | tee $log
+    rc=${PIPESTATUS[0]}
+    [ $rc = 0 ] || error "$runlst failed: $rc"
+
+    lst_end_session --verbose | tee -a $log
+    check_lst_err $log
+
+    # every client reports the latency percentiles of the test
+    [ $(grep -c "latency p50 [1-9][0-9]*us p99 [1-9]" $log) -ge $nc ] ||
+        error "no latency percentiles from lst query"
+
+    # A session without LST_FEAT_PROFILE (0x2) must refuse a size range
+    export LST_SESSION=$$
+    export LST_FEATURES=1
+    $LST new_session --timeo 100000 noprofile || error "new_session failed"
+    $LST add_group c $(nids_list $lst_CLIENTS)
+    $LST add_group s $(nids_list $lst_SERVERS)
+    $LST add_batch b
+    $LST add_test --batch b --from c --to s brw size=4K-1M &&
+        error "size=4K-1M accepted without LST_FEAT_PROFILE"
+    $LST end_session
+    unset LST_FEATURES
+
+    lst_cleanup_all
+}
+run_test profile "lst brw workload profile and latency percentiles"
+
 complete $SECONDS
 if [ "$RESTORE_MOUNT" = yes ]; then
     setupall
@@ -3059,6 +3059,56 @@ test_87b() {
 }
 run_test 87b "write replay with changed data (checksum resend)"
 
+test_87c() {
+	remote_ost_nodsh && skip "remote OST with nodsh" && return 0
+	$LCTL get_param -n osc.$FSNAME-OST0000-osc-[^M]*.import |
+		grep -q compound ||
+		{ skip "OST_COMPOUND is not supported" && return 0; }
+
+	local nfiles=16
+	local compounds
+	local i
+
+	mkdir -p $DIR/$tdir || error "mkdir $DIR/$tdir failed"
+	$SETSTRIPE -i 0 -c 1 $DIR/$tdir || error "setstripe $DIR/$tdir failed"
+	for ((i = 0; i < nfiles; i++)); do
+		dd if=/dev/zero of=$DIR/$tdir/p$i bs=64k count=4 2>/dev/null ||
+			error "dd to $DIR/$tdir/p$i failed"
+		touch $DIR/$tdir/s$i || error "touch $DIR/$tdir/s$i failed"
+	done
+	sync
+	$LCTL set_param -n osc.*.stats=0
+
+	# drop the first OST_COMPOUND, it is resent after ost1 fails over
+	#define OBD_FAIL_OST_COMPOUND_NET 0x239
+	do_facet ost1 "$LCTL set_param fail_loc=0x80000239"
+	for ((i = 0; i < nfiles; i++)); do
+		$TRUNCATE $DIR/$tdir/p$i $((i * 4096)) &
+		touch -m -d @$((1000000000 + i)) $DIR/$tdir/s$i &
+	done
+	sleep 1
+	fail ost1
+	wait
+	do_facet ost1 "$LCTL set_param fail_loc=0"
+
+	compounds=$($LCTL get_param -n osc.$FSNAME-OST0000-osc-[^M]*.stats |
+		    awk '/^ost_compound/ { print $2 }')
+	[ ${compounds:-0} -gt 0 ] || error "no OST_COMPOUND RPC was sent"
+
+	# check both the cached attributes and those from the OST
+	for pass in cached ost; do
+		for ((i = 0; i < nfiles; i++)); do
+			$CHECKSTAT -s $((i * 4096)) $DIR/$tdir/p$i ||
+				error "$pass: wrong size of p$i"
+			[ $(stat -c %Y $DIR/$tdir/s$i) -eq $((1000000000 + i)) ] ||
+				error "$pass: wrong mtime of s$i"
+		done
+		cancel_lru_locks osc
+	done
+	rm -rf $DIR/$tdir
+}
+run_test 87c "OST_COMPOUND setattr and punch resent across OST failover"
+
 test_88() { #bug 17485
 	mkdir $DIR/$tdir || error "mkdir $DIR/$tdir failed"
 	mkdir -p $TMP/$tdir || error "mkdir $TMP/$tdir failed"
@@ -5508,6 +5508,58 @@ test_64c() {
 }
 run_test 64c "verify grant shrink ========================------"
 
+# grant_stats field $2 of OSC $1
+osc_grant_stat() {
+	$LCTL get_param -n osc.$1.grant_stats | awk "/^$2:/ { print \$2 }"
+}
+
+test_64d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local osc="*OST0000-osc-[^mM]*"
+	$LCTL get_param -n osc.$osc.grant_stats > /dev/null 2>&1 ||
+		{ skip "no osc grant_stats" && return; }
+
+	local interval=$($LCTL get_param -n osc.$osc.grant_shrink_interval)
+	local rpc_bytes=$(($($LCTL get_param -n \
+			   osc.$osc.max_pages_per_rpc) * $(get_page_size client)))
+	local requests=$(osc_grant_stat "$osc" requests)
+	local end
+
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+
+	# dirty pages steadily for a while, so that the dirty rate is
+	# known and grant is asked for ahead of the writes
+	end=$((SECONDS + 6))
+	while [ $SECONDS -lt $end ]; do
+		dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 \
+			conv=notrunc,fsync 2>/dev/null ||
+			error "dd failed"
+	done
+	$LCTL get_param osc.$osc.grant_stats
+	[ $(osc_grant_stat "$osc" requests) -gt $requests ] ||
+		error "no grant requested ahead of the writes"
+	# writers that had to wait for grant or cache space anyway
+	local stalls=$(osc_grant_stat "$osc" stalls)
+	[ -n "$stalls" ] || error "no writer stall count"
+	echo "writer stalls: $stalls," \
+	     "max $(osc_grant_stat "$osc" stall_max_us) us"
+
+	# once idle, the next RPC gives back all but one RPC's worth
+	$LCTL set_param osc.$osc.grant_shrink_interval=1
+	wait_update $HOSTNAME "$LCTL get_param -n osc.$osc.grant_stats |
+		awk '/^dirty_rate:/ { print \$2 }'" 0 10 ||
+		error "dirty rate did not decay while idle"
+	cancel_lru_locks osc
+	cat $DIR/$tfile > /dev/null || error "read failed"
+	local grant=$($LCTL get_param -n osc.$osc.cur_grant_bytes)
+	$LCTL set_param osc.$osc.grant_shrink_interval=$interval
+
+	[ $grant -le $rpc_bytes ] ||
+		error "idle client kept $grant bytes of grant > $rpc_bytes"
+	rm -f $DIR/$tfile
+}
+run_test 64d "grant is requested ahead of writers and returned when idle"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
@@ -8271,6 +8323,55 @@ test_119d() # bug 15950
 }
 run_test 119d "The DIO path should try to send a new rpc once one is completed"
 
+test_119e() {
+	local lean_sav=$($LCTL get_param -n llite.*.lean_dio 2>/dev/null |
+			 head -n 1)
+	[ -z "$lean_sav" ] && skip "no lean DIO support" && return
+
+	local bsize=1048576
+	local count=64
+	local lean
+
+	$SETSTRIPE -c -1 -S $bsize $DIR/$tfile || error "setstripe failed"
+	dd if=/dev/urandom of=$TMP/$tfile bs=$bsize count=$count ||
+		error "create $TMP/$tfile failed"
+
+	for lean in 0 1; do
+		$LCTL set_param -n llite.*.lean_dio=$lean
+		cancel_lru_locks osc
+		clear_osc_stats
+
+		local start=$(date +%s%N)
+		dd if=$TMP/$tfile of=$DIR/$tfile bs=$bsize count=$count \
+			oflag=direct conv=notrunc ||
+			error "DIO write with lean_dio=$lean failed"
+		local mid=$(date +%s%N)
+		dd if=$DIR/$tfile of=$TMP/$tfile.2 bs=$bsize count=$count \
+			iflag=direct || error "DIO read with lean_dio=$lean failed"
+		local end=$(date +%s%N)
+
+		cmp $TMP/$tfile $TMP/$tfile.2 ||
+			error "data mismatch with lean_dio=$lean"
+
+		# bytes sent by RPCs built straight from the user pages
+		local lean_bytes=$(calc_osc_stats lean_dio_bytes)
+		if [ $lean -eq 1 ]; then
+			[ $lean_bytes -gt 0 ] ||
+				error "lean_dio=1 did not use the lean path"
+		else
+			[ $lean_bytes -eq 0 ] ||
+				error "lean_dio=0 sent $lean_bytes lean bytes"
+		fi
+		echo "lean_dio=$lean: write $(((mid - start) / 1000000))ms," \
+		     "read $(((end - mid) / 1000000))ms"
+		rm -f $TMP/$tfile.2
+	done
+
+	$LCTL set_param -n llite.*.lean_dio=$lean_sav
+	rm -f $DIR/$tfile $TMP/$tfile
+}
+run_test 119e "DIO bypassing cl_page returns the same data"
+
 test_120a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
 	remote_mds_nodsh && skip "remote MDS with nodsh" && return
@@ -9926,6 +10027,52 @@ test_150() {
 }
 run_test 150 "truncate/append tests"
 
+test_150b() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local TF="$TMP/$tfile"
+	local psize=$(get_page_size client)
+	local fid
+	local size
+
+	dd if=/dev/urandom of=$TF bs=1M count=2 || error "dd $TF failed"
+	cp $TF $DIR/$tfile || error "cp failed"
+	fid=$($LFS path2fid $DIR/$tfile)
+
+	# unaligned write over many pages: both edge pages are partial and
+	# have to be read in before the pages between them are batched
+	dd if=/dev/urandom of=$TF.patch bs=40000 count=1 ||
+		error "dd $TF.patch failed"
+	dd if=$TF.patch of=$TF bs=40000 count=1 seek=5000 \
+		oflag=seek_bytes conv=notrunc || error "dd patch $TF failed"
+	cancel_lru_locks osc
+	dd if=$TF.patch of=$DIR/$tfile bs=40000 count=1 seek=5000 \
+		oflag=seek_bytes conv=notrunc || error "dd patch failed"
+	cancel_lru_locks osc
+	cmp $TF $DIR/$tfile || error "$TF $DIR/$tfile differ (partial)"
+
+	# short write: write_begin fails on the 9th of 16 pages written
+	# past EOF, after the pages following it were set up in one batch
+	size=$(stat -c %s $DIR/$tfile)
+	#define OBD_FAIL_LLITE_WRITE_BEGIN	0x140d
+	$LCTL set_param fail_val=$((size / psize + 8)) fail_loc=0x140d
+	dd if=/dev/zero of=$DIR/$tfile bs=$((16 * psize)) count=1 \
+		seek=$size oflag=seek_bytes conv=notrunc &&
+		error "write should have failed"
+	$LCTL set_param fail_loc=0 fail_val=0
+
+	(( $(stat -c %s $DIR/$tfile) == size + 8 * psize )) ||
+		error "short write size $(stat -c %s $DIR/$tfile)" \
+		      "!= $((size + 8 * psize))"
+	# no page without data may stay cached with its cl_page
+	$LCTL get_param -n llite.*.dump_page_cache | grep -F "$fid" |
+		grep -v uptodate && error "cached pages without data"
+
+	cancel_lru_locks osc
+	cmp -n $size $TF $DIR/$tfile || error "$TF $DIR/$tfile differ (short)"
+	rm -f $TF $TF.patch $DIR/$tfile
+}
+run_test 150b "buffered write batching: partial pages and short write"
+
 #LU-2902 roc_hit was not able to read all values from lproc
 function roc_hit_init() {
 	local list=$(comma_list $(osts_nodes))
@@ -13624,6 +13771,59 @@ test_234() {
 }
 run_test 234 "xattr cache should not crash on ENOMEM"
 
+test_234b() {
+	local mode=$(getenforce 2>/dev/null)
+	[ -z "$mode" -o "$mode" = "Disabled" ] &&
+		skip "SELinux is disabled" && return
+
+	local p="$TMP/sanity-$TESTNAME.parameters"
+	save_lustre_params client "llite.*.xattr_cache" > $p
+	lctl set_param llite.*.xattr_cache 1 ||
+		{ skip "xattr cache is not supported"; return 0; }
+
+	mkdir -p $DIR/$tdir || error "mkdir failed"
+	touch $DIR/$tdir/$tfile.ref || error "touch $tfile.ref failed"
+	local ctx=$(stat -c %C $DIR/$tdir/$tfile.ref)
+	[ -n "$ctx" ] || error "no security context on $tfile.ref"
+
+	# create a file without a label, so that security.selinux
+	# is absent from the MDT reply and gets a negative entry
+	#define OBD_FAIL_LLITE_NO_SECURITY_INIT	0x140c
+	$LCTL set_param fail_loc=0x140c
+	touch $DIR/$tdir/$tfile
+	local rc=$?
+	$LCTL set_param fail_loc=0
+	[ $rc -eq 0 ] || error "touch $tfile failed"
+
+	debugsave
+	lctl set_param debug=+cache
+
+	cancel_lru_locks mdc
+	$LCTL clear
+	getfattr -n trusted.nosuch $DIR/$tdir/$tfile 2>/dev/null &&
+		error "getfattr trusted.nosuch should fail"
+	$LCTL dk | grep -q "set negative: \[security.selinux\]" ||
+		error "no negative security.selinux entry cached"
+
+	# setxattr revokes the XATTR lock, the refill must see the label
+	setfattr -n security.selinux -v "$ctx" $DIR/$tdir/$tfile ||
+		error "setfattr security.selinux failed"
+	$LCTL clear
+	getfattr -n trusted.nosuch $DIR/$tdir/$tfile 2>/dev/null &&
+		error "getfattr trusted.nosuch should fail"
+	local log=$($LCTL dk)
+	echo "$log" | grep -q "set negative: \[security.selinux\]" &&
+		error "stale negative security.selinux entry after setxattr"
+	echo "$log" | grep -q "caching \[security.selinux\]" ||
+		error "security.selinux not cached after setxattr"
+
+	debugrestore
+	rm -rf $DIR/$tdir
+	restore_lustre_params < $p
+	rm -f $p
+}
+run_test 234b "setxattr invalidates a negative xattr cache entry"
+
 test_235() {
 	[ $(lustre_version_code $SINGLEMDS) -lt $(version_code 2.4.52) ] &&
 		skip "Need MDS version at least 2.4.52" && return
@@ -15852,6 +16052,50 @@ test_408() {
 }
 run_test 408 "drop_caches should not hang due to page leaks"
 
+test_409() {
+	local map=$(do_facet ost1 $LCTL get_param -n ost.OSS.ost_io.rqbd_cpt_map)
+
+	[ -z "$map" ] && skip "no rqbd_cpt_map on ost1" && return
+	echo "$map"
+
+	# every partition has buffers, and its home is a CPT which is its own
+	# home, i.e. one an NI receives on
+	echo "$map" | awk 'NR > 1 { part[$1] = $2; bufs[$1] = $3 }
+		END { for (p in part) {
+			if (bufs[p] <= 0)
+				{ print "partition " p " has no buffers"; exit 1 }
+			if ((part[p] in part) && part[part[p]] != part[p])
+				{ print "partition " p " home " part[p] \
+					" is not an NI CPT"; exit 1 }
+		} }' || error "bad request buffer CPT map"
+}
+run_test 409 "service partitions post buffers on NI CPTs"
+
+test_410() {
+	local param=mds.MDS.mdt.stats
+
+	test_mkdir $DIR/$tdir
+	do_facet $SINGLEMDS $LCTL set_param -n $param=0
+	createmany -o $DIR/$tdir/f 1000 || error "createmany failed"
+	unlinkmany $DIR/$tdir/f 1000 || error "unlinkmany failed"
+	sync
+
+	local stats=$(do_facet $SINGLEMDS $LCTL get_param -n $param)
+	echo "$stats" | grep -E "^rep_(batch|waittime)"
+
+	local nwait=$(echo "$stats" | awk '/^rep_waittime/ { print $2 }')
+	local sum=$(echo "$stats" | awk '/^rep_waittime/ { print $7 }')
+
+	[ -z "$nwait" ] && skip "no difficult replies handled" && return
+	echo "$stats" | grep -q "^rep_batch" || error "no rep_batch stats"
+
+	# replies are handled as soon as an hr thread is woken, they are not
+	# held back to fill a batch
+	(( sum / nwait < 1000 )) ||
+		error "replies waited $((sum / nwait))us on average"
+}
+run_test 410 "reply handling batches without added latency"
+
 #
 # tests that do cleanup/setup should be run at the end
 #
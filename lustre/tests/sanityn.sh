@@ -3323,6 +3323,259 @@ test_77i() {
 }
 run_test 77i "Change rank of TBF rule"
 
+edf_class_operate()
+{
+	local facet=$1
+	shift 1
+
+	do_facet $facet lctl set_param \
+		ost.OSS.ost_io.nrs_edf_class="$*"
+	[ $? -ne 0 ] &&
+		error "failed to run operate '$*' on EDF classes"
+}
+
+# sum of the RPCs started from EDF class $2 over all CPTs of $1
+edf_class_started()
+{
+	local facet=$1
+	local class=$2
+
+	do_facet $facet lctl get_param -n ost.OSS.ost_io.nrs_edf_class |
+		awk '$1 == "'$class'" {
+			for (i = 2; i <= NF; i++)
+				if (sub("^started=", "", $i))
+					sum += $i
+		} END { print sum + 0 }'
+}
+
+test_77j() {
+	oss=$(comma_list $(osts_nodes))
+
+	# Configure jobid_var
+	local saved_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" procname_uid
+	fi
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="edf"
+	[ $? -ne 0 ] && error "failed to set EDF policy"
+
+	# Only operate classes on ost1 since OSTs might run on the same OSS
+	edf_class_operate ost1 "start\ dd_runas\ jobid=dd.$RUNAS_ID\ type=io\ deadline=50\ rate=1000"
+	edf_class_operate ost1 "start\ meta\ type=meta\ deadline=200"
+
+	# Bad classes must be refused
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_edf_class="start\ bad\ deadline=0"
+	[ $? -eq 0 ] && error "class with a zero deadline should be refused"
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_edf_class="change\ meta\ type=io"
+	[ $? -eq 0 ] && error "changing the type of a class should be refused"
+
+	nrs_write_read "$RUNAS"
+	do_facet ost1 lctl get_param ost.OSS.ost_io.nrs_edf_class
+	[ $(edf_class_started ost1 dd_runas) -gt 0 ] ||
+		error "no RPC handled from EDF class dd_runas"
+
+	# The same I/O classified by the uid of the files it writes
+	edf_class_operate ost1 "stop\ dd_runas"
+	edf_class_operate ost1 "start\ runas_uid\ uid=$RUNAS_ID\ type=io\ deadline=100"
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_edf_class="start\ bad\ uid=abc"
+	[ $? -eq 0 ] && error "class with a bad uid should be refused"
+
+	nrs_write_read "$RUNAS"
+	do_facet ost1 lctl get_param ost.OSS.ost_io.nrs_edf_class
+	[ $(edf_class_started ost1 runas_uid) -gt 0 ] ||
+		error "no RPC handled from EDF class runas_uid"
+
+	# Change the classes
+	edf_class_operate ost1 "change\ runas_uid\ deadline=10\ rate=100"
+	edf_class_operate ost1 "change\ meta\ rate=50"
+	nrs_write_read "$RUNAS"
+
+	# Stop the classes
+	edf_class_operate ost1 "stop\ runas_uid"
+	edf_class_operate ost1 "stop\ meta"
+	nrs_write_read "$RUNAS"
+
+	# Cleanup the EDF policy
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+	[ $? -ne 0 ] && error "failed to set policy back to fifo"
+	nrs_write_read "$RUNAS"
+
+	local current_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != $current_jobid_var ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" $saved_jobid_var
+	fi
+	return 0
+}
+run_test 77j "check EDF nrs policy"
+
+# clients of TBF rule $2 on $1 summed over all CPTs, see "ref" in its dump
+tbf_rule_ref()
+{
+	local facet=$1
+	local rule=$2
+
+	do_facet $facet lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		awk '$1 == "'$rule'" { sum += $NF } END { print sum + 0 }'
+}
+
+test_77k() {
+	oss=$(comma_list $(osts_nodes))
+
+	# Configure jobid_var
+	local saved_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" procname_uid
+	fi
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="tbf\ generic"
+	[ $? -ne 0 ] && error "failed to set TBF policy"
+
+	# Malformed conditions must be refused
+	local bad
+	for bad in "opcode={no_such_op}" "uid={abc}" "gid={}" "foo={1}"; do
+		do_facet ost1 lctl set_param \
+			ost.OSS.ost_io.nrs_tbf_rule="start\ bad\ $bad\ rate=100"
+		[ $? -eq 0 ] && error "rule with '$bad' should be refused"
+	done
+
+	# Only operate rules on ost1 since OSTs might run on the same OSS
+	# Add some rules, each one over a different field. The newest rule
+	# is matched first.
+	tbf_rule_operate ost1 "start\ others\ nid={*.*.*.*@$NETTYPE}\ rate=100"
+	tbf_rule_operate ost1 "start\ dd_runas\ jobid={dd.$RUNAS_ID},nid={0@lo}\ rate=500"
+	tbf_rule_operate ost1 "start\ runas_rd\ opcode={ost_read}\&gid={$RUNAS_GID}\ rate=1000"
+	tbf_rule_operate ost1 "start\ runas_wr\ opcode={ost_write}\&uid={$RUNAS_ID}\ rate=1000"
+	nrs_write_read "$RUNAS"
+	do_facet ost1 lctl get_param ost.OSS.ost_io.nrs_tbf_rule
+	[ $(tbf_rule_ref ost1 runas_wr) -gt 0 ] ||
+		error "no client matched the opcode and uid rule"
+
+	# Change the rules
+	tbf_rule_operate ost1 "change\ runas_wr\ rate=1001"
+	tbf_rule_operate ost1 "change\ runas_rd\ rate=1001"
+	tbf_rule_operate ost1 "change\ dd_runas\ rate=501"
+	tbf_rule_operate ost1 "change\ others\ rate=101"
+	nrs_write_read "$RUNAS"
+
+	# Stop the rules
+	tbf_rule_operate ost1 "stop\ runas_wr"
+	tbf_rule_operate ost1 "stop\ runas_rd"
+	tbf_rule_operate ost1 "stop\ dd_runas"
+	tbf_rule_operate ost1 "stop\ others"
+	nrs_write_read "$RUNAS"
+
+	# Cleanup the TBF policy
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+	[ $? -ne 0 ] && error "failed to set policy back to fifo"
+	nrs_write_read "$RUNAS"
+
+	local current_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != $current_jobid_var ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" $saved_jobid_var
+	fi
+	return 0
+}
+run_test 77k "check TBF generic nrs policy"
+
+# ceiling of TBF child rule $2 on $1, from the "parent" line of its dump
+tbf_rule_ceil()
+{
+	local facet=$1
+	local rule=$2
+
+	do_facet $facet lctl get_param -n ost.OSS.ost_io.nrs_tbf_rule |
+		awk '$1 == "'$rule'" { found = 1; next }
+		     found && $1 == "parent" { print $NF; exit }
+		     { found = 0 }'
+}
+
+test_77l() {
+	oss=$(comma_list $(osts_nodes))
+
+	# Configure jobid_var
+	local saved_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" procname_uid
+	fi
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="tbf\ jobid"
+	[ $? -ne 0 ] && error "failed to set TBF policy"
+
+	# Only operate rules on ost1 since OSTs might run on the same OSS
+	tbf_rule_operate ost1 "start\ proj1\ jobid={none}\ rate=1000"
+
+	# Bad hierarchies must be refused
+	local bad
+	for bad in "rate=100\ parent=proj1\ ceil=50" "rate=100\ ceil=800" \
+		   "rate=100\ parent=no_such_rule"; do
+		do_facet ost1 lctl set_param \
+			ost.OSS.ost_io.nrs_tbf_rule="start\ bad\ jobid={dd.$RUNAS_ID}\ $bad"
+		[ $? -eq 0 ] && error "rule with '$bad' should be refused"
+	done
+
+	tbf_rule_operate ost1 "start\ dd_runas\ jobid={dd.$RUNAS_ID}\ rate=100\ parent=proj1\ ceil=800"
+	[ "$(tbf_rule_ceil ost1 dd_runas)" = 800 ] ||
+		error "dd_runas should have a ceiling of 800"
+
+	# The ceiling defaults to the parent's rate, but not below the rule's
+	tbf_rule_operate ost1 "start\ iozone_runas\ jobid={iozone.$RUNAS_ID}\ rate=2000\ parent=proj1"
+	[ "$(tbf_rule_ceil ost1 iozone_runas)" = 2000 ] ||
+		error "iozone_runas should have a ceiling of 2000"
+	nrs_write_read "$RUNAS"
+
+	# Change the rules, keeping the ceilings above the rates
+	tbf_rule_operate ost1 "change\ dd_runas\ ceil=500"
+	[ "$(tbf_rule_ceil ost1 dd_runas)" = 500 ] ||
+		error "dd_runas should have a ceiling of 500"
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="change\ dd_runas\ ceil=50"
+	[ $? -eq 0 ] && error "ceiling below the rate should be refused"
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="change\ dd_runas\ rate=900"
+	[ $? -eq 0 ] && error "rate above the ceiling should be refused"
+	tbf_rule_operate ost1 "change\ dd_runas\ rate=400\ ceil=900"
+	tbf_rule_operate ost1 "change\ proj1\ rate=500"
+	nrs_write_read "$RUNAS"
+
+	# A parent can't go before its children
+	do_facet ost1 lctl set_param \
+		ost.OSS.ost_io.nrs_tbf_rule="stop\ proj1"
+	[ $? -eq 0 ] && error "rule with children should not be stopped"
+
+	# Stop the rules
+	tbf_rule_operate ost1 "stop\ dd_runas"
+	tbf_rule_operate ost1 "stop\ iozone_runas"
+	tbf_rule_operate ost1 "stop\ proj1"
+	nrs_write_read "$RUNAS"
+
+	# Cleanup the TBF policy
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+	[ $? -ne 0 ] && error "failed to set policy back to fifo"
+
+	local current_jobid_var=$($LCTL get_param -n jobid_var)
+	if [ $saved_jobid_var != $current_jobid_var ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" $saved_jobid_var
+	fi
+	return 0
+}
+run_test 77l "check hierarchical TBF rules"
+
 test_78() { #LU-6673
 	local rc
 
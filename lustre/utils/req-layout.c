@@ -116,6 +116,7 @@
 #define lustre_swab_lfsck_reply NULL
 #define lustre_swab_ladvise_hdr NULL
 #define lustre_swab_ladvise NULL
+#define lustre_swab_ost_compound_op NULL
 
 /*
  * Yes, include .c file.
@@ -578,6 +578,7 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_OBDOPACK);
 	CHECK_DEFINE_64X(OBD_CONNECT_FLAGS2);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FILE_SECCTX);
+	CHECK_DEFINE_64X(OBD_CONNECT2_COMPOUND);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -683,6 +684,7 @@ check_obdo(void)
 	CHECK_CVALUE_X(OBD_FL_NOSPC_BLK);
 	CHECK_CVALUE_X(OBD_FL_FLUSH);
 	CHECK_CVALUE_X(OBD_FL_SHORT_IO);
+	CHECK_CVALUE_X(OBD_FL_GRANT_REQUEST);
 	CHECK_CVALUE_X(OBD_FL_LOCAL_MASK);
 }
 
@@ -930,6 +932,17 @@ check_ost_body(void)
 	CHECK_MEMBER(ost_body, oa);
 }
 
+static void
+check_ost_compound_op(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(ost_compound_op);
+	CHECK_MEMBER(ost_compound_op, oco_opc);
+	CHECK_MEMBER(ost_compound_op, oco_rc);
+	CHECK_MEMBER(ost_compound_op, oco_body);
+	CHECK_CDEFINE(OST_COMPOUND_MAX_OPS);
+}
+
 static void
 check_ll_fid(void)
 {
@@ -2434,6 +2447,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(OST_QUOTACTL);
 	CHECK_VALUE(OST_QUOTA_ADJUST_QUNIT);
 	CHECK_VALUE(OST_LADVISE);
+	CHECK_VALUE(OST_COMPOUND);
 	CHECK_VALUE(OST_LAST_OPC);
 
 	CHECK_DEFINE_64X(OBD_OBJECT_EOF);
@@ -2646,6 +2660,7 @@ main(int argc, char **argv)
 	check_obd_idx_read();
 	check_niobuf_remote();
 	check_ost_body();
+	check_ost_compound_op();
 	check_ll_fid();
 	check_mdt_body();
 	check_mdt_ioepoch();
@@ -117,7 +117,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)OST_QUOTA_ADJUST_QUNIT);
 	LASSERTF(OST_LADVISE == 21, "found %lld\n",
 		 (long long)OST_LADVISE);
-	LASSERTF(OST_LAST_OPC == 22, "found %lld\n",
+	LASSERTF(OST_COMPOUND == 22, "found %lld\n",
+		 (long long)OST_COMPOUND);
+	LASSERTF(OST_LAST_OPC == 23, "found %lld\n",
 		 (long long)OST_LAST_OPC);
 	LASSERTF(OBD_OBJECT_EOF == 0xffffffffffffffffULL, "found 0x%.16llxULL\n",
 		 OBD_OBJECT_EOF);
@@ -1219,6 +1221,8 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT_FLAGS2);
 	LASSERTF(OBD_CONNECT2_FILE_SECCTX == 0x1ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_FILE_SECCTX);
+	LASSERTF(OBD_CONNECT2_COMPOUND == 0x2ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_COMPOUND);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -1439,6 +1443,7 @@ void lustre_assert_wire_constants(void)
 	CLASSERT(OBD_FL_NOSPC_BLK == 0x00100000);
 	CLASSERT(OBD_FL_FLUSH == 0x00200000);
 	CLASSERT(OBD_FL_SHORT_IO == 0x00400000);
+	CLASSERT(OBD_FL_GRANT_REQUEST == 0x00800000);
 	CLASSERT(OBD_FL_LOCAL_MASK == 0xf0000000);
 
 	/* Checks for struct lov_ost_data_v1 */
@@ -1976,6 +1981,23 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct ost_body *)0)->oa) == 208, "found %lld\n",
 		 (long long)(int)sizeof(((struct ost_body *)0)->oa));
 
+	/* Checks for struct ost_compound_op */
+	LASSERTF((int)sizeof(struct ost_compound_op) == 216, "found %lld\n",
+		 (long long)(int)sizeof(struct ost_compound_op));
+	LASSERTF((int)offsetof(struct ost_compound_op, oco_opc) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compound_op, oco_opc));
+	LASSERTF((int)sizeof(((struct ost_compound_op *)0)->oco_opc) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compound_op *)0)->oco_opc));
+	LASSERTF((int)offsetof(struct ost_compound_op, oco_rc) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compound_op, oco_rc));
+	LASSERTF((int)sizeof(((struct ost_compound_op *)0)->oco_rc) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compound_op *)0)->oco_rc));
+	LASSERTF((int)offsetof(struct ost_compound_op, oco_body) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct ost_compound_op, oco_body));
+	LASSERTF((int)sizeof(((struct ost_compound_op *)0)->oco_body) == 208, "found %lld\n",
+		 (long long)(int)sizeof(((struct ost_compound_op *)0)->oco_body));
+	CLASSERT(OST_COMPOUND_MAX_OPS == 32);
+
 	/* Checks for struct ll_fid */
 	LASSERTF((int)sizeof(struct ll_fid) == 16, "found %lld\n",
 		 (long long)(int)sizeof(struct ll_fid));